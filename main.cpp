@@ -5,10 +5,16 @@
 #include "senjo/UCIAdapter.h"
 #include "senjo/Output.h"
 #include "Bitfoot.h"
+#include "Commands.h"
 
 //----------------------------------------------------------------------------
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
+  // anything else on the command line is ignored, as it always was
+  if ((argc > 1) && bitfoot::IsCommand(argv[1])) {
+    return bitfoot::RunCommand(argc, argv);
+  }
+
   bitfoot::Bitfoot engine;
   senjo::UCIAdapter adapter;
 
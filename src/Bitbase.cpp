@@ -0,0 +1,971 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Output.h"
+#include "senjo/Platform.h"
+#include "senjo/Threading.h"
+#include "Bitbase.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+
+#ifdef WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static const char     _MAGIC[4]    = { 'B', 'F', 'B', '1' };
+static const char     _NAMES[]     = "..PPNNBBRRQQKK";
+static const int      _TYPES[]     = { Queen, Rook, Bishop, Knight, Pawn };
+static const int      _KEY_SIZE    = 59049; // 3^10, up to 2 of each piece
+static const uint64_t _BLOCK_SIZE  = 4096;  // entries per work unit
+static const int      _MAX_MOVES   = 128;
+
+//----------------------------------------------------------------------------
+// king, knight, and between-squares bitmaps and the 10 squares the strong
+// king is mapped into for tables without pawns (a1-d1-d4)
+//----------------------------------------------------------------------------
+static struct Geometry {
+  Geometry() {
+    int n = 0;
+    for (int sqr = A1; sqr <= H8; ++sqr) {
+      triangle[sqr] = -1;
+      if ((XC(sqr) < 4) && (YC(sqr) <= XC(sqr))) {
+        triangle[sqr] = n;
+        triangleSqr[n++] = sqr;
+      }
+      kingAtk[sqr] = knightAtk[sqr] = 0;
+      for (int to = A1; to <= H8; ++to) {
+        const int dx = abs(XC(to) - XC(sqr));
+        const int dy = abs(YC(to) - YC(sqr));
+        if (std::max<int>(dx, dy) == 1) {
+          kingAtk[sqr] |= BIT(to);
+        }
+        if ((dx * dy) == 2) {
+          knightAtk[sqr] |= BIT(to);
+        }
+        between[sqr][to] = 0;
+        if ((sqr != to) && (!dx || !dy || (dx == dy))) {
+          const int sx = ((XC(to) > XC(sqr)) - (XC(to) < XC(sqr)));
+          const int sy = ((YC(to) > YC(sqr)) - (YC(to) < YC(sqr)));
+          for (int s = (sqr + sx + (8 * sy)); s != to; s += (sx + (8 * sy))) {
+            between[sqr][to] |= BIT(s);
+          }
+        }
+      }
+    }
+  }
+
+  int      triangle[64];
+  int      triangleSqr[10];
+  uint64_t kingAtk[64];
+  uint64_t knightAtk[64];
+  uint64_t between[64][64];
+} _geo;
+
+//----------------------------------------------------------------------------
+static inline int Transpose(const int sqr)
+{
+  return ((8 * XC(sqr)) + YC(sqr));
+}
+
+//----------------------------------------------------------------------------
+// does 'piece' on 'from' attack 'to' with the given board occupancy?
+//----------------------------------------------------------------------------
+static bool Attacks(const int piece, const int from, const int to,
+                    const uint64_t occ)
+{
+  const int dx = (XC(to) - XC(from));
+  const int dy = (YC(to) - YC(from));
+  switch (piece & ~ColorMask) {
+  case Pawn:
+    return ((abs(dx) == 1) && (dy == (COLOR_OF(piece) ? -1 : 1)));
+  case Knight:
+    return (_geo.knightAtk[from] & BIT(to));
+  case Bishop:
+    return ((abs(dx) == abs(dy)) && dx && !(_geo.between[from][to] & occ));
+  case Rook:
+    return ((!dx != !dy) && !(_geo.between[from][to] & occ));
+  case Queen:
+    return ((!dx || !dy || (abs(dx) == abs(dy))) && (dx || dy) &&
+            !(_geo.between[from][to] & occ));
+  case King:
+    return (_geo.kingAtk[from] & BIT(to));
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// empty squares a non-pawn piece on 'from' can move to
+//----------------------------------------------------------------------------
+static uint64_t Targets(const int piece, const int from, const uint64_t occ)
+{
+  static const int dirs[8][2] = {
+    { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+    { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 }
+  };
+
+  uint64_t targets = 0;
+  const int type = (piece & ~ColorMask);
+  switch (type) {
+  case Knight:
+    return _geo.knightAtk[from];
+  case King:
+    return _geo.kingAtk[from];
+  case Bishop:
+  case Rook:
+  case Queen:
+    for (int d = ((type == Bishop) ? 4 : 0);
+         d < ((type == Rook) ? 4 : 8); ++d)
+    {
+      int x = XC(from);
+      int y = YC(from);
+      while (true) {
+        x += dirs[d][0];
+        y += dirs[d][1];
+        if ((x < 0) || (x > 7) || (y < 0) || (y > 7)) {
+          break;
+        }
+        targets |= BIT(SQR(x, y));
+        if (occ & BIT(SQR(x, y))) {
+          break;
+        }
+      }
+    }
+    break;
+  }
+  return targets;
+}
+
+//----------------------------------------------------------------------------
+// one material signature
+//
+// Slot 0 is the white (stronger side's) king, slot 1 the black king, then
+// white's pieces and black's pieces, each by descending piece type.  An
+// index is (king slot 0, squares of the other slots, side to move) with
+// the board mirrored so the white king is on files a-d, and for tables
+// without pawns also ranks 1-4 below the a1-h8 diagonal.  Identical
+// pieces are kept in ascending square order, so every position has
+// exactly one index.
+//----------------------------------------------------------------------------
+struct Bitbases::Table
+{
+  explicit Table(const std::string& signature);
+
+  int Get(const uint64_t index) const {
+    return ((values[index / 4] >> (2 * (index & 3))) & 3);
+  }
+
+  uint64_t Index(const int* squares, const int colorToMove) const;
+  void Decode(uint64_t index, int* squares, int& colorToMove) const;
+
+  std::string          name;
+  int                  count;
+  int                  pieces[MaxPieces];
+  int                  range[MaxPieces];
+  int                  offset[MaxPieces];
+  bool                 pawns;
+  uint64_t             entries;
+  std::vector<uint8_t> owned;  // values of a generated table
+  RecordReader         file;   // values of a loaded table
+  const uint8_t*       values;
+
+private:
+  uint64_t Encode(int* squares, const int colorToMove) const;
+};
+
+//----------------------------------------------------------------------------
+Bitbases::Table::Table(const std::string& signature)
+  : name(signature),
+    count(0),
+    pawns(false),
+    entries(2),
+    values(NULL)
+{
+  // "KQKR" -> WhiteKing, BlackKing, WhiteQueen, BlackRook
+  pieces[count++] = WhiteKing;
+  pieces[count++] = BlackKing;
+  int color = White;
+  for (size_t i = 1; i < name.size(); ++i) {
+    if (name[i] == 'K') {
+      color = Black;
+      continue;
+    }
+    const int type = static_cast<int>(strchr(_NAMES, name[i]) - _NAMES);
+    pieces[count++] = (type | color);
+    pawns |= (type == Pawn);
+  }
+
+  range[0] = (pawns ? 32 : 10);
+  offset[0] = 0;
+  entries *= range[0];
+  for (int i = 1; i < count; ++i) {
+    const bool pawn = ((pieces[i] & ~ColorMask) == Pawn);
+    range[i] = (pawn ? 48 : 64);
+    offset[i] = (pawn ? 8 : 0);
+    entries *= range[i];
+  }
+}
+
+//----------------------------------------------------------------------------
+uint64_t Bitbases::Table::Encode(int* squares, const int colorToMove) const
+{
+  for (int i = 3; i < count; ++i) {
+    if ((pieces[i] == pieces[i - 1]) && (squares[i] < squares[i - 1])) {
+      std::swap(squares[i], squares[i - 1]);
+    }
+  }
+  uint64_t index = (pawns ? ((4 * YC(squares[0])) + XC(squares[0]))
+                          : _geo.triangle[squares[0]]);
+  for (int i = 1; i < count; ++i) {
+    index = ((index * range[i]) + (squares[i] - offset[i]));
+  }
+  return ((index * 2) + colorToMove);
+}
+
+//----------------------------------------------------------------------------
+uint64_t Bitbases::Table::Index(const int* squares,
+                                const int colorToMove) const
+{
+  int sqr[MaxPieces];
+  memcpy(sqr, squares, (count * sizeof(int)));
+
+  const int flip = (((XC(sqr[0]) > 3) ? 7 : 0) |
+                    ((!pawns && (YC(sqr[0]) > 3)) ? 56 : 0));
+  for (int i = 0; flip && (i < count); ++i) {
+    sqr[i] ^= flip;
+  }
+  if (pawns) {
+    return Encode(sqr, colorToMove);
+  }
+
+  if (YC(sqr[0]) > XC(sqr[0])) {
+    for (int i = 0; i < count; ++i) {
+      sqr[i] = Transpose(sqr[i]);
+    }
+  }
+  else if (YC(sqr[0]) == XC(sqr[0])) {
+    // both ways round are in the triangle, use the lower index
+    int alt[MaxPieces];
+    for (int i = 0; i < count; ++i) {
+      alt[i] = Transpose(sqr[i]);
+    }
+    return std::min<uint64_t>(Encode(sqr, colorToMove),
+                              Encode(alt, colorToMove));
+  }
+  return Encode(sqr, colorToMove);
+}
+
+//----------------------------------------------------------------------------
+void Bitbases::Table::Decode(uint64_t index, int* squares,
+                             int& colorToMove) const
+{
+  colorToMove = static_cast<int>(index & 1);
+  index /= 2;
+  for (int i = (count - 1); i > 0; --i) {
+    squares[i] = (static_cast<int>(index % range[i]) + offset[i]);
+    index /= range[i];
+  }
+  squares[0] = (pawns ? SQR((index % 4), (index / 4))
+                      : _geo.triangleSqr[index]);
+}
+
+//----------------------------------------------------------------------------
+// every signature with up to MaxPieces pieces, ordered so the tables a
+// table's captures and promotions lead to come before it
+//----------------------------------------------------------------------------
+static std::vector<std::string> AllSignatures()
+{
+  std::vector<std::string> names;
+  for (int i = 0; i < 5; ++i) {
+    names.push_back(std::string("K") + _NAMES[_TYPES[i]] + "K");
+  }
+  for (int pawns = 0; pawns <= 2; ++pawns) {
+    for (int i = 0; i < 5; ++i) {
+      for (int k = i; k < 5; ++k) {
+        const char x = _NAMES[_TYPES[i]];
+        const char y = _NAMES[_TYPES[k]];
+        if (((x == 'P') + (y == 'P')) == pawns) {
+          names.push_back(std::string("K") + x + y + "K");
+          names.push_back(std::string("K") + x + "K" + y);
+        }
+      }
+    }
+  }
+  return names;
+}
+
+//----------------------------------------------------------------------------
+// material key of a list of pieces, kings are ignored
+//----------------------------------------------------------------------------
+static int MaterialKey(const int count, const int* pieces)
+{
+  static const int pow3[10] = {
+    1, 3, 9, 27, 81, 243, 729, 2187, 6561, 19683
+  };
+  int key = 0;
+  for (int i = 0; i < count; ++i) {
+    if ((pieces[i] & ~ColorMask) != King) {
+      key += pow3[pieces[i] - WhitePawn];
+    }
+  }
+  return key;
+}
+
+//----------------------------------------------------------------------------
+Bitbases::Bitbases()
+  : lookup(_KEY_SIZE, -1)
+{
+}
+
+//----------------------------------------------------------------------------
+Bitbases::~Bitbases()
+{
+  for (size_t i = 0; i < tables.size(); ++i) {
+    delete tables[i];
+  }
+  tables.clear();
+}
+
+//----------------------------------------------------------------------------
+size_t Bitbases::TableCount() const
+{
+  return tables.size();
+}
+
+//----------------------------------------------------------------------------
+bool Bitbases::Add(Table* table)
+{
+  int flipped[MaxPieces];
+  for (int i = 0; i < table->count; ++i) {
+    flipped[i] = (table->pieces[i] ^ ColorMask);
+  }
+  const int key = MaterialKey(table->count, table->pieces);
+  const int flipKey = MaterialKey(table->count, flipped);
+  const int id = static_cast<int>(tables.size());
+  tables.push_back(table);
+  lookup[flipKey] = ((2 * id) + 1);
+  lookup[key] = (2 * id);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Bitbases::Load(const std::string& dir)
+{
+  const std::vector<std::string> names = AllSignatures();
+  for (size_t i = 0; i < names.size(); ++i) {
+    Table* table = new Table(names[i]);
+    const std::string path = (dir + '/' + names[i] + ".bfb");
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+      delete table;
+      continue;
+    }
+    fclose(fp);
+
+    const uint64_t bytes = ((table->entries + 3) / 4);
+    uint32_t entries = 0;
+    const uint8_t* data = NULL;
+    if (table->file.Open(path, 1) && (table->file.Count() == (8 + bytes))) {
+      data = static_cast<const uint8_t*>(table->file.Get(0));
+      memcpy(&entries, (data + 4), sizeof(entries));
+    }
+    if (!data || memcmp(data, _MAGIC, 4) || (entries != table->entries)) {
+      Output() << "Invalid bitbase file: " << path;
+      delete table;
+      continue;
+    }
+    table->values = (data + 8);
+    Add(table);
+  }
+  return !tables.empty();
+}
+
+//----------------------------------------------------------------------------
+Bitbases::Result Bitbases::Probe(const int count, const int* pieces,
+                                 const int* squares,
+                                 const int colorToMove) const
+{
+  if (count <= 2) {
+    return (count == 2) ? Draw : NotFound;
+  }
+  if (count > MaxPieces) {
+    return NotFound;
+  }
+
+  const int entry = lookup[MaterialKey(count, pieces)];
+  if (entry < 0) {
+    return NotFound;
+  }
+  const Table& table = *tables[entry / 2];
+  const int flip = (entry & 1);
+  if (!table.values) {
+    return NotFound;
+  }
+
+  // put the pieces into table order, black becomes white when flipped
+  int sqr[MaxPieces];
+  int used = 0;
+  for (int slot = 0; slot < count; ++slot) {
+    int i = 0;
+    while ((i < count) &&
+           ((used & (1 << i)) || ((pieces[i] ^ flip) != table.pieces[slot])))
+    {
+      i++;
+    }
+    if (i >= count) {
+      return NotFound;
+    }
+    used |= (1 << i);
+    sqr[slot] = (flip ? (squares[i] ^ 56) : squares[i]);
+  }
+
+  return static_cast<Result>(
+      table.Get(table.Index(sqr, (colorToMove ^ flip))));
+}
+
+//----------------------------------------------------------------------------
+static senjo::Mutex _openLock;
+static std::map<std::string, std::weak_ptr<const Bitbases> > _open;
+
+//----------------------------------------------------------------------------
+std::shared_ptr<const Bitbases> Bitbases::Open(const std::string& dir)
+{
+  std::shared_ptr<const Bitbases> bitbases;
+  _openLock.Lock();
+  bitbases = _open[dir].lock();
+  if (!bitbases) {
+    std::shared_ptr<Bitbases> loaded(new Bitbases());
+    if (loaded->Load(dir)) {
+      bitbases = loaded;
+      _open[dir] = bitbases;
+    }
+  }
+  _openLock.Unlock();
+  return bitbases;
+}
+
+//----------------------------------------------------------------------------
+// retrograde analysis of one table
+//
+// Every position is first scored by looking at its moves, then only the
+// positions with a move into a position scored in the previous pass are
+// scored again, until a pass scores nothing new.  A position is a win as
+// soon as one move leads to a loss for the other side, a loss or draw
+// once every move leads to a known result.  Anything left is a draw.
+//----------------------------------------------------------------------------
+class Builder
+{
+public:
+  enum Value {
+    Unknown,
+    Win,
+    Loss,
+    Draw,
+    Invalid
+  };
+
+  Builder(const Bitbases& owner, Bitbases::Table& table)
+    : owner(owner),
+      table(table),
+      values(new std::atomic<uint8_t>[table.entries]),
+      marks(new std::atomic<uint8_t>[table.entries]),
+      fresh(new std::atomic<uint8_t>[table.entries]),
+      next(0),
+      scored(0),
+      failed(false)
+  {
+    for (uint64_t i = 0; i < table.entries; ++i) {
+      values[i] = Unknown;
+      marks[i] = 0;
+      fresh[i] = 0;
+    }
+  }
+
+  bool Run(const int threads);
+
+private:
+  enum Phase {
+    Initial,
+    Mark,
+    Score
+  };
+
+  struct Move {
+    int slot;
+    int to;
+    int promo;
+  };
+
+  static void RunWorker(void* param);
+
+  void RunPhase(const Phase phase, const int threads);
+  void Work();
+  int Evaluate(const int* sqr, const int colorToMove);
+  int EnPassant(const int* sqr, const int slot, const int colorToMove,
+                const int value);
+  void MarkPredecessors(const int* sqr, const int colorToMove);
+  bool InCheck(const int* sqr, const int color, const int skip) const;
+  int Generate(const int* sqr, const int colorToMove, Move* moves) const;
+
+  const Bitbases&                          owner;
+  Bitbases::Table&                         table;
+  std::unique_ptr<std::atomic<uint8_t>[]> values;
+  std::unique_ptr<std::atomic<uint8_t>[]> marks;
+  std::unique_ptr<std::atomic<uint8_t>[]> fresh;
+  std::atomic<uint64_t>                    next;
+  std::atomic<uint64_t>                    scored;
+  std::atomic<bool>                        failed;
+  Phase                                    phase;
+};
+
+//----------------------------------------------------------------------------
+void Builder::RunWorker(void* param)
+{
+  static_cast<Builder*>(param)->Work();
+}
+
+//----------------------------------------------------------------------------
+void Builder::RunPhase(const Phase p, const int threads)
+{
+  phase = p;
+  next = 0;
+  std::vector<senjo::Thread> workers(std::max<int>(0, (threads - 1)));
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].Start(RunWorker, this);
+  }
+  Work();
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].Join();
+  }
+}
+
+//----------------------------------------------------------------------------
+void Builder::Work()
+{
+  int sqr[Bitbases::MaxPieces];
+  int stm;
+  uint64_t begin;
+  while ((begin = (next += _BLOCK_SIZE) - _BLOCK_SIZE) < table.entries) {
+    const uint64_t end = std::min<uint64_t>((begin + _BLOCK_SIZE),
+                                            table.entries);
+    for (uint64_t i = begin; i < end; ++i) {
+      switch (phase) {
+      case Initial: {
+        table.Decode(i, sqr, stm);
+        bool valid = (table.Index(sqr, stm) == i);
+        uint64_t occ = 0;
+        for (int k = 0; valid && (k < table.count); ++k) {
+          valid = !(occ & BIT(sqr[k]));
+          occ |= BIT(sqr[k]);
+        }
+        if (!valid || InCheck(sqr, !stm, -1)) {
+          values[i] = Invalid;
+          break;
+        }
+        const int value = Evaluate(sqr, stm);
+        if (value != Unknown) {
+          values[i] = static_cast<uint8_t>(value);
+          fresh[i] = 1;
+          scored++;
+        }
+        break;
+      }
+      case Mark:
+        if (fresh[i]) {
+          fresh[i] = 0;
+          table.Decode(i, sqr, stm);
+          MarkPredecessors(sqr, stm);
+        }
+        break;
+      case Score:
+        if (marks[i]) {
+          marks[i] = 0;
+          if (values[i] == Unknown) {
+            table.Decode(i, sqr, stm);
+            const int value = Evaluate(sqr, stm);
+            if (value != Unknown) {
+              values[i] = static_cast<uint8_t>(value);
+              fresh[i] = 1;
+              scored++;
+            }
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// is 'color' in check, ignoring the piece in slot 'skip'?
+//----------------------------------------------------------------------------
+bool Builder::InCheck(const int* sqr, const int color, const int skip) const
+{
+  uint64_t occ = 0;
+  for (int i = 0; i < table.count; ++i) {
+    if (i != skip) {
+      occ |= BIT(sqr[i]);
+    }
+  }
+  for (int i = 0; i < table.count; ++i) {
+    if ((i != skip) && (COLOR_OF(table.pieces[i]) != color) &&
+        Attacks(table.pieces[i], sqr[i], sqr[color], occ))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// pseudo legal moves, captures of the king excluded
+//----------------------------------------------------------------------------
+int Builder::Generate(const int* sqr, const int colorToMove,
+                      Move* moves) const
+{
+  uint64_t occ = 0;
+  uint64_t own = 0;
+  for (int i = 0; i < table.count; ++i) {
+    occ |= BIT(sqr[i]);
+    if (COLOR_OF(table.pieces[i]) == colorToMove) {
+      own |= BIT(sqr[i]);
+    }
+  }
+  const uint64_t enemyKing = BIT(sqr[!colorToMove]);
+
+  int count = 0;
+  for (int i = 0; i < table.count; ++i) {
+    const int piece = table.pieces[i];
+    if (COLOR_OF(piece) != colorToMove) {
+      continue;
+    }
+    uint64_t targets;
+    if ((piece & ~ColorMask) == Pawn) {
+      const int from = sqr[i];
+      const int dir = (colorToMove ? -8 : 8);
+      targets = 0;
+      if (!(occ & BIT(from + dir))) {
+        targets |= BIT(from + dir);
+        if ((YC(from) == (colorToMove ? 6 : 1)) &&
+            !(occ & BIT(from + dir + dir)))
+        {
+          targets |= BIT(from + dir + dir);
+        }
+      }
+      for (int dx = -1; dx <= 1; dx += 2) {
+        const int x = (XC(from) + dx);
+        if ((x >= 0) && (x < 8)) {
+          const int to = SQR(x, YC(from + dir));
+          if (occ & ~own & BIT(to)) {
+            targets |= BIT(to);
+          }
+        }
+      }
+    }
+    else {
+      targets = (Targets(piece, sqr[i], occ) & ~own);
+    }
+    targets &= ~enemyKing;
+
+    while (targets) {
+      const int to = LowSquare(targets);
+      targets &= (targets - 1);
+      if (((piece & ~ColorMask) == Pawn) && ((YC(to) == 0) || (YC(to) == 7))) {
+        for (int t = 0; t < 4; ++t) {
+          Move& move = moves[count++];
+          move.slot = i;
+          move.to = to;
+          move.promo = (_TYPES[t] | colorToMove);
+        }
+      }
+      else {
+        Move& move = moves[count++];
+        move.slot = i;
+        move.to = to;
+        move.promo = 0;
+      }
+    }
+  }
+  assert(count <= _MAX_MOVES);
+  return count;
+}
+
+//----------------------------------------------------------------------------
+int Builder::Evaluate(const int* sqr, const int colorToMove)
+{
+  Move moves[_MAX_MOVES];
+  const int count = Generate(sqr, colorToMove, moves);
+
+  bool legal = false;
+  bool unknown = false;
+  bool draw = false;
+  for (int m = 0; m < count; ++m) {
+    const Move& move = moves[m];
+    int child[Bitbases::MaxPieces];
+    memcpy(child, sqr, (table.count * sizeof(int)));
+    child[move.slot] = move.to;
+
+    int captured = -1;
+    for (int i = 0; i < table.count; ++i) {
+      if ((i != move.slot) && (sqr[i] == move.to)) {
+        captured = i;
+      }
+    }
+    if (InCheck(child, colorToMove, captured)) {
+      continue;
+    }
+    legal = true;
+
+    int value;
+    if ((captured < 0) && !move.promo) {
+      value = values[table.Index(child, !colorToMove)];
+      if (((table.pieces[move.slot] & ~ColorMask) == Pawn) &&
+          (abs(move.to - sqr[move.slot]) == 16))
+      {
+        value = EnPassant(child, move.slot, colorToMove, value);
+      }
+    }
+    else {
+      // the position after this move is in a different table
+      int pieces[Bitbases::MaxPieces];
+      int squares[Bitbases::MaxPieces];
+      int n = 0;
+      for (int i = 0; i < table.count; ++i) {
+        if (i != captured) {
+          pieces[n] = ((i == move.slot) && move.promo) ? move.promo
+                                                       : table.pieces[i];
+          squares[n++] = child[i];
+        }
+      }
+      switch (owner.Probe(n, pieces, squares, !colorToMove)) {
+      case Bitbases::Win:  value = Win;  break;
+      case Bitbases::Loss: value = Loss; break;
+      case Bitbases::Draw: value = Draw; break;
+      default:
+        failed = true;
+        value = Draw;
+        break;
+      }
+    }
+
+    switch (value) {
+    case Loss:
+      return Win;
+    case Draw:
+      draw = true;
+      break;
+    case Win:
+      break;
+    default:
+      unknown = true;
+      break;
+    }
+  }
+
+  if (!legal) {
+    return InCheck(sqr, colorToMove, -1) ? Loss : Draw;
+  }
+  if (unknown) {
+    return Unknown;
+  }
+  return (draw ? Draw : Loss);
+}
+
+//----------------------------------------------------------------------------
+// value for the other side of the position after the pawn in 'slot' made a
+// double push, 'value' being its table entry.  Table entries have no en
+// passant square, so an en passant capture the reply could make is scored
+// here, from the table the capture leads to.
+//----------------------------------------------------------------------------
+int Builder::EnPassant(const int* sqr, const int slot, const int colorToMove,
+                       const int value)
+{
+  const int to = sqr[slot];
+  const int ep = (to + (colorToMove ? 8 : -8));
+  int result = value;
+  for (int i = 0; i < table.count; ++i) {
+    if ((table.pieces[i] != (Pawn | !colorToMove)) ||
+        (YC(sqr[i]) != YC(to)) || (abs(XC(sqr[i]) - XC(to)) != 1))
+    {
+      continue;
+    }
+
+    int child[Bitbases::MaxPieces];
+    memcpy(child, sqr, (table.count * sizeof(int)));
+    child[i] = ep;
+    if (InCheck(child, !colorToMove, slot)) {
+      continue;
+    }
+
+    int pieces[Bitbases::MaxPieces];
+    int squares[Bitbases::MaxPieces];
+    int n = 0;
+    for (int k = 0; k < table.count; ++k) {
+      if (k != slot) {
+        pieces[n] = table.pieces[k];
+        squares[n++] = child[k];
+      }
+    }
+    switch (owner.Probe(n, pieces, squares, colorToMove)) {
+    case Bitbases::Loss:
+      return Win;
+    case Bitbases::Draw:
+      if (result == Loss) {
+        result = Draw;
+      }
+      break;
+    case Bitbases::Win:
+      break;
+    default:
+      failed = true;
+      break;
+    }
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------
+// flag every unscored position that can move into this one for scoring
+//----------------------------------------------------------------------------
+void Builder::MarkPredecessors(const int* sqr, const int colorToMove)
+{
+  const int mover = !colorToMove;
+  uint64_t occ = 0;
+  for (int i = 0; i < table.count; ++i) {
+    occ |= BIT(sqr[i]);
+  }
+
+  int pred[Bitbases::MaxPieces];
+  memcpy(pred, sqr, (table.count * sizeof(int)));
+  for (int i = 0; i < table.count; ++i) {
+    const int piece = table.pieces[i];
+    if (COLOR_OF(piece) != mover) {
+      continue;
+    }
+
+    uint64_t origins;
+    if ((piece & ~ColorMask) == Pawn) {
+      const int dir = (mover ? 8 : -8);
+      const int from = (sqr[i] + dir);
+      origins = 0;
+      if ((YC(from) != (mover ? 7 : 0)) && !(occ & BIT(from))) {
+        origins |= BIT(from);
+        if ((YC(sqr[i]) == (mover ? 4 : 3)) && !(occ & BIT(from + dir))) {
+          origins |= BIT(from + dir);
+        }
+      }
+    }
+    else {
+      origins = (Targets(piece, sqr[i], occ) & ~occ);
+    }
+
+    while (origins) {
+      pred[i] = LowSquare(origins);
+      origins &= (origins - 1);
+      const uint64_t index = table.Index(pred, mover);
+      if (values[index] == Unknown) {
+        marks[index] = 1;
+      }
+    }
+    pred[i] = sqr[i];
+  }
+}
+
+//----------------------------------------------------------------------------
+bool Builder::Run(const int threads)
+{
+  const uint64_t start = Now();
+  RunPhase(Initial, threads);
+  int passes = 1;
+  for (uint64_t last = 0; scored > last; ++passes) {
+    last = scored;
+    RunPhase(Mark, threads);
+    RunPhase(Score, threads);
+  }
+  if (failed) {
+    Output() << table.name << ": missing table for captures or promotions";
+    return false;
+  }
+
+  uint64_t counts[5] = {0};
+  table.owned.assign(((table.entries + 3) / 4), 0);
+  for (uint64_t i = 0; i < table.entries; ++i) {
+    const int value = values[i];
+    counts[value]++;
+    const int bits = ((value == Win) ? Bitbases::Win :
+                      (value == Loss) ? Bitbases::Loss : Bitbases::Draw);
+    table.owned[i / 4] |= static_cast<uint8_t>(bits << (2 * (i & 3)));
+  }
+  table.values = &table.owned[0];
+
+  Output() << table.name << ": " << counts[Win] << " wins, "
+           << (counts[Draw] + counts[Unknown]) << " draws, "
+           << counts[Loss] << " losses, " << counts[Invalid]
+           << " unused, " << passes << " passes, "
+           << (Now() - start) << " msecs";
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Bitbases::Build(Table& table, const int threads)
+{
+  Builder builder(*this, table);
+  return builder.Run(threads);
+}
+
+//----------------------------------------------------------------------------
+bool Bitbases::Generate(const std::string& dir, const int threads)
+{
+#ifdef WIN32
+  _mkdir(dir.c_str());
+#else
+  mkdir(dir.c_str(), 0755);
+#endif
+
+  Bitbases bitbases;
+  bitbases.Load(dir);
+
+  const std::vector<std::string> names = AllSignatures();
+  for (size_t i = 0; i < names.size(); ++i) {
+    Table* table = new Table(names[i]);
+    if (bitbases.lookup[MaterialKey(table->count, table->pieces)] >= 0) {
+      delete table; // already loaded
+      continue;
+    }
+    if (!bitbases.Build(*table, std::max<int>(1, threads))) {
+      delete table;
+      return false;
+    }
+    bitbases.Add(table);
+
+    const std::string path = (dir + '/' + names[i] + ".bfb");
+    const uint32_t entries = static_cast<uint32_t>(table->entries);
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp ||
+        (fwrite(_MAGIC, 4, 1, fp) != 1) ||
+        (fwrite(&entries, sizeof(entries), 1, fp) != 1) ||
+        (fwrite(&table->owned[0], table->owned.size(), 1, fp) != 1))
+    {
+      Output() << "Cannot write '" << path << "': " << strerror(errno);
+      if (fp) {
+        fclose(fp);
+      }
+      return false;
+    }
+    fclose(fp);
+  }
+  return true;
+}
+
+} // namespace bitfoot
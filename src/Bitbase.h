@@ -0,0 +1,92 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_BITBASE_H
+#define BITFOOT_BITBASE_H
+
+#include "PackedPosition.h"
+
+#include <memory>
+#include <vector>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// win/draw/loss endgame bitbases for every ending with up to MaxPieces
+// pieces (kings included)
+//
+// Tables are built by retrograde analysis with Generate() and written to
+// one file per material signature, e.g. "KRKN.bfb":
+//   char    magic[4]          "BFB1"
+//   uint32  entries
+//   uint8   values[(entries + 3) / 4]
+//
+// Each entry is 2 bits, 0 = draw (or unused), 1 = the side to move wins,
+// 2 = the side to move loses.  The side with the stronger material is
+// white in the tables, probes of positions where black is stronger are
+// flipped first.  Positions with castling rights or an en passant square
+// are outside the tables, so is the 50 move rule.  The en passant capture
+// a double pawn push allows is still taken into account when scoring the
+// position the push was made from.
+//----------------------------------------------------------------------------
+class Bitbases
+{
+public:
+  enum {
+    MaxPieces = 4
+  };
+
+  enum Result {
+    NotFound = -1,
+    Draw     = 0,
+    Win      = 1,
+    Loss     = 2
+  };
+
+  //--------------------------------------------------------------------------
+  // generate every table missing from 'dir' using 'threads' threads,
+  // tables already in 'dir' are loaded and used to build the rest
+  //--------------------------------------------------------------------------
+  static bool Generate(const std::string& dir, const int threads);
+
+  //--------------------------------------------------------------------------
+  // the tables in 'dir', loaded once per process and shared by every
+  // caller asking for the same directory, NULL if there are none
+  //--------------------------------------------------------------------------
+  static std::shared_ptr<const Bitbases> Open(const std::string& dir);
+
+  Bitbases();
+  ~Bitbases();
+
+  //--------------------------------------------------------------------------
+  // map every table file in 'dir' into memory, false if none were found
+  //--------------------------------------------------------------------------
+  bool Load(const std::string& dir);
+
+  size_t TableCount() const;
+
+  //--------------------------------------------------------------------------
+  // result for the side to move, 'pieces' and 'squares' list every piece
+  // on the board (PieceType and square, A1 = 0) in any order
+  //--------------------------------------------------------------------------
+  Result Probe(const int count, const int* pieces, const int* squares,
+               const int colorToMove) const;
+
+  struct Table;
+
+private:
+  Bitbases(const Bitbases&);
+  Bitbases& operator=(const Bitbases&);
+
+  bool Add(Table* table);
+  bool Build(Table& table, const int threads);
+
+  std::vector<Table*> tables;
+  std::vector<int>    lookup; // material key -> table index * 2 + flip
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_BITBASE_H
@@ -14,48 +14,189 @@ namespace bitfoot
 static const std::string _TRUE = "true";
 
 //----------------------------------------------------------------------------
-bool                Bitfoot::_ext = false;
-bool                Bitfoot::_iid = false;
-bool                Bitfoot::_initialized = false;
-bool                Bitfoot::_lmr = false;
-bool                Bitfoot::_nmp = false;
-bool                Bitfoot::_nmr = false;
-bool                Bitfoot::_oneReply = false;
-char                Bitfoot::_hist[0x10000] = {0};
-int                 Bitfoot::_board[64] = {0};
-int                 Bitfoot::_contempt = 0;
-int                 Bitfoot::_delta = 0;
-int                 Bitfoot::_depth = 0;
-int                 Bitfoot::_drawScore[2] = {0};
-int                 Bitfoot::_futility = 0;
-int                 Bitfoot::_movenum = 0;
-int                 Bitfoot::_rzr = 0;
-int                 Bitfoot::_seldepth = 0;
-int                 Bitfoot::_tempo = 0;
-int                 Bitfoot::_test = 0;
-std::string         Bitfoot::_currmove;
-int64_t             Bitfoot::_hashSize = 0;
-Bitfoot             Bitfoot::_node[MaxPlies];
-std::set<uint64_t>  Bitfoot::_seen;
-Stats               Bitfoot::_stats;
-Stats               Bitfoot::_totalStats;
-TranspositionTable  Bitfoot::_tt;
-
-//----------------------------------------------------------------------------
-EngineOption Bitfoot::_optHash("Hash", "1024", EngineOption::Spin, 0, 4096);
-EngineOption Bitfoot::_optClearHash("Clear Hash", "", EngineOption::Button);
-EngineOption Bitfoot::_optContempt("Contempt", "0", EngineOption::Spin, 0, 50);
-EngineOption Bitfoot::_optDelta("Delta Pruning Margin", "0", EngineOption::Spin, 0, 9999);
-EngineOption Bitfoot::_optEXT("Check Extensions", _TRUE, EngineOption::Checkbox);
-EngineOption Bitfoot::_optFutility("Futility Pruning Delta", "200", EngineOption::Spin, 0, 9999);
-EngineOption Bitfoot::_optIID("Internal Iterative Deepening", _TRUE, EngineOption::Checkbox);
-EngineOption Bitfoot::_optLMR("Late Move Reductions", _TRUE, EngineOption::Checkbox);
-EngineOption Bitfoot::_optNMP("Null Move Pruning", _TRUE, EngineOption::Checkbox);
-EngineOption Bitfoot::_optNMR("Null Move Reductions", _TRUE, EngineOption::Checkbox);
-EngineOption Bitfoot::_optOneReply("One Reply Extensions", _TRUE, EngineOption::Checkbox);
-EngineOption Bitfoot::_optRZR("Razoring Delta", "500", EngineOption::Spin, 0, 9999);
-EngineOption Bitfoot::_optTempo("Tempo Bonus", "0", EngineOption::Spin, 0, 50);
-EngineOption Bitfoot::_optTest("Experimental Feature", "0", EngineOption::Spin, 0, 9999);
+Bitfoot::Context::Context(Bitfoot* root)
+  : root(root),
+    stop(root->GetStopFlags()),
+    ext(false),
+    hashLoaded(false),
+    hashPending(true),
+    iid(false),
+    initialized(false),
+    lmr(false),
+    nnue(false),
+    nmp(false),
+    nmr(false),
+    oneReply(false),
+    bitbasePieces(0),
+    contempt(0),
+    delta(0),
+    depth(0),
+    features(0),
+    futility(0),
+    movenum(0),
+    pvDepth(0),
+    rzr(0),
+    seldepth(0),
+    tempo(0),
+    test(0),
+    hashSize(0),
+    nodeLimit(0),
+    node(NULL),
+    ownTT(std::make_shared<TranspositionTable>()),
+    tt(ownTT),
+    optHash("Hash", "1024", EngineOption::Spin, 0, 4096),
+    optHashFile("HashFile", "", EngineOption::String),
+    optSharedHash("SharedHash", "", EngineOption::String),
+    optBitbasePath("BitbasePath", "", EngineOption::String),
+    optBookFile("BookFile", "", EngineOption::String),
+    optClearHash("Clear Hash", "", EngineOption::Button),
+    optContempt("Contempt", "0", EngineOption::Spin, 0, 50),
+    optDelta("Delta Pruning Margin", "0", EngineOption::Spin, 0, 9999),
+    optEvalFile("EvalFile", "", EngineOption::String),
+    optEXT("Check Extensions", _TRUE, EngineOption::Checkbox),
+    optFutility("Futility Pruning Delta", "200", EngineOption::Spin, 0, 9999),
+    optIID("Internal Iterative Deepening", _TRUE, EngineOption::Checkbox),
+    optLMR("Late Move Reductions", _TRUE, EngineOption::Checkbox),
+    optOverhead("Move Overhead", "30", EngineOption::Spin, 0, 5000),
+    optOwnBook("OwnBook", "false", EngineOption::Checkbox),
+    optNMP("Null Move Pruning", _TRUE, EngineOption::Checkbox),
+    optNMR("Null Move Reductions", _TRUE, EngineOption::Checkbox),
+    optOneReply("One Reply Extensions", _TRUE, EngineOption::Checkbox),
+    optRZR("Razoring Delta", "500", EngineOption::Spin, 0, 9999),
+    optTempo("Tempo Bonus", "0", EngineOption::Spin, 0, 50),
+    optTest("Experimental Feature", "0", EngineOption::Spin, 0, 9999),
+    optTrace("Trace File", "", EngineOption::String),
+    optUseNNUE("Use NNUE", _TRUE, EngineOption::Checkbox)
+{
+  memset(hist, 0, sizeof(hist));
+  memset(board, 0, sizeof(board));
+  memset(drawScore, 0, sizeof(drawScore));
+  memset(matTable, 0, sizeof(matTable));
+#ifndef NDEBUG
+  memset(evalInfo, 0, sizeof(evalInfo));
+#endif
+
+  // nodes start out zeroed, the same as they did when they were static
+  void* mem = operator new(sizeof(Bitfoot) * MaxPlies);
+  memset(mem, 0, (sizeof(Bitfoot) * MaxPlies));
+  node = static_cast<Bitfoot*>(mem);
+  for (int i = 0; i < MaxPlies; ++i) {
+    new (node + i) Bitfoot(this);
+  }
+}
+
+//----------------------------------------------------------------------------
+Bitfoot::Context::~Context()
+{
+  for (int i = 0; i < MaxPlies; ++i) {
+    node[i].~Bitfoot();
+  }
+  operator delete(node);
+  node = NULL;
+}
+
+//----------------------------------------------------------------------------
+Bitfoot::Bitfoot()
+  : ctx(new Context(this))
+{
+}
+
+//----------------------------------------------------------------------------
+Bitfoot::Bitfoot(Context* context)
+  : ChessEngine(context->root),
+    ctx(context)
+{
+}
+
+//----------------------------------------------------------------------------
+Bitfoot::~Bitfoot()
+{
+  if (ctx && (ctx->root == this)) {
+    delete ctx;
+  }
+  ctx = NULL;
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::ShareHashTable(Bitfoot* owner)
+{
+  if (owner && (owner != this)) {
+    // if the owner is sharing too this uses the same table it does
+    ctx->tt = owner->ctx->tt;
+    ctx->ownTT->Resize(0);
+  }
+  else if (ctx->tt != ctx->ownTT) {
+    ctx->tt = ctx->ownTT;
+    ctx->hashPending = true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int Bitfoot::StaticEval(EvalTerms* terms)
+{
+  // evaluate again with the current contempt, tempo, etc
+  SetDrawScores();
+  state &= ~Draw;
+  if (terms) {
+    Evaluate<true>(terms);
+  }
+  else {
+    Evaluate<false>(NULL);
+  }
+  return standPat;
+}
+
+//----------------------------------------------------------------------------
+int Bitfoot::QSearchScore()
+{
+  ClearStopFlags();
+  InitSearch();
+  return (WhiteToMove()
+          ? QSearch<White, DefaultFeatures>(-Infinity, Infinity, 0)
+          : QSearch<Black, DefaultFeatures>(-Infinity, Infinity, 0));
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::Search(const SearchLimits& limits, SearchResult& result)
+{
+  result = SearchResult();
+  ClearStopFlags();
+  if (limits.cancel && *limits.cancel) {
+    Stop(FullStop);
+  }
+  ctx->nodeLimit = limits.nodes;
+  result.bestmove = Go(limits.depth, 0, limits.movetime,
+                       limits.wtime, limits.winc, limits.btime, limits.binc);
+  ctx->nodeLimit = 0;
+
+  result.depth    = ctx->pvDepth;
+  result.seldepth = ctx->seldepth;
+  result.nodes    = (ctx->stats.snodes + ctx->stats.qnodes);
+  result.qnodes   = ctx->stats.qnodes;
+  result.msecs    = (Now() - GetStartTime());
+
+  if (result.bestmove.size() && (pvCount > 0)) {
+    for (int i = 0; i < pvCount; ++i) {
+      result.pv.push_back(pv[i].ToString());
+    }
+    result.score = pv[0].GetScore();
+    if (abs(result.score) >= MateScore) {
+      const int mate = (((Infinity - abs(result.score)) + 1) / 2);
+      result.mate = ((result.score < 0) ? -mate : mate);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+uint64_t Bitfoot::CountLeaves(const int depth)
+{
+  if (depth <= 0) {
+    return 1;
+  }
+  ClearStopFlags();
+  const int d = std::min<int>(depth, MaxPlies);
+  return (WhiteToMove() ? PerftSearch<White>(d) : PerftSearch<Black>(d));
+}
 
 //----------------------------------------------------------------------------
 #ifndef USE_SHIFT
@@ -90,7 +231,7 @@ const uint64_t _BITMAP[64] =
 bitfoot::Diff _diff;
 
 //----------------------------------------------------------------------------
-const int Bitfoot::_PIECE_SQR[PieceTypeCount - 2][64] =
+EVAL_CONST int Bitfoot::_PIECE_SQR[PieceTypeCount - 2][64] =
 {
   { // King Midgame
     0,  8,  8, -8, -8, -8,  8,  0,
@@ -215,7 +356,7 @@ const int Bitfoot::_PIECE_SQR[PieceTypeCount - 2][64] =
 };
 
 //----------------------------------------------------------------------------
-const int Bitfoot::_VALUE_OF[PieceTypeCount] =
+EVAL_CONST int Bitfoot::_VALUE_OF[PieceTypeCount] =
 {
   0,           0,
   PawnValue,   PawnValue,
@@ -248,7 +389,7 @@ const int Bitfoot::_TOUCH[64] =
 };
 
 //----------------------------------------------------------------------------
-const int Bitfoot::_ATK_WEIGHT[100] =
+EVAL_CONST int Bitfoot::_ATK_WEIGHT[100] =
 {
     0,   0,   1,   2,   3,   5,   7,   9,  12,  15,
    18,  22,  26,  30,  35,  39,  44,  50,  56,  62,
@@ -262,6 +403,137 @@ const int Bitfoot::_ATK_WEIGHT[100] =
   500, 500, 500, 500, 500, 500, 500, 500, 500, 500,
 };
 
+//----------------------------------------------------------------------------
+// passed pawn bonus by rank, from the pawn owner's side of the board
+//----------------------------------------------------------------------------
+EVAL_CONST int Bitfoot::_PASSER_RANK[8] =
+{
+  0, 12, 16, 24, 36, 56, 88, 0
+};
+
+#ifdef BITFOOT_TUNE
+//----------------------------------------------------------------------------
+#define BITFOOT_DEFINE_PARAM(name, value) int name = value;
+BITFOOT_EVAL_PARAMS(BITFOOT_DEFINE_PARAM)
+#undef BITFOOT_DEFINE_PARAM
+
+//----------------------------------------------------------------------------
+static const char* _PIECE_SQR_NAME[PieceTypeCount - 2] = {
+  "King Midgame", "King Endgame",
+  "WhitePawn",    "BlackPawn",
+  "WhiteKnight",  "BlackKnight",
+  "WhiteBishop",  "BlackBishop",
+  "WhiteRook",    "BlackRook",
+  "WhiteQueen",   "BlackQueen"
+};
+
+//----------------------------------------------------------------------------
+static const char* _PIECE_NAME[PieceTypeCount / 2] = {
+  "", "Pawn", "Knight", "Bishop", "Rook", "Queen", "King"
+};
+
+//----------------------------------------------------------------------------
+void Bitfoot::GetEvalParams(std::vector<EvalParam>& params)
+{
+  char label[64];
+  params.clear();
+
+#define BITFOOT_ADD_PARAM(name, value) \
+  params.push_back(EvalParam(#name, &name));
+  BITFOOT_EVAL_PARAMS(BITFOOT_ADD_PARAM)
+#undef BITFOOT_ADD_PARAM
+
+  // pawn value is the unit everything else is measured in, it stays put
+  for (int piece = Knight; piece < King; piece += 2) {
+    snprintf(label, sizeof(label), "%sValue", _PIECE_NAME[piece / 2]);
+    params.push_back(EvalParam(label, &_VALUE_OF[piece]));
+    params.back().slots.push_back(&_VALUE_OF[Black|piece]);
+  }
+
+  // king tables are used for both colors, so keep them symmetric
+  for (int table = 0; table < 2; ++table) {
+    for (int sqr = A1; sqr < A5; ++sqr) {
+      snprintf(label, sizeof(label), "%s %c%d", _PIECE_SQR_NAME[table],
+               ('a' + XC(sqr)), (YC(sqr) + 1));
+      params.push_back(EvalParam(label, &_PIECE_SQR[table][sqr]));
+      params.back().slots.push_back(&_PIECE_SQR[table][sqr ^ 56]);
+    }
+  }
+
+  // black tables mirror the white tables
+  for (int piece = WhitePawn; piece < WhiteKing; piece += 2) {
+    for (int sqr = A1; sqr <= H8; ++sqr) {
+      if ((piece == WhitePawn) && ((YC(sqr) == 0) || (YC(sqr) == 7))) {
+        continue;
+      }
+      snprintf(label, sizeof(label), "%s %c%d", _PIECE_SQR_NAME[piece],
+               ('a' + XC(sqr)), (YC(sqr) + 1));
+      params.push_back(EvalParam(label, &_PIECE_SQR[piece][sqr]));
+      params.back().slots.push_back(&_PIECE_SQR[Black|piece][sqr ^ 56]);
+    }
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    snprintf(label, sizeof(label), "AttackWeight %d", i);
+    params.push_back(EvalParam(label, &_ATK_WEIGHT[i]));
+  }
+
+  for (int i = 1; i < 7; ++i) {
+    snprintf(label, sizeof(label), "PasserRank %d", (i + 1));
+    params.push_back(EvalParam(label, &_PASSER_RANK[i]));
+  }
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::PrintEvalParams(FILE* fp)
+{
+  fprintf(fp, "// Defs.h\n");
+  for (int piece = Pawn; piece < King; piece += 2) {
+    fprintf(fp, "  %-11s = %d,\n",
+            (std::string(_PIECE_NAME[piece / 2]) + "Value").c_str(),
+            _VALUE_OF[piece]);
+  }
+
+  fprintf(fp, "\n// Params.h\n");
+#define BITFOOT_PRINT_PARAM(name, value) \
+  fprintf(fp, "  PARAM(%-22s%3d) \\\n", (#name ","), name);
+  BITFOOT_EVAL_PARAMS(BITFOOT_PRINT_PARAM)
+#undef BITFOOT_PRINT_PARAM
+
+  fprintf(fp, "\n// Bitfoot.cpp\n");
+  fprintf(fp, "EVAL_CONST int Bitfoot::_PIECE_SQR[PieceTypeCount - 2][64] =\n");
+  fprintf(fp, "{\n");
+  for (int table = 0; table < (PieceTypeCount - 2); ++table) {
+    fprintf(fp, "  { // %s\n", _PIECE_SQR_NAME[table]);
+    for (int row = 0; row < 8; ++row) {
+      fprintf(fp, " ");
+      for (int col = 0; col < 8; ++col) {
+        fprintf(fp, "%s%3d", (col ? "," : " "),
+                _PIECE_SQR[table][(row * 8) + col]);
+      }
+      fprintf(fp, "%s\n", (row < 7) ? "," : "");
+    }
+    fprintf(fp, "  }%s\n", (table < (PieceTypeCount - 3)) ? "," : "");
+  }
+  fprintf(fp, "};\n\n");
+
+  fprintf(fp, "EVAL_CONST int Bitfoot::_ATK_WEIGHT[100] =\n");
+  fprintf(fp, "{\n");
+  for (int i = 0; i < 100; ++i) {
+    fprintf(fp, "%s%3d,%s", ((i % 10) ? " " : "  "), _ATK_WEIGHT[i],
+            (((i % 10) == 9) ? "\n" : ""));
+  }
+  fprintf(fp, "};\n\n");
+
+  fprintf(fp, "EVAL_CONST int Bitfoot::_PASSER_RANK[8] =\n");
+  fprintf(fp, "{\n ");
+  for (int i = 0; i < 8; ++i) {
+    fprintf(fp, "%s %d", (i ? "," : ""), _PASSER_RANK[i]);
+  }
+  fprintf(fp, "\n};\n");
+}
+#endif
+
 //----------------------------------------------------------------------------
 const uint64_t Bitfoot::_ALL       = 0xFFFFFFFFFFFFFFFFULL;
 const uint64_t Bitfoot::_CENTER4   = 0x0000001818000000ULL;
@@ -763,20 +1035,29 @@ std::string Bitfoot::GetCountryName() const
 std::list<EngineOption> Bitfoot::GetOptions() const
 {
   std::list<EngineOption> opts;
-  opts.push_back(_optHash);
-  opts.push_back(_optClearHash);
-  opts.push_back(_optContempt);
-  opts.push_back(_optDelta);
-  opts.push_back(_optEXT);
-  opts.push_back(_optFutility);
-  opts.push_back(_optIID);
-  opts.push_back(_optLMR);
-  opts.push_back(_optNMP);
-  opts.push_back(_optNMR);
-  opts.push_back(_optOneReply);
-  opts.push_back(_optRZR);
-  opts.push_back(_optTempo);
-  opts.push_back(_optTest);
+  opts.push_back(ctx->optHash);
+  opts.push_back(ctx->optHashFile);
+  opts.push_back(ctx->optSharedHash);
+  opts.push_back(ctx->optBitbasePath);
+  opts.push_back(ctx->optBookFile);
+  opts.push_back(ctx->optClearHash);
+  opts.push_back(ctx->optContempt);
+  opts.push_back(ctx->optDelta);
+  opts.push_back(ctx->optEvalFile);
+  opts.push_back(ctx->optEXT);
+  opts.push_back(ctx->optFutility);
+  opts.push_back(ctx->optIID);
+  opts.push_back(ctx->optLMR);
+  opts.push_back(ctx->optOverhead);
+  opts.push_back(ctx->optOwnBook);
+  opts.push_back(ctx->optNMP);
+  opts.push_back(ctx->optNMR);
+  opts.push_back(ctx->optOneReply);
+  opts.push_back(ctx->optRZR);
+  opts.push_back(ctx->optTempo);
+  opts.push_back(ctx->optTest);
+  opts.push_back(ctx->optTrace);
+  opts.push_back(ctx->optUseNNUE);
   return opts;
 }
 
@@ -784,128 +1065,387 @@ std::list<EngineOption> Bitfoot::GetOptions() const
 bool Bitfoot::SetEngineOption(const std::string& optionName,
                              const std::string& optionValue)
 {
-  if (!stricmp(optionName.c_str(), _optHash.GetName().c_str())) {
-    if (_optHash.SetValue(optionValue)) {
-      SetHashSize(_optHash.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optHash.GetName().c_str())) {
+    // the hash options are applied together by Initialize(), so the table
+    // doesn't depend on the order they're set in
+    if (ctx->optHash.SetValue(optionValue)) {
+      ctx->hashPending = true;
+      return true;
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optHashFile.GetName().c_str())) {
+    if (ctx->optHashFile.SetValue(optionValue)) {
+      ctx->ownTT->SetFile(ctx->optHashFile.GetValue());
+      ctx->hashPending = true;
+      return true;
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optSharedHash.GetName().c_str())) {
+    if (ctx->optSharedHash.SetValue(optionValue)) {
+      ctx->ownTT->SetSharedMemory(ctx->optSharedHash.GetValue());
+      ctx->hashPending = true;
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optClearHash.GetName().c_str())) {
+  if (!stricmp(optionName.c_str(), ctx->optBitbasePath.GetName().c_str())) {
+    if (ctx->optBitbasePath.SetValue(optionValue)) {
+      return LoadBitbases(ctx->optBitbasePath.GetValue());
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optBookFile.GetName().c_str())) {
+    if (ctx->optBookFile.SetValue(optionValue)) {
+      return LoadBook(ctx->optBookFile.GetValue());
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optClearHash.GetName().c_str())) {
     ClearHash();
     return true;
   }
-  if (!stricmp(optionName.c_str(), _optContempt.GetName().c_str())) {
-    if (_optContempt.SetValue(optionValue)) {
-      _contempt = static_cast<int>(_optContempt.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optContempt.GetName().c_str())) {
+    if (ctx->optContempt.SetValue(optionValue)) {
+      ctx->contempt = static_cast<int>(ctx->optContempt.GetIntValue());
+      return true;
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optDelta.GetName().c_str())) {
+    if (ctx->optDelta.SetValue(optionValue)) {
+      ctx->delta = static_cast<int>(ctx->optDelta.GetIntValue());
+      return true;
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optEvalFile.GetName().c_str())) {
+    if (ctx->optEvalFile.SetValue(optionValue)) {
+      return LoadNetwork(ctx->optEvalFile.GetValue());
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optEXT.GetName().c_str())) {
+    if (ctx->optEXT.SetValue(optionValue)) {
+      ctx->ext = (ctx->optEXT.GetValue() == _TRUE);
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optDelta.GetName().c_str())) {
-    if (_optDelta.SetValue(optionValue)) {
-      _delta = static_cast<int>(_optDelta.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optFutility.GetName().c_str())) {
+    if (ctx->optFutility.SetValue(optionValue)) {
+      ctx->futility = static_cast<int>(ctx->optFutility.GetIntValue());
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optEXT.GetName().c_str())) {
-    if (_optEXT.SetValue(optionValue)) {
-      _ext = (_optEXT.GetValue() == _TRUE);
+  if (!stricmp(optionName.c_str(), ctx->optIID.GetName().c_str())) {
+    if (ctx->optIID.SetValue(optionValue)) {
+      ctx->iid = (ctx->optIID.GetValue() == _TRUE);
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optFutility.GetName().c_str())) {
-    if (_optFutility.SetValue(optionValue)) {
-      _futility = static_cast<int>(_optFutility.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optOverhead.GetName().c_str())) {
+    if (ctx->optOverhead.SetValue(optionValue)) {
+      SetMoveOverhead(static_cast<uint64_t>(ctx->optOverhead.GetIntValue()));
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optIID.GetName().c_str())) {
-    if (_optIID.SetValue(optionValue)) {
-      _iid = (_optIID.GetValue() == _TRUE);
+  if (!stricmp(optionName.c_str(), ctx->optOwnBook.GetName().c_str())) {
+    if (ctx->optOwnBook.SetValue(optionValue)) {
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optLMR.GetName().c_str())) {
-    if (_optLMR.SetValue(optionValue)) {
-      _lmr = (_optLMR.GetValue() == _TRUE);
+  if (!stricmp(optionName.c_str(), ctx->optLMR.GetName().c_str())) {
+    if (ctx->optLMR.SetValue(optionValue)) {
+      ctx->lmr = (ctx->optLMR.GetValue() == _TRUE);
       return true;
     }
   }
-  if (!stricmp(optionName .c_str(), _optNMP.GetName().c_str())) {
-    if (_optNMP.SetValue(optionValue)) {
-      _nmp = (_optNMP.GetValue() == _TRUE);
+  if (!stricmp(optionName .c_str(), ctx->optNMP.GetName().c_str())) {
+    if (ctx->optNMP.SetValue(optionValue)) {
+      ctx->nmp = (ctx->optNMP.GetValue() == _TRUE);
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optNMR.GetName().c_str())) {
-    if (_optNMR.SetValue(optionValue)) {
-      _nmr = (_optNMR.GetValue() == _TRUE);
+  if (!stricmp(optionName.c_str(), ctx->optNMR.GetName().c_str())) {
+    if (ctx->optNMR.SetValue(optionValue)) {
+      ctx->nmr = (ctx->optNMR.GetValue() == _TRUE);
       return true;
     }
   }
-  if (!stricmp(optionName .c_str(), _optOneReply.GetName().c_str())) {
-    if (_optOneReply.SetValue(optionValue)) {
-      _oneReply = (_optOneReply.GetValue() == _TRUE);
+  if (!stricmp(optionName .c_str(), ctx->optOneReply.GetName().c_str())) {
+    if (ctx->optOneReply.SetValue(optionValue)) {
+      ctx->oneReply = (ctx->optOneReply.GetValue() == _TRUE);
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optRZR.GetName().c_str())) {
-    if (_optRZR.SetValue(optionValue)) {
-      _rzr = static_cast<int>(_optRZR.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optRZR.GetName().c_str())) {
+    if (ctx->optRZR.SetValue(optionValue)) {
+      ctx->rzr = static_cast<int>(ctx->optRZR.GetIntValue());
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optTempo.GetName().c_str())) {
-    if (_optTempo.SetValue(optionValue)) {
-      _tempo = static_cast<int>(_optTempo.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optTempo.GetName().c_str())) {
+    if (ctx->optTempo.SetValue(optionValue)) {
+      ctx->tempo = static_cast<int>(ctx->optTempo.GetIntValue());
       return true;
     }
   }
-  if (!stricmp(optionName.c_str(), _optTest.GetName().c_str())) {
-    if (_optTest.SetValue(optionValue)) {
-      _test = static_cast<int>(_optTest.GetIntValue());
+  if (!stricmp(optionName.c_str(), ctx->optTest.GetName().c_str())) {
+    if (ctx->optTest.SetValue(optionValue)) {
+      ctx->test = static_cast<int>(ctx->optTest.GetIntValue());
+      return true;
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optTrace.GetName().c_str())) {
+    if (ctx->optTrace.SetValue(optionValue)) {
+      ctx->trace.Close();
+      if (ctx->optTrace.GetValue().empty()) {
+        return true;
+      }
+      return ctx->trace.Open(ctx->optTrace.GetValue());
+    }
+  }
+  if (!stricmp(optionName.c_str(), ctx->optUseNNUE.GetName().c_str())) {
+    if (ctx->optUseNNUE.SetValue(optionValue)) {
+      SelectEvaluator();
       return true;
     }
   }
   return false;
 }
 
+//----------------------------------------------------------------------------
+bool Bitfoot::LoadBitbases(const std::string& dir)
+{
+  ctx->bitbases.reset();
+  if (dir.empty()) {
+    return true;
+  }
+  ctx->bitbases = Bitbases::Open(dir);
+  if (!ctx->bitbases) {
+    Output() << "No bitbases found in '" << dir << "'";
+    return false;
+  }
+  Output() << ctx->bitbases->TableCount() << " bitbases loaded from '"
+           << dir << "'";
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Bitfoot::LoadBook(const std::string& fileName)
+{
+  ctx->book.Close();
+  if (fileName.empty()) {
+    return true;
+  }
+  if (!ctx->book.Open(fileName)) {
+    return false;
+  }
+  Output() << ctx->book.Count() << " book entries in '" << fileName << "'";
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// opening book key of the current position, see Book.h
+//----------------------------------------------------------------------------
+uint64_t Bitfoot::PolyglotKey() const
+{
+  uint64_t key = 0;
+  for (int sqr = A1; sqr <= H8; ++sqr) {
+    const int pc = ctx->board[sqr];
+    if (pc) {
+      const int kind = (((pc & ~Black) - Pawn) | (COLOR_OF(pc) == White));
+      key ^= Book::Random64[Book::RandomPiece + (64 * kind) + sqr];
+    }
+  }
+
+  static const int rights[4] = {
+    WhiteShort, WhiteLong, BlackShort, BlackLong
+  };
+  for (int i = 0; i < 4; ++i) {
+    if (state & rights[i]) {
+      key ^= Book::Random64[Book::RandomCastle + i];
+    }
+  }
+
+  // the en passant file only counts if the capture is possible
+  if (ep != NoSquare) {
+    const int color = ColorToMove();
+    const int from = (ep + (color ? North : South));
+    if (((XC(ep) > 0) && (ctx->board[from - 1] == (color|Pawn))) ||
+        ((XC(ep) < 7) && (ctx->board[from + 1] == (color|Pawn))))
+    {
+      key ^= Book::Random64[Book::RandomEnPassant + XC(ep)];
+    }
+  }
+
+  if (WhiteToMove()) {
+    key ^= Book::Random64[Book::RandomTurn];
+  }
+  return key;
+}
+
+//----------------------------------------------------------------------------
+// legal move from the opening book for the current position, empty if
+// the position isn't in the book
+//----------------------------------------------------------------------------
+std::string Bitfoot::GetBookMove()
+{
+  const std::vector<Book::Entry> entries = ctx->book.Find(PolyglotKey());
+  const Book::Entry* entry = ctx->book.Choose(entries);
+  if (!entry) {
+    return std::string();
+  }
+
+  static const int promos[8] = { 0, Knight, Bishop, Rook, Queen, 0, 0, 0 };
+  const int color = ColorToMove();
+  const int from = ((entry->move >> 6) & 0x3F);
+  const int promo = promos[(entry->move >> 12) & 7];
+  int to = (entry->move & 0x3F);
+
+  // castling is stored as the king taking its own rook
+  if ((ctx->board[from] == (color|King)) && (ctx->board[to] == (color|Rook))) {
+    to = (from + ((to > from) ? 2 : -2));
+  }
+
+  // positions with the same key aren't always the same position
+  if (WhiteToMove()) {
+    GenerateMoves<White>();
+  }
+  else {
+    GenerateMoves<Black>();
+  }
+  for (int i = moveIndex; i < moveCount; ++i) {
+    const Move& move = moves[i];
+    if ((move.GetFrom() == from) && (move.GetTo() == to) &&
+        (move.GetPromo() == (promo ? (color|promo) : 0)))
+    {
+      return move.ToString();
+    }
+  }
+  return std::string();
+}
+
+//----------------------------------------------------------------------------
+bool Bitfoot::LoadNetwork(const std::string& fileName)
+{
+  bool ok = true;
+  if (fileName.empty()) {
+    ctx->network.Clear();
+  }
+  else {
+    ok = ctx->network.Load(fileName);
+  }
+  if (ctx->initialized) {
+    WireAccumulators();
+  }
+  SelectEvaluator();
+  return ok;
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::WireAccumulators()
+{
+  // a ply's worth of accumulators is sizable, don't keep them without a
+  // network to fill them
+  if (ctx->network.IsLoaded()) {
+    ctx->accumulators.resize(MaxPlies + 1);
+  }
+  else {
+    std::vector<Network::Accumulator>().swap(ctx->accumulators);
+  }
+
+  Network::Accumulator* mem =
+      (ctx->accumulators.empty() ? NULL : &(ctx->accumulators[0]));
+  acc = mem;
+  for (int i = 0; i < MaxPlies; ++i) {
+    ctx->node[i].acc = (mem ? (mem + i + 1) : NULL);
+  }
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::SelectEvaluator()
+{
+  ctx->nnue = (ctx->network.IsLoaded() &&
+               (ctx->optUseNNUE.GetValue() == _TRUE));
+
+  // the current position needs a fresh accumulator and evaluation,
+  // the node stack isn't wired up until the engine is initialized
+  if (ctx->initialized) {
+    RefreshAccumulator();
+    state &= ~Draw;
+    Evaluate();
+  }
+}
+
 //----------------------------------------------------------------------------
 void Bitfoot::Initialize()
 {
+  // hash options set since the last time are all that's left to do
+  if (ctx->initialized) {
+    ApplyHashOptions();
+    return;
+  }
+
   ply = 0;
-  child = _node;
+  child = ctx->node;
   parent = NULL;
+  moves = ctx->moveList[0];
+  pv = PVRow(0, 0);
+#ifndef NDEBUG
+  evals = &(ctx->evalInfo[0]);
+#endif
   for (int i = 0; i < MaxPlies; ++i) {
-    _node[i].ply = (i + 1);
-    _node[i].child = ((i + 1) < MaxPlies) ? &(_node[i + 1]) : NULL;
-    _node[i].parent = (i > 0) ? &(_node[i - 1]) : this;
-  }
-
-  _hashSize = _optHash.GetIntValue();
-  _contempt = static_cast<int>(_optContempt.GetIntValue());
-  _delta    = static_cast<int>(_optDelta.GetIntValue());
-  _futility = static_cast<int>(_optFutility.GetIntValue());
-  _rzr      = static_cast<int>(_optRZR.GetIntValue());
-  _tempo    = static_cast<int>(_optTempo.GetIntValue());
-  _test     = static_cast<int>(_optTest.GetIntValue());
-  _ext      = (_optEXT.GetValue() == _TRUE);
-  _iid      = (_optIID.GetValue() == _TRUE);
-  _lmr      = (_optLMR.GetValue() == _TRUE);
-  _nmp      = (_optNMP.GetValue() == _TRUE);
-  _nmr      = (_optNMR.GetValue() == _TRUE);
-  _oneReply = (_optOneReply.GetValue() == _TRUE);
-
+    ctx->node[i].ply = (i + 1);
+    ctx->node[i].child = ((i + 1) < MaxPlies) ? &(ctx->node[i + 1]) : NULL;
+    ctx->node[i].parent = (i > 0) ? &(ctx->node[i - 1]) : this;
+    ctx->node[i].moves = ctx->moveList[i + 1];
+    ctx->node[i].pv = PVRow((i + 1), (i + 1));
+#ifndef NDEBUG
+    ctx->node[i].evals = &(ctx->evalInfo[i + 1]);
+#endif
+  }
+  WireAccumulators();
+
+  ctx->contempt = static_cast<int>(ctx->optContempt.GetIntValue());
+  ctx->delta    = static_cast<int>(ctx->optDelta.GetIntValue());
+  ctx->futility = static_cast<int>(ctx->optFutility.GetIntValue());
+  ctx->rzr      = static_cast<int>(ctx->optRZR.GetIntValue());
+  ctx->tempo    = static_cast<int>(ctx->optTempo.GetIntValue());
+  ctx->test     = static_cast<int>(ctx->optTest.GetIntValue());
+  ctx->ext      = (ctx->optEXT.GetValue() == _TRUE);
+  ctx->iid      = (ctx->optIID.GetValue() == _TRUE);
+  ctx->lmr      = (ctx->optLMR.GetValue() == _TRUE);
+  ctx->nmp      = (ctx->optNMP.GetValue() == _TRUE);
+  ctx->nmr      = (ctx->optNMR.GetValue() == _TRUE);
+  ctx->oneReply = (ctx->optOneReply.GetValue() == _TRUE);
+
+  SetMoveOverhead(static_cast<uint64_t>(ctx->optOverhead.GetIntValue()));
   ClearHistory();
-  SetHashSize(_hashSize);
+  ApplyHashOptions();
   SetPosition(_STARTPOS);
 
-  _initialized = true;
+  ctx->initialized = true;
 }
 
 //----------------------------------------------------------------------------
 bool Bitfoot::IsInitialized() const
 {
-  return _initialized;
+  return (ctx->initialized && !ctx->hashPending);
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::ApplyHashOptions()
+{
+  if (ctx->hashPending) {
+    ctx->hashPending = false;
+    ctx->hashLoaded = false;
+    ctx->hashSize = ctx->optHash.GetIntValue();
+    SetHashSize(ctx->hashSize);
+
+    // other processes won't see a private table used in place of the
+    // shared one, the reason has already been reported
+    if (ctx->hashSize && (ctx->tt == ctx->ownTT) &&
+        !ctx->optSharedHash.GetValue().empty() &&
+        !ctx->ownTT->IsSharedMemory())
+    {
+      Output() << "Using a private hash table instead of shared memory '"
+               << ctx->optSharedHash.GetValue() << "'";
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -916,18 +1456,12 @@ const char* Bitfoot::SetPosition(const char* fen)
     return NULL;
   }
 
-  uint64_t pieces[PieceTypeCount];
   int tmpBoard[64];
-  int kingPosition[2] = { -1, -1 };
-  int materialTotal[2] = { 0, 0 };
-  int squareTotal[2] = { 0, 0 };
   int moveCount = 0;
   int reversibleCount = 0;
   int boardState = 0;
   int epSquare = NoSquare;
-  uint64_t pcKey = 0;
 
-  memset(pieces, 0, sizeof(pieces));
   memset(tmpBoard, 0, sizeof(tmpBoard));
 
   const char* p = fen;
@@ -939,100 +1473,18 @@ const char* Bitfoot::SetPosition(const char* fen)
       case '5': case '6': case '7': case '8':
         x += (*p - '1');
         break;
-      case 'B':
-        pieces[White] |= BIT(sqr);
-        pieces[WhiteBishop] |= BIT(sqr);
-        tmpBoard[sqr] = WhiteBishop;
-        materialTotal[White] += BishopValue;
-        squareTotal[White] += SquareValue(WhiteBishop, sqr);
-        pcKey ^= _HASH[White|Bishop][sqr];
-        break;
-      case 'K':
-        pieces[White] |= BIT(sqr);
-        pieces[WhiteKing] |= BIT(sqr);
-        tmpBoard[sqr] = WhiteKing;
-        kingPosition[White] = sqr;
-        pcKey ^= _HASH[White|King][sqr];
-        break;
-      case 'N':
-        pieces[White] |= BIT(sqr);
-        pieces[WhiteKnight] |= BIT(sqr);
-        tmpBoard[sqr] = WhiteKnight;
-        materialTotal[White] += KnightValue;
-        squareTotal[White] += SquareValue(WhiteKnight, sqr);
-        pcKey ^= _HASH[White|Knight][sqr];
-        break;
-      case 'P':
-        pieces[White] |= BIT(sqr);
-        pieces[WhitePawn] |= BIT(sqr);
-        tmpBoard[sqr] = WhitePawn;
-        materialTotal[White] += PawnValue;
-        squareTotal[White] += SquareValue(WhitePawn, sqr);
-        pcKey ^= _HASH[White|Pawn][sqr];
-        break;
-      case 'Q':
-        pieces[White] |= BIT(sqr);
-        pieces[WhiteQueen] |= BIT(sqr);
-        tmpBoard[sqr] = WhiteQueen;
-        materialTotal[White] += QueenValue;
-        squareTotal[White] += SquareValue(WhiteQueen, sqr);
-        pcKey ^= _HASH[White|Queen][sqr];
-        break;
-      case 'R':
-        pieces[White] |= BIT(sqr);
-        pieces[WhiteRook] |= BIT(sqr);
-        tmpBoard[sqr] = WhiteRook;
-        materialTotal[White] += RookValue;
-        squareTotal[White] += SquareValue(WhiteRook, sqr);
-        pcKey ^= _HASH[White|Rook][sqr];
-        break;
-      case 'b':
-        pieces[Black] |= BIT(sqr);
-        pieces[BlackBishop] |= BIT(sqr);
-        tmpBoard[sqr] = BlackBishop;
-        materialTotal[Black] += BishopValue;
-        squareTotal[Black] += SquareValue(BlackBishop, sqr);
-        pcKey ^= _HASH[Black|Bishop][sqr];
-        break;
-      case 'k':
-        pieces[Black] |= BIT(sqr);
-        pieces[BlackKing] |= BIT(sqr);
-        tmpBoard[sqr] = BlackKing;
-        kingPosition[Black] = sqr;
-        pcKey ^= _HASH[Black|King][sqr];
-        break;
-      case 'n':
-        pieces[Black] |= BIT(sqr);
-        pieces[BlackKnight] |= BIT(sqr);
-        tmpBoard[sqr] = BlackKnight;
-        materialTotal[Black] += KnightValue;
-        squareTotal[Black] += SquareValue(BlackKnight, sqr);
-        pcKey ^= _HASH[Black|Knight][sqr];
-        break;
-      case 'p':
-        pieces[Black] |= BIT(sqr);
-        pieces[BlackPawn] |= BIT(sqr);
-        tmpBoard[sqr] = BlackPawn;
-        materialTotal[Black] += PawnValue;
-        squareTotal[Black] += SquareValue(BlackPawn, sqr);
-        pcKey ^= _HASH[Black|Pawn][sqr];
-        break;
-      case 'q':
-        pieces[Black] |= BIT(sqr);
-        pieces[BlackQueen] |= BIT(sqr);
-        tmpBoard[sqr] = BlackQueen;
-        materialTotal[Black] += QueenValue;
-        squareTotal[Black] += SquareValue(BlackQueen, sqr);
-        pcKey ^= _HASH[Black|Queen][sqr];
-        break;
-      case 'r':
-        pieces[Black] |= BIT(sqr);
-        pieces[BlackRook] |= BIT(sqr);
-        tmpBoard[sqr] = BlackRook;
-        materialTotal[Black] += RookValue;
-        squareTotal[Black] += SquareValue(BlackRook, sqr);
-        pcKey ^= _HASH[Black|Rook][sqr];
-        break;
+      case 'B': tmpBoard[sqr] = WhiteBishop; break;
+      case 'K': tmpBoard[sqr] = WhiteKing;   break;
+      case 'N': tmpBoard[sqr] = WhiteKnight; break;
+      case 'P': tmpBoard[sqr] = WhitePawn;   break;
+      case 'Q': tmpBoard[sqr] = WhiteQueen;  break;
+      case 'R': tmpBoard[sqr] = WhiteRook;   break;
+      case 'b': tmpBoard[sqr] = BlackBishop; break;
+      case 'k': tmpBoard[sqr] = BlackKing;   break;
+      case 'n': tmpBoard[sqr] = BlackKnight; break;
+      case 'p': tmpBoard[sqr] = BlackPawn;   break;
+      case 'q': tmpBoard[sqr] = BlackQueen;  break;
+      case 'r': tmpBoard[sqr] = BlackRook;   break;
       default:
         Output() << "Invalid character at " << p;
         return NULL;
@@ -1044,11 +1496,6 @@ const char* Bitfoot::SetPosition(const char* fen)
     }
   }
 
-  if (!SINGLE_BIT(pieces[WhiteKing]) || !SINGLE_BIT(pieces[BlackKing])) {
-    Output() << "Wrong number of kings in " << fen;
-    return NULL;
-  }
-
   NextWord(p);
   switch (*p++) {
   case 'b': boardState |= Black; break;
@@ -1116,9 +1563,57 @@ const char* Bitfoot::SetPosition(const char* fen)
     }
   }
 
-  _seen.clear();
+  if (!LoadPosition(tmpBoard, boardState, epSquare, reversibleCount,
+                    moveCount))
+  {
+    return NULL;
+  }
+  return p;
+}
+
+//----------------------------------------------------------------------------
+// set the position from a board of piece codes (A1 = 0) and the parts of
+// a FEN string that follow the piece placement, return false if it's not
+// a valid position
+//----------------------------------------------------------------------------
+bool Bitfoot::LoadPosition(const int* tmpBoard, const int boardState,
+                           const int epSquare, const int reversibleCount,
+                           const int moveCount)
+{
+  uint64_t pieces[PieceTypeCount];
+  int kingPosition[2] = { -1, -1 };
+  int materialTotal[2] = { 0, 0 };
+  int squareTotal[2] = { 0, 0 };
+  uint64_t pcKey = 0;
+
+  memset(pieces, 0, sizeof(pieces));
+
+  for (int sqr = A1; sqr <= H8; ++sqr) {
+    const int piece = tmpBoard[sqr];
+    if (!piece) {
+      continue;
+    }
+    const int color = COLOR_OF(piece);
+    pieces[color] |= BIT(sqr);
+    pieces[piece] |= BIT(sqr);
+    pcKey ^= _HASH[piece][sqr];
+    if ((Black|piece) == BlackKing) {
+      kingPosition[color] = sqr;
+    }
+    else {
+      materialTotal[color] += ValueOf(piece);
+      squareTotal[color] += SquareValue(piece, sqr);
+    }
+  }
+
+  if (!SINGLE_BIT(pieces[WhiteKing]) || !SINGLE_BIT(pieces[BlackKing])) {
+    Output() << "Wrong number of kings";
+    return false;
+  }
+
+  ctx->seen.clear();
   memcpy(pc, pieces, sizeof(pc));
-  memcpy(_board, tmpBoard, sizeof(_board));
+  memcpy(ctx->board, tmpBoard, sizeof(ctx->board));
   memcpy(king, kingPosition, sizeof(king));
   memcpy(material, materialTotal, sizeof(material));
   memcpy(sqrVal, squareTotal, sizeof(sqrVal));
@@ -1134,6 +1629,7 @@ const char* Bitfoot::SetPosition(const char* fen)
   ep             = epSquare;
   rcount         = reversibleCount;
   pieceKey       = pcKey;
+  materialKey    = CalcMaterialKey();
   positionKey    = (pcKey ^ _HASH[0][state & StateMask] ^ _HASH[1][ep]);
   kcross[White]  = RookXO(king[White]);
   kcross[Black]  = RookXO(king[Black]);
@@ -1154,12 +1650,71 @@ const char* Bitfoot::SetPosition(const char* fen)
       : AttackedBy<White>(king[Black]))
   {
     Output() << "Side to move can take enemy king!";
-    return NULL;
+    return false;
   }
 
+  RefreshAccumulator();
   Evaluate();
 
-  return p;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Bitfoot::SetPackedPosition(const PackedPosition& packed)
+{
+  int tmpBoard[64];
+  memset(tmpBoard, 0, sizeof(tmpBoard));
+
+  if (BitCount(packed.occupied) > 32) {
+    Output() << "Too many pieces in packed position";
+    return false;
+  }
+
+  int index = 0;
+  for (uint64_t occ = packed.occupied; occ; occ &= (occ - 1), ++index) {
+    const int piece = ((packed.pieces[index / 2] >> (4 * (index & 1))) & 0xF);
+    if ((piece < WhitePawn) || (piece > BlackKing)) {
+      Output() << "Invalid piece code in packed position: " << piece;
+      return false;
+    }
+    tmpBoard[LowSquare(occ)] = piece;
+  }
+
+  const int boardState = (packed.flags & StateMask);
+  int epSquare = NoSquare;
+  if (packed.ep != 0xFF) {
+    epSquare = packed.ep;
+    if (NOT_SQUARE(epSquare) ||
+        (YC(epSquare) != ((boardState & Black) ? 2 : 5)))
+    {
+      Output() << "Invalid en passant square in packed position";
+      return false;
+    }
+  }
+
+  return LoadPosition(tmpBoard, boardState, epSquare, packed.rcount,
+                      packed.moveNumber);
+}
+
+//----------------------------------------------------------------------------
+void Bitfoot::GetPackedPosition(PackedPosition& packed) const
+{
+  memset(&packed, 0, sizeof(packed));
+
+  int index = 0;
+  for (int sqr = A1; sqr <= H8; ++sqr) {
+    const int piece = ctx->board[sqr];
+    if (piece) {
+      packed.occupied |= BIT(sqr);
+      packed.pieces[index / 2] |= (piece << (4 * (index & 1)));
+      index++;
+    }
+  }
+
+  packed.flags = static_cast<uint8_t>(state & StateMask);
+  packed.ep = static_cast<uint8_t>(IS_SQUARE(ep) ? ep : 0xFF);
+  packed.moveNumber = static_cast<uint16_t>((mcount + 1) / 2);
+  packed.rcount = static_cast<uint8_t>(std::min<int>(rcount, 0xFF));
 }
 
 //----------------------------------------------------------------------------
@@ -1174,8 +1729,8 @@ const char* Bitfoot::MakeMove(const char* str)
 
   int from  = SQR(TO_X(str[0]), TO_Y(str[1]));
   int to    = SQR(TO_X(str[2]), TO_Y(str[3]));
-  int pc    = _board[from];
-  int cap   = _board[to];
+  int pc    = ctx->board[from];
+  int cap   = ctx->board[to];
   int promo = 0;
 
   const char* p = (str + 4);
@@ -1242,7 +1797,7 @@ std::string Bitfoot::GetFEN() const
   // piece positions
   for (int y = 7; y >= 0; --y) {
     for (int x = 0; x < 8; ++x) {
-      if ((type = _board[SQR(x,y)]) && empty) {
+      if ((type = ctx->board[SQR(x,y)]) && empty) {
         *p++ = ('0' + empty);
         empty = 0;
       }
@@ -1331,7 +1886,7 @@ void Bitfoot::PrintBoard() const
 
   for (int y = 7; y >= 0; --y) {
     for (int x = 0; x < 8; ++x) {
-      switch (_board[SQR(x, y)]) {
+      switch (ctx->board[SQR(x, y)]) {
       case WhitePawn:   out << " P"; break;
       case WhiteKnight: out << " N"; break;
       case WhiteBishop: out << " B"; break;
@@ -1390,20 +1945,20 @@ void Bitfoot::PrintBoard() const
   }
 
 #ifndef NDEBUG
-  if (_debug) {
-    out << "\nMaterial: " << material[White]       << ", " << material[Black]
-        << "\nSqrVal:   " << sqrVal[White]         << ", " << sqrVal[Black]
-        << "\nPins:     " << evals.pc[White]       << ". " << evals.pc[Black]
-        << "\nPawns:    " << pinfo[White].score    << ", " << pinfo[Black].score
-        << "\nPassers:  " << evals.pc[WhitePawn]   << ", " << evals.pc[BlackPawn]
-        << "\nKnights:  " << evals.pc[WhiteKnight] << ", " << evals.pc[BlackKnight]
-        << "\nBishops:  " << evals.pc[WhiteBishop] << ", " << evals.pc[BlackBishop]
-        << "\nRooks:    " << evals.pc[WhiteRook]   << ", " << evals.pc[BlackRook]
-        << "\nQueens:   " << evals.pc[WhiteQueen]  << ", " << evals.pc[BlackQueen]
-        << "\nKings:    " << evals.pc[WhiteKing]   << ", " << evals.pc[BlackKing]
-        << "\nLoose:    " << evals.loose[White]    << ", " << evals.loose[Black]
-        << "\nCoverage: " << evals.coverage[White] << ", " << evals.coverage[Black]
-        << "\nSpace:    " << evals.space[White]    << ", " << evals.space[Black];
+  if (IsDebugOn()) {
+    out << "\nMaterial: " << material[White]        << ", " << material[Black]
+        << "\nSqrVal:   " << sqrVal[White]          << ", " << sqrVal[Black]
+        << "\nPins:     " << evals->pc[White]       << ". " << evals->pc[Black]
+        << "\nPawns:    " << pinfo[White].score     << ", " << pinfo[Black].score
+        << "\nPassers:  " << evals->pc[WhitePawn]   << ", " << evals->pc[BlackPawn]
+        << "\nKnights:  " << evals->pc[WhiteKnight] << ", " << evals->pc[BlackKnight]
+        << "\nBishops:  " << evals->pc[WhiteBishop] << ", " << evals->pc[BlackBishop]
+        << "\nRooks:    " << evals->pc[WhiteRook]   << ", " << evals->pc[BlackRook]
+        << "\nQueens:   " << evals->pc[WhiteQueen]  << ", " << evals->pc[BlackQueen]
+        << "\nKings:    " << evals->pc[WhiteKing]   << ", " << evals->pc[BlackKing]
+        << "\nLoose:    " << evals->loose[White]    << ", " << evals->loose[Black]
+        << "\nCoverage: " << evals->coverage[White] << ", " << evals->coverage[Black]
+        << "\nSpace:    " << evals->space[White]    << ", " << evals->space[Black];
   }
 #endif
 
@@ -1419,7 +1974,11 @@ bool Bitfoot::WhiteToMove() const
 //----------------------------------------------------------------------------
 void Bitfoot::ClearSearchData()
 {
-  ClearHash();
+  // tables kept in a file or shared memory, or loaded from a file, are
+  // there to be reused, only "Clear Hash" clears them
+  if (!ctx->ownTT->IsMapped() && !ctx->hashLoaded) {
+    ClearHash();
+  }
   ClearHistory();
   ClearKillers();
 }
@@ -1439,13 +1998,57 @@ void Bitfoot::Quit()
 
 //----------------------------------------------------------------------------
 void Bitfoot::ResetStatsTotals() {
-  _totalStats.Clear();
+  ctx->totalStats.Clear();
 }
 
 //----------------------------------------------------------------------------
 void Bitfoot::ShowStatsTotals() const {
   Output() << "--- Averaged Stats";
-  _totalStats.Average().Print();
+  ctx->totalStats.Average().Print();
+}
+
+//----------------------------------------------------------------------------
+std::string Bitfoot::StatsTotalsJSON() const {
+  return ctx->totalStats.ToJSON();
+}
+
+//----------------------------------------------------------------------------
+bool Bitfoot::IsPrivateOption(const std::string& name) const
+{
+  // one trace file per process, and child processes get tables of their own
+  return (!stricmp(name.c_str(), ctx->optTrace.GetName().c_str()) ||
+          !stricmp(name.c_str(), ctx->optHashFile.GetName().c_str()) ||
+          !stricmp(name.c_str(), ctx->optSharedHash.GetName().c_str()));
+}
+
+//----------------------------------------------------------------------------
+bool Bitfoot::SaveHashTable(const std::string& fileName)
+{
+  return ctx->tt->Save(fileName);
+}
+
+//----------------------------------------------------------------------------
+bool Bitfoot::LoadHashTable(const std::string& fileName)
+{
+  // a shared table belongs to the engine it's shared from
+  if (ctx->tt != ctx->ownTT) {
+    Output() << "Cannot load into a shared hash table";
+    return false;
+  }
+  if (!ctx->ownTT->Load(fileName)) {
+    ctx->hashPending = true;
+    ApplyHashOptions();
+    return false;
+  }
+  ctx->hashPending = false;
+  ctx->hashLoaded = true;
+
+  // keep the option in step with the size of the loaded table
+  const uint64_t mbytes = ctx->ownTT->GetMBytes();
+  if (mbytes && ctx->optHash.SetValue(std::to_string(mbytes))) {
+    ctx->hashSize = static_cast<int64_t>(mbytes);
+  }
+  return true;
 }
 
 //----------------------------------------------------------------------------
@@ -1458,33 +2061,36 @@ void Bitfoot::GetStats(int* depth,
                       char* move,
                       const size_t movelen) const
 {
+  // may be called from the timer thread while the search is running,
+  // so only read the snapshot the search thread published
+  const ProgressInfo info = ctx->progress.Read();
   if (depth) {
-    *depth = _depth;
+    *depth = info.depth;
   }
   if (seldepth) {
-    *seldepth = _seldepth;
+    *seldepth = info.seldepth;
   }
   if (nodes) {
-    *nodes = (_stats.snodes + _stats.qnodes);
+    *nodes = info.nodes;
   }
   if (qnodes) {
-    *qnodes = _stats.qnodes;
+    *qnodes = info.qnodes;
   }
   if (msecs) {
-    *msecs = (Now() - _startTime);
+    *msecs = (Now() - GetStartTime());
   }
   if (movenum) {
-    *movenum = _movenum;
+    *movenum = info.movenum;
   }
   if (move && movelen) {
-    snprintf(move, movelen, "%s", _currmove.c_str());
+    snprintf(move, movelen, "%s", Move(info.moveBits).ToString().c_str());
   }
 }
 
 //----------------------------------------------------------------------------
 uint64_t Bitfoot::MyPerft(const int depth)
 {
-  if (!_initialized) {
+  if (!ctx->initialized) {
     Output() << "Engine not initialized";
     return 0;
   }
@@ -1494,8 +2100,9 @@ uint64_t Bitfoot::MyPerft(const int depth)
   const int d = std::min<int>(depth, MaxPlies);
   const uint64_t count = WhiteToMove() ? PerftSearchRoot<White>(d)
                                        : PerftSearchRoot<Black>(d);
+  PublishProgress();
 
-  const uint64_t msecs = (Now() - _startTime);
+  const uint64_t msecs = (Now() - GetStartTime());
   Output() << "Perft " << count << ' ' << Rate((count / 1000), msecs)
            << " KLeafs/sec";
 
@@ -1510,28 +2117,67 @@ std::string Bitfoot::MyGo(const int depth,
                          const uint64_t /*btime*/, const uint64_t /*binc*/,
                          std::string* /*ponder*/)
 {
-  if (!_initialized) {
+  if (!ctx->initialized) {
     Output() << "Engine not initialized";
     return std::string();
   }
 
+  // book moves are played without searching
+  if ((ctx->optOwnBook.GetValue() == _TRUE) && ctx->book.IsOpen()) {
+    const std::string bookMove = GetBookMove();
+    if (bookMove.size()) {
+      return bookMove;
+    }
+  }
+
   InitSearch();
 
   int d = std::min<int>(depth, MaxPlies);
   if (d <= 0) {
     d = MaxPlies;
   }
-  std::string bestmove = (WhiteToMove() ? SearchRoot<White>(d)
-                                        : SearchRoot<Black>(d));
+  ctx->features = ((ctx->ext            ? UseEXT        : 0) |
+                   (ctx->iid            ? UseIID        : 0) |
+                   (ctx->lmr            ? UseLMR        : 0) |
+                   (ctx->nmp            ? UseNMP        : 0) |
+                   (ctx->nmr            ? UseNMR        : 0) |
+                   (ctx->oneReply       ? UseOneReply   : 0) |
+                   ((ctx->test & 1)     ? UseNullThreat : 0) |
+                   ((ctx->test & 4)     ? UseThreatExt  : 0) |
+                   (IsDebugOn()         ? CollectStats  : 0) |
+                   (ctx->trace.IsOpen() ? UseTrace      : 0));
+
+  if (ctx->trace.IsOpen()) {
+    ctx->trace.Begin(GetFEN());
+  }
 
-  _totalStats += _stats;
-  if (_debug) {
-    Output() << "--- Stats";
-    Output() << _tt.GetStores() << " stores, " << _tt.GetHits() << " hits, "
-             << _tt.GetCheckmates() << " checkmates, "
-             << _tt.GetStalemates() << " stalemates";
+  // use the fully specialized search kernel when possible
+  std::string bestmove;
+  if (ctx->features == DefaultFeatures) {
+    bestmove = (WhiteToMove() ? SearchRoot<White, DefaultFeatures>(d)
+                              : SearchRoot<Black, DefaultFeatures>(d));
+  }
+  else {
+    bestmove = (WhiteToMove() ? SearchRoot<White, GenericSearch>(d)
+                              : SearchRoot<Black, GenericSearch>(d));
+  }
 
-    _stats.Print();
+  PublishProgress();
+  ctx->trace.Flush();
+  ctx->stats.collected = ((ctx->features & CollectStats) ? 1 : 0);
+  ctx->totalStats += ctx->stats;
+  if (IsDebugOn()) {
+    Output() << "--- Stats";
+    Output() << ctx->tt->GetStores() << " stores, "
+             << ctx->tt->GetHits() << " hits, "
+             << ctx->tt->GetCheckmates() << " checkmates, "
+             << ctx->tt->GetStalemates() << " stalemates";
+    Output() << sizeof(Bitfoot) << " bytes per node, "
+             << ((sizeof(ctx->moveList) + sizeof(ctx->pvTable)) /
+                 (MaxPlies + 1))
+             << " bytes per ply in cold storage";
+
+    ctx->stats.Print();
   }
 
   return bestmove;
@@ -7,16 +7,68 @@
 
 #include "senjo/ChessEngine.h"
 #include "senjo/Output.h"
+#include "Bitbase.h"
+#include "Book.h"
 #include "HashTable.h"
+#include "Material.h"
 #include "Diff.h"
+#include "Engine.h"
+#include "Network.h"
+#include "PackedPosition.h"
+#include "Params.h"
+#include "Progress.h"
 #include "Stats.h"
+#include "Trace.h"
 
 namespace bitfoot
 {
 
 class Bitfoot : public senjo::ChessEngine
 {
+  friend class Engine;
+
 public:
+  //--------------------------------------------------------------------------
+  // every Bitfoot is an independent engine with its own search state, so
+  // any number of them may search at the same time on different threads
+  //--------------------------------------------------------------------------
+  Bitfoot();
+  ~Bitfoot();
+
+  //--------------------------------------------------------------------------
+  // search with another engine's transposition table instead of this one's,
+  // the owner controls the table size but the table lives until the last
+  // engine using it is gone, pass NULL to go back to a private table of the
+  // 'Hash' option size
+  //--------------------------------------------------------------------------
+  void ShareHashTable(Bitfoot* owner);
+
+  //--------------------------------------------------------------------------
+  // methods behind the Engine interface, these never write search output
+  // (implemented in Bitfoot.cpp)
+  //--------------------------------------------------------------------------
+  int StaticEval(EvalTerms* terms);
+  int QSearchScore();
+  void Search(const SearchLimits& limits, SearchResult& result);
+  uint64_t CountLeaves(const int depth);
+
+  //--------------------------------------------------------------------------
+  // set or get the current position without going through FEN text
+  // (implemented in Bitfoot.cpp)
+  //--------------------------------------------------------------------------
+  bool SetPackedPosition(const PackedPosition& packed);
+  void GetPackedPosition(PackedPosition& packed) const;
+
+#ifdef BITFOOT_TUNE
+  //--------------------------------------------------------------------------
+  // tuning builds only: every evaluation parameter, and a dump of their
+  // current values laid out the way they are declared in the source
+  // (implemented in Bitfoot.cpp)
+  //--------------------------------------------------------------------------
+  static void GetEvalParams(std::vector<EvalParam>& params);
+  static void PrintEvalParams(FILE* fp);
+#endif
+
   //--------------------------------------------------------------------------
   // senjo::ChessEngine methods (implemented in Bitfoot.cpp)
   //--------------------------------------------------------------------------
@@ -38,6 +90,10 @@ public:
   void Quit();
   void ResetStatsTotals();
   void ShowStatsTotals() const;
+  std::string StatsTotalsJSON() const;
+  bool IsPrivateOption(const std::string& name) const;
+  bool SaveHashTable(const std::string& fileName);
+  bool LoadHashTable(const std::string& fileName);
   void GetStats(int* depth,
                 int* seldepth = NULL,
                 uint64_t* nodes = NULL,
@@ -60,13 +116,31 @@ protected:
                    std::string* ponder = NULL);
 
 private:
+  struct Context;
+  explicit Bitfoot(Context* context);
+  Bitfoot(const Bitfoot&);
+  Bitfoot& operator=(const Bitfoot&);
+
+  bool LoadPosition(const int* board, const int boardState,
+                    const int epSquare, const int reversibleCount,
+                    const int moveCount);
+  bool LoadBitbases(const std::string& dir);
+  bool LoadBook(const std::string& fileName);
+  std::string GetBookMove();
+  uint64_t PolyglotKey() const;
+  bool LoadNetwork(const std::string& fileName);
+  void SelectEvaluator();
+  void WireAccumulators();
+  void ApplyHashOptions();
+
   static void PrintBitmap(const uint64_t map);
 
   //--------------------------------------------------------------------------
-  static const int      _PIECE_SQR[PieceTypeCount - 2][64];
-  static const int      _VALUE_OF[PieceTypeCount];
+  static EVAL_CONST int _PIECE_SQR[PieceTypeCount - 2][64];
+  static EVAL_CONST int _VALUE_OF[PieceTypeCount];
   static const int      _TOUCH[64];
-  static const int      _ATK_WEIGHT[100];
+  static EVAL_CONST int _ATK_WEIGHT[100];
+  static EVAL_CONST int _PASSER_RANK[8];
   static const uint64_t _ALL;
   static const uint64_t _CENTER4;
   static const uint64_t _CENTER16;
@@ -93,48 +167,6 @@ private:
   static const uint64_t _WIDE_NORTH[64];
   static const uint64_t _WIDE_SOUTH[64];
 
-  //--------------------------------------------------------------------------
-  static bool                _ext;            // check extensions
-  static bool                _iid;            // internal iterative deepening
-  static bool                _initialized;    // is the engine initialized?
-  static bool                _lmr;            // late move reductions
-  static bool                _nmp;            // null move pruning
-  static bool                _nmr;            // null move reductions
-  static bool                _oneReply;       // one reply extenstions
-  static char                _hist[0x10000];  // move performance history
-  static int                 _board[64];      // piece positions
-  static int                 _contempt;       // contempt for draw value
-  static int                 _delta;          // delta pruning margin
-  static int                 _depth;          // current root search depth
-  static int                 _drawScore[2];   // score for getting a draw
-  static int                 _futility;       // futility pruning delta
-  static int                 _movenum;        // current root search move number
-  static int                 _rzr;            // razoring delta
-  static int                 _seldepth;       // current selective search depth
-  static int                 _tempo;          // tempo bonus for side to move
-  static int                 _test;           // new feature test value
-  static std::string         _currmove;       // current root search move
-  static int64_t             _hashSize;       // transposition table byte size
-  static Bitfoot             _node[MaxPlies]; // the node stack
-  static std::set<uint64_t>  _seen;           // position keys already seen
-  static Stats               _stats;          // misc counters
-  static Stats               _totalStats;     // sum of misc counters
-  static TranspositionTable  _tt;             // info about visited positions
-  static senjo::EngineOption _optHash;        // hash size option
-  static senjo::EngineOption _optClearHash;   // clear hash option
-  static senjo::EngineOption _optContempt;    // contempt for draw option
-  static senjo::EngineOption _optDelta;       // delta pruning margin option
-  static senjo::EngineOption _optEXT;         // check extensions option
-  static senjo::EngineOption _optFutility;    // futility pruning option
-  static senjo::EngineOption _optIID;         // intrnl iterative deepening opt
-  static senjo::EngineOption _optLMR;         // late move reductions option
-  static senjo::EngineOption _optNMP;         // null move pruning option
-  static senjo::EngineOption _optNMR;         // null move reduction option
-  static senjo::EngineOption _optOneReply;    // one reply extensions option
-  static senjo::EngineOption _optRZR;         // razoring delta option
-  static senjo::EngineOption _optTempo;       // tempo bonus option
-  static senjo::EngineOption _optTest;        // new feature testing option
-
   //--------------------------------------------------------------------------
   struct PawnInfo {
     uint64_t backward;
@@ -147,12 +179,112 @@ private:
     int      score;
   };
 
+#ifndef NDEBUG
+  //--------------------------------------------------------------------------
+  struct EvalInfo {
+    int pc[PieceTypeCount];
+    int loose[2];
+    int coverage[2];
+    int space[2];
+  };
+#endif
+
+  //--------------------------------------------------------------------------
+  // everything one engine instance shares between the root and its node
+  // stack, every Bitfoot created with the public constructor has its own
+  //--------------------------------------------------------------------------
+  struct Context {
+    explicit Context(Bitfoot* root);
+    ~Context();
+
+    Bitfoot*                   root;           // the engine that owns this
+    const std::atomic<int>*    stop;           // root's stop flags
+    std::shared_ptr<const Bitbases> bitbases;  // endgame bitbases, or NULL
+    bool                       ext;            // check extensions
+    bool                       hashLoaded;     // table came from LoadHashTable
+    bool                       hashPending;    // table not sized to options
+    bool                       iid;            // internal iterative deepening
+    bool                       initialized;    // is the engine initialized?
+    bool                       lmr;            // late move reductions
+    bool                       nnue;           // evaluate with the network
+    bool                       nmp;            // null move pruning
+    bool                       nmr;            // null move reductions
+    bool                       oneReply;       // one reply extenstions
+    char                       hist[0x10000];  // move performance history
+    int                        bitbasePieces;  // max pieces to probe
+    int                        board[64];      // piece positions
+    int                        contempt;       // contempt for draw value
+    int                        delta;          // delta pruning margin
+    int                        depth;          // current root search depth
+    int                        drawScore[2];   // score for getting a draw
+    int                        features;       // runtime search features
+    int                        futility;       // futility pruning delta
+    int                        movenum;        // current root search move num
+    int                        pvDepth;        // depth of last reported pv
+    int                        rzr;            // razoring delta
+    int                        seldepth;       // current selective depth
+    int                        tempo;          // tempo bonus for side to move
+    int                        test;           // new feature test value
+    int64_t                    hashSize;       // transposition table MB
+    uint64_t                   nodeLimit;      // search node limit, 0 = none
+    Book                       book;           // opening book
+    MaterialEntry              matTable[MaterialSlots]; // material eval cache
+    Move                       currmove;       // current root search move
+    Network                    network;        // evaluation network
+    Progress                   progress;       // snapshot for other threads
+    SearchTrace                trace;          // search tree trace writer
+    Bitfoot*                   node;           // the node stack
+    std::set<uint64_t>         seen;           // position keys already seen
+    Stats                      stats;          // misc counters
+    Stats                      totalStats;     // sum of misc counters
+    std::shared_ptr<TranspositionTable> ownTT; // this engine's hash table
+    std::shared_ptr<TranspositionTable> tt;    // ownTT or a shared table
+    senjo::EngineOption        optHash;        // hash size option
+    senjo::EngineOption        optHashFile;    // file backed hash option
+    senjo::EngineOption        optSharedHash;  // shared memory hash option
+    senjo::EngineOption        optBitbasePath; // endgame bitbases option
+    senjo::EngineOption        optBookFile;    // opening book file option
+    senjo::EngineOption        optClearHash;   // clear hash option
+    senjo::EngineOption        optContempt;    // contempt for draw option
+    senjo::EngineOption        optDelta;       // delta pruning margin option
+    senjo::EngineOption        optEvalFile;    // network file option
+    senjo::EngineOption        optEXT;         // check extensions option
+    senjo::EngineOption        optFutility;    // futility pruning option
+    senjo::EngineOption        optIID;         // intrnl iterative deepening
+    senjo::EngineOption        optLMR;         // late move reductions option
+    senjo::EngineOption        optOverhead;    // move overhead option
+    senjo::EngineOption        optOwnBook;     // use opening book option
+    senjo::EngineOption        optNMP;         // null move pruning option
+    senjo::EngineOption        optNMR;         // null move reduction option
+    senjo::EngineOption        optOneReply;    // one reply extensions option
+    senjo::EngineOption        optRZR;         // razoring delta option
+    senjo::EngineOption        optTempo;       // tempo bonus option
+    senjo::EngineOption        optTest;        // new feature testing option
+    senjo::EngineOption        optTrace;       // search trace file option
+    senjo::EngineOption        optUseNNUE;     // network evaluation option
+
+    // per-ply storage that is rarely touched, kept out of the node stack
+    Move                       moveList[MaxPlies + 1][MaxMoves];
+    Move                       pvTable[PVTableSize];
+    std::vector<Network::Accumulator> accumulators; // only with a network
+#ifndef NDEBUG
+    EvalInfo                   evalInfo[MaxPlies + 1];
+#endif
+  };
+
   //--------------------------------------------------------------------------
   // unchanging variables
   //--------------------------------------------------------------------------
-  Bitfoot* parent;
-  Bitfoot* child;
-  int      ply;
+  Context*  ctx;
+  Bitfoot*  parent;
+  Bitfoot*  child;
+  Move*     moves;
+  Move*     pv;
+  Network::Accumulator* acc;
+#ifndef NDEBUG
+  EvalInfo* evals;
+#endif
+  int       ply;
 
   //--------------------------------------------------------------------------
   // variables updated by Exec() - in approximate order of update
@@ -170,27 +302,19 @@ private:
   int      sqrVal[2];
   int      rcount;
   uint64_t pieceKey;
+  uint64_t materialKey;
   uint64_t positionKey;
   uint64_t kcross[2];
   uint64_t kdiags[2];
   uint64_t chkrs;
-  PawnInfo pinfo[2];
 
   //--------------------------------------------------------------------------
   // variables updated by Evaluate() - which is called by Exec()
   //--------------------------------------------------------------------------
-#ifndef NDEBUG
-  struct EvalInfo {
-    int pc[PieceTypeCount];
-    int loose[2];
-    int coverage[2];
-    int space[2];
-  };
-  EvalInfo evals;
-#endif
   uint64_t atks[PieceTypeCount];
+  uint64_t atks2[PieceTypeCount];
+  uint64_t atkCounts[2][3]; // attackers per square, bit sliced, sans kings
   uint64_t pinned[2];
-  uint64_t slider[64];
   int      atkCount[2];
   int      atkScore[2];
   int      standPat;
@@ -198,7 +322,6 @@ private:
   //--------------------------------------------------------------------------
   // variables updated by move generator
   //--------------------------------------------------------------------------
-  Move     moves[MaxMoves];
   uint64_t movegenKey;
   int      moveStage;
   int      moveCount;
@@ -213,7 +336,22 @@ private:
   int  nullMoveOk;
   int  pvCount;
   Move killer[2];
-  Move pv[MaxPlies];
+
+  //--------------------------------------------------------------------------
+  // larger tables updated by Evaluate(), placed last so the variables above
+  // share as few cache lines as possible
+  //--------------------------------------------------------------------------
+  PawnInfo pinfo[2];
+  uint64_t slider[64];
+
+  //--------------------------------------------------------------------------
+  inline void CheckNodeLimit() const {
+    if (ctx->nodeLimit &&
+        ((ctx->stats.snodes + ctx->stats.qnodes) >= ctx->nodeLimit))
+    {
+      ctx->root->Stop(Timeout);
+    }
+  }
 
   //--------------------------------------------------------------------------
   inline uint64_t Empty()       const { return ~(pc[White] | pc[Black]); }
@@ -222,7 +360,47 @@ private:
 
   //--------------------------------------------------------------------------
   inline bool IsDraw() const {
-    return ((state & Draw) || (rcount >= 100) || _seen.count(positionKey));
+    return ((state & Draw) || (rcount >= 100) || ctx->seen.count(positionKey));
+  }
+
+  //--------------------------------------------------------------------------
+  // win/draw/loss for the side to move from the endgame bitbases
+  //--------------------------------------------------------------------------
+  inline Bitbases::Result BitbaseResult() const {
+    if (!ctx->bitbases || (state & CastleMask) || (ep != NoSquare)) {
+      return Bitbases::NotFound;
+    }
+
+    int count = 0;
+    int pieces[Bitbases::MaxPieces];
+    int squares[Bitbases::MaxPieces];
+    for (uint64_t bits = Occupied(); bits; bits &= (bits - 1)) {
+      if (count >= Bitbases::MaxPieces) {
+        return Bitbases::NotFound;
+      }
+      const int sqr = LowSquare(bits);
+      pieces[count] = ctx->board[sqr];
+      squares[count++] = sqr;
+    }
+    return ctx->bitbases->Probe(count, pieces, squares, ColorToMove());
+  }
+
+  //--------------------------------------------------------------------------
+  // search score from the endgame bitbases, false if there's no table for
+  // this position or it has as many pieces as the root
+  //--------------------------------------------------------------------------
+  inline bool ProbeBitbase(int& score) const {
+    if (!ctx->bitbasePieces || (BitCount(Occupied()) > ctx->bitbasePieces)) {
+      return false;
+    }
+
+    switch (BitbaseResult()) {
+    case Bitbases::Win:  score = (BitbaseScore - ply); return true;
+    case Bitbases::Loss: score = (ply - BitbaseScore); return true;
+    case Bitbases::Draw: score = ctx->drawScore[ColorToMove()]; return true;
+    default:
+      return false;
+    }
   }
 
   //--------------------------------------------------------------------------
@@ -233,12 +411,12 @@ private:
   //--------------------------------------------------------------------------
   inline int RazorDelta(const int depth) const {
     const int x = (64 * depth);
-    return (_rzr + (x * (x / 128)));
+    return (ctx->rzr + (x * (x / 128)));
   }
 
   //--------------------------------------------------------------------------
   inline int FutilityDelta(const int depth) const {
-    const int x = (_futility * depth);
+    const int x = (ctx->futility * depth);
     return std::max<int>(x, (x * (x / 256)));
   }
 
@@ -269,19 +447,22 @@ private:
 
   //--------------------------------------------------------------------------
   void SetHashSize(const int64_t mbytes) {
-    if (!_tt.Resize(mbytes)) {
+    // a shared table belongs to the engine it's shared from
+    if ((ctx->tt == ctx->ownTT) && !ctx->ownTT->Resize(mbytes)) {
       senjo::Output() << "cannot allocate hash table of " << mbytes << " MB";
     }
   }
 
   //--------------------------------------------------------------------------
   void ClearHash() {
-    _tt.Clear();
+    if (ctx->tt == ctx->ownTT) {
+      ctx->ownTT->Clear();
+    }
   }
 
   //--------------------------------------------------------------------------
   void ClearHistory() {
-    memset(_hist, 0, sizeof(_hist));
+    memset(ctx->hist, 0, sizeof(ctx->hist));
   }
 
   //--------------------------------------------------------------------------
@@ -289,8 +470,8 @@ private:
     killer[0].Clear();
     killer[1].Clear();
     for (int i = 0; i < MaxPlies; ++i) {
-      _node[i].killer[0].Clear();
-      _node[i].killer[1].Clear();
+      ctx->node[i].killer[0].Clear();
+      ctx->node[i].killer[1].Clear();
     }
   }
 
@@ -299,8 +480,8 @@ private:
     assert(depth >= 0);
     if (!check) {
       const int idx = move.GetHistoryIndex();
-      const int val = (_hist[idx] + depth + 2);
-      _hist[idx] = static_cast<char>(std::min<int>(val, 40));
+      const int val = (ctx->hist[idx] + depth + 2);
+      ctx->hist[idx] = static_cast<char>(std::min<int>(val, 40));
     }
   }
 
@@ -308,8 +489,8 @@ private:
   inline void DecHistory(const Move& move, const bool check) {
     if (!check) {
       const int idx = move.GetHistoryIndex();
-      const int val = (_hist[idx] - 1);
-      _hist[idx] = static_cast<char>(std::max<int>(val, -2));
+      const int val = (ctx->hist[idx] - 1);
+      ctx->hist[idx] = static_cast<char>(std::max<int>(val, -2));
     }
   }
 
@@ -326,36 +507,107 @@ private:
     return ((move == killer[0]) || (move == killer[1]));
   }
 
+  //--------------------------------------------------------------------------
+  // Every node's pv points into a row of the PV table at the node's own
+  // ply, so the child's line is already in place behind this ply's slot of
+  // the child's row.  Rather than copying it, this node takes the child's
+  // row and gives it this one, which the child's next search overwrites.
   //--------------------------------------------------------------------------
   inline void UpdatePV(const Move& move) {
-    pv[0] = move;
+    pvCount = 1;
     if (child) {
-      if ((pvCount = (child->pvCount + 1)) > 1) {
-        assert(pvCount <= MaxPlies);
-        memcpy((pv + 1), child->pv, (child->pvCount * sizeof(Move)));
-      }
+      assert(child->pvCount <= (MaxPlies - ply));
+      Move* line = (child->pv - 1);
+      child->pv = (pv + 1);
+      pv = line;
+      pvCount += child->pvCount;
     }
-    else {
-      pvCount = 1;
+    pv[0] = move;
+  }
+
+  //--------------------------------------------------------------------------
+  // start of the given ply in the given row of the PV table, each row holds
+  // one move per ply so rows can trade places between a node and its child
+  //--------------------------------------------------------------------------
+  inline Move* PVRow(const int row, const int ply) const {
+    assert((row >= 0) && (row <= MaxPlies));
+    assert((ply >= 0) && (ply <= MaxPlies));
+    return (ctx->pvTable + (row * (MaxPlies + 1)) + ply);
+  }
+
+  //--------------------------------------------------------------------------
+  // extend a pv that was cut short (by hash table cutoffs or search stop)
+  // with the best moves stored in the transposition table
+  //--------------------------------------------------------------------------
+  template<Color color>
+  void ExtendPV(Move* line, const int idx, int& count, const int limit) {
+    if (idx < count) {
+      Exec<color>(line[idx], *child);
+      child->ExtendPV<!color>(line, (idx + 1), count, limit);
+      Undo<color>(line[idx]);
+      return;
+    }
+
+    if ((count >= limit) || !child || (state & Draw)) {
+      return;
+    }
+
+    HashEntry  hashEntry;
+    HashEntry* entry = ctx->tt->Probe(positionKey, hashEntry, ply);
+    if (!entry || !entry->moveBits) {
+      return;
+    }
+
+    // only trust the hash move if it's in the list of legal moves
+    const Move ttMove(entry->moveBits, entry->score);
+    GenerateMoves<color>();
+    for (int i = 0; i < moveCount; ++i) {
+      if (moves[i] == ttMove) {
+        line[count++] = moves[i];
+        Exec<color>(moves[i], *child);
+        child->ExtendPV<!color>(line, (idx + 1), count, limit);
+        Undo<color>(moves[i]);
+        break;
+      }
     }
   }
 
+  //--------------------------------------------------------------------------
+  // make current search progress visible to GetStats() on other threads
+  //--------------------------------------------------------------------------
+  void PublishProgress() const {
+    ProgressInfo info;
+    info.depth    = ctx->depth;
+    info.seldepth = ctx->seldepth;
+    info.movenum  = ctx->movenum;
+    info.moveBits = ctx->currmove.GetBits();
+    info.nodes    = (ctx->stats.snodes + ctx->stats.qnodes);
+    info.qnodes   = ctx->stats.qnodes;
+    ctx->progress.Publish(info);
+  }
+
   //--------------------------------------------------------------------------
   void OutputPV(const int score, const int bound = 0) const {
-    if (pvCount > 0) {
-      const uint64_t msecs = (senjo::Now() - _startTime);
+    if (!bound) {
+      ctx->pvDepth = ctx->depth;
+      if (pvCount > 0) {
+        ctx->root->ReportBestMove(pv[0].ToString());
+      }
+    }
+    if ((pvCount > 0) && !IsQuiet()) {
+      const uint64_t msecs = (senjo::Now() - GetStartTime());
       senjo::Output out(senjo::Output::NoPrefix);
 
-      const uint64_t nodes = (_stats.snodes + _stats.qnodes);
-      out << "info depth " << _depth
-          << " seldepth " << _seldepth
+      const uint64_t nodes = (ctx->stats.snodes + ctx->stats.qnodes);
+      out << "info depth " << ctx->depth
+          << " seldepth " << ctx->seldepth
           << " nodes " << nodes
           << " time " << msecs
           << " nps " << static_cast<uint64_t>(senjo::Rate(nodes, msecs));
 
       if (bound) {
-        out << " currmovenumber " << _movenum
-            << " currmove " << _currmove;
+        out << " currmovenumber " << ctx->movenum
+            << " currmove " << ctx->currmove.ToString();
       }
 
       if (abs(score) < MateScore) {
@@ -836,6 +1088,132 @@ private:
     return score;
   }
 
+  //--------------------------------------------------------------------------
+  // reuse parent attack maps for pieces not effected by the last move
+  //--------------------------------------------------------------------------
+  template<int piece>
+  inline void UpdateSliderMap() {
+    uint64_t p = pc[piece];
+    uint64_t all = 0;
+    uint64_t dbl = 0;
+    uint64_t x;
+    int sqr;
+
+    while (p) {
+      PopLowSquare(p, sqr);
+      if (!parent || (effected & (BIT(sqr) | parent->slider[sqr]))) {
+        switch (piece & ~ColorMask) {
+        case Bishop: x = BishopXO(sqr); break;
+        case Rook:   x = RookXO(sqr);   break;
+        default:     x = QueenXO(sqr);  break;
+        }
+      }
+      else {
+        x = parent->slider[sqr];
+      }
+      slider[sqr] = x;
+      dbl |= (all & x);
+      all |= x;
+    }
+
+    atks[piece] = all;
+    atks2[piece] = dbl;
+  }
+
+  //--------------------------------------------------------------------------
+  template<Color color>
+  inline void UpdateAttackMaps() {
+    uint64_t p;
+    uint64_t x;
+    int sqr;
+
+    // pawn attacks only change when a pawn of this color moves or is taken
+    if (parent && (pc[color|Pawn] == parent->pc[color|Pawn])) {
+      atks[color|Pawn] = parent->atks[color|Pawn];
+      atks2[color|Pawn] = parent->atks2[color|Pawn];
+    }
+    else {
+      p = pc[color|Pawn];
+      const uint64_t west = (color ? ((p & ~_FILE[0]) >> 9)
+                                   : ((p & ~_FILE[0]) << 7));
+      const uint64_t east = (color ? ((p & ~_FILE[7]) >> 7)
+                                   : ((p & ~_FILE[7]) << 9));
+      atks[color|Pawn] = (west | east);
+      atks2[color|Pawn] = (west & east);
+    }
+
+    // same for knights
+    if (parent && (pc[color|Knight] == parent->pc[color|Knight])) {
+      atks[color|Knight] = parent->atks[color|Knight];
+      atks2[color|Knight] = parent->atks2[color|Knight];
+    }
+    else {
+      atks[color|Knight] = 0;
+      atks2[color|Knight] = 0;
+      p = pc[color|Knight];
+      while (p) {
+        PopLowSquare(p, sqr);
+        x = _KNIGHT_ATK[sqr];
+        atks2[color|Knight] |= (atks[color|Knight] & x);
+        atks[color|Knight] |= x;
+      }
+    }
+
+    // sliders must check whether their rays were effected
+    UpdateSliderMap<color|Bishop>();
+    UpdateSliderMap<color|Rook>();
+    UpdateSliderMap<color|Queen>();
+
+    atks[color|King] = _KING_ATK[king[color]];
+    atks2[color|King] = 0;
+
+    // combined attack maps and number of attackers per square, king attacks
+    // are added to the combined maps after KingEval() but never counted
+    uint64_t* count = atkCounts[color];
+    uint64_t all = atks[color|Pawn];
+    uint64_t dbl = atks2[color|Pawn];
+    count[0] = (all & ~dbl);
+    count[1] = dbl;
+    count[2] = 0;
+    for (int piece = (color|Knight); piece < (color|King); piece += 2) {
+      dbl |= (atks2[piece] | (all & atks[piece]));
+      all |= atks[piece];
+      AddAttackers(count, (atks[piece] & ~atks2[piece]), atks2[piece]);
+    }
+    atks[color] = all;
+    atks2[color] = dbl;
+  }
+
+  //--------------------------------------------------------------------------
+  // add a 2 bit count of attackers (lo, hi) to a bit sliced 3 bit count of
+  // attackers, saturating at 7
+  //--------------------------------------------------------------------------
+  static inline void AddAttackers(uint64_t* count, const uint64_t lo,
+                                  const uint64_t hi)
+  {
+    const uint64_t carry0 = (count[0] & lo);
+    count[0] ^= lo;
+    const uint64_t carry1 = ((count[1] & hi) | ((count[1] ^ hi) & carry0));
+    count[1] ^= (hi ^ carry0);
+    const uint64_t over = (count[2] & carry1);
+    count[2] |= carry1;
+    count[0] |= over;
+    count[1] |= over;
+  }
+
+  //--------------------------------------------------------------------------
+  // squares 'color' has more attackers on than the other side, kings not
+  // counted
+  //--------------------------------------------------------------------------
+  template<Color color>
+  inline uint64_t Outnumbers() const {
+    const uint64_t* a = atkCounts[color];
+    const uint64_t* b = atkCounts[!color];
+    return ((a[2] & ~b[2]) |
+            (~(a[2] ^ b[2]) & ((a[1] & ~b[1]) |
+                               (~(a[1] ^ b[1]) & a[0] & ~b[0]))));
+  }
+
   //--------------------------------------------------------------------------
   template<Color color>
   inline int PawnEval() {
@@ -847,13 +1225,6 @@ private:
     PawnInfo& info = pinfo[color];
     info.count = BitCount(p);
 
-    if (color) {
-      atks[color|Pawn] = (((p & ~_FILE[0]) >> 9) | ((p & ~_FILE[7]) >> 7));
-    }
-    else {
-      atks[color|Pawn] = (((p & ~_FILE[0]) << 7) | ((p & ~_FILE[7]) << 9));
-    }
-
     while (p) {
       const int sqr = LowSquare(p);
       const uint64_t bit = LOW_BIT(p);
@@ -887,7 +1258,7 @@ private:
           x = (color ? ((_WIDE_NORTH[sqr] ^ _NORTH[sqr]) & pc[BlackPawn])
                      : ((_WIDE_SOUTH[sqr] ^ _SOUTH[sqr]) & pc[WhitePawn]));
           if (count >= BitCount(x)) {
-            info.score += (8 * (color ? (7 - YC(sqr)) : YC(sqr)));
+            info.score += (PawnCandidate * (color ? (7 - YC(sqr)) : YC(sqr)));
           }
         }
       }
@@ -898,7 +1269,7 @@ private:
         info.behind |= (color ? _NORTH[sqr] : _SOUTH[sqr]);
 
         // will be counted twice if adjacent
-        info.score += 4;
+        info.score += PawnSupported;
       }
 
       // is it giving support?
@@ -916,21 +1287,23 @@ private:
                   _PAWN_ATK[color][sqr + (color ? South : North)])))
         {
           // guarded by enemy pawn(s)
-          info.score -= (MULTI_BIT(x) ? 16 : 12);
+          info.score -= (MULTI_BIT(x) ? PawnBackwardGuarded2
+                                    : PawnBackwardGuarded);
         }
         else if (SquareValue((color|Pawn), sqr) < 12) {
-          info.score -= 8;
+          info.score -= PawnBackward;
         }
 
         // extra penalty if on an open file
         if (!(pc[(!color)|Pawn] & (color ? _SOUTH[sqr] : _NORTH[sqr]))) {
-          info.score -= 8;
+          info.score -= PawnBackwardOpen;
         }
       }
 
       // penalty if doubled, more so if backward/isolated
       if (pc[color|Pawn] & (color ? _NORTH[sqr] : _SOUTH[sqr])) {
-        info.score -= ((bit & info.backward) ? 40 : 24);
+        info.score -= ((bit & info.backward) ? PawnDoubledBackward
+                                            : PawnDoubled);
       }
     }
 
@@ -952,7 +1325,7 @@ private:
         & (color ? (pc[color|Pawn] >> 8) : (pc[color|Pawn] << 8)))
     {
       // do not update PawnInfo struct with info relative to non-pawns
-      return (info.score - 16);
+      return (info.score - PawnBlockedCenter);
     }
 
     return info.score;
@@ -967,17 +1340,16 @@ private:
     uint64_t x;
     int score = 0;
 
-    const uint64_t available = ~(pc[color] | atks[(!color)|Pawn] |
-        (pc[(!color)|Pawn] & atks[!color]));
+    const uint64_t available = ~(pc[color] | atks[(!color)|Pawn]);
 
     // redundant knights are worth slightly less
     if (MULTI_BIT(p)) {
-      score -= 16;
+      score -= KnightRedundant;
     }
 
     // loner knights are worth less
     else if (SINGLE_BITX(p) && (p == MajorsAndMinors<color>())) {
-      score -= 50;
+      score -= KnightLoner;
     }
 
     while (p) {
@@ -985,24 +1357,23 @@ private:
       const uint64_t bit = LOW_BIT(p);
       p ^= bit;
 
-      // update attack map
-      atks[color|Knight] |= (x = _KNIGHT_ATK[sqr]);
+      x = _KNIGHT_ATK[sqr];
 
       // is this piece menacing the enemy king
       if (x & (_KING_ATK[king[!color]] |
                (_KNIGHT_ATK[king[!color]] & ~pc[color])))
       {
         atkCount[color]++;
-        atkScore[color] += 20;
+        atkScore[color] += KnightKingAttack;
       }
 
       // penalty for zero mobility, more if trapped in the corner
       if (!(x &= available)) {
         if (bit & _CORNER12) {
-          score -= 32;
+          score -= KnightCornered;
         }
         else {
-          score -= 16;
+          score -= KnightImmobile;
         }
       }
       else {
@@ -1012,7 +1383,7 @@ private:
             (_FILE[3] & pc[color|Pawn]) &&
             (XC(king[color]) > 2))
         {
-          score -= 10;
+          score -= KnightBlocksC;
         }
 
         // outpost bonus
@@ -1021,25 +1392,25 @@ private:
                                          : (_WIDE_NORTH[sqr] ^ _NORTH[sqr]))))
         {
           // bigger bonus if no opposing minor pieces
-          score += (MinorPieces<!color>() ? 8 : 16);
+          score += (MinorPieces<!color>() ? KnightOutpost : KnightOutpostAlone);
 
           // more if in front of a backward pawn
           if (bit & (color ? (pinfo[!color].backward << 8)
                            : (pinfo[!color].backward >> 8)))
           {
-            score += 8;
+            score += KnightOutpostHole;
           }
 
           // more if protected by pawn(s)
           if (bit & atks[color|Pawn]) {
-            score += 8;
+            score += KnightOutpostGuarded;
           }
         }
       }
     }
 
 #ifndef NDEBUG
-    evals.pc[color|Knight] = score;
+    evals->pc[color|Knight] = score;
 #endif
     return score;
   }
@@ -1054,17 +1425,17 @@ private:
     int count;
     int score = 0;
 
-    const uint64_t available = ~(pc[color] | atks[(!color)|Pawn] |
-        (pc[(!color)|Pawn] & atks[!color]));
+    const uint64_t available = ~(pc[color] | atks[(!color)|Pawn]);
 
     // bonus for having bishop pair (increases as pawns come off the board)
     if ((p & _LIGHT) && (p & _DARK)) {
-      score += (48 - ((5 * (pinfo[White].count + pinfo[Black].count)) / 3));
+      score += (BishopPair -
+                ((5 * (pinfo[White].count + pinfo[Black].count)) / 3));
     }
 
     // loner bishops are worth less
     else if (SINGLE_BITX(p) && (p == MajorsAndMinors<color>())) {
-      score -= 50;
+      score -= BishopLoner;
     }
 
     while (p) {
@@ -1072,31 +1443,21 @@ private:
       const uint64_t bit = LOW_BIT(p);
       p ^= bit;
 
-      if (!parent || (effected & (bit | parent->slider[sqr]))) {
-        x = BishopXO(sqr);
-      }
-      else {
-        x = parent->slider[sqr];
-        assert(x == BishopXO(sqr));
-      }
-
-      // update attack map
-      slider[sqr] = x;
-      atks[color|Bishop] |= x;
+      x = slider[sqr];
 
       // is this piece menacing the enemy king
       if (x & (_KING_ATK[king[!color]] | (kdiags[!color] & ~pc[color]))) {
         atkCount[color]++;
-        atkScore[color] += 20;
+        atkScore[color] += BishopKingAttack;
       }
 
       // penalty for zero mobility, more if trapped in the corner
       if (!(x &= available)) {
         if (bit & _CORNER12) {
-          score -= 32;
+          score -= BishopCornered;
         }
         else {
-          score -= 16;
+          score -= BishopImmobile;
         }
       }
       else {
@@ -1106,18 +1467,18 @@ private:
                                          : (_WIDE_NORTH[sqr] ^ _NORTH[sqr]))))
         {
           // bigger bonus if no opposing minor pieces
-          score += (MinorPieces<!color>() ? 8 : 16);
+          score += (MinorPieces<!color>() ? BishopOutpost : BishopOutpostAlone);
 
           // more if in front of a backward pawn
           if (bit & (color ? (pinfo[!color].backward << 8)
                            : (pinfo[!color].backward >> 8)))
           {
-            score += 8;
+            score += BishopOutpostHole;
           }
 
           // more if protected by pawn(s)
           if (bit & atks[color|Pawn]) {
-            score += 8;
+            score += BishopOutpostGuarded;
           }
         }
         else if ((sqr == (color ? B7 : B2)) &&
@@ -1125,14 +1486,14 @@ private:
                  (pc[color|Pawn] & _PAWN_ATK[!color][color ? B6 : B3]))
         {
           // fianchetto bonus
-          score += 8;
+          score += BishopFianchetto;
         }
         else if ((sqr == (color ? G7 : G2)) &&
                  (pc[color|Pawn] & BIT(color ? G6 : G3)) &&
                  (pc[color|Pawn] & _PAWN_ATK[!color][color ? G6 : G3]))
         {
           // fianchetto bonus
-          score += 8;
+          score += BishopFianchetto;
         }
       }
 
@@ -1140,21 +1501,21 @@ private:
       x = (pc[color|Pawn] & ((bit & _LIGHT) ? _LIGHT : _DARK));
       if (MULTI_BIT(x)) {
         if ((count = BitCount(x)) >= 3) {
-          score -= (3 * BitCount(x));
+          score -= (BishopPawnColor * BitCount(x));
           if ((x &= (((x & ~_FILE[7]) << 9) |
                      ((x & ~_FILE[7]) << 7) |
                      ((x & ~_FILE[0]) >> 7) |
                      ((x & ~_FILE[0]) >> 9))))
           {
             // extra penalty when those pawns are connected (make some holes!)
-            score -= (6 * BitCount(x));
+            score -= (BishopPawnChain * BitCount(x));
           }
         }
       }
     }
 
 #ifndef NDEBUG
-    evals.pc[color|Bishop] = score;
+    evals->pc[color|Bishop] = score;
 #endif
     return score;
   }
@@ -1173,52 +1534,41 @@ private:
     // penalty for developing rooks before minor pieces
     if (p & (x = (color ? (_ALL >> 16) : (_ALL << 16)))) {
       if ((x = (MinorPieces<color>() & ~x))) {
-        score -= (8 * BitCount(x));
+        score -= (RookEarly * BitCount(x));
       }
     }
 
     const uint64_t available = ~(pc[color] | atks[(!color)|Pawn] |
-        atks[(!color)|Knight] | atks[(!color)|Bishop] |
-        ((pc[(!color)|Pawn] | MinorPieces<!color>()) & atks[!color]));
+        atks[(!color)|Knight] | atks[(!color)|Bishop]);
 
     while (p) {
       const int sqr = LowSquare(p);
       const uint64_t bit = LOW_BIT(p);
       p ^= bit;
 
-      if (!parent || (effected & (bit | parent->slider[sqr]))) {
-        x = RookXO(sqr);
-      }
-      else {
-        x = parent->slider[sqr];
-        assert(x == RookXO(sqr));
-      }
-
-      // update attack map
-      slider[sqr] = x;
-      atks[color|Rook] |= x;
+      x = slider[sqr];
       connected = (x & MajorPieces<color>());
 
       // is this piece menacing the enemy king
       if (x & (_KING_ATK[king[!color]] | (kcross[!color] & ~pc[color]))) {
         atkCount[color]++;
-        atkScore[color] += 40;
+        atkScore[color] += RookKingAttack;
       }
 
       // bonus for being behind passers
       if (x & (((color ? _SOUTH[sqr] : _NORTH[sqr]) & pinfo[color].passed) |
                ((color ? _NORTH[sqr] : _SOUTH[sqr]) & pinfo[!color].passed)))
       {
-        score += 12;
+        score += RookBehindPasser;
       }
 
       // bonus for being on an open file
       else if (bit & ~(pinfo[color].closed | pinfo[!color].closed)) {
         if (_FILE[XC(sqr)] & BIT(king[!color])) {
-          score += 12;
+          score += RookOpenKing;
         }
         else {
-          score += 10;
+          score += RookOpen;
         }
       }
 
@@ -1226,10 +1576,10 @@ private:
       else if (bit & ~pinfo[color].closed) {
         z = (color ? _SOUTH[sqr] : _NORTH[sqr]);
         if (z & (BIT(king[!color]) | pinfo[!color].backward)) {
-          score += 10;
+          score += RookHalfOpenTarget;
         }
         else {
-          score += 8;
+          score += RookHalfOpen;
         }
       }
 
@@ -1245,10 +1595,10 @@ private:
           if (rx >= kx) {
             // worse if not connected to an open file
             if (!(x & _RANK[YC(sqr)] & ~pinfo[color].closed & available)) {
-              score -= 50;
+              score -= RookBoxedIn;
             }
             else {
-              score -= 20;
+              score -= RookBehindPawns;
             }
             connected = 0ULL;
           }
@@ -1258,10 +1608,10 @@ private:
           if (rx <= kx) {
             // worse if not connected to an open file
             if (!(x & _RANK[YC(sqr)] & ~pinfo[color].closed & available)) {
-              score -= 50;
+              score -= RookBoxedIn;
             }
             else {
-              score -= 20;
+              score -= RookBehindPawns;
             }
             connected = 0ULL;
           }
@@ -1272,13 +1622,13 @@ private:
       if (connected) {
         x &= available;
         if (MULTI_BIT(x)) {
-          score += 4;
+          score += RookConnected;
         }
       }
     }
 
 #ifndef NDEBUG
-    evals.pc[color|Rook] = score;
+    evals->pc[color|Rook] = score;
 #endif
     return score;
   }
@@ -1295,50 +1645,39 @@ private:
     // penalty for developing queens before minor pieces
     if (p & (x = (color ? (_ALL >> 16) : (_ALL << 16)))) {
       if ((x = (MinorPieces<color>() & ~x))) {
-        score -= (12 * BitCount(x));
+        score -= (QueenEarly * BitCount(x));
       }
     }
 
     const uint64_t available = ~(pc[color] | atks[(!color)|Pawn] |
-        atks[(!color)|Knight] | atks[(!color)|Bishop] | atks[(!color)|Rook] |
-        ((pc[!color] ^ pc[(!color)|Queen] ^ pc[(!color)|King]) & atks[!color]));
+        atks[(!color)|Knight] | atks[(!color)|Bishop] | atks[(!color)|Rook]);
 
     while (p) {
       const int sqr = LowSquare(p);
       const uint64_t bit = LOW_BIT(p);
       p ^= bit;
 
-      if (!parent || (effected & (bit | parent->slider[sqr]))) {
-        x = QueenXO(sqr);
-      }
-      else {
-        x = parent->slider[sqr];
-        assert(x == QueenXO(sqr));
-      }
-
-      // update attack map
-      slider[sqr] = x;
-      atks[color|Queen] |= x;
+      x = slider[sqr];
 
       // is this piece menacing the enemy king
       if (x & (_KING_ATK[king[!color]] | (KingLines<!color>() & ~pc[color]))) {
         atkCount[color]++;
-        atkScore[color] += 80;
+        atkScore[color] += QueenKingAttack;
       }
 
       // penalty for zero mobility, more if trapped in the corner
       if (!(x &= available)) {
         if (bit & _CORNER12) {
-          score -= 32;
+          score -= QueenCornered;
         }
         else {
-          score -= 16;
+          score -= QueenImmobile;
         }
       }
     }
 
 #ifndef NDEBUG
-    evals.pc[color|Queen] = score;
+    evals->pc[color|Queen] = score;
 #endif
     return score;
   }
@@ -1347,8 +1686,8 @@ private:
   template<Color color>
   inline int KingEval() {
     const int sqr = king[color];
-    assert(_board[sqr] == (color|King));
-    assert(!atks[color|King]);
+    assert(ctx->board[sqr] == (color|King));
+    assert(atks[color|King] == _KING_ATK[sqr]);
 
     int score = 0;
     int chksqr;
@@ -1366,13 +1705,13 @@ private:
     assert(!(state & (color ? WhiteThreat : BlackThreat)));
     p = (_KING_ATK[sqr] & ~(pc[color] | atks[!color] | _KING_ATK[king[!color]]));
     if (!p) {
-      score -= 20;
+      score -= KingImmobile;
     }
 
     // is there a potential mate threat?
     // NOTE: this routine is imperfect in many ways, but it should catch
     // a large bulk of real mate threats, such as back rank mates
-    if ((_test & 2) && !MULTI_BIT(p)) {
+    if ((ctx->test & 2) && !MULTI_BIT(p)) {
       w = (_KNIGHT_ATK[sqr] & atks[(!color)|Knight] & ~atks[color]);
       if (w && !p) {
         score -= 10;
@@ -1464,7 +1803,8 @@ private:
     // penalty for being in front of own pawns
     if (BIT(sqr) & pinfo[color].front) {
       assert(pc[color|Pawn] & (color ? _NORTH[sqr] : _SOUTH[sqr]));
-      score -= static_cast<int>(10 + (40 * ratio));
+      score -= static_cast<int>(KingFrontOfPawns +
+                               (KingFrontOfPawnsMid * ratio));
     }
 
     // midgame considerations
@@ -1485,19 +1825,19 @@ private:
       {
         // bigger penalty if can't castle
         if (state & (color ? BlackCastleMask : WhiteCastleMask)) {
-          mid -= (4 * BitCount(p));
+          mid -= (KingHoleCastle * BitCount(p));
         }
         else {
-          mid -= (8 * BitCount(p));
+          mid -= (KingHole * BitCount(p));
         }
 
         // extra penalty for holes attacked by the enemy
         if ((p &= atks[!color])) {
-          mid -= (6 * BitCount(p));
+          mid -= (KingHoleAttacked * BitCount(p));
 
-          // more for those that are not defended
-          if ((p &= ~atks[color])) {
-            mid -= (6 * BitCount(p));
+          // more for those with fewer defenders than attackers
+          if ((p &= Outnumbers<!color>())) {
+            mid -= (KingHoleWeak * BitCount(p));
           }
         }
       }
@@ -1506,52 +1846,52 @@ private:
       switch (XC(sqr)) {
       case 0: // A file
       case 1: // B file
-        mid -= ((6 * !(_FILE[0] & pc[WhitePawn])) +
-                (6 * !(_FILE[0] & pc[BlackPawn])) +
-                (6 * !(_FILE[1] & pc[WhitePawn])) +
-                (6 * !(_FILE[1] & pc[BlackPawn])) +
-                (6 * !(_FILE[2] & pc[WhitePawn])) +
-                (6 * !(_FILE[2] & pc[BlackPawn])));
+        mid -= ((KingOpenFile * !(_FILE[0] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[0] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[1] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[1] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[2] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[2] & pc[BlackPawn])));
         break;
 
       case 2: // C file
-        mid -= ((6 * !(_FILE[0] & pc[WhitePawn])) +
-                (6 * !(_FILE[0] & pc[BlackPawn])) +
-                (6 * !(_FILE[1] & pc[WhitePawn])) +
-                (6 * !(_FILE[1] & pc[BlackPawn])) +
-                (6 * !(_FILE[2] & pc[WhitePawn])) +
-                (6 * !(_FILE[2] & pc[BlackPawn])));
+        mid -= ((KingOpenFile * !(_FILE[0] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[0] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[1] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[1] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[2] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[2] & pc[BlackPawn])));
         break;
 
       case 3: // D file
       case 4: // E file
-        mid -= ((6 * !(_FILE[2] & pc[WhitePawn])) +
-                (6 * !(_FILE[2] & pc[BlackPawn])) +
-                (6 * !(_FILE[3] & pc[WhitePawn])) +
-                (6 * !(_FILE[3] & pc[BlackPawn])) +
-                (6 * !(_FILE[4] & pc[WhitePawn])) +
-                (6 * !(_FILE[4] & pc[BlackPawn])) +
-                (6 * !(_FILE[5] & pc[WhitePawn])) +
-                (6 * !(_FILE[5] & pc[BlackPawn])));
+        mid -= ((KingOpenFile * !(_FILE[2] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[2] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[3] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[3] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[4] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[4] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[5] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[5] & pc[BlackPawn])));
         break;
 
       case 5: // F file
-        mid -= ((6 * !(_FILE[5] & pc[WhitePawn])) +
-                (6 * !(_FILE[5] & pc[BlackPawn])) +
-                (6 * !(_FILE[6] & pc[WhitePawn])) +
-                (6 * !(_FILE[6] & pc[BlackPawn])) +
-                (6 * !(_FILE[7] & pc[WhitePawn])) +
-                (6 * !(_FILE[7] & pc[BlackPawn])));
+        mid -= ((KingOpenFile * !(_FILE[5] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[5] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[6] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[6] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[7] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[7] & pc[BlackPawn])));
         break;
 
       case 6: // G file
       case 7: // H file
-        mid -= ((6 * !(_FILE[5] & pc[WhitePawn])) +
-                (6 * !(_FILE[5] & pc[BlackPawn])) +
-                (6 * !(_FILE[6] & pc[WhitePawn])) +
-                (6 * !(_FILE[6] & pc[BlackPawn])) +
-                (6 * !(_FILE[7] & pc[WhitePawn])) +
-                (6 * !(_FILE[7] & pc[BlackPawn])));
+        mid -= ((KingOpenFile * !(_FILE[5] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[5] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[6] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[6] & pc[BlackPawn])) +
+                (KingOpenFile * !(_FILE[7] & pc[WhitePawn])) +
+                (KingOpenFile * !(_FILE[7] & pc[BlackPawn])));
         break;
       }
 
@@ -1559,10 +1899,8 @@ private:
       score += static_cast<int>(ratio * mid);
     }
 
-    atks[color|King] = _KING_ATK[sqr];
-
 #ifndef NDEBUG
-    evals.pc[color|King] = score;
+    evals->pc[color|King] = score;
 #endif
     return score;
   }
@@ -1581,14 +1919,13 @@ private:
     assert(pinfo[White].passed == (pc[WhitePawn] & pinfo[White].passed));
     assert(pinfo[Black].passed == (pc[BlackPawn] & pinfo[Black].passed));
 
-    static const int PROGRESS[8] = { 0, 12, 16, 24, 36, 56, 88, 0 };
     while (p) {
       const int sqr = LowSquare(p);
       const uint64_t bit = LOW_BIT(p);
       p ^= bit;
 
       const int y = YC(sqr);
-      bonus = PROGRESS[color ? (7 - y) : y];
+      bonus = _PASSER_RANK[color ? (7 - y) : y];
 
       // when no rooks or queens then king and knight suuport is needed
       if (!MajorPieces<color>()) {
@@ -1600,7 +1937,7 @@ private:
           dist = std::min<int>(dist, _diff.Dist(sqr, xsqr));
         }
         assert(dist < 8);
-        bonus -= (8 * dist);
+        bonus -= (PasserFriendDist * dist);
       }
 
       if (!MajorPieces<!color>()) {
@@ -1612,7 +1949,7 @@ private:
           dist = std::min<int>(dist, _diff.Dist(sqr, xsqr));
         }
         assert(dist < 8);
-        bonus += (8 * dist);
+        bonus += (PasserEnemyDist * dist);
       }
 
       // bonus if it has support
@@ -1641,14 +1978,14 @@ private:
       else {
         x = (color ? _SOUTH[sqr] : _NORTH[sqr]);
         if (!(x & (Occupied() | atks[!color]))) {
-          bonus += 20;
+          bonus += PasserFreePath;
           if (OnlyHasPawns<!color>()) {
             // can it outrun the enemy king?
             xsqr = ((color ? A1 : A8) + XC(sqr)); // destination square
             if ((_diff.Dist(sqr, xsqr) + (ColorToMove() != color)) <
                 (_diff.Dist(king[!color], xsqr)))
             {
-              bonus += 200;
+              bonus += PasserUnstoppable;
             }
           }
         }
@@ -1658,7 +1995,7 @@ private:
     }
 
 #ifndef NDEBUG
-    evals.pc[color|Pawn] = score;
+    evals->pc[color|Pawn] = score;
 #endif
     return score;
   }
@@ -1712,6 +2049,57 @@ private:
     }
   }
 
+  //--------------------------------------------------------------------------
+  inline void VerifyAttackMaps() const {
+    uint64_t all[PieceTypeCount] = {0};
+    uint64_t dbl[PieceTypeCount] = {0};
+    uint64_t p;
+    uint64_t x;
+    int sqr;
+
+    for (int piece = WhitePawn; piece < PieceTypeCount; ++piece) {
+      p = pc[piece];
+      while (p) {
+        PopLowSquare(p, sqr);
+        switch (piece & ~ColorMask) {
+        case Pawn:   x = _PAWN_ATK[COLOR_OF(piece)][sqr]; break;
+        case Knight: x = _KNIGHT_ATK[sqr];                break;
+        case Bishop: x = BishopXO(sqr);                   break;
+        case Rook:   x = RookXO(sqr);                     break;
+        case Queen:  x = QueenXO(sqr);                    break;
+        default:     x = _KING_ATK[sqr];                  break;
+        }
+        dbl[piece] |= (all[piece] & x);
+        all[piece] |= x;
+      }
+      assert(atks[piece] == all[piece]);
+      assert(atks2[piece] == dbl[piece]);
+      const int color = COLOR_OF(piece);
+      dbl[color] |= (dbl[piece] | (all[color] & all[piece]));
+      all[color] |= all[piece];
+    }
+
+    assert(atks[White] == all[White]);
+    assert(atks[Black] == all[Black]);
+    assert(atks2[White] == dbl[White]);
+    assert(atks2[Black] == dbl[Black]);
+
+    // attackers per square, counted one piece at a time
+    for (int color = White; color <= Black; ++color) {
+      for (sqr = A1; sqr <= H8; ++sqr) {
+        int count = 0;
+        for (int piece = (color|Pawn); piece < (color|King); piece += 2) {
+          count += !!(all[piece] & BIT(sqr));
+          count += !!(dbl[piece] & BIT(sqr));
+        }
+        count = std::min<int>(count, 7);
+        assert(count == (!!(atkCounts[color][0] & BIT(sqr)) +
+                         (2 * !!(atkCounts[color][1] & BIT(sqr))) +
+                         (4 * !!(atkCounts[color][2] & BIT(sqr)))));
+      }
+    }
+  }
+
   //--------------------------------------------------------------------------
   inline uint64_t CalcHashKey() const {
     uint64_t key = 0;
@@ -1729,6 +2117,20 @@ private:
     return key;
   }
 
+  //--------------------------------------------------------------------------
+  // material key is the combination of hash values indexed by piece count
+  //--------------------------------------------------------------------------
+  inline uint64_t CalcMaterialKey() const {
+    uint64_t key = 0;
+    for (int piece = WhitePawn; piece <= BlackKing; ++piece) {
+      const int count = BitCount(pc[piece]);
+      for (int i = 0; i < count; ++i) {
+        key ^= _HASH[piece][i];
+      }
+    }
+    return key;
+  }
+
   //--------------------------------------------------------------------------
   inline void VerifyPosition() const {
     assert(!(pc[White] & pc[Black]));
@@ -1754,10 +2156,12 @@ private:
       assert(!FindPiecesGivingCheck<Black>());
     }
 
-    if (_debug) {
+    if (IsDebugOn()) {
       VerifyMaterial();
       VerifySliderMaps();
+      VerifyAttackMaps();
       assert(pieceKey == CalcHashKey());
+      assert(materialKey == CalcMaterialKey());
       assert(kdiags[White] == BishopXO(king[White]));
       assert(kdiags[Black] == BishopXO(king[Black]));
       assert(kcross[White] == RookXO(king[White]));
@@ -1766,59 +2170,255 @@ private:
   }
 
   //--------------------------------------------------------------------------
-  void Evaluate() {
+  // specialized endgame where 'color' has the extra material, 'n' is the
+  // number of each piece type on the board
+  //--------------------------------------------------------------------------
+  static MaterialEntry::Endgame SelectEndgame(const int* n,
+                                              const Color color)
+  {
+    const int ours = (n[color|Knight] + n[color|Bishop] +
+                      n[color|Rook] + n[color|Queen]);
+    const int theirs = (n[(!color)|Knight] + n[(!color)|Bishop] +
+                        n[(!color)|Rook] + n[(!color)|Queen]);
+    if (theirs || n[(!color)|Pawn]) {
+      if ((ours == 1) && n[color|Rook] && !n[color|Pawn] &&
+          !theirs && (n[(!color)|Pawn] == 1))
+      {
+        return MaterialEntry::KRKP;
+      }
+      if ((ours == 1) && n[color|Queen] && !n[color|Pawn] &&
+          (theirs == 1) && n[(!color)|Rook] && !n[(!color)|Pawn])
+      {
+        return MaterialEntry::KQKR;
+      }
+    }
+    else if (n[color|Pawn]) {
+      if (!ours && (n[color|Pawn] == 1)) {
+        return MaterialEntry::KPK;
+      }
+    }
+    else if ((ours == 2) && (n[color|Bishop] == 1) && (n[color|Knight] == 1)) {
+      return MaterialEntry::KBNK;
+    }
+    else if (ours) {
+      return MaterialEntry::KXK;
+    }
+    return MaterialEntry::NoEndgame;
+  }
+
+  //--------------------------------------------------------------------------
+  // fill in evaluation terms that only depend on the number of each piece
+  //--------------------------------------------------------------------------
+  void InitMaterialEntry(MaterialEntry& entry) const {
+    int n[PieceTypeCount];
+    for (int piece = WhitePawn; piece < PieceTypeCount; ++piece) {
+      n[piece] = BitCount(pc[piece]);
+    }
+
+    const int pawns = (n[WhitePawn] + n[BlackPawn]);
+    const int whitePcs = (n[WhiteKnight] + n[WhiteBishop] +
+                          n[WhiteRook] + n[WhiteQueen]);
+    const int blackPcs = (n[BlackKnight] + n[BlackBishop] +
+                          n[BlackRook] + n[BlackQueen]);
+    int imbalance = 0;
+
+    // redundant knights are worth slightly less
+    if (n[WhiteKnight] > 1) {
+      imbalance -= (16 * (n[WhiteKnight] - 1));
+    }
+    if (n[BlackKnight] > 1) {
+      imbalance += (16 * (n[BlackKnight] - 1));
+    }
+
+    // are there any pawns on the board?
+    if (pawns) {
+      // increase value of 1 knight relative to # of pawns on the board
+      int count = ((4 * pawns) / 3);
+      assert(count <= 21);
+      if (n[WhiteKnight]) {
+        imbalance += count;
+      }
+      if (n[BlackKnight]) {
+        imbalance -= count;
+      }
+
+      // increase value of 1 rook as pawns come off the board
+      count = ((4 * count) / 3); // inflate pawn count a bit more
+      assert(count <= 28);
+      if (n[WhiteRook]) {
+        imbalance += (28 - count);
+      }
+      if (n[BlackRook]) {
+        imbalance -= (28 - count);
+      }
+    }
+
+    // enough mating material?
+    const bool whiteCanWin = (n[WhitePawn] || n[WhiteRook] || n[WhiteQueen] ||
+                              (n[WhiteBishop] > 1) ||
+                              (n[WhiteKnight] && n[WhiteBishop]) ||
+                              (whitePcs > 2));
+    const bool blackCanWin = (n[BlackPawn] || n[BlackRook] || n[BlackQueen] ||
+                              (n[BlackBishop] > 1) ||
+                              (n[BlackKnight] && n[BlackBishop]) ||
+                              (blackPcs > 2));
+
+    // endings with a specialized evaluation
+    MaterialEntry::Endgame endgame = MaterialEntry::NoEndgame;
+    Color strong = White;
+    if (whiteCanWin) {
+      endgame = SelectEndgame(n, White);
+    }
+    if (!endgame && blackCanWin) {
+      endgame = SelectEndgame(n, Black);
+      strong = Black;
+    }
+
+    MaterialEntry::Scale scale = MaterialEntry::NoScale;
+    if (!pawns) {
+      if ((whitePcs == 1) && (blackPcs == 1) &&
+          ((n[WhiteQueen] && n[BlackRook]) || (n[BlackQueen] && n[WhiteRook])))
+      {
+        scale = MaterialEntry::QueenVsRook;
+      }
+      else if (((whitePcs == 1) && n[WhiteRook] && (blackPcs <= 2) &&
+                !n[BlackRook] && !n[BlackQueen]) ||
+               ((blackPcs == 1) && n[BlackRook] && (whitePcs <= 2) &&
+                !n[WhiteRook] && !n[WhiteQueen]))
+      {
+        scale = MaterialEntry::RookVsMinors;
+      }
+    }
+    else if ((whitePcs == n[WhiteRook]) && (blackPcs == n[BlackRook])) {
+      scale = MaterialEntry::RookEnding;
+      if ((whitePcs == 1) && (blackPcs == 1) && (pawns == 1)) {
+        scale = MaterialEntry::RookPawnVsRook;
+      }
+    }
+    else if (((whitePcs == 1) && n[WhiteBishop] && n[WhitePawn] &&
+              !blackPcs && !n[BlackPawn]) ||
+             ((blackPcs == 1) && n[BlackBishop] && n[BlackPawn] &&
+              !whitePcs && !n[WhitePawn]))
+    {
+      scale = MaterialEntry::WrongBishop;
+    }
+    else if ((whitePcs == 1) && n[WhiteBishop] &&
+             (blackPcs == 1) && n[BlackBishop])
+    {
+      scale = MaterialEntry::BishopEnding;
+    }
+
+    entry.materialKey = materialKey;
+    entry.imbalance   = static_cast<int16_t>(imbalance);
+    entry.flags       = static_cast<uint8_t>(
+        (whiteCanWin ? MaterialEntry::WhiteCanWin : 0) |
+        (blackCanWin ? MaterialEntry::BlackCanWin : 0) |
+        ((whiteCanWin || blackCanWin) ? 0 : MaterialEntry::DrawnEnding));
+    entry.scale       = static_cast<uint8_t>(scale);
+    entry.endgame     = static_cast<uint8_t>(endgame);
+    entry.strong      = static_cast<uint8_t>(strong);
+  }
+
+  //--------------------------------------------------------------------------
+  inline const MaterialEntry& GetMaterialEntry() const {
+    MaterialEntry& entry = ctx->matTable[materialKey & (MaterialSlots - 1)];
+    if (entry.materialKey != materialKey) {
+      InitMaterialEntry(entry);
+    }
+    return entry;
+  }
+
+  //--------------------------------------------------------------------------
+  // when collecting eval terms store the change in 'eval' since 'mark'
+  //--------------------------------------------------------------------------
+  template<bool withTerms>
+  static inline void EvalTerm(EvalTerms* terms, int EvalTerms::*term,
+                              int& mark, const int eval)
+  {
+    if (withTerms) {
+      terms->*term = (eval - mark);
+      mark = eval;
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  inline void Evaluate() {
+    Evaluate<false>(NULL);
+  }
+
+  //--------------------------------------------------------------------------
+  template<bool withTerms>
+  void Evaluate(EvalTerms* terms) {
 #ifndef NDEBUG
     assert(!(state & Draw));
-    memset(&evals, 0, sizeof(evals));
+    memset(evals, 0, sizeof(EvalInfo));
 #endif
     memset(pinfo, 0, sizeof(pinfo));
-    memset(atks, 0, sizeof(atks));
     atkCount[White] = 0;
     atkCount[Black] = 0;
     atkScore[White] = 0;
     atkScore[Black] = 0;
 
+    // attack bitmaps sans king attacks
+    UpdateAttackMaps<White>();
+    UpdateAttackMaps<Black>();
+
     // evaluate from white's perspective
-    int eval = ((ColorToMove() ? -_tempo : _tempo) +
+    const int tempo = (ColorToMove() ? -ctx->tempo : ctx->tempo);
+    const int pins = (GetPins<Black>(6) - GetPins<White>(6));
+    int eval = (tempo +
                 material[White] -
                 material[Black] +
                 sqrVal[White] -
                 sqrVal[Black] +
-                GetPins<Black>(6) -
-                GetPins<White>(6));
+                pins);
+    int mark = eval;
+    if (withTerms) {
+      memset(terms, 0, sizeof(EvalTerms));
+      terms->tempo    = tempo;
+      terms->material = (material[White] - material[Black]);
+      terms->squares  = (sqrVal[White] - sqrVal[Black]);
+      terms->pins     = pins;
+    }
+
+    // specialized endgames replace everything that follows
+    const MaterialEntry& mat = GetMaterialEntry();
+    if (mat.endgame) {
+      EvalEndgame<withTerms>(mat, terms);
+      return;
+    }
 
     // no pawns = bad
-    if (pc[WhitePawn])   eval += PawnEval<White>(); else eval -= 50;
-    if (pc[BlackPawn])   eval -= PawnEval<Black>(); else eval += 50;
+    if (pc[WhitePawn])   eval += PawnEval<White>(); else eval -= NoPawns;
+    if (pc[BlackPawn])   eval -= PawnEval<Black>(); else eval += NoPawns;
+    EvalTerm<withTerms>(terms, &EvalTerms::pawns, mark, eval);
     if (pc[WhiteKnight]) eval += KnightEval<White>();
     if (pc[BlackKnight]) eval -= KnightEval<Black>();
+    EvalTerm<withTerms>(terms, &EvalTerms::knights, mark, eval);
     if (pc[WhiteBishop]) eval += BishopEval<White>();
     if (pc[BlackBishop]) eval -= BishopEval<Black>();
+    EvalTerm<withTerms>(terms, &EvalTerms::bishops, mark, eval);
     if (pc[WhiteRook])   eval += RookEval<White>();
     if (pc[BlackRook])   eval -= RookEval<Black>();
+    EvalTerm<withTerms>(terms, &EvalTerms::rooks, mark, eval);
     if (pc[WhiteQueen])  eval += QueenEval<White>();
     if (pc[BlackQueen])  eval -= QueenEval<Black>();
-
-    // fill in attack bitmaps sans king attacks
-    atks[White] = (atks[WhitePawn] | atks[WhiteKnight] | atks[WhiteBishop] |
-                   atks[WhiteRook] | atks[WhiteQueen]);
-    atks[Black] = (atks[BlackPawn] | atks[BlackKnight] | atks[BlackBishop] |
-                   atks[BlackRook] | atks[BlackQueen]);
+    EvalTerm<withTerms>(terms, &EvalTerms::queens, mark, eval);
 
     eval += KingEval<White>();
     eval -= KingEval<Black>();
+    EvalTerm<withTerms>(terms, &EvalTerms::kings, mark, eval);
 
     // finish populating attack bitmaps
-    atks[WhiteKing] = _KING_ATK[king[White]];
-    atks[BlackKing] = _KING_ATK[king[Black]];
-    atks[White] = (atks[WhitePawn] | atks[WhiteKnight] | atks[WhiteBishop] |
-                   atks[WhiteRook] | atks[WhiteQueen]  | atks[WhiteKing]);
-    atks[Black] = (atks[BlackPawn] | atks[BlackKnight] | atks[BlackBishop] |
-                   atks[BlackRook] | atks[BlackQueen]  | atks[BlackKing]);
+    atks2[White] |= (atks[White] & atks[WhiteKing]);
+    atks2[Black] |= (atks[Black] & atks[BlackKing]);
+    atks[White] |= atks[WhiteKing];
+    atks[Black] |= atks[BlackKing];
 
     // now that attack bitmaps are complete evaluate passed pawns
     if (pinfo[White].passed) eval += PasserEval<White>();
     if (pinfo[Black].passed) eval -= PasserEval<Black>();
+    EvalTerm<withTerms>(terms, &EvalTerms::passers, mark, eval);
 
 #ifndef NDEBUG
     VerifyPosition();
@@ -1828,11 +2428,25 @@ private:
     //       because rcount is not encoded into positionKey
     if (IsDraw()) {
       state |= Draw;
-      standPat = _drawScore[ColorToMove()];
+      standPat = ctx->drawScore[ColorToMove()];
+      EvalDrawn<withTerms>(terms);
       return;
     }
 
-    // TODO use specialized eval function for particular piece configurations
+    // draw due to lack of mating material?
+    if (mat.IsDrawn()) {
+      state |= Draw;
+      standPat = ctx->drawScore[ColorToMove()];
+      EvalDrawn<withTerms>(terms);
+      return;
+    }
+
+    // the network replaces the rest of the hand written terms,
+    // they are only finished when someone wants to see them
+    if (!withTerms && ctx->nnue) {
+      standPat = NetworkEval();
+      return;
+    }
 
     // bonus for board coverage
     uint64_t x;
@@ -1844,22 +2458,20 @@ private:
          (atks[BlackQueen] & (_CENTER16|atks[WhiteKing]|atks[BlackKing])));
     eval -= (BitCount(x) + BitCount(x & _CENTER4) +
              BitCount(x & (atks[WhiteKing]|atks[BlackKing])));
+    EvalTerm<withTerms>(terms, &EvalTerms::coverage, mark, eval);
 
     // penalty for unprotected pawns, knights, and bishops
     if ((x = ((pc[WhitePawn]|MinorPieces<White>()) & ~atks[White]))) {
       eval -= (6 * BitCount(x));
     }
     if ((x = ((pc[BlackPawn]|MinorPieces<Black>()) & ~atks[Black]))) {
-      eval += (6 * BitCount(x));
-    }
-
-    // redundant knights are worth slightly less
-    if (MULTI_BIT(pc[WhiteKnight])) {
-      eval -= (16 * (BitCount(pc[WhiteKnight]) - 1));
-    }
-    if (MULTI_BIT(pc[BlackKnight])) {
-      eval += (16 * (BitCount(pc[BlackKnight]) - 1));
+      eval += (6 * BitCount(x));
     }
+    EvalTerm<withTerms>(terms, &EvalTerms::loose, mark, eval);
+
+    // material imbalance adjustments
+    eval += mat.imbalance;
+    EvalTerm<withTerms>(terms, &EvalTerms::imbalance, mark, eval);
 
     // are there any pawns on the board?
     if (pc[WhitePawn] || pc[BlackPawn]) {
@@ -1873,103 +2485,97 @@ private:
       x = (pinfo[Black].behind & ~atks[White]);
       x &= (x >> 8);
       eval -= (2 * BitCount(x));
-
-      // increase value of 1 knight relative to # of pawns on the board
-      int count = ((4 * (pinfo[White].count + pinfo[Black].count)) / 3);
-      assert(count <= 21);
-      if (pc[WhiteKnight]) {
-        eval += count;
-      }
-      if (pc[BlackKnight]) {
-        eval -= count;
-      }
-
-      // increase value of 1 rook as pawns come off the board
-      count = ((4 * count) / 3); // inflate pawn count a bit more
-      assert(count <= 28);
-      if (pc[WhiteRook]) {
-        eval += (28 - count);
-      }
-      if (pc[BlackRook]) {
-        eval -= (28 - count);
-      }
+      EvalTerm<withTerms>(terms, &EvalTerms::space, mark, eval);
 
       // reduce winning score relative to number of locked pawns
       if ((x = ((pinfo[White].connected << North) & pinfo[Black].connected))) {
         if ((x &= ~((x & ~_FILE[0]) >> 1))) {
-          if ((count = BitCount(x)) > 2) {
+          const int count = BitCount(x);
+          if (count > 2) {
             eval = ((eval * (10 - count)) / 8);
           }
         }
       }
     }
 
-    // draw due to lack of mating material?
-    const uint64_t whitePcs = MajorsAndMinors<White>();
-    const uint64_t blackPcs = MajorsAndMinors<Black>();
-    const bool whiteCanWin  = (pc[WhitePawn] || pc[WhiteRook] ||
-                               pc[WhiteQueen] || MULTI_BIT(pc[WhiteBishop]) ||
-                               (pc[WhiteKnight] && pc[WhiteBishop]) ||
-                               (BitCount(whitePcs) > 2));
-    const bool blackCanWin  = (pc[BlackPawn] || pc[BlackRook] ||
-                               pc[BlackQueen] || MULTI_BIT(pc[BlackBishop]) ||
-                               (pc[BlackKnight] && pc[BlackBishop]) ||
-                               (BitCount(blackPcs) > 2));
-    if (!whiteCanWin && !blackCanWin) {
-      state |= Draw;
-      standPat = _drawScore[ColorToMove()];
-      return;
-    }
-
     // reduce winning score if "winning" side can't win
+    const bool whiteCanWin = mat.CanWin(White);
+    const bool blackCanWin = mat.CanWin(Black);
     if (((eval > 0) && !whiteCanWin) || ((eval < 0) && !blackCanWin)) {
       assert(whiteCanWin != blackCanWin);
       assert(abs(eval) < 1000);
       eval = ((eval * abs(eval)) / 1000);
       eval += (whiteCanWin ? 50 : -50);
     }
+    else {
+      switch (mat.scale) {
+      case MaterialEntry::NoScale:
+        break;
 
-    else if (!pc[WhitePawn] && !pc[BlackPawn]) {
       // reduce winning score if Q vs R
-      if (SINGLE_BIT(whitePcs) && SINGLE_BIT(blackPcs) &&
-          (((whitePcs == pc[WhiteQueen]) && (blackPcs == pc[BlackRook])) ||
-           ((blackPcs == pc[BlackQueen]) && (whitePcs == pc[WhiteRook]))))
-      {
+      case MaterialEntry::QueenVsRook:
         eval -= ((eval > 0) ? 80 : -80);
-      }
+        break;
 
       // reduce winning score if R vs minor(s)
-      else if (SINGLE_BIT(whitePcs) && (whitePcs == pc[WhiteRook]) &&
-               (blackPcs == MinorPieces<Black>()) &&
-               (BitCount(blackPcs) <= 2) && (abs(eval) < 256))
-      {
-        eval = ((eval * abs(eval)) / 256);
-      }
-      else if (SINGLE_BIT(blackPcs) && (blackPcs == pc[BlackRook]) &&
-               (whitePcs == MinorPieces<White>()) &&
-               (BitCount(whitePcs) <= 2) && (abs(eval) < 256))
-      {
-        eval = ((eval * abs(eval)) / 256);
+      case MaterialEntry::RookVsMinors:
+        if (abs(eval) < 256) {
+          eval = ((eval * abs(eval)) / 256);
+        }
+        break;
+
+      // reduce winning score if pawns + R vs R ending
+      case MaterialEntry::RookEnding:
+        if (abs(eval) < 128) {
+          eval = ((eval * abs(eval)) / 128);
+        }
+        break;
+
+      // reduce winning score if the defending king is in front of the
+      // pawn in a rook + pawn vs rook ending
+      case MaterialEntry::RookPawnVsRook: {
+        const Color color = (pc[WhitePawn] ? White : Black);
+        const int sqr = LowSquare(pc[color|Pawn]);
+        if ((BIT(king[!color]) & (color ? _SOUTH[sqr] : _NORTH[sqr])) &&
+            !(BIT(king[color]) & (color ? _WIDE_SOUTH[sqr]
+                                        : _WIDE_NORTH[sqr])))
+        {
+          eval /= 4;
+        }
+        else if (abs(eval) < 128) {
+          eval = ((eval * abs(eval)) / 128);
+        }
+        break;
       }
-    }
 
-    // reduce winning score if pawns + R vs R ending
-    else if ((whitePcs == pc[WhiteRook]) && (blackPcs == pc[BlackRook]) &&
-             (abs(eval) < 128))
-    {
-      eval = ((eval * abs(eval)) / 128);
-    }
+      // rook pawns and a bishop that doesn't cover the promotion square
+      // can't win if the defending king gets into the corner
+      case MaterialEntry::WrongBishop: {
+        const Color color = (pc[WhitePawn] ? White : Black);
+        const uint64_t pawns = pc[color|Pawn];
+        if (!(pawns & ~_FILE[0]) || !(pawns & ~_FILE[7])) {
+          const int sqr = ((color ? A1 : A8) + XC(LowSquare(pawns)));
+          if (!(pc[color|Bishop] & ((BIT(sqr) & _LIGHT) ? _LIGHT : _DARK)) &&
+              (_diff.Dist(king[!color], sqr) <= 1))
+          {
+            eval /= 16;
+          }
+        }
+        break;
+      }
 
-    // reduce winning score if pawns + opposite color bishop ending
-    else if ((whitePcs == pc[WhiteBishop]) && (blackPcs == pc[BlackBishop]) &&
-             (!(whitePcs & _LIGHT) != !(blackPcs & _LIGHT)) &&
-             SINGLE_BIT(whitePcs) && SINGLE_BIT(blackPcs) &&
-             (abs(eval) < 300))
-    {
-      if ((eval > 0) ? !pinfo[White].connected : !pinfo[Black].connected) {
-        eval /= 3;
+      // reduce winning score if pawns + opposite color bishop ending
+      case MaterialEntry::BishopEnding:
+        if ((!(pc[WhiteBishop] & _LIGHT) != !(pc[BlackBishop] & _LIGHT)) &&
+            (abs(eval) < 300))
+        {
+          if ((eval > 0) ? !pinfo[White].connected : !pinfo[Black].connected) {
+            eval /= 3;
+          }
+          eval = ((eval * abs(eval)) / 300);
+        }
+        break;
       }
-      eval = ((eval * abs(eval)) / 300);
     }
 
     // reduce winning score if rcount is getting large
@@ -1981,6 +2587,313 @@ private:
 
     // standPat is eval from persepctive of the side to move
     standPat = (ColorToMove() ? -eval : eval);
+    EvalTerm<withTerms>(terms, &EvalTerms::scaling, mark, eval);
+    if (withTerms) {
+      terms->total = eval;
+      if (ctx->nnue) {
+        standPat = NetworkEval();
+        terms->network = (ColorToMove() ? -standPat : standPat);
+        terms->total = terms->network;
+      }
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  template<Color color>
+  inline uint64_t PassedPawns() const {
+    uint64_t passed = 0;
+    for (uint64_t p = pc[color|Pawn]; p; p &= (p - 1)) {
+      const int sqr = LowSquare(p);
+      if (color ? !(_WIDE_SOUTH[sqr] & pc[WhitePawn])
+                : !(_WIDE_NORTH[sqr] & pc[BlackPawn]))
+      {
+        passed |= BIT(sqr);
+      }
+    }
+    return passed;
+  }
+
+  //--------------------------------------------------------------------------
+  // distance from the nearest edge of the board, 0 to 3
+  //--------------------------------------------------------------------------
+  static inline int EdgeDist(const int sqr) {
+    return std::min<int>(std::min<int>(XC(sqr), (7 - XC(sqr))),
+                         std::min<int>(YC(sqr), (7 - YC(sqr))));
+  }
+
+  //--------------------------------------------------------------------------
+  // specialized endgame evaluation, only the attack maps and passed pawns
+  // the search relies on are filled in
+  //--------------------------------------------------------------------------
+  template<bool withTerms>
+  void EvalEndgame(const MaterialEntry& mat, EvalTerms* terms) {
+    atks2[White] |= (atks[White] & atks[WhiteKing]);
+    atks2[Black] |= (atks[Black] & atks[BlackKing]);
+    atks[White] |= atks[WhiteKing];
+    atks[Black] |= atks[BlackKing];
+    pinfo[White].passed = PassedPawns<White>();
+    pinfo[Black].passed = PassedPawns<Black>();
+    if (withTerms) {
+      memset(terms, 0, sizeof(EvalTerms));
+    }
+
+#ifndef NDEBUG
+    VerifyPosition();
+#endif
+
+    if (IsDraw()) {
+      state |= Draw;
+      standPat = ctx->drawScore[ColorToMove()];
+      EvalDrawn<withTerms>(terms);
+      return;
+    }
+
+    // from the strong side's perspective
+    const bool white = (mat.strong == White);
+    int eval = 0;
+    switch (mat.endgame) {
+    case MaterialEntry::KXK:
+      eval = (white ? EvalKXK<White>() : EvalKXK<Black>());
+      break;
+    case MaterialEntry::KBNK:
+      eval = (white ? EvalKBNK<White>() : EvalKBNK<Black>());
+      break;
+    case MaterialEntry::KPK:
+      eval = (white ? EvalKPK<White>() : EvalKPK<Black>());
+      break;
+    case MaterialEntry::KRKP:
+      eval = (white ? EvalKRKP<White>() : EvalKRKP<Black>());
+      break;
+    case MaterialEntry::KQKR:
+      eval = (white ? EvalKQKR<White>() : EvalKQKR<Black>());
+      break;
+    default:
+      assert(false);
+    }
+    if (!white) {
+      eval = -eval;
+    }
+
+    // reduce winning score if rcount is getting large
+    if ((rcount > 25) && (abs(eval) > 8)) {
+      eval = static_cast<int>(eval * (25.0 / rcount));
+    }
+
+    standPat = (ColorToMove() ? -eval : eval);
+    if (withTerms) {
+      terms->endgame = eval;
+      terms->total = eval;
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  // drive the bare king to the edge and bring the other king closer
+  //--------------------------------------------------------------------------
+  template<Color color>
+  int EvalKXK() const {
+    // bishops that all stand on one color can't mate on their own
+    const uint64_t bishops = pc[color|Bishop];
+    if ((pc[color] == (bishops | pc[color|King])) &&
+        (!(bishops & _LIGHT) || !(bishops & _DARK)))
+    {
+      return 0;
+    }
+
+    return (material[color] - material[!color] + EndgameKnownWin +
+            (EndgameKingEdge * (3 - EdgeDist(king[!color]))) -
+            (EndgameKingDist * _diff.Dist(king[color], king[!color])));
+  }
+
+  //--------------------------------------------------------------------------
+  // drive the bare king into a corner of the bishop's color, the bishop
+  // is tested against the color of a1 because _LIGHT and _DARK are only
+  // used to tell the two colors apart
+  //--------------------------------------------------------------------------
+  template<Color color>
+  int EvalKBNK() const {
+    const int sqr = king[!color];
+    const uint64_t a1 = ((BIT(A1) & _LIGHT) ? _LIGHT : _DARK);
+    const int corner = ((pc[color|Bishop] & a1)
+        ? std::min<int>(_diff.Dist(sqr, A1), _diff.Dist(sqr, H8))
+        : std::min<int>(_diff.Dist(sqr, A8), _diff.Dist(sqr, H1)));
+    return (material[color] - material[!color] + EndgameKnownWin +
+            (EndgameKingEdge * (3 - EdgeDist(sqr))) +
+            (EndgameCorner * (7 - corner)) -
+            (EndgameKingDist * _diff.Dist(king[color], sqr)));
+  }
+
+  //--------------------------------------------------------------------------
+  // king and pawn vs king, exact with the bitbases, otherwise the rule of
+  // the square, rook pawns, and the defending king in front of the pawn
+  //--------------------------------------------------------------------------
+  template<Color color>
+  int EvalKPK() const {
+    const int sqr = LowSquare(pc[color|Pawn]);
+    const int promo = ((color ? A1 : A8) + XC(sqr));
+    const int rank = (color ? (7 - YC(sqr)) : YC(sqr));
+    const int score = (material[color] - material[!color] +
+                       (EndgamePawnRank * rank));
+
+    switch (BitbaseResult()) {
+    case Bitbases::Draw:
+      return 0;
+    case Bitbases::Win:
+    case Bitbases::Loss:
+      return (score + EndgameKnownWin);
+    default:
+      break;
+    }
+
+    // rook pawn with the defending king in the corner
+    if (((XC(sqr) == 0) || (XC(sqr) == 7)) &&
+        (_diff.Dist(king[!color], promo) <= 1))
+    {
+      return 0;
+    }
+
+    // can the pawn outrun the defending king?
+    const uint64_t path = (color ? _SOUTH[sqr] : _NORTH[sqr]);
+    const int steps = (_diff.Dist(sqr, promo) - (rank == 1));
+    if (!(path & pc[color|King]) &&
+        ((_diff.Dist(king[!color], promo) - (ColorToMove() != color)) > steps))
+    {
+      return (score + EndgameKnownWin);
+    }
+
+    // defending king in front of the pawn, attacking king behind it
+    if ((path & pc[(!color)|King]) &&
+        !(pc[color|King] & (color ? _WIDE_SOUTH[sqr] : _WIDE_NORTH[sqr])))
+    {
+      return (score / 4);
+    }
+
+    // otherwise the attacking king should lead the pawn
+    return (score + (EndgameKingDist * (_diff.Dist(king[!color], sqr) -
+                                        _diff.Dist(king[color], sqr))));
+  }
+
+  //--------------------------------------------------------------------------
+  // rook vs pawn, a win unless the pawn is far advanced and supported
+  //--------------------------------------------------------------------------
+  template<Color color>
+  int EvalKRKP() const {
+    const int rook = LowSquare(pc[color|Rook]);
+    const int pawn = LowSquare(pc[(!color)|Pawn]);
+    const int promo = ((color ? A8 : A1) + XC(pawn));
+    const int front = (pawn + (color ? North : South));
+    const int rank = (color ? YC(pawn) : (7 - YC(pawn))); // pawn's view
+    const int tempo = (ColorToMove() == color);
+    const int dist = _diff.Dist(king[color], pawn);
+
+    // attacking king in front of the pawn, or defending king too far away
+    if ((pc[color|King] & (color ? _NORTH[pawn] : _SOUTH[pawn])) ||
+        ((_diff.Dist(king[!color], pawn) >= (4 - tempo)) &&
+         (_diff.Dist(king[!color], rook) >= 3)))
+    {
+      return (RookValue - (EndgameKingDist * dist));
+    }
+
+    // advanced pawn supported by its king, attacking king too far away
+    if ((rank >= 5) && (_diff.Dist(king[!color], pawn) == 1) &&
+        (dist > (2 + tempo)))
+    {
+      return (80 - (EndgamePawnRank * dist));
+    }
+
+    return (200 - (EndgamePawnRank * (_diff.Dist(king[color], front) -
+                                      _diff.Dist(king[!color], front) -
+                                      _diff.Dist(pawn, promo))));
+  }
+
+  //--------------------------------------------------------------------------
+  // queen vs rook, drive the defending king to the edge
+  //--------------------------------------------------------------------------
+  template<Color color>
+  int EvalKQKR() const {
+    return (material[color] - material[!color] +
+            (EndgameKingEdge * (3 - EdgeDist(king[!color]))) -
+            (EndgameKingDist * _diff.Dist(king[color], king[!color])));
+  }
+
+  //--------------------------------------------------------------------------
+  // network score from the perspective of the side to move
+  //--------------------------------------------------------------------------
+  inline int NetworkEval() const {
+#ifndef NDEBUG
+    Network::Accumulator fresh;
+    ctx->network.Refresh(fresh, pc);
+    for (int side = White; side <= Black; ++side) {
+      assert(!memcmp(fresh.values[side], acc->values[side],
+                     (sizeof(int16_t) * ctx->network.Hidden())));
+    }
+#endif
+    int eval = ctx->network.Evaluate(*acc, ColorToMove());
+
+    // same 50 move rule scaling as the hand written eval
+    if ((rcount > 25) && (abs(eval) > 8)) {
+      eval = static_cast<int>(eval * (25.0 / rcount));
+    }
+    return eval;
+  }
+
+  //--------------------------------------------------------------------------
+  // rebuild this node's accumulator from scratch, needed whenever the
+  // position is set up some other way than Exec()
+  //--------------------------------------------------------------------------
+  inline void RefreshAccumulator() {
+    if (ctx->nnue) {
+      ctx->network.Refresh(*acc, pc);
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  // incremental accumulator update, the same piece changes Exec() makes
+  //--------------------------------------------------------------------------
+  template<Color color>
+  inline void UpdateAccumulator(const Move& move, Bitfoot& dest) const {
+    const Network& network = ctx->network;
+    const int from  = move.GetFrom();
+    const int to    = move.GetTo();
+    const int piece = move.GetPc();
+    const int cap   = move.GetCap();
+    const int promo = move.GetPromo();
+
+    if (this != &dest) {
+      network.Copy(*dest.acc, *acc);
+    }
+    if (move.GetType() == NoMove) {
+      return;
+    }
+
+    network.Sub(*dest.acc, piece, from);
+    network.Add(*dest.acc, (promo ? promo : piece), to);
+    switch (move.GetType()) {
+    case EnPassant:
+      network.Sub(*dest.acc, cap, (to + (color ? North : South)));
+      break;
+    case CastleShort:
+      network.Sub(*dest.acc, (color|Rook), (color ? H8 : H1));
+      network.Add(*dest.acc, (color|Rook), (color ? F8 : F1));
+      break;
+    case CastleLong:
+      network.Sub(*dest.acc, (color|Rook), (color ? A8 : A1));
+      network.Add(*dest.acc, (color|Rook), (color ? D8 : D1));
+      break;
+    default:
+      if (cap) {
+        network.Sub(*dest.acc, cap, to);
+      }
+      break;
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  template<bool withTerms>
+  inline void EvalDrawn(EvalTerms* terms) const {
+    if (withTerms) {
+      terms->total = (ColorToMove() ? -standPat : standPat);
+      terms->drawn = true;
+    }
   }
 
   //--------------------------------------------------------------------------
@@ -2009,7 +2922,7 @@ private:
     VASSERT(from != to);
     VASSERT(IS_PIECE(piece));
     VASSERT(COLOR_OF(piece) == color);
-    VASSERT(piece == _board[from]);
+    VASSERT(piece == ctx->board[from]);
     VASSERT(pc[color] & BIT(from));
     VASSERT(pc[piece] & BIT(from));
     VASSERT(!(pc[color] & BIT(to)));
@@ -2023,12 +2936,12 @@ private:
     case Normal:
       VASSERT(!promo);
       if (cap) {
-        VASSERT(cap == _board[to]);
+        VASSERT(cap == ctx->board[to]);
         VASSERT(pc[!color] & BIT(to));
         VASSERT(pc[cap] & BIT(to));
       }
       else {
-        VASSERT(!_board[to]);
+        VASSERT(!ctx->board[to]);
         VASSERT(!(pc[!color] & BIT(to)));
       }
       break;
@@ -2037,7 +2950,7 @@ private:
       VASSERT(!cap);
       VASSERT(!(BIT(from) & (_RANK[0] | _RANK[7])));
       VASSERT(to == (from + (color ? South : North)));
-      VASSERT(!_board[to]);
+      VASSERT(!ctx->board[to]);
       if (promo) {
         VASSERT(BIT(to) & _RANK[color ? 0 : 7]);
         VASSERT(!(pc[promo] & BIT(to)));
@@ -2052,12 +2965,12 @@ private:
       VASSERT(!promo);
       VASSERT(BIT(from) & _RANK[color ? 6 : 1]);
       VASSERT(to == (from + (2 * (color ? South : North))));
-      VASSERT(!_board[from + (color ? South : North)]);
-      VASSERT(!_board[to]);
+      VASSERT(!ctx->board[from + (color ? South : North)]);
+      VASSERT(!ctx->board[to]);
       break;
     case PawnCapture:
       VASSERT(piece == (color|Pawn));
-      VASSERT(cap && (cap == _board[to]));
+      VASSERT(cap && (cap == ctx->board[to]));
       VASSERT(!(BIT(from) & (_RANK[0] | _RANK[7])));
       VASSERT(BIT(to) & _PAWN_ATK[color][from]);
       VASSERT(pc[!color] & BIT(to));
@@ -2078,8 +2991,8 @@ private:
       VASSERT(BIT(from) & _RANK[color ? 3 : 4]);
       VASSERT(BIT(to) & _PAWN_ATK[color][from]);
       VASSERT(to == ep);
-      VASSERT(!_board[to]);
-      VASSERT(_board[to + (color ? North : South)] == cap);
+      VASSERT(!ctx->board[to]);
+      VASSERT(ctx->board[to + (color ? North : South)] == cap);
       VASSERT(!(pc[!color] & BIT(to)));
       VASSERT(!(pc[cap] & BIT(to)));
       VASSERT(pc[!color] & BIT(to + (color ? North : South)));
@@ -2091,12 +3004,12 @@ private:
       VASSERT(BIT(to) & _KING_ATK[from]);
       VASSERT(!AttackedBy<!color>(to));
       if (cap) {
-        VASSERT(cap == _board[to]);
+        VASSERT(cap == ctx->board[to]);
         VASSERT(pc[!color] & BIT(to));
         VASSERT(pc[cap] & BIT(to));
       }
       else {
-        VASSERT(!_board[to]);
+        VASSERT(!ctx->board[to]);
         VASSERT(!(pc[!color] & BIT(to)));
       }
       break;
@@ -2107,9 +3020,9 @@ private:
       VASSERT(state & (color ? BlackShort : WhiteShort));
       VASSERT(from == (color ? E8 : E1));
       VASSERT(to == (color ? G8 : G1));
-      VASSERT(!_board[color ? F8 : F1]);
-      VASSERT(!_board[color ? G8 : G1]);
-      VASSERT(_board[color ? H8 : H1] == (color|Rook));
+      VASSERT(!ctx->board[color ? F8 : F1]);
+      VASSERT(!ctx->board[color ? G8 : G1]);
+      VASSERT(ctx->board[color ? H8 : H1] == (color|Rook));
       VASSERT(!AttackedBy<!color>(color ? E8 : E1));
       VASSERT(!AttackedBy<!color>(color ? F8 : F1));
       VASSERT(!AttackedBy<!color>(color ? G8 : G1));
@@ -2121,10 +3034,10 @@ private:
       VASSERT(state & (color ? BlackLong : WhiteLong));
       VASSERT(from == (color ? E8 : E1));
       VASSERT(to == (color ? C8 : C1));
-      VASSERT(_board[color ? A8 : A1] == (color|Rook));
-      VASSERT(!_board[color ? B8 : B1]);
-      VASSERT(!_board[color ? C8 : C1]);
-      VASSERT(!_board[color ? D8 : D1]);
+      VASSERT(ctx->board[color ? A8 : A1] == (color|Rook));
+      VASSERT(!ctx->board[color ? B8 : B1]);
+      VASSERT(!ctx->board[color ? C8 : C1]);
+      VASSERT(!ctx->board[color ? D8 : D1]);
       VASSERT(!AttackedBy<!color>(color ? C8 : C1));
       VASSERT(!AttackedBy<!color>(color ? D8 : D1));
       VASSERT(!AttackedBy<!color>(color ? E8 : E1));
@@ -2148,8 +3061,7 @@ private:
     const int promo     = move.GetPromo();
     int epSqr;
 
-    _stats.execs++;
-    _seen.insert(positionKey);
+    ctx->seen.insert(positionKey);
 
     if (this != &dest) {
       memcpy(dest.pc, pc, sizeof(pc));
@@ -2182,6 +3094,7 @@ private:
                          _HASH[piece][from] ^
                          _HASH[piece][to] ^
                          _HASH[cap][to]);
+        dest.materialKey = (materialKey ^ _HASH[cap][BitCount(pc[cap]) - 1]);
         dest.pc[!color] ^= BIT(to);
         dest.pc[cap] ^= BIT(to);
       }
@@ -2194,11 +3107,12 @@ private:
                               SquareValue(piece, to));
         dest.rcount = (rcount + 1);
         dest.pieceKey = (pieceKey ^ _HASH[piece][from] ^ _HASH[piece][to]);
+        dest.materialKey = materialKey;
       }
       dest.pc[color] ^= dest.effected;
       dest.pc[piece] ^= dest.effected;
-      _board[to] = piece;
-      _board[from] = 0;
+      ctx->board[to] = piece;
+      ctx->board[from] = 0;
       break;
 
     case PawnPush:
@@ -2218,11 +3132,14 @@ private:
                               SquareValue(promo, to));
         dest.rcount = 0;
         dest.pieceKey = (pieceKey ^ _HASH[piece][from] ^ _HASH[promo][to]);
+        dest.materialKey = (materialKey ^
+                            _HASH[piece][BitCount(pc[piece]) - 1] ^
+                            _HASH[promo][BitCount(pc[promo])]);
         dest.pc[color] ^= dest.effected;
         dest.pc[piece] ^= BIT(from);
         dest.pc[promo] ^= BIT(to);
-        _board[to] = promo;
-        _board[from] = 0;
+        ctx->board[to] = promo;
+        ctx->board[from] = 0;
       }
       else {
         dest.material[White] = material[White];
@@ -2233,10 +3150,11 @@ private:
                               SquareValue(piece, to));
         dest.rcount = 0;
         dest.pieceKey = (pieceKey ^ _HASH[piece][from] ^ _HASH[piece][to]);
+        dest.materialKey = materialKey;
         dest.pc[color] ^= dest.effected;
         dest.pc[piece] ^= dest.effected;
-        _board[to] = piece;
-        _board[from] = 0;
+        ctx->board[to] = piece;
+        ctx->board[from] = 0;
       }
       break;
 
@@ -2254,10 +3172,11 @@ private:
                             SquareValue(piece, to));
       dest.rcount = 0;
       dest.pieceKey = (pieceKey ^ _HASH[piece][from] ^ _HASH[piece][to]);
+      dest.materialKey = materialKey;
       dest.pc[color] ^= dest.effected;
       dest.pc[piece] ^= dest.effected;
-      _board[to] = piece;
-      _board[from] = 0;
+      ctx->board[to] = piece;
+      ctx->board[from] = 0;
       break;
 
     case PawnCapture:
@@ -2280,13 +3199,17 @@ private:
                          _HASH[piece][from] ^
                          _HASH[promo][to] ^
                          _HASH[cap][to]);
+        dest.materialKey = (materialKey ^
+                            _HASH[piece][BitCount(pc[piece]) - 1] ^
+                            _HASH[promo][BitCount(pc[promo])] ^
+                            _HASH[cap][BitCount(pc[cap]) - 1]);
         dest.pc[color] ^= dest.effected;
         dest.pc[piece] ^= BIT(from);
         dest.pc[promo] ^= BIT(to);
         dest.pc[!color] ^= BIT(to);
         dest.pc[cap] ^= BIT(to);
-        _board[to] = promo;
-        _board[from] = 0;
+        ctx->board[to] = promo;
+        ctx->board[from] = 0;
       }
       else {
         dest.material[!color] = (material[!color] - ValueOf(cap));
@@ -2300,12 +3223,13 @@ private:
                          _HASH[piece][from] ^
                          _HASH[piece][to] ^
                          _HASH[cap][to]);
+        dest.materialKey = (materialKey ^ _HASH[cap][BitCount(pc[cap]) - 1]);
         dest.pc[color] ^= dest.effected;
         dest.pc[piece] ^= dest.effected;
         dest.pc[!color] ^= BIT(to);
         dest.pc[cap] ^= BIT(to);
-        _board[to] = piece;
-        _board[from] = 0;
+        ctx->board[to] = piece;
+        ctx->board[from] = 0;
       }
       break;
 
@@ -2327,13 +3251,14 @@ private:
                        _HASH[piece][from] ^
                        _HASH[piece][to] ^
                        _HASH[cap][epSqr]);
+      dest.materialKey = (materialKey ^ _HASH[cap][BitCount(pc[cap]) - 1]);
       dest.pc[color] ^= (BIT(from) | BIT(to));
       dest.pc[piece] ^= (BIT(from) | BIT(to));
       dest.pc[!color] ^= BIT(epSqr);
       dest.pc[cap] ^= BIT(epSqr);
-      _board[to] = piece;
-      _board[from] = 0;
-      _board[epSqr] = 0;
+      ctx->board[to] = piece;
+      ctx->board[from] = 0;
+      ctx->board[epSqr] = 0;
       break;
 
     case KingMove:
@@ -2352,6 +3277,7 @@ private:
                          _HASH[piece][from] ^
                          _HASH[piece][to] ^
                          _HASH[cap][to]);
+        dest.materialKey = (materialKey ^ _HASH[cap][BitCount(pc[cap]) - 1]);
         dest.pc[!color] ^= BIT(to);
         dest.pc[cap] ^= BIT(to);
       }
@@ -2362,11 +3288,12 @@ private:
         dest.sqrVal[Black] = sqrVal[Black];
         dest.rcount = (rcount + 1);
         dest.pieceKey = (pieceKey ^ _HASH[piece][from] ^ _HASH[piece][to]);
+        dest.materialKey = materialKey;
       }
       dest.pc[color] ^= dest.effected;
       dest.pc[piece] ^= dest.effected;
-      _board[to] = piece;
-      _board[from] = 0;
+      ctx->board[to] = piece;
+      ctx->board[from] = 0;
       break;
 
     case CastleShort:
@@ -2388,13 +3315,14 @@ private:
                        _HASH[piece][to] ^
                        _HASH[color|Rook][color ? F8 : F1] ^
                        _HASH[color|Rook][color ? H8 : H1]);
+      dest.materialKey = materialKey;
       dest.pc[color] ^= dest.effected;
       dest.pc[piece] ^= (BIT(from) | BIT(to));
       dest.pc[color|Rook] ^= (BIT(color ? F8 : F1) | BIT(color ? H8 : H1));
-      _board[color ? F8 : F1] = (color|Rook);
-      _board[color ? H8 : H1] = 0;
-      _board[to] = piece;
-      _board[from] = 0;
+      ctx->board[color ? F8 : F1] = (color|Rook);
+      ctx->board[color ? H8 : H1] = 0;
+      ctx->board[to] = piece;
+      ctx->board[from] = 0;
       break;
 
     case CastleLong:
@@ -2416,13 +3344,14 @@ private:
                        _HASH[piece][to] ^
                        _HASH[color|Rook][color ? A8 : A1] ^
                        _HASH[color|Rook][color ? D8 : D1]);
+      dest.materialKey = materialKey;
       dest.pc[color] ^= dest.effected;
       dest.pc[piece] ^= (BIT(from) | BIT(to));
       dest.pc[color|Rook] ^= (BIT(color ? A8 : A1) | BIT(color ? D8 : D1));
-      _board[color ? A8 : A1] = 0;
-      _board[color ? D8 : D1] = (color|Rook);
-      _board[to] = piece;
-      _board[from] = 0;
+      ctx->board[color ? A8 : A1] = 0;
+      ctx->board[color ? D8 : D1] = (color|Rook);
+      ctx->board[to] = piece;
+      ctx->board[from] = 0;
       break;
     }
 
@@ -2467,6 +3396,10 @@ private:
       dest.state |= Check;
     }
 
+    if (ctx->nnue) {
+      UpdateAccumulator<color>(move, dest);
+    }
+
     dest.Evaluate();
   }
 
@@ -2477,8 +3410,6 @@ private:
     assert(&dest != this);
     assert(!chkrs);
 
-    _stats.nullMoves++;
-
     memcpy(dest.pc, pc, sizeof(pc));
     dest.lastMove.Clear();
     dest.lastPieceMoved  = 0;
@@ -2495,6 +3426,7 @@ private:
     dest.sqrVal[Black]   = sqrVal[Black];
     dest.rcount          = 0;
     dest.pieceKey        = pieceKey;
+    dest.materialKey     = materialKey;
     dest.positionKey     = (dest.pieceKey ^ _HASH[0][dest.state & StateMask]);
     dest.kcross[White]   = kcross[White];
     dest.kcross[Black]   = kcross[Black];
@@ -2502,6 +3434,10 @@ private:
     dest.kdiags[Black]   = kdiags[Black];
     dest.chkrs           = 0ULL;
 
+    if (ctx->nnue) {
+      ctx->network.Copy(*dest.acc, *acc);
+    }
+
     dest.Evaluate();
   }
 
@@ -2518,46 +3454,46 @@ private:
     assert(!move.GetPromo() ||
            ((move.GetPromo() >= Knight) && (move.GetCap() < King)));
 
-    _board[move.GetFrom()] = move.GetPc();
+    ctx->board[move.GetFrom()] = move.GetPc();
     switch (move.GetType()) {
     case Normal:
-      _board[move.GetTo()] = move.GetCap();
+      ctx->board[move.GetTo()] = move.GetCap();
       break;
     case PawnPush:
     case PawnLung:
       assert(move.GetPc() == (color|Pawn));
-      _board[move.GetTo()] = 0;
+      ctx->board[move.GetTo()] = 0;
       break;
     case PawnCapture:
       assert(move.GetPc() == (color|Pawn));
-      _board[move.GetTo()] = move.GetCap();
+      ctx->board[move.GetTo()] = move.GetCap();
       break;
     case EnPassant:
       assert(move.GetPc() == (color|Pawn));
       assert(move.GetCap() == ((!color)|Pawn));
-      _board[move.GetTo()] = 0;
-      _board[move.GetTo() + (color ? North : South)] = ((!color)|Pawn);
+      ctx->board[move.GetTo()] = 0;
+      ctx->board[move.GetTo() + (color ? North : South)] = ((!color)|Pawn);
       break;
     case KingMove:
       assert(move.GetPc() == (color|King));
-      _board[move.GetTo()] = move.GetCap();
+      ctx->board[move.GetTo()] = move.GetCap();
       break;
     case CastleShort:
       assert(move.GetPc() == (color|King));
-      _board[move.GetTo()] = 0;
-      _board[color ? H8 : H1] = (color|Rook);
-      _board[color ? F8 : F1] = 0;
+      ctx->board[move.GetTo()] = 0;
+      ctx->board[color ? H8 : H1] = (color|Rook);
+      ctx->board[color ? F8 : F1] = 0;
       break;
     case CastleLong:
       assert(move.GetPc() == (color|King));
-      _board[move.GetTo()] = 0;
-      _board[color ? A8 : A1] = (color|Rook);
-      _board[color ? D8 : D1] = 0;
+      ctx->board[move.GetTo()] = 0;
+      ctx->board[color ? A8 : A1] = (color|Rook);
+      ctx->board[color ? D8 : D1] = 0;
       break;
     default:
       assert(false);
     }
-    _seen.erase(positionKey);
+    ctx->seen.erase(positionKey);
   }
 
   //--------------------------------------------------------------------------
@@ -2569,11 +3505,11 @@ private:
     int sqr;
 
     if ((tmp = (_PAWN_ATK[!color][to] & pc[color|Pawn]))) {
-      assert(_board[LowSquare(tmp)] == (color|Pawn));
+      assert(ctx->board[LowSquare(tmp)] == (color|Pawn));
       return LowSquare(tmp);
     }
     if ((tmp = (_KNIGHT_ATK[to] & pc[color|Knight]))) {
-      assert(_board[LowSquare(tmp)] == (color|Knight));
+      assert(ctx->board[LowSquare(tmp)] == (color|Knight));
       return LowSquare(tmp);
     }
 
@@ -2581,19 +3517,19 @@ private:
     tmp = (BishopX(to) & (pc[color|Bishop] | pc[color|Queen]));
     while (tmp) {
       PopLowSquare(tmp, sqr);
-      if (_board[sqr] == (color|Bishop)) {
+      if (ctx->board[sqr] == (color|Bishop)) {
         return sqr;
       }
-      assert(_board[sqr] == (color|Queen));
+      assert(ctx->board[sqr] == (color|Queen));
       queen = sqr;
     }
     tmp = (RookX(to) & (pc[color|Rook] | pc[color|Queen]));
     while (tmp) {
       PopLowSquare(tmp, sqr);
-      if (_board[sqr] == (color|Rook)) {
+      if (ctx->board[sqr] == (color|Rook)) {
         return sqr;
       }
-      assert(_board[sqr] == (color|Queen));
+      assert(ctx->board[sqr] == (color|Queen));
       queen = sqr;
     }
 
@@ -2602,7 +3538,7 @@ private:
     }
 
     if ((tmp = (_KING_ATK[to] & pc[color|King]))) {
-      assert(_board[LowSquare(tmp)] == (color|King));
+      assert(ctx->board[LowSquare(tmp)] == (color|King));
       return LowSquare(tmp);
     }
 
@@ -2617,26 +3553,26 @@ private:
   inline int StaticExchange(const int from, const int to) {
     assert(IS_SQUARE(from));
     assert(IS_SQUARE(to));
-    assert(_board[from]);
-    assert(_board[to] < King);
-    assert(COLOR_OF(_board[from]) == color);
+    assert(ctx->board[from]);
+    assert(ctx->board[to] < King);
+    assert(COLOR_OF(ctx->board[from]) == color);
     assert(pc[color] & BIT(from));
-    assert(pc[_board[from]] & BIT(from));
+    assert(pc[ctx->board[from]] & BIT(from));
 
-    const int cap = _board[to];
+    const int cap = ctx->board[to];
     if ((!forced && !cap) || Pinned<color>(from, to)) {
       return 0;
     }
 
     assert(forced || (COLOR_OF(cap) != color));
     int gain = ValueOf(cap);
-    const int piece = _board[from];
+    const int piece = ctx->board[from];
     if (piece < King) {
       if (ValueOf(piece) >= gain) {
         const uint64_t fromBit = BIT(from);
         const uint64_t toBit = BIT(to);
-        _board[to] = piece;
-        _board[from] = 0;
+        ctx->board[to] = piece;
+        ctx->board[from] = 0;
         pc[color] ^= (fromBit | toBit);
         pc[piece] ^= (fromBit | toBit);
         if (cap) {
@@ -2652,8 +3588,8 @@ private:
             gain = 0;
           }
         }
-        _board[from] = piece;
-        _board[to] = cap;
+        ctx->board[from] = piece;
+        ctx->board[to] = cap;
         pc[color] ^= (fromBit | toBit);
         pc[piece] ^= (fromBit | toBit);
         if (cap) {
@@ -2683,7 +3619,7 @@ private:
     assert(IS_SQUARE(to));
     assert(IS_PIECE(piece));
     assert(COLOR_OF(piece) == color);
-    assert(_board[from] == piece);
+    assert(ctx->board[from] == piece);
     assert(abs(score) < Infinity);
     assert(!cap || ((cap >= Pawn) && (cap < King)));
     assert(!cap || (COLOR_OF(cap) != color));
@@ -2701,9 +3637,9 @@ private:
         move.Score() += 50;
       }
       else {
-        assert(_hist[move.GetHistoryIndex()] >= -2);
-        assert(_hist[move.GetHistoryIndex()] <= 40);
-        move.Score() += _hist[move.GetHistoryIndex()];
+        assert(ctx->hist[move.GetHistoryIndex()] >= -2);
+        assert(ctx->hist[move.GetHistoryIndex()] <= 40);
+        move.Score() += ctx->hist[move.GetHistoryIndex()];
       }
     }
   }
@@ -2737,14 +3673,16 @@ private:
           assert(false);
         }
         AddMove<color, KingMove>((color|King), from, to,
-                                 (ValueOf(_board[to]) - 50), _board[to], 0);
+                                 (ValueOf(ctx->board[to]) - 50),
+                                 ctx->board[to], 0);
       }
     }
     else {
       while (dests) {
         PopLowSquare(dests, to);
         AddMove<color, KingMove>((color|King), from, to,
-                                 (ValueOf(_board[to]) - 50), _board[to], 0);
+                                 (ValueOf(ctx->board[to]) - 50),
+                                 ctx->board[to], 0);
       }
     }
   }
@@ -2831,13 +3769,13 @@ private:
   inline void AddCastleMoves() {
     if (CanCastleKingSide<color>()) {
       assert(king[color] == (color ? E8 : E1));
-      assert(_board[color ? H8 : H1] == (color|Rook));
+      assert(ctx->board[color ? H8 : H1] == (color|Rook));
       AddMove<color, CastleShort>((color|King), king[color], (color ? G8 : G1),
                                   25, 0, 0);
     }
     if (CanCastleQueenSide<color>()) {
       assert(king[color] == (color ? E8 : E1));
-      assert(_board[color ? A8 : A1] == (color|Rook));
+      assert(ctx->board[color ? A8 : A1] == (color|Rook));
       AddMove<color, CastleLong>((color|King), king[color], (color ? C8 : C1),
                                  20, 0, 0);
     }
@@ -2850,7 +3788,7 @@ private:
         (BIT(king[!color]) & (color ? SouthX(G8) : NorthX(G1))))
     {
       assert(king[color] == (color ? E8 : E1));
-      assert(_board[color ? H8 : H1] == (color|Rook));
+      assert(ctx->board[color ? H8 : H1] == (color|Rook));
       AddMove<color, CastleShort>((color|King), king[color], (color ? G8 : G1),
                                   25, 0, 0);
     }
@@ -2858,7 +3796,7 @@ private:
         (BIT(king[!color]) & (color ? SouthX(D8) : NorthX(D1))))
     {
       assert(king[color] == (color ? E8 : E1));
-      assert(_board[color ? A8 : A1] == (color|Rook));
+      assert(ctx->board[color ? A8 : A1] == (color|Rook));
       AddMove<color, CastleLong>((color|King), king[color], (color ? C8 : C1),
                                  20, 0, 0);
     }
@@ -2898,27 +3836,28 @@ private:
     }
     while (dest) {
       from = (PopLowSquare(dest, to) + (color ? NorthEast : SouthEast));
-      assert(_board[to] && (COLOR_OF(_board[to]) == !color));
+      assert(ctx->board[to] && (COLOR_OF(ctx->board[to]) == !color));
       if (!Pinned<color>(from, to)) {
         if (BIT(to) & _RANK[color ? 0 : 7]) {
           AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                      (ValueOf(_board[to]) + QueenValue),
-                                      _board[to], (color|Queen));
+                                      (ValueOf(ctx->board[to]) + QueenValue),
+                                      ctx->board[to], (color|Queen));
           if (under_promote) {
             AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                        (ValueOf(_board[to]) + RookValue),
-                                        _board[to], (color|Rook));
+                                        (ValueOf(ctx->board[to]) + RookValue),
+                                        ctx->board[to], (color|Rook));
             AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                        (ValueOf(_board[to]) + BishopValue),
-                                        _board[to], (color|Bishop));
+                                        (ValueOf(ctx->board[to]) + BishopValue),
+                                        ctx->board[to], (color|Bishop));
             AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                        (ValueOf(_board[to]) + KnightValue),
-                                        _board[to], (color|Knight));
+                                        (ValueOf(ctx->board[to]) + KnightValue),
+                                        ctx->board[to], (color|Knight));
           }
         }
         else {
           AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                      ValueOf(_board[to]), _board[to], 0);
+                                      ValueOf(ctx->board[to]),
+                                      ctx->board[to], 0);
         }
       }
     }
@@ -2931,27 +3870,28 @@ private:
     }
     while (dest) {
       from = (PopLowSquare(dest, to) + (color ? NorthWest : SouthWest));
-      assert(_board[to] && (COLOR_OF(_board[to]) == !color));
+      assert(ctx->board[to] && (COLOR_OF(ctx->board[to]) == !color));
       if (!Pinned<color>(from, to)) {
         if (BIT(to) & _RANK[color ? 0 : 7]) {
           AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                      (ValueOf(_board[to]) + QueenValue),
-                                      _board[to], (color|Queen));
+                                      (ValueOf(ctx->board[to]) + QueenValue),
+                                      ctx->board[to], (color|Queen));
           if (under_promote) {
             AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                        (ValueOf(_board[to]) + RookValue),
-                                        _board[to], (color|Rook));
+                                        (ValueOf(ctx->board[to]) + RookValue),
+                                        ctx->board[to], (color|Rook));
             AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                        (ValueOf(_board[to]) + BishopValue),
-                                        _board[to], (color|Bishop));
+                                        (ValueOf(ctx->board[to]) + BishopValue),
+                                        ctx->board[to], (color|Bishop));
             AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                        (ValueOf(_board[to]) + KnightValue),
-                                        _board[to], (color|Knight));
+                                        (ValueOf(ctx->board[to]) + KnightValue),
+                                        ctx->board[to], (color|Knight));
           }
         }
         else {
           AddMove<color, PawnCapture>((color|Pawn), from, to,
-                                      ValueOf(_board[to]), _board[to], 0);
+                                      ValueOf(ctx->board[to]),
+                                      ctx->board[to], 0);
         }
       }
     }
@@ -3118,14 +4058,15 @@ private:
       dest = (_KNIGHT_ATK[PopLowSquare(pieces, from)] & dests & ~pc[color]);
       while (dest) {
         if (!Pinned<color>(from, PopLowSquare(dest, to))) {
-          if (_board[to] >= Knight) {
+          if (ctx->board[to] >= Knight) {
             AddMove<color, Normal>((color|Knight), from, to,
-                                   (ValueOf(_board[to]) - 10), _board[to], 0);
+                                   (ValueOf(ctx->board[to]) - 10),
+                                   ctx->board[to], 0);
           }
           else {
             AddMove<color, Normal>((color|Knight), from, to,
                                    StaticExchange<color, true>(from, to),
-                                   _board[to], 0);
+                                   ctx->board[to], 0);
           }
         }
       }
@@ -3228,14 +4169,15 @@ private:
       dest = (slider[PopLowSquare(pieces, from)] & dests & ~pc[color]);
       while (dest) {
         if (!Pinned<color>(from, PopLowSquare(dest, to))) {
-          if (_board[to] >= Knight) {
+          if (ctx->board[to] >= Knight) {
             AddMove<color, Normal>((color|Bishop), from, to,
-                                   (ValueOf(_board[to]) - 20), _board[to], 0);
+                                   (ValueOf(ctx->board[to]) - 20),
+                                   ctx->board[to], 0);
           }
           else {
             AddMove<color, Normal>((color|Bishop), from, to,
                                    StaticExchange<color, true>(from, to),
-                                   _board[to], 0);
+                                   ctx->board[to], 0);
           }
         }
       }
@@ -3329,14 +4271,15 @@ private:
       dest = (slider[PopLowSquare(pieces, from)] & dests & ~pc[color]);
       while (dest) {
         if (!Pinned<color>(from, PopLowSquare(dest, to))) {
-          if (_board[to] >= Rook) {
+          if (ctx->board[to] >= Rook) {
             AddMove<color, Normal>((color|Rook), from, to,
-                                   (ValueOf(_board[to]) - 30), _board[to], 0);
+                                   (ValueOf(ctx->board[to]) - 30),
+                                   ctx->board[to], 0);
           }
           else {
             AddMove<color, Normal>((color|Rook), from, to,
                                    StaticExchange<color, true>(from, to),
-                                   _board[to], 0);
+                                   ctx->board[to], 0);
           }
         }
       }
@@ -3430,14 +4373,15 @@ private:
       dest = (slider[PopLowSquare(pieces, from)] & dests & ~pc[color]);
       while (dest) {
         if (!Pinned<color>(from, PopLowSquare(dest, to))) {
-          if (_board[to] >= Queen) {
+          if (ctx->board[to] >= Queen) {
             AddMove<color, Normal>((color|Queen), from, to,
-                                   (ValueOf(_board[to]) - 40), _board[to], 0);
+                                   (ValueOf(ctx->board[to]) - 40),
+                                   ctx->board[to], 0);
           }
           else {
             AddMove<color, Normal>((color|Queen), from, to,
                                    StaticExchange<color, true>(from, to),
-                                   _board[to], 0);
+                                   ctx->board[to], 0);
           }
         }
       }
@@ -3741,9 +4685,9 @@ private:
     const int from = dest.pv[0].GetFrom();
     const int to = dest.pv[0].GetTo();
 
-    assert(_board[from] > 0);
-    assert(COLOR_OF(_board[from]) == dest.ColorToMove());
-    assert(!_board[to] || (COLOR_OF(_board[to]) == ColorToMove()));
+    assert(ctx->board[from] > 0);
+    assert(COLOR_OF(ctx->board[from]) == dest.ColorToMove());
+    assert(!ctx->board[to] || (COLOR_OF(ctx->board[to]) == ColorToMove()));
 
     // dest.pv[0] is continuation of lastMove?
     // or occupies square vacated by last move?
@@ -3800,7 +4744,7 @@ private:
 
     // does lastMove protect dest.pv[0]?
     const int lastDest = lastMove.GetTo();
-    if (_board[lastDest] == lastPieceMoved) {
+    if (ctx->board[lastDest] == lastPieceMoved) {
       assert(to != lastDest);
       switch (Black|lastPieceMoved) {
       case (BlackPawn):
@@ -3933,7 +4877,7 @@ private:
 
     uint64_t count = 0;
 
-    for (; !_stop && (moveIndex < moveCount); ++moveIndex) {
+    for (; !*ctx->stop && (moveIndex < moveCount); ++moveIndex) {
       const Move& move = moves[moveIndex];
       Exec<color>(move, *child);
       count += child->PerftSearch<!color>(depth - 1);
@@ -3946,12 +4890,12 @@ private:
   //--------------------------------------------------------------------------
   template<Color color>
   uint64_t PerftSearchRoot(const int depth) {
-    assert(_initialized);
+    assert(ctx->initialized);
     assert(ply == 0);
     assert(!parent);
-    assert(child == _node);
+    assert(child == ctx->node);
 
-    if (_debug) {
+    if (IsDebugOn()) {
       PrintBoard();
       senjo::Output() << GetFEN();
     }
@@ -3962,7 +4906,7 @@ private:
     uint64_t count = 0;
 
     if (child && (depth > 1)) {
-      for (; !_stop && (moveIndex < moveCount); ++moveIndex) {
+      for (; !*ctx->stop && (moveIndex < moveCount); ++moveIndex) {
         const Move& move = moves[moveIndex];
         Exec<color>(move, *child);
         const uint64_t c = child->PerftSearch<!color>(depth - 1);
@@ -3972,7 +4916,7 @@ private:
       }
     }
     else {
-      for (; !_stop && (moveIndex < moveCount); ++moveIndex) {
+      for (; !*ctx->stop && (moveIndex < moveCount); ++moveIndex) {
         senjo::Output() << moves[moveIndex].ToString() << " 1 "
                         << moves[moveIndex].GetScore();
         count++;
@@ -3983,21 +4927,44 @@ private:
   }
 
   //--------------------------------------------------------------------------
-  template<Color color>
-  int QSearch(int alpha, int beta, const int depth) {
+  template<Color color, int features>
+  inline int QSearch(int alpha, int beta, const int depth) {
+    if (!Enabled<features>(UseTrace)) {
+      return QSearchNode<color, features>(alpha, beta, depth);
+    }
+    TraceNode(TraceQEnter, depth, alpha, beta, 0, false);
+    const int score = QSearchNode<color, features>(alpha, beta, depth);
+    TraceNode(TraceQExit, depth, alpha, beta, score, false);
+    return score;
+  }
+
+  //--------------------------------------------------------------------------
+  template<Color color, int features>
+  int QSearchNode(int alpha, int beta, const int depth) {
     assert(alpha < beta);
     assert(abs(alpha) <= Infinity);
     assert(abs(beta) <= Infinity);
     assert(depth <= 0);
 
-    _stats.qnodes++;
-    if (ply > _seldepth) {
-      _seldepth = ply;
+    ctx->stats.qnodes++;
+    Count<features>(ctx->stats.qnodesAtPly[ply]);
+    CheckNodeLimit();
+    if (ply > ctx->seldepth) {
+      ctx->seldepth = ply;
+    }
+    if (!(ctx->stats.qnodes & ProgressMask)) {
+      PublishProgress();
     }
 
     pvCount = 0;
     if (IsDraw()) {
-      return _drawScore[color];
+      return ctx->drawScore[color];
+    }
+
+    int score;
+    if (ProbeBitbase(score)) {
+      Count<features>(ctx->stats.bitbaseHits);
+      return score;
     }
 
     // mate distance pruning and standPat beta cutoff
@@ -4012,17 +4979,19 @@ private:
 
     // do we have anything for this position in the transposition table?
     Move firstMove;
-    HashEntry* entry = _tt.Probe(positionKey);
+    HashEntry  hashEntry;
+    HashEntry* entry = ctx->tt->Probe(positionKey, hashEntry, ply);
     if (entry) {
       switch (entry->GetPrimaryFlag()) {
       case HashEntry::Checkmate: return (ply - Infinity);
-      case HashEntry::Stalemate: return _drawScore[color];
+      case HashEntry::Stalemate: return ctx->drawScore[color];
       case HashEntry::UpperBound:
         firstMove.Init(entry->moveBits, entry->score);
         assert(ValidateMove<color>(firstMove) == 0);
         if (entry->score <= alpha) {
           pv[0] = firstMove;
           pvCount = 1;
+          Note<features>(HashCutoff);
           return entry->score;
         }
         break;
@@ -4035,6 +5004,7 @@ private:
           IncHistory(firstMove, check, entry->depth);
           AddKiller(firstMove);
         }
+        Note<features>(HashCutoff);
         return entry->score;
       case HashEntry::LowerBound:
         firstMove.Init(entry->moveBits, entry->score);
@@ -4046,6 +5016,7 @@ private:
             IncHistory(firstMove, check, entry->depth);
             AddKiller(firstMove);
           }
+          Note<features>(HashCutoff);
           return entry->score;
         }
         if (entry->score > best) {
@@ -4067,15 +5038,17 @@ private:
     // search firstMove if we have it
     const int orig_alpha = alpha;
     if (firstMove.IsValid()) {
-      _stats.qexecs++;
+      Count<features>(ctx->stats.execs);
+      Count<features>(ctx->stats.qexecs);
       Exec<color>(firstMove, *child);
       if (!check && !firstMove.IsCapOrPromo() && !child->InCheck()) {
         Undo<color>(firstMove);
       }
       else {
-        firstMove.Score() = -child->QSearch<!color>(-beta, -alpha, (depth - 1));
+        firstMove.Score() =
+            -child->QSearch<!color, features>(-beta, -alpha, (depth - 1));
         Undo<color>(firstMove);
-        if (_stop) {
+        if (*ctx->stop) {
           return beta;
         }
         if (firstMove.GetScore() > alpha) {
@@ -4090,7 +5063,8 @@ private:
             }
             if (check) {
               firstMove.Score() = beta;
-              _tt.Store(positionKey, firstMove, 0, HashEntry::LowerBound, 0);
+              ctx->tt->Store(positionKey, firstMove, 0, HashEntry::LowerBound,
+                             0, ply);
             }
             return best;
           }
@@ -4107,23 +5081,25 @@ private:
         continue;
       }
 
-      _stats.qexecs++;
+      Count<features>(ctx->stats.execs);
+      Count<features>(ctx->stats.qexecs);
       Exec<color>(*move, *child);
-      if (_delta && !check && (depth < 0) &&
+      if (ctx->delta && !check && (depth < 0) &&
           !move->GetPromo() && !child->InCheck() &&
-          ((standPat + ValueOf(move->GetCap()) + _delta) <= alpha))
+          ((standPat + ValueOf(move->GetCap()) + ctx->delta) <= alpha))
       {
-        _stats.deltaCount++;
+        Count<features>(ctx->stats.deltaCount, DeltaPrune);
         Undo<color>(*move);
-        if (_stop) {
+        if (*ctx->stop) {
           return beta;
         }
         continue;
       }
 
-      move->Score() = -child->QSearch<!color>(-beta, -alpha, (depth - 1));
+      move->Score() =
+          -child->QSearch<!color, features>(-beta, -alpha, (depth - 1));
       Undo<color>(*move);
-      if (_stop) {
+      if (*ctx->stop) {
         return beta;
       }
       if (move->GetScore() > alpha) {
@@ -4138,7 +5114,8 @@ private:
           }
           if (check) {
             move->Score() = beta;
-            _tt.Store(positionKey, *move, 0, HashEntry::LowerBound, 0);
+            ctx->tt->Store(positionKey, *move, 0, HashEntry::LowerBound, 0,
+                           ply);
           }
           return best;
         }
@@ -4152,21 +5129,21 @@ private:
       if (!moveCount) {
         assert(!firstMove.IsValid());
         assert(!pvCount);
-        _tt.StoreCheckmate(positionKey);
+        ctx->tt->StoreCheckmate(positionKey);
         return (ply - Infinity);
       }
       if (pvCount > 0) {
         if (alpha > orig_alpha) {
           assert(pv[0].GetScore() == alpha);
           assert(beta > (orig_alpha + 1));
-          _tt.Store(positionKey, pv[0], 0, HashEntry::ExactScore,
-              HashEntry::FromPV);
+          ctx->tt->Store(positionKey, pv[0], 0, HashEntry::ExactScore,
+              HashEntry::FromPV, ply);
         }
         else {
           assert(alpha == orig_alpha);
           assert(pv[0].GetScore() <= alpha);
           pv[0].Score() = alpha;
-          _tt.Store(positionKey, pv[0], 0, HashEntry::UpperBound, 0);
+          ctx->tt->Store(positionKey, pv[0], 0, HashEntry::UpperBound, 0, ply);
         }
       }
     }
@@ -4176,8 +5153,113 @@ private:
 
   //--------------------------------------------------------------------------
   enum NodeType { PV, NonPV };
-  template<NodeType type, Color color>
-  int Search(int alpha, int beta, int depth, const bool cutNode) {
+
+  //--------------------------------------------------------------------------
+  // search features are a template parameter so the default configuration
+  // gets a kernel without option branches, GenericSearch instead checks the
+  // feature bits in ctx->features at runtime
+  //--------------------------------------------------------------------------
+  enum SearchFeature {
+    UseEXT          = 0x001, // check extensions
+    UseIID          = 0x002, // internal iterative deepening
+    UseLMR          = 0x004, // late move reductions
+    UseNMP          = 0x008, // null move pruning
+    UseNMR          = 0x010, // null move reductions
+    UseOneReply     = 0x020, // one reply extensions
+    UseNullThreat   = 0x040, // null move threat extensions (ctx->test & 1)
+    UseThreatExt    = 0x080, // mate threat extensions (ctx->test & 4)
+    GenericSearch   = 0x100,
+    CollectStats    = 0x200, // diagnostic counters beyond snodes/qnodes
+    UseTrace        = 0x400, // write search tree trace records
+    DefaultFeatures = (UseEXT|UseIID|UseLMR|UseNMP|UseNMR|UseOneReply)
+  };
+
+  //--------------------------------------------------------------------------
+  template<int features>
+  inline bool Enabled(const SearchFeature feature) const {
+    return ((features & GenericSearch) ? (ctx->features & feature)
+                                       : (features & feature));
+  }
+
+  //--------------------------------------------------------------------------
+  template<int features>
+  inline void Count(uint64_t& counter) const {
+    if (Enabled<features>(CollectStats)) {
+      counter++;
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  template<int features>
+  inline void Count(uint64_t& counter, const TraceReasonType reason) const {
+    Count<features>(counter);
+    Note<features>(reason);
+  }
+
+  //--------------------------------------------------------------------------
+  template<int features>
+  inline void Note(const TraceReasonType reason) const {
+    if (Enabled<features>(UseTrace)) {
+      TraceRecord record;
+      memset(&record, 0, sizeof(record));
+      record.event  = TraceReason;
+      record.reason = static_cast<uint8_t>(reason);
+      record.ply    = static_cast<uint8_t>(ply);
+      ctx->trace.Add(record);
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  void TraceNode(const TraceEvent event, const int depth, const int alpha,
+                 const int beta, const int score, const bool pvNode) const
+  {
+    TraceRecord record;
+    record.move   = lastMove.GetBits();
+    record.alpha  = static_cast<int16_t>(alpha);
+    record.beta   = static_cast<int16_t>(beta);
+    record.score  = static_cast<int16_t>(score);
+    record.depth  = static_cast<int8_t>(depth);
+    record.ply    = static_cast<uint8_t>(ply);
+    record.event  = static_cast<uint8_t>(event);
+    record.reason = NoReason;
+    record.flags  = (pvNode ? TraceRecord::PVNode : 0);
+    ctx->trace.Add(record);
+  }
+
+  //--------------------------------------------------------------------------
+  // record which move caused a beta cutoff, must be called before the
+  // cutoff move is added to the killer list
+  //--------------------------------------------------------------------------
+  template<NodeType type, int features>
+  inline void CountCutoff(const Move& move, const int index, const int depth,
+                          const bool hashMove) const
+  {
+    Note<features>(BetaCutoff);
+    if (Enabled<features>(CollectStats)) {
+      ctx->stats.AddCutoff((type == PV), depth, index,
+                       hashMove              ? Stats::HashMove    :
+                       IsKiller(move)        ? Stats::KillerMove  :
+                       move.IsCapOrPromo()   ? Stats::CaptureMove :
+                                               Stats::QuietMove);
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  template<NodeType type, Color color, int features>
+  inline int Search(int alpha, int beta, int depth, const bool cutNode) {
+    if (!Enabled<features>(UseTrace)) {
+      return SearchNode<type, color, features>(alpha, beta, depth, cutNode);
+    }
+    TraceNode(TraceEnter, depth, alpha, beta, 0, (type == PV));
+    const int score =
+        SearchNode<type, color, features>(alpha, beta, depth, cutNode);
+    TraceNode(TraceExit, depth, alpha, beta, score, (type == PV));
+    return score;
+  }
+
+  //--------------------------------------------------------------------------
+  template<NodeType type, Color color, int features>
+  int SearchNode(int alpha, int beta, int depth, const bool cutNode) {
     assert(alpha < beta);
     assert(abs(alpha) <= Infinity);
     assert(abs(beta) <= Infinity);
@@ -4186,11 +5268,22 @@ private:
     assert((depth + depthChange) > 0);
     assert((type == PV) || ((alpha + 1) == beta));
 
-    _stats.snodes++;
+    ctx->stats.snodes++;
+    Count<features>(ctx->stats.snodesAtPly[ply]);
+    CheckNodeLimit();
+    if (!(ctx->stats.snodes & ProgressMask)) {
+      PublishProgress();
+    }
     pvCount = 0;
 
     if (IsDraw()) {
-      return _drawScore[color];
+      return ctx->drawScore[color];
+    }
+
+    int score;
+    if (ProbeBitbase(score)) {
+      Count<features>(ctx->stats.bitbaseHits);
+      return score;
     }
 
     // mate distance pruning
@@ -4206,9 +5299,11 @@ private:
     // check extensions
     uint64_t tmp;
     const bool check = InCheck();
-    if (_ext && check && (depthChange <= 0) && (parent->depthChange <= 0)) {
+    if (Enabled<features>(UseEXT) && check &&
+        (depthChange <= 0) && (parent->depthChange <= 0))
+    {
       if (MULTI_BIT(chkrs)) {
-        _stats.chkExts++;
+        Count<features>(ctx->stats.chkExts, CheckExtension);
         depthChange++;
         depth++;
       }
@@ -4231,7 +5326,7 @@ private:
           }
         }
         if (!MULTI_BIT(tmp)) {
-          _stats.chkExts++;
+          Count<features>(ctx->stats.chkExts, CheckExtension);
           depthChange++;
           depth++;
         }
@@ -4240,24 +5335,26 @@ private:
 
     // extend depth if we are facing a new threat
     // TODO try only doing this when (depthChange < 0)
-    if ((_test & 4) && (depthChange <= 0) && (parent->depthChange <= 0) &&
+    if (Enabled<features>(UseThreatExt) &&
+        (depthChange <= 0) && (parent->depthChange <= 0) &&
         (state & (color ? WhiteThreat : BlackThreat)) &&
         !(parent->state & (color ? WhiteThreat : BlackThreat)))
     {
-      _stats.threatExts++;
+      Count<features>(ctx->stats.threatExts, ThreatExtension);
       depthChange++;
       depth++;
     }
 
     // do we have anything for this position in the transposition table?
     const bool pvNode = (type == PV);
-    HashEntry* entry = _tt.Probe(positionKey);
+    HashEntry  hashEntry;
+    HashEntry* entry = ctx->tt->Probe(positionKey, hashEntry, ply);
     Move firstMove;
     int eval = standPat;
     if (entry) {
       switch (entry->GetPrimaryFlag()) {
       case HashEntry::Checkmate: return (ply - Infinity);
-      case HashEntry::Stalemate: return _drawScore[color];
+      case HashEntry::Stalemate: return ctx->drawScore[color];
       case HashEntry::UpperBound:
         firstMove.Init(entry->moveBits, entry->score);
         assert(ValidateMove<color>(firstMove) == 0);
@@ -4266,6 +5363,7 @@ private:
         {
           pv[0] = firstMove;
           pvCount = 1;
+          Note<features>(HashCutoff);
           return entry->score;
         }
         if ((entry->depth >= (depth - 3)) && (entry->score < eval)) {
@@ -4285,6 +5383,7 @@ private:
             IncHistory(firstMove, check, entry->depth);
             AddKiller(firstMove);
           }
+          Note<features>(HashCutoff);
           return entry->score;
         }
         if (entry->depth >= (depth - 3)) {
@@ -4303,6 +5402,7 @@ private:
             IncHistory(firstMove, check, entry->depth);
             AddKiller(firstMove);
           }
+          Note<features>(HashCutoff);
           return entry->score;
         }
         if ((entry->depth >= (depth - 3)) && (entry->score > eval)) {
@@ -4315,7 +5415,7 @@ private:
       if (entry->HasExtendedFlag() && (depthChange <= 0) &&
           (parent->depthChange <= 0))
       {
-        _stats.hashExts++;
+        Count<features>(ctx->stats.hashExts, HashExtension);
         depthChange++;
         depth++;
       }
@@ -4325,22 +5425,22 @@ private:
     bool pruneOK = (!pvNode && !check && nullMoveOk && (depthChange <= 0));
 
     // razoring (fail low pruning)
-    if (_rzr && pruneOK && (depth < 4) && (alpha < WinningScore) &&
+    if (ctx->rzr && pruneOK && (depth < 4) && (alpha < WinningScore) &&
         !(pinfo[color].passed & _RANK[color ? 1 : 6]) &&
         !parent->InCheck() && ((eval + RazorDelta(depth)) <= alpha))
     {
-      _stats.rzrCount++;
+      Count<features>(ctx->stats.rzrCount);
       if ((depth <= 1) && ((eval + RazorDelta(3 * depth)) <= alpha)) {
-        _stats.rzrEarlyOut++;
-        return QSearch<color>(alpha, beta, 0);
+        Count<features>(ctx->stats.rzrEarlyOut);
+        return QSearch<color, features>(alpha, beta, 0);
       }
       const int ralpha = (alpha - RazorDelta(depth));
-      const int val = QSearch<color>(ralpha, (ralpha + 1), 0);
-      if (_stop) {
+      const int val = QSearch<color, features>(ralpha, (ralpha + 1), 0);
+      if (*ctx->stop) {
         return beta;
       }
       if (val <= ralpha) {
-        _stats.rzrCutoffs++;
+        Count<features>(ctx->stats.rzrCutoffs, RazorCutoff);
         return val;
       }
     }
@@ -4350,54 +5450,58 @@ private:
     pruneOK &= (!check && (MULTI_BIT(tmp) || (BitCount(pc[color]) > 3)));
 
     // futility pruning (static null move pruning)
-    if (_futility && cutNode && pruneOK && (depth < 7) && // TODO try different max depths
+    if (ctx->futility && cutNode && pruneOK && (depth < 7) && // TODO try different max depths
         ((eval - FutilityDelta(depth)) >= beta))
     {
-      _stats.futility++;
+      Count<features>(ctx->stats.futility, FutilityPrune);
       pvCount = 0;
       return (eval - FutilityDelta(depth));
     }
 
     // null move heuristics
     int searchDepth;
-    if (_nmp && pruneOK && (depth > 1)) {
+    if (Enabled<features>(UseNMP) && pruneOK && (depth > 1)) {
       assert((alpha + 1) == beta);
       // stand pat if we can get a score >= beta without even making a move
       if (eval >= beta) {
+        Count<features>(ctx->stats.nullMoves);
         ExecNullMove<color>(*child);
         child->depthChange = 0;
         child->nullMoveOk = 0;
         searchDepth = (depth - 3 - (depth / 6) - ((eval - 400) >= beta));
         eval = (searchDepth > 0)
-            ? -child->Search<NonPV, !color>(-beta, -alpha, searchDepth, false)
-            : -child->QSearch<!color>(-beta, -alpha, 0);
-        if (_stop) {
+            ? -child->Search<NonPV, !color, features>(-beta, -alpha, searchDepth, false)
+            : -child->QSearch<!color, features>(-beta, -alpha, 0);
+        if (*ctx->stop) {
           return beta;
         }
         if (eval >= beta) {
           // TODO do verification search if depth reduction > 4
-          _stats.nmCutoffs++;
+          Count<features>(ctx->stats.nmCutoffs, NullMoveCutoff);
           pvCount = 0;
           return (standPat >= beta) ? standPat : beta; // do not return eval
         }
-        else if ((_test & 1) && (eval <= -WinningScore) && child->pvCount &&
+        else if (Enabled<features>(UseNullThreat) &&
+                 (eval <= -WinningScore) && child->pvCount &&
                  (depthChange <= 0) && (parent->depthChange <= 0) &&
                  LastMoveEnabledPV(*child))
         {
-          _stats.nmThreats++;
+          Count<features>(ctx->stats.nmThreats, NullMoveThreat);
           depthChange++;
           depth++;
         }
       }
-      else if (_nmr && cutNode && (depth > 2) && !parent->InCheck() &&
+      else if (Enabled<features>(UseNMR) &&
+               cutNode && (depth > 2) && !parent->InCheck() &&
                (eval >= -parent->standPat) && !lastMove.IsCapOrPromo() &&
                !(BIT(lastMove.GetTo()) & pc[(!color)|Pawn] & _RANK[color ? 6 : 1]))
       {
         nmrAttempt = 1;
-        _stats.nmrCandidates++;
+        Count<features>(ctx->stats.nmrCandidates);
+        Count<features>(ctx->stats.nullMoves);
         ExecNullMove<color>(*child);
-        eval = -child->QSearch<!color>(-standPat, (1 - standPat), 0);
-        if (_stop) {
+        eval = -child->QSearch<!color, features>(-standPat, (1 - standPat), 0);
+        if (*ctx->stop) {
           return beta;
         }
         if (eval >= standPat) {
@@ -4414,7 +5518,7 @@ private:
 //                          << ", " << eval
 //                          << ", " << standPat;
 //          PrintBoard();
-          _stats.nmReductions++;
+          Count<features>(ctx->stats.nmReductions, NullMoveReduction);
           depthChange -= (1 + (eval >= -parent->standPat));
           depth -= (1 + (eval >= -parent->standPat));
         }
@@ -4422,16 +5526,19 @@ private:
     }
     nullMoveOk = 0;
 
+    const bool hashMove = firstMove.IsValid();
+
     // internal iterative deepening if no firstMove in transposition table
-    if (_iid && !check && !firstMove.IsValid() && (beta < Infinity) &&
+    if (Enabled<features>(UseIID) &&
+        !check && !firstMove.IsValid() && (beta < Infinity) &&
         ((beta - 1) > -Infinity) && (depth >= (pvNode ? 4 : 6)))
     {
       assert(!pvCount);
-      _stats.iidCount++;
+      Count<features>(ctx->stats.iidCount, InternalDeepening);
       // subtract depthChange because it will be added again at top of Search()
       searchDepth = (depth - depthChange - (pvNode ? 2 : 4));
-      eval = Search<NonPV, color>((beta - 1), beta, searchDepth, true);
-      if (_stop || !pvCount) {
+      eval = Search<NonPV, color, features>((beta - 1), beta, searchDepth, true);
+      if (*ctx->stop || !pvCount) {
         return eval;
       }
       assert(pv[0].IsValid());
@@ -4445,17 +5552,18 @@ private:
       if (!(move = GetNextMove<color, AllMoves>(depth))) {
         assert(!moveCount);
         if (check) {
-          _tt.StoreCheckmate(positionKey);
+          ctx->tt->StoreCheckmate(positionKey);
           return (ply - Infinity);
         }
-        _tt.StoreStalemate(positionKey);
-        return _drawScore[color];
+        ctx->tt->StoreStalemate(positionKey);
+        return ctx->drawScore[color];
       }
       firstMove = (*move);
-      if (_oneReply && (moveCount == 1) && (depthChange <= 0) &&
+      if (Enabled<features>(UseOneReply) &&
+          (moveCount == 1) && (depthChange <= 0) &&
           (parent->depthChange <= 0))
       {
-        _stats.oneReplyExts++;
+        Count<features>(ctx->stats.oneReplyExts, OneReplyExtension);
         depthChange++;
         depth++;
       }
@@ -4464,16 +5572,17 @@ private:
     // search first move with full alpha/beta window
     assert(depth > 0);
     const int orig_alpha = alpha;
+    Count<features>(ctx->stats.execs);
     Exec<color>(firstMove, *child);
     child->depthChange = 0;
     child->nmrAttempt = 0;
     child->nullMoveOk = 1;
     eval = (depth > 1)
-        ? -child->Search<type, !color>(-beta, -alpha, (depth - 1), !cutNode)
-        : -child->QSearch<!color>(-beta, -alpha, 0);
+        ? -child->Search<type, !color, features>(-beta, -alpha, (depth - 1), !cutNode)
+        : -child->QSearch<!color, features>(-beta, -alpha, 0);
     assert(!pvNode || (child->depthChange >= 0));
     assert((depth + child->depthChange) >= 0);
-    if (_stop) {
+    if (*ctx->stop) {
       Undo<color>(firstMove);
       return beta;
     }
@@ -4484,13 +5593,13 @@ private:
       assert(child->nmrAttempt);
       child->nullMoveOk = 0;
       child->depthChange = 0;
-      eval = -child->Search<type, !color>(-beta, -alpha, (depth - 1), false);
-      if (_stop) {
+      eval = -child->Search<type, !color, features>(-beta, -alpha, (depth - 1), false);
+      if (*ctx->stop) {
         Undo<color>(firstMove);
         return beta;
       }
       if ((eval <= alpha) && child->nmrAttempt) {
-        _stats.nmrBackfires++;
+        Count<features>(ctx->stats.nmrBackfires);
       }
     }
     Undo<color>(firstMove);
@@ -4504,38 +5613,43 @@ private:
       DecHistory(firstMove, check);
     }
     if (eval >= beta) {
+      CountCutoff<type, features>(firstMove, 0, depth, hashMove);
       if (!firstMove.IsCapOrPromo()) {
         IncHistory(firstMove, check, pvDepth);
         AddKiller(firstMove);
       }
       firstMove.Score() = beta;
-      _tt.Store(positionKey, firstMove, pvDepth, HashEntry::LowerBound,
+      ctx->tt->Store(positionKey, firstMove, pvDepth, HashEntry::LowerBound,
                 (((depthChange > 0) ? HashEntry::Extended : 0) |
-                 (pvNode ? HashEntry::FromPV : 0)));
+                 (pvNode ? HashEntry::FromPV : 0)), ply);
       return best;
     }
 
     // search remaining moves
-    const bool lmr_ok = (_lmr && (cutNode | !pvNode) && !check && (depth > 2));
+    const bool lmr_ok = (Enabled<features>(UseLMR) &&
+                         (cutNode | !pvNode) && !check && (depth > 2));
+    int searched = 1;
     while ((move = GetNextMove<color, AllMoves>(depth))) {
       if (firstMove == (*move)) {
         assert(firstMove.IsValid());
         continue;
       }
+      const int index = searched++;
 
+      Count<features>(ctx->stats.execs);
       Exec<color>(*move, *child);
 
       // late move reductions
-      _stats.lateMoves++;
-      if (lmr_ok) _stats.lmCandidates++;
+      Count<features>(ctx->stats.lateMoves);
+      if (lmr_ok) Count<features>(ctx->stats.lmCandidates);
       if (lmr_ok &&
           !move->IsCapOrPromo() &&
           !child->InCheck() &&
           !IsKiller(*move) &&
-          (_hist[move->GetHistoryIndex()] < 0) &&
+          (ctx->hist[move->GetHistoryIndex()] < 0) &&
           (!pvNode || (moveIndex > 7)))
       {
-        _stats.lmReductions++;
+        Count<features>(ctx->stats.lmReductions, LateMoveReduction);
         child->depthChange = -(1 + (!pvNode &&
                                     (-child->standPat <= -parent->standPat)));
       }
@@ -4547,45 +5661,45 @@ private:
       child->nmrAttempt = 0;
       child->nullMoveOk = 1;
       eval = ((depth + child->depthChange - 1) > 0)
-          ? -child->Search<NonPV, !color>(-(alpha + 1), -alpha, (depth - 1), true)
-          : -child->QSearch<!color>(-(alpha + 1), -alpha, 0);
+          ? -child->Search<NonPV, !color, features>(-(alpha + 1), -alpha, (depth - 1), true)
+          : -child->QSearch<!color, features>(-(alpha + 1), -alpha, 0);
 
       // re-search at full depth?
-      if (!_stop && (child->depthChange < 0) && (eval > alpha)) {
+      if (!*ctx->stop && (child->depthChange < 0) && (eval > alpha)) {
         assert(depth > 1);
-        _stats.lmResearches++;
+        Count<features>(ctx->stats.lmResearches, LateMoveResearch);
         child->nullMoveOk = 0;
         child->depthChange = 0;
-        eval = -child->Search<NonPV, !color>(-(alpha + 1), -alpha, (depth - 1), false);
-        if (!_stop) {
+        eval = -child->Search<NonPV, !color, features>(-(alpha + 1), -alpha, (depth - 1), false);
+        if (!*ctx->stop) {
           if (eval > alpha) {
-            _stats.lmConfirmed++;
+            Count<features>(ctx->stats.lmConfirmed);
           }
           else if (child->nmrAttempt) {
-            _stats.nmrBackfires++;
+            Count<features>(ctx->stats.nmrBackfires);
           }
         }
       }
 
       // re-search with full window?
-      if (!_stop && pvNode && (eval > alpha)) {
+      if (!*ctx->stop && pvNode && (eval > alpha)) {
         assert(child->depthChange >= 0);
         child->nullMoveOk = 0;
         eval = (depth > 1)
-            ? -child->Search<type, !color>(-beta, -alpha, (depth - 1), false)
-            : -child->QSearch<!color>(-beta, -alpha, 0);
-        if (!_stop && (eval <= alpha) && child->nmrAttempt) {
-          _stats.nmrBackfires++;
+            ? -child->Search<type, !color, features>(-beta, -alpha, (depth - 1), false)
+            : -child->QSearch<!color, features>(-beta, -alpha, 0);
+        if (!*ctx->stop && (eval <= alpha) && child->nmrAttempt) {
+          Count<features>(ctx->stats.nmrBackfires);
         }
       }
 
       Undo<color>(*move);
-      if (_stop) {
+      if (*ctx->stop) {
         return beta;
       }
       if (eval > alpha) {
         alpha = eval;
-        _stats.lmAlphaIncs++;
+        Count<features>(ctx->stats.lmAlphaIncs);
         assert(child->depthChange >= 0);
       }
       else if (!move->IsCapOrPromo()) {
@@ -4597,14 +5711,15 @@ private:
         assert((depth + child->depthChange) >= 0);
         pvDepth = (depth + ((child->depthChange < 0) ? child->depthChange : 0));
         if (eval >= beta) {
+          CountCutoff<type, features>(*move, index, depth, false);
           if (!move->IsCapOrPromo()) {
             IncHistory(*move, check, pvDepth);
             AddKiller(*move);
           }
           move->Score() = beta;
-          _tt.Store(positionKey, *move, pvDepth, HashEntry::LowerBound,
+          ctx->tt->Store(positionKey, *move, pvDepth, HashEntry::LowerBound,
                     (((depthChange > 0) ? HashEntry::Extended : 0) |
-                     (pvNode ? HashEntry::FromPV : 0)));
+                     (pvNode ? HashEntry::FromPV : 0)), ply);
           return best;
         }
       }
@@ -4622,16 +5737,16 @@ private:
         if (!pv[0].IsCapOrPromo()) {
           IncHistory(pv[0], check, pvDepth);
         }
-        _tt.Store(positionKey, pv[0], pvDepth, HashEntry::ExactScore,
+        ctx->tt->Store(positionKey, pv[0], pvDepth, HashEntry::ExactScore,
             (((depthChange > 0) ? HashEntry::Extended : 0) |
-             HashEntry::FromPV));
+             HashEntry::FromPV), ply);
       }
       else {
         assert(alpha == orig_alpha);
         assert(pvDepth <= depth);
-        _tt.Store(positionKey, pv[0], pvDepth, HashEntry::UpperBound,
+        ctx->tt->Store(positionKey, pv[0], pvDepth, HashEntry::UpperBound,
             (((depthChange > 0) ? HashEntry::Extended : 0) |
-             (pvNode ? HashEntry::FromPV : 0)));
+             (pvNode ? HashEntry::FromPV : 0)), ply);
       }
     }
 
@@ -4639,31 +5754,34 @@ private:
   }
 
   //--------------------------------------------------------------------------
-  template<Color color>
+  template<Color color, int features>
   std::string SearchRoot(const int depth) {
-    assert(_initialized);
+    assert(ctx->initialized);
     assert(ply == 0);
     assert(!parent);
-    assert(child == _node);
+    assert(child == ctx->node);
 
     depthChange = 0;
     nullMoveOk  = 0;
 
-    if (_debug) {
+    if (IsDebugOn()) {
       PrintBoard();
       senjo::Output() << GetFEN();
     }
 
     GenerateMoves<color>();
     if (moveCount <= 0) {
-      senjo::Output() << "No legal moves";
+      if (!IsQuiet()) {
+        senjo::Output() << "No legal moves";
+      }
       return std::string();
     }
     while (GetNextMove<color, AllMoves>(1)) { ; } // sort 'em
 
     // move transposition table move (if any) to front of list
     if (moveCount > 1) {
-      HashEntry* entry = _tt.Probe(positionKey);
+      HashEntry  hashEntry;
+      HashEntry* entry = ctx->tt->Probe(positionKey, hashEntry, ply);
       if (entry) {
         switch (entry->GetPrimaryFlag()) {
         case HashEntry::Checkmate:
@@ -4704,19 +5822,30 @@ private:
     int   beta;
     int   delta;
 
+    // node counts of the last two iterations for effective branching
+    // factor, 0 if it didn't search a full tree
+    uint64_t iterEnd = 0;
+    uint64_t iterNodes[2] = { 0, 0 };
+
     // iterative deepening
-    for (int d = 0; !_stop && (d < depth); ++d) {
-      _seldepth = _depth = (d + 1);
+    for (int d = 0; !*ctx->stop && (d < depth); ++d) {
+      ctx->seldepth = ctx->depth = (d + 1);
 
       newPV = true;
-      delta = (_depth < 5) ? HugeDelta : 25;
+      delta = (ctx->depth < 5) ? HugeDelta : 25;
       alpha = std::max<int>((best - delta), -Infinity);
       beta  = std::min<int>((best + delta), +Infinity);
+      if (Enabled<features>(UseTrace)) {
+        TraceNode(TraceIteration, ctx->depth, alpha, beta, 0, true);
+      }
 
-      for (moveIndex = 0; !_stop && (moveIndex < moveCount); ++moveIndex) {
+      for (moveIndex = 0; !*ctx->stop && (moveIndex < moveCount);
+           ++moveIndex)
+      {
         move      = (moves + moveIndex);
-        _currmove = move->ToString();
-        _movenum  = (moveIndex + 1);
+        ctx->currmove = *move;
+        ctx->movenum  = (moveIndex + 1);
+        PublishProgress();
 
 #ifndef NDEBUG
         VerifyPosition();
@@ -4724,26 +5853,27 @@ private:
 
         child->depthChange = 0;
         child->nullMoveOk = 1;
+        Count<features>(ctx->stats.execs);
         Exec<color>(*move, *child);
-        move->Score() = (_depth > 1)
-            ? ((_movenum == 1)
-               ? -child->Search<PV, !color>(-beta, -alpha, (_depth - 1), false)
-               : -child->Search<NonPV, !color>(-beta, -alpha, (_depth - 1), true))
-            : -child->QSearch<!color>(-beta, -alpha, 0);
+        move->Score() = (ctx->depth > 1)
+            ? ((ctx->movenum == 1)
+               ? -child->Search<PV, !color, features>(-beta, -alpha, (ctx->depth - 1), false)
+               : -child->Search<NonPV, !color, features>(-beta, -alpha, (ctx->depth - 1), true))
+            : -child->QSearch<!color, features>(-beta, -alpha, 0);
         assert(move->GetScore() > -Infinity);
         assert(move->GetScore() < Infinity);
-        if (_stop) {
+        if (*ctx->stop) {
           Undo<color>(*move);
           break;
         }
 
         // re-search to get real score?
         if ((move->GetScore() >= beta) ||
-            ((move->GetScore() <= alpha) && (_movenum == 1)))
+            ((move->GetScore() <= alpha) && (ctx->movenum == 1)))
         {
           int bound[2] = { -Infinity, Infinity };
           newPV = true;
-          delta = (_depth < 5) ? HugeDelta : 100;
+          delta = (ctx->depth < 5) ? HugeDelta : 100;
           do {
             if (move->GetScore() >= beta) {
               OutputPV(move->GetScore(), 1); // report lowerbound
@@ -4753,7 +5883,7 @@ private:
             else {
               assert(move->GetScore() <= alpha);
               OutputPV(move->GetScore(), -1); // report upperbound
-              if (_movenum == 1) {
+              if (ctx->movenum == 1) {
                 alpha = std::max<int>(-Infinity, (move->GetScore() - delta));
               }
               else {
@@ -4763,15 +5893,15 @@ private:
             }
             child->depthChange = 0;
             child->nullMoveOk = 0;
-            move->Score() = (_depth > 1)
-                ? -child->Search<PV, !color>(-beta, -alpha, (_depth - 1), false)
-                : -child->QSearch<!color>(-beta, -alpha, 0);
+            move->Score() = (ctx->depth > 1)
+                ? -child->Search<PV, !color, features>(-beta, -alpha, (ctx->depth - 1), false)
+                : -child->QSearch<!color, features>(-beta, -alpha, 0);
             assert(move->GetScore() > -Infinity);
             assert(move->GetScore() < Infinity);
-            if (_stop) {
+            if (*ctx->stop) {
               break;
             }
-            if ((_movenum > 1) && (move->GetScore() <= best)) {
+            if ((ctx->movenum > 1) && (move->GetScore() <= best)) {
               newPV = false;
               break;
             }
@@ -4783,8 +5913,10 @@ private:
             }
             else {
               // TODO increase time
-              senjo::Output() << "UNSTABLE(" << move->GetScore() << ", "
-                              << bound[0] << ", " << bound[1] << ")";
+              if (!IsQuiet()) {
+                senjo::Output() << "UNSTABLE(" << move->GetScore() << ", "
+                                << bound[0] << ", " << bound[1] << ")";
+              }
               break;
             }
             if (abs(move->GetScore()) >= 1000) {
@@ -4799,12 +5931,13 @@ private:
           newPV = false;
           showPV = false;
           UpdatePV(*move);
-          if (!_stop &&
+          ExtendPV<color>(pv, 0, pvCount, ctx->depth);
+          if (!*ctx->stop &&
               (move->GetScore() > alpha) && (move->GetScore() < beta))
           {
             OutputPV(move->GetScore());
-            _tt.Store(positionKey, *move, _depth, HashEntry::ExactScore,
-                      HashEntry::FromPV);
+            ctx->tt->Store(positionKey, *move, ctx->depth,
+                           HashEntry::ExactScore, HashEntry::FromPV, ply);
           }
 
           best = alpha = move->GetScore();
@@ -4814,6 +5947,22 @@ private:
         // set null aspiration window now that we have a principal variation
         beta = (alpha + 1);
       }
+
+      // an iteration that searched fewer nodes than the one two plies
+      // shallower was cut short by the transposition table
+      if (!*ctx->stop && Enabled<features>(CollectStats)) {
+        const uint64_t total = (ctx->stats.snodes + ctx->stats.qnodes);
+        uint64_t nodes = (total - iterEnd);
+        const uint64_t base = iterNodes[ctx->depth & 1];
+        if (base && (nodes > base)) {
+          ctx->stats.AddIteration(ctx->depth, nodes, base);
+        }
+        else if (base) {
+          nodes = 0;
+        }
+        iterNodes[ctx->depth & 1] = nodes;
+        iterEnd = total;
+      }
     }
 
     if (showPV) {
@@ -4825,16 +5974,29 @@ private:
 
   //--------------------------------------------------------------------------
   void InitSearch() {
-    _currmove.clear();
-    _stats.Clear();
-    _tt.ResetCounters();
-
-    _depth    = 0;
-    _movenum  = 0;
-    _seldepth = 0;
+    ctx->currmove = Move();
+    ctx->stats.Clear();
+    ctx->tt->ResetCounters();
+
+    ctx->depth    = 0;
+    ctx->movenum  = 0;
+    ctx->pvDepth  = 0;
+    ctx->seldepth = 0;
+    PublishProgress();
+
+    // only probe once material comes off, a bitbase score at the root
+    // says who wins but not how
+    ctx->bitbasePieces = (ctx->bitbases
+        ? std::min<int>(Bitbases::MaxPieces, (BitCount(Occupied()) - 1))
+        : 0);
+
+    SetDrawScores();
+  }
 
-    _drawScore[ColorToMove()] = -_contempt;
-    _drawScore[!ColorToMove()] = _contempt;
+  //--------------------------------------------------------------------------
+  void SetDrawScores() {
+    ctx->drawScore[ColorToMove()] = -ctx->contempt;
+    ctx->drawScore[!ColorToMove()] = ctx->contempt;
   }
 };
 
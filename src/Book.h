@@ -0,0 +1,105 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_BOOK_H
+#define BITFOOT_BOOK_H
+
+#include "PackedPosition.h"
+
+#include <random>
+#include <vector>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// opening book in the Polyglot file layout
+//
+// The file is a list of 16 byte big endian entries sorted by key:
+//   uint64  key     position key
+//   uint16  move    bits 0-5 to square, 6-11 from square (A1 = 0),
+//                   12-14 promotion (0 none, 1 knight ... 4 queen),
+//                   castling is the king taking its own rook (e1h1)
+//   uint16  weight  relative frequency of the move
+//   uint32  learn   unused
+//
+// Keys are Polyglot keys: the xor of the Random64 entries for every piece
+// (RandomPiece + 64 * kind + square, kind is 0 for a black pawn, 1 for a
+// white pawn, 2 for a black knight ... 11 for a white king), each castling
+// right (RandomCastle + 0 to 3 for white short, white long, black short,
+// black long), the en passant file if a pawn of the side to move can
+// capture en passant (RandomEnPassant + file), and RandomTurn if white is
+// to move.  Standard Polyglot books work as is, "Bitfoot --make-book"
+// builds them from game lists.  The file is memory mapped, opening a book
+// costs the same no matter how big it is.
+//----------------------------------------------------------------------------
+class Book
+{
+public:
+  struct Entry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+  };
+
+  enum {
+    EntrySize       = 16,
+    RandomPiece     = 0,
+    RandomCastle    = 768,
+    RandomEnPassant = 772,
+    RandomTurn      = 780,
+    RandomCount     = 781
+  };
+
+  static const uint64_t Random64[RandomCount];
+
+  Book();
+
+  bool Open(const std::string& fileName);
+  void Close();
+
+  bool IsOpen() const {
+    return (file.Count() > 0);
+  }
+
+  uint64_t Count() const {
+    return file.Count();
+  }
+
+  //--------------------------------------------------------------------------
+  // every entry for 'key', found by binary search
+  //--------------------------------------------------------------------------
+  std::vector<Entry> Find(const uint64_t key) const;
+
+  //--------------------------------------------------------------------------
+  // one of the entries picked at random in proportion to their weights,
+  // NULL if none of them have any weight
+  //--------------------------------------------------------------------------
+  const Entry* Choose(const std::vector<Entry>& entries);
+
+  //--------------------------------------------------------------------------
+  // coordinate notation move to book move, 'castle' must be set if the
+  // move is castling (e.g. "e1g1" by a king)
+  //--------------------------------------------------------------------------
+  static uint16_t EncodeMove(const std::string& move, const bool castle);
+
+  //--------------------------------------------------------------------------
+  // sort 'entries', merge duplicates, and write them to 'fileName'
+  //--------------------------------------------------------------------------
+  static bool Write(const std::string& fileName, std::vector<Entry>& entries);
+
+private:
+  Book(const Book&);
+  Book& operator=(const Book&);
+
+  Entry Get(const uint64_t index) const;
+
+  RecordReader    file;
+  std::mt19937_64 random;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_BOOK_H
@@ -0,0 +1,425 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/ChessEngine.h"
+#include "senjo/Output.h"
+#include "Bitbase.h"
+#include "Book.h"
+#include "Commands.h"
+#include "Engine.h"
+#include "Match.h"
+#include "PackedPosition.h"
+#include "SelfPlay.h"
+#include "Server.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// arguments of one command: its positional values followed by any number
+// of "--flag value" pairs, only the flags the command accepts are kept
+//----------------------------------------------------------------------------
+struct Args
+{
+  typedef std::pair<std::string, std::string> Flag;
+
+  std::vector<std::string> values;
+  std::vector<Flag>        flags;
+
+  // value of the last occurrence of 'flag', or 'def' if it isn't given
+  std::string Get(const char* flag, const std::string& def) const {
+    for (size_t i = flags.size(); i > 0; --i) {
+      if (flags[i - 1].first == flag) {
+        return flags[i - 1].second;
+      }
+    }
+    return def;
+  }
+
+  // values of every occurrence of 'flag' in the order given
+  std::vector<std::string> GetAll(const char* flag) const {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < flags.size(); ++i) {
+      if (flags[i].first == flag) {
+        result.push_back(flags[i].second);
+      }
+    }
+    return result;
+  }
+
+  int GetInt(const char* flag, const int def) const {
+    const std::string value = Get(flag, "");
+    return (value.empty() ? def : atoi(value.c_str()));
+  }
+
+  uint64_t GetUInt64(const char* flag, const uint64_t def) const {
+    const std::string value = Get(flag, "");
+    return (value.empty() ? def : strtoull(value.c_str(), NULL, 10));
+  }
+
+  double GetDouble(const char* flag, const double def) const {
+    const std::string value = Get(flag, "");
+    return (value.empty() ? def : atof(value.c_str()));
+  }
+};
+
+//----------------------------------------------------------------------------
+static int HardwareThreads()
+{
+  return std::max<int>(1, std::thread::hardware_concurrency());
+}
+
+//----------------------------------------------------------------------------
+static int Serve(const Args& args)
+{
+  const int workers = args.GetInt("--workers", HardwareThreads());
+  const int hashSize = args.GetInt("--hash", 0);
+
+  Server server;
+  return (server.Run(args.values[0], workers, hashSize) ? 0 : 1);
+}
+
+//----------------------------------------------------------------------------
+static int GenerateTrainingData(const Args& args)
+{
+  SelfPlay::Settings settings;
+  settings.threads     = args.GetInt("--threads", HardwareThreads());
+  settings.positions   = args.GetUInt64("--positions", settings.positions);
+  settings.nodes       = args.GetUInt64("--nodes", settings.nodes);
+  settings.randomPlies = args.GetInt("--random-plies", settings.randomPlies);
+  settings.maxPlies    = args.GetInt("--max-plies", settings.maxPlies);
+  settings.resignScore = args.GetInt("--resign", settings.resignScore);
+  settings.hashSize    = args.GetInt("--hash", settings.hashSize);
+  settings.dedupSize   = args.GetInt("--dedup", settings.dedupSize);
+  settings.seed        = args.GetUInt64("--seed", settings.seed);
+
+  SelfPlay selfPlay;
+  return (selfPlay.Run(args.values[0], settings) ? 0 : 1);
+}
+
+//----------------------------------------------------------------------------
+// split each "name=value" into an engine option
+//----------------------------------------------------------------------------
+static bool ParseOptions(const std::vector<std::string>& args,
+                         std::vector<Match::Option>& options)
+{
+  for (size_t i = 0; i < args.size(); ++i) {
+    const size_t eq = args[i].find('=');
+    if ((eq == std::string::npos) || !eq) {
+      Output() << "Expected <name>=<value>, not '" << args[i] << "'";
+      return false;
+    }
+    options.push_back(std::make_pair(args[i].substr(0, eq),
+                                     args[i].substr(eq + 1)));
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+static int PlayMatch(const Args& args)
+{
+  Match::Settings settings;
+  settings.threads  = args.GetInt("--threads", HardwareThreads());
+  settings.games    = args.GetInt("--games", settings.games);
+  settings.nodes    = args.GetUInt64("--nodes", settings.nodes);
+  settings.movetime = args.GetUInt64("--movetime", settings.movetime);
+  settings.hashSize = args.GetInt("--hash", settings.hashSize);
+  settings.elo0     = args.GetDouble("--elo0", settings.elo0);
+  settings.elo1     = args.GetDouble("--elo1", settings.elo1);
+  settings.alpha    = args.GetDouble("--alpha", settings.alpha);
+  settings.beta     = args.GetDouble("--beta", settings.beta);
+
+  // <msecs>[+<msecs>]
+  const std::string tc = args.Get("--tc", "");
+  if (tc.size()) {
+    char* p = NULL;
+    settings.time = strtoull(tc.c_str(), &p, 10);
+    settings.inc = ((*p == '+') ? strtoull(p + 1, NULL, 10) : 0);
+  }
+
+  if (!ParseOptions(args.GetAll("--option-a"), settings.optionsA) ||
+      !ParseOptions(args.GetAll("--option-b"), settings.optionsB))
+  {
+    return 1;
+  }
+
+  Match match;
+  return (match.Run(args.values[0], settings) ? 0 : 1);
+}
+
+//----------------------------------------------------------------------------
+// EPD operations after the position are not kept
+//----------------------------------------------------------------------------
+static int Pack(const Args& args)
+{
+  const std::string& inFile = args.values[0];
+  const std::string& outFile = args.values[1];
+
+  std::ifstream in(inFile.c_str());
+  if (!in) {
+    Output() << "Cannot open '" << inFile << "': " << strerror(errno);
+    return 1;
+  }
+  FILE* fp = fopen(outFile.c_str(), "wb");
+  if (!fp) {
+    Output() << "Cannot open '" << outFile << "': " << strerror(errno);
+    return 1;
+  }
+
+  Engine engine;
+  engine.SetOption("Hash", "0");
+
+  PackedPosition packed;
+  std::string line;
+  uint64_t count = 0;
+  int lineNumber = 0;
+  while (std::getline(in, line)) {
+    lineNumber++;
+    const size_t start = line.find_first_not_of(" \t\r");
+    if ((start == std::string::npos) || (line[start] == '#')) {
+      continue;
+    }
+    if (!engine.SetPosition(line.substr(start))) {
+      Output() << inFile << " line " << lineNumber
+               << ": invalid position, skipped";
+      continue;
+    }
+    engine.GetPosition(packed);
+    if (fwrite(&packed, sizeof(packed), 1, fp) != 1) {
+      Output() << "Cannot write '" << outFile << "': " << strerror(errno);
+      fclose(fp);
+      return 1;
+    }
+    count++;
+  }
+
+  fclose(fp);
+  Output() << count << " positions written to " << outFile;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+// stride is the record size of files with more than a PackedPosition per
+// record, such as self-play training data (40)
+//----------------------------------------------------------------------------
+static int Unpack(const Args& args)
+{
+  const std::string& inFile = args.values[0];
+  const std::string& outFile = args.values[1];
+  const int stride =
+      args.GetInt("--stride", static_cast<int>(sizeof(PackedPosition)));
+  if (stride < static_cast<int>(sizeof(PackedPosition))) {
+    Output() << "Stride must be at least " << sizeof(PackedPosition);
+    return 1;
+  }
+
+  RecordReader reader;
+  if (!reader.Open(inFile, static_cast<size_t>(stride))) {
+    return 1;
+  }
+  FILE* fp = fopen(outFile.c_str(), "w");
+  if (!fp) {
+    Output() << "Cannot open '" << outFile << "': " << strerror(errno);
+    return 1;
+  }
+
+  Engine engine;
+  engine.SetOption("Hash", "0");
+
+  PackedPosition packed;
+  uint64_t count = 0;
+  for (uint64_t i = 0; i < reader.Count(); ++i) {
+    memcpy(&packed, reader.Get(i), sizeof(packed));
+    if (!engine.SetPosition(packed)) {
+      Output() << "Invalid position in record " << i << ", skipped";
+      continue;
+    }
+    fprintf(fp, "%s\n", engine.GetFEN().c_str());
+    count++;
+  }
+
+  fclose(fp);
+  Output() << count << " positions written to " << outFile;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+static int GenerateBitbases(const Args& args)
+{
+  return (Bitbases::Generate(args.values[0],
+                             args.GetInt("--threads", HardwareThreads()))
+          ? 0 : 1);
+}
+
+//----------------------------------------------------------------------------
+// one game per line, moves in coordinate notation from the start position,
+// every position/move pair adds 1 to the weight of that book move
+//----------------------------------------------------------------------------
+static int MakeBook(const Args& args)
+{
+  const std::string& inFile = args.values[0];
+  const std::string& outFile = args.values[1];
+  const int plies = args.GetInt("--plies", 20);
+  if (plies <= 0) {
+    Output() << "Plies must be at least 1";
+    return 1;
+  }
+
+  std::ifstream in(inFile.c_str());
+  if (!in) {
+    Output() << "Cannot open '" << inFile << "': " << strerror(errno);
+    return 1;
+  }
+
+  Engine engine;
+  engine.SetOption("Hash", "0");
+
+  std::vector<Book::Entry> entries;
+  std::string line;
+  int lineNumber = 0;
+  int games = 0;
+  while (std::getline(in, line)) {
+    lineNumber++;
+    std::istringstream moves(line);
+    std::string move;
+    if (!(moves >> move) || (move[0] == '#')) {
+      continue;
+    }
+
+    engine.SetPosition(ChessEngine::_STARTPOS);
+    int ply = 0;
+    do {
+      if ((move == "1-0") || (move == "0-1") || (move == "1/2-1/2")) {
+        break;
+      }
+      Book::Entry entry;
+      entry.key = engine.GetPolyglotKey();
+      entry.move = engine.EncodeBookMove(move);
+      if (!entry.move || !engine.MakeMove(move)) {
+        Output() << inFile << " line " << lineNumber
+                 << ": illegal move " << move << ", rest skipped";
+        break;
+      }
+      entry.weight = 1;
+      entry.learn = 0;
+      entries.push_back(entry);
+    } while ((++ply < plies) && (moves >> move));
+    games++;
+  }
+
+  if (!Book::Write(outFile, entries)) {
+    return 1;
+  }
+  Output() << games << " games, " << entries.size()
+           << " moves written to " << outFile;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+struct Command
+{
+  const char* name;
+  size_t      values; // number of positional arguments
+  const char* flags;  // flags that take a value, space separated
+  const char* usage;
+  int       (*run)(const Args& args);
+};
+
+//----------------------------------------------------------------------------
+static const Command _COMMANDS[] =
+{
+  { "--serve", 1, "--workers --hash",
+    "<socket> [--workers <n>] [--hash <mb>]", Serve },
+
+  { "--gensfen", 1,
+    "--threads --positions --nodes --random-plies --max-plies --resign"
+    " --hash --dedup --seed",
+    "<file> [--threads <n>] [--positions <n>] [--nodes <n>]"
+    " [--random-plies <n>] [--max-plies <n>] [--resign <cp>] [--hash <mb>]"
+    " [--dedup <mb>] [--seed <n>]",
+    GenerateTrainingData },
+
+  { "--match", 1,
+    "--threads --games --nodes --movetime --tc --hash --option-a --option-b"
+    " --elo0 --elo1 --alpha --beta",
+    "<epd file> [--threads <n>] [--games <n>] [--nodes <n>]"
+    " [--movetime <msecs>] [--tc <msecs>[+<msecs>]] [--hash <mb>]"
+    " [--option-a <name>=<value>] [--option-b <name>=<value>]"
+    " [--elo0 <x>] [--elo1 <x>] [--alpha <x>] [--beta <x>]",
+    PlayMatch },
+
+  { "--pack", 2, "",
+    "<epd file> <packed file>", Pack },
+
+  { "--unpack", 2, "--stride",
+    "<packed file> <epd file> [--stride <bytes>]", Unpack },
+
+  { "--gen-bitbases", 1, "--threads",
+    "<directory> [--threads <n>]", GenerateBitbases },
+
+  { "--make-book", 2, "--plies",
+    "<games file> <book file> [--plies <n>]", MakeBook },
+};
+
+static const size_t CommandCount = (sizeof(_COMMANDS) / sizeof(_COMMANDS[0]));
+
+//----------------------------------------------------------------------------
+static bool ParseArgs(const Command& command, int argc, char** argv,
+                      Args& args)
+{
+  const std::string accepted = (' ' + std::string(command.flags) + ' ');
+  for (int i = 2; i < argc; ++i) {
+    if (args.values.size() < command.values) {
+      args.values.push_back(argv[i]);
+    }
+    else if (((i + 1) < argc) &&
+             (accepted.find(' ' + std::string(argv[i]) + ' ') !=
+              std::string::npos))
+    {
+      args.flags.push_back(std::make_pair(argv[i], argv[i + 1]));
+      ++i;
+    }
+    else {
+      return false;
+    }
+  }
+  return (args.values.size() == command.values);
+}
+
+//----------------------------------------------------------------------------
+bool IsCommand(const char* arg)
+{
+  return (arg && !strncmp(arg, "--", 2));
+}
+
+//----------------------------------------------------------------------------
+int RunCommand(int argc, char** argv)
+{
+  for (size_t i = 0; (argc > 1) && (i < CommandCount); ++i) {
+    const Command& command = _COMMANDS[i];
+    if (!strcmp(argv[1], command.name)) {
+      Args args;
+      if (!ParseArgs(command, argc, argv, args)) {
+        Output() << "usage: " << argv[0] << ' ' << command.name << ' '
+                 << command.usage;
+        return 1;
+      }
+      return command.run(args);
+    }
+  }
+
+  Output() << "usage: " << argv[0] << " [<command>]";
+  for (size_t i = 0; i < CommandCount; ++i) {
+    Output() << "  " << _COMMANDS[i].name << ' ' << _COMMANDS[i].usage;
+  }
+  return 1;
+}
+
+} // namespace bitfoot
@@ -0,0 +1,26 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_COMMANDS_H
+#define BITFOOT_COMMANDS_H
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// does 'arg' ask for a command line tool rather than the UCI engine?
+// Command names start with "--", anything else is not for us.
+//----------------------------------------------------------------------------
+bool IsCommand(const char* arg);
+
+//----------------------------------------------------------------------------
+// run the command line tool named by argv[1] (e.g. --match, --gensfen),
+// a usage summary is written if it isn't one of them or its arguments are
+// wrong.  Returns the process exit code.
+//----------------------------------------------------------------------------
+int RunCommand(int argc, char** argv);
+
+} // namespace bitfoot
+
+#endif // BITFOOT_COMMANDS_H
@@ -164,8 +164,12 @@ enum Limits
   PieceTypeCount = 14,
   MaxPlies       = 100,
   MaxMoves       = 128,
+  PVTableSize    = ((MaxPlies + 1) * (MaxPlies + 1)),
+  MaterialSlots  = 0x2000,
+  ProgressMask   = 0x3FF,
   StartMaterial  = ((8 * PawnValue) + (2 * KnightValue) +
                     (2 * BishopValue) + (2 * RookValue) +  QueenValue),
+  BitbaseScore   = 20000,
   WinningScore   = 30000,
   MateScore      = 31000,
   Infinity       = 32000,
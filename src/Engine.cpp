@@ -0,0 +1,205 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "Engine.h"
+#include "Bitfoot.h"
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// batch jobs may create an engine per game, so they don't get the UCI
+// default of 1024 MB each
+//----------------------------------------------------------------------------
+static const char* DefaultHashMBytes = "16";
+
+//----------------------------------------------------------------------------
+Engine::Engine()
+  : engine(new Bitfoot())
+{
+  engine->SetQuiet(true);
+  engine->SetEngineOption("Hash", DefaultHashMBytes);
+}
+
+//----------------------------------------------------------------------------
+Engine::~Engine()
+{
+  delete engine;
+  engine = NULL;
+}
+
+//----------------------------------------------------------------------------
+// initialize on first use so options can be set first
+//----------------------------------------------------------------------------
+Bitfoot& Engine::Ready() const
+{
+  if (!engine->IsInitialized()) {
+    engine->Initialize();
+  }
+  return *engine;
+}
+
+//----------------------------------------------------------------------------
+bool Engine::SetOption(const std::string& name, const std::string& value)
+{
+  return engine->SetEngineOption(name, value);
+}
+
+//----------------------------------------------------------------------------
+void Engine::ShareHashTable(Engine* owner)
+{
+  engine->ShareHashTable(owner ? owner->engine : NULL);
+}
+
+//----------------------------------------------------------------------------
+bool Engine::SetPosition(const std::string& fen)
+{
+  return (Ready().SetPosition(fen.c_str()) != NULL);
+}
+
+//----------------------------------------------------------------------------
+bool Engine::MakeMove(const std::string& move)
+{
+  return (Ready().MakeMove(move.c_str()) != NULL);
+}
+
+//----------------------------------------------------------------------------
+std::string Engine::GetFEN() const
+{
+  return Ready().GetFEN();
+}
+
+//----------------------------------------------------------------------------
+bool Engine::SetPosition(const PackedPosition& packed)
+{
+  return Ready().SetPackedPosition(packed);
+}
+
+//----------------------------------------------------------------------------
+void Engine::GetPosition(PackedPosition& packed) const
+{
+  Ready().GetPackedPosition(packed);
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::string> Engine::GetMoves()
+{
+  Bitfoot& root = Ready();
+  if (root.WhiteToMove()) {
+    root.GenerateMoves<White>();
+  }
+  else {
+    root.GenerateMoves<Black>();
+  }
+
+  std::vector<std::string> moves;
+  for (int i = root.moveIndex; i < root.moveCount; ++i) {
+    moves.push_back(root.moves[i].ToString());
+  }
+  return moves;
+}
+
+//----------------------------------------------------------------------------
+// bits of the legal move matching 'move' in the current position, 0 if none
+//----------------------------------------------------------------------------
+uint32_t Engine::FindMove(const std::string& move) const
+{
+  Bitfoot& root = Ready();
+  if (root.WhiteToMove()) {
+    root.GenerateMoves<White>();
+  }
+  else {
+    root.GenerateMoves<Black>();
+  }
+
+  for (int i = root.moveIndex; i < root.moveCount; ++i) {
+    if (root.moves[i].ToString() == move) {
+      return root.moves[i].GetBits();
+    }
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+bool Engine::IsCapOrPromo(const std::string& move)
+{
+  const Move mv(FindMove(move));
+  return (mv.IsValid() &&
+          (mv.IsCapOrPromo() || (mv.GetType() == EnPassant)));
+}
+
+//----------------------------------------------------------------------------
+uint16_t Engine::EncodeBookMove(const std::string& move)
+{
+  const Move mv(FindMove(move));
+  if (!mv.IsValid()) {
+    return 0;
+  }
+  return Book::EncodeMove(move, ((mv.GetType() == CastleShort) ||
+                                 (mv.GetType() == CastleLong)));
+}
+
+//----------------------------------------------------------------------------
+bool Engine::InCheck() const
+{
+  return Ready().InCheck();
+}
+
+//----------------------------------------------------------------------------
+bool Engine::IsDraw() const
+{
+  return Ready().IsDraw();
+}
+
+//----------------------------------------------------------------------------
+uint64_t Engine::GetPositionKey() const
+{
+  return Ready().positionKey;
+}
+
+//----------------------------------------------------------------------------
+uint64_t Engine::GetPolyglotKey() const
+{
+  return Ready().PolyglotKey();
+}
+
+//----------------------------------------------------------------------------
+int Engine::Evaluate(EvalTerms* terms)
+{
+  return Ready().StaticEval(terms);
+}
+
+//----------------------------------------------------------------------------
+int Engine::QSearch()
+{
+  return Ready().QSearchScore();
+}
+
+//----------------------------------------------------------------------------
+SearchResult Engine::Search(const SearchLimits& limits)
+{
+  SearchResult result;
+  Ready().Search(limits, result);
+  return result;
+}
+
+//----------------------------------------------------------------------------
+uint64_t Engine::Perft(const int depth)
+{
+  return Ready().CountLeaves(depth);
+}
+
+//----------------------------------------------------------------------------
+void Engine::ClearSearchData()
+{
+  Ready().ClearSearchData();
+}
+
+//----------------------------------------------------------------------------
+void Engine::Stop()
+{
+  engine->Stop(senjo::ChessEngine::FullStop);
+}
+
+} // namespace bitfoot
@@ -0,0 +1,212 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_ENGINE_H
+#define BITFOOT_ENGINE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace bitfoot
+{
+
+class Bitfoot;
+struct PackedPosition;
+
+//----------------------------------------------------------------------------
+// static evaluation split into the terms that make it up, all in centipawns
+// from white's point of view, so total is the sum of everything above it
+// unless an evaluation network is in use, then total is the network score
+// and the hand written terms are only there for comparison
+//----------------------------------------------------------------------------
+struct EvalTerms
+{
+  int  tempo;     // bonus for the side to move
+  int  material;  // piece values
+  int  squares;   // piece square tables
+  int  pins;      // pieces pinned against their king
+  int  pawns;     // pawn structure
+  int  knights;
+  int  bishops;
+  int  rooks;
+  int  queens;
+  int  kings;     // king safety
+  int  passers;   // passed pawns
+  int  coverage;  // squares attacked
+  int  loose;     // unprotected pawns and minor pieces
+  int  imbalance; // material imbalance adjustments
+  int  space;     // space behind connected pawns
+  int  scaling;   // drawish ending and 50 move rule adjustments
+  int  endgame;   // specialized endgame evaluation, the terms above are 0
+                  // when it applies
+  int  network;   // network score, 0 if the network isn't in use
+  int  total;
+  bool drawn;     // draw by rule or lack of mating material, total is the
+                  // draw score and the other terms are incomplete
+};
+
+//----------------------------------------------------------------------------
+struct SearchLimits
+{
+  SearchLimits()
+    : depth(0),
+      movetime(0),
+      nodes(0),
+      wtime(0),
+      winc(0),
+      btime(0),
+      binc(0),
+      cancel(NULL)
+  { }
+
+  int      depth;    // maximum search depth, 0 = no limit
+  uint64_t movetime; // maximum milliseconds to search, 0 = no limit
+  uint64_t nodes;    // maximum nodes to search, 0 = no limit
+  uint64_t wtime;    // milliseconds left on white's clock, 0 = no clock
+  uint64_t winc;     // white's increment per move in milliseconds
+  uint64_t btime;    // milliseconds left on black's clock, 0 = no clock
+  uint64_t binc;     // black's increment per move in milliseconds
+
+  // if not NULL the search stops at once when this is true after it has
+  // cleared the flags set by any earlier Stop(), set it before calling
+  // Stop() to cancel a search that may not have started yet
+  const std::atomic<bool>* cancel;
+};
+
+//----------------------------------------------------------------------------
+struct SearchResult
+{
+  SearchResult()
+    : score(0),
+      mate(0),
+      depth(0),
+      seldepth(0),
+      nodes(0),
+      qnodes(0),
+      msecs(0)
+  { }
+
+  std::string              bestmove; // empty if there are no legal moves
+  std::vector<std::string> pv;       // principal variation, moves in
+                                     // coordinate notation
+  int                      score;    // centipawns for the side to move
+  int                      mate;     // moves to mate, negative if getting
+                                     // mated, 0 if no mate was found
+  int                      depth;
+  int                      seldepth;
+  uint64_t                 nodes;
+  uint64_t                 qnodes;
+  uint64_t                 msecs;
+};
+
+//----------------------------------------------------------------------------
+// Embeddable engine interface for programs that link bitfoot_lib directly.
+// Nothing is written to stdout, results come back as plain values.  Each
+// Engine is independent, different engines may be used on different
+// threads at the same time but a single Engine is not thread safe (except
+// for Stop).
+//----------------------------------------------------------------------------
+class Engine
+{
+public:
+  Engine();
+  ~Engine();
+
+  //--------------------------------------------------------------------------
+  // same names and values as the UCI options except "Hash" defaults to
+  // 16 MB, the hash table isn't allocated until the engine is first used so
+  // set "Hash" before then to avoid allocating the default size
+  //--------------------------------------------------------------------------
+  bool SetOption(const std::string& name, const std::string& value);
+
+  //--------------------------------------------------------------------------
+  // search with the owner's transposition table instead of a private one,
+  // the table stays alive as long as any engine uses it, pass NULL to go
+  // back to a private table
+  //--------------------------------------------------------------------------
+  void ShareHashTable(Engine* owner);
+
+  //--------------------------------------------------------------------------
+  // position setup, both return false if the fen or move is not valid
+  //--------------------------------------------------------------------------
+  bool SetPosition(const std::string& fen);
+  bool MakeMove(const std::string& move);
+  std::string GetFEN() const;
+
+  //--------------------------------------------------------------------------
+  // same as above using the binary position format in PackedPosition.h
+  //--------------------------------------------------------------------------
+  bool SetPosition(const PackedPosition& packed);
+  void GetPosition(PackedPosition& packed) const;
+
+  //--------------------------------------------------------------------------
+  // legal moves of the current position in coordinate notation
+  //--------------------------------------------------------------------------
+  std::vector<std::string> GetMoves();
+
+  //--------------------------------------------------------------------------
+  // IsCapOrPromo: does 'move' capture (en passant included) or promote?
+  //                 false if it isn't a legal move in the current position
+  // EncodeBookMove: 'move' in the opening book encoding (see Book.h), 0 if
+  //                 it isn't a legal move in the current position
+  //--------------------------------------------------------------------------
+  bool IsCapOrPromo(const std::string& move);
+  uint16_t EncodeBookMove(const std::string& move);
+
+  //--------------------------------------------------------------------------
+  // InCheck: is the side to move in check?
+  // IsDraw: draw by the 50 move rule, lack of mating material, or a
+  //         position repeated since the last SetPosition()
+  // GetPositionKey: zobrist key of the current position
+  // GetPolyglotKey: opening book key of the current position (see Book.h)
+  //--------------------------------------------------------------------------
+  bool InCheck() const;
+  bool IsDraw() const;
+  uint64_t GetPositionKey() const;
+  uint64_t GetPolyglotKey() const;
+
+  //--------------------------------------------------------------------------
+  // static evaluation of the current position for the side to move,
+  // fill in 'terms' too if it isn't NULL
+  //--------------------------------------------------------------------------
+  int Evaluate(EvalTerms* terms = NULL);
+
+  //--------------------------------------------------------------------------
+  // quiescence search score of the current position for the side to move
+  //--------------------------------------------------------------------------
+  int QSearch();
+
+  //--------------------------------------------------------------------------
+  SearchResult Search(const SearchLimits& limits);
+
+  //--------------------------------------------------------------------------
+  // number of leaf nodes at the given depth
+  //--------------------------------------------------------------------------
+  uint64_t Perft(const int depth);
+
+  //--------------------------------------------------------------------------
+  // clear hash table, history, and killers
+  //--------------------------------------------------------------------------
+  void ClearSearchData();
+
+  //--------------------------------------------------------------------------
+  // stop a Search() or Perft() running on another thread
+  //--------------------------------------------------------------------------
+  void Stop();
+
+private:
+  Engine(const Engine&);
+  Engine& operator=(const Engine&);
+
+  Bitfoot& Ready() const;
+  uint32_t FindMove(const std::string& move) const;
+
+  Bitfoot* engine;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_ENGINE_H
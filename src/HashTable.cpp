@@ -2,15 +2,18 @@
 // Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
 //----------------------------------------------------------------------------
 
+#include "senjo/Output.h"
+#include "senjo/Platform.h"
 #include "HashTable.h"
 
-namespace bitfoot {
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-//----------------------------------------------------------------------------
-uint64_t TranspositionTable::_stores = 0;
-uint64_t TranspositionTable::_hits = 0;
-uint64_t TranspositionTable::_checkmates = 0;
-uint64_t TranspositionTable::_stalemates = 0;
+namespace bitfoot {
 
 //----------------------------------------------------------------------------
 const uint64_t _HASH[PieceTypeCount][64] =
@@ -479,4 +482,355 @@ const uint64_t _HASH[PieceTypeCount][64] =
   }
 };
 
+//----------------------------------------------------------------------------
+namespace
+{
+  const char HashFileMagic[4] = { 'B', 'F', 'T', 'T' };
+
+  struct HashFileHeader
+  {
+    char     magic[4];
+    uint32_t version;
+    uint32_t entrySize;
+    uint32_t reserved1;
+    uint64_t count;
+    uint64_t reserved2;
+  };
+
+  static_assert(sizeof(HashFileHeader) == TranspositionTable::FileHeaderSize,
+                "HashFileHeader must be packed");
+
+  //--------------------------------------------------------------------------
+  void InitHeader(HashFileHeader& header, const uint64_t count)
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HashFileMagic, sizeof(header.magic));
+    header.version   = TranspositionTable::FileVersion;
+    header.entrySize = sizeof(HashEntry);
+    header.count     = count;
+  }
+
+  //--------------------------------------------------------------------------
+  bool IsValid(const HashFileHeader& header)
+  {
+    return (!memcmp(header.magic, HashFileMagic, sizeof(header.magic)) &&
+            (header.version == TranspositionTable::FileVersion) &&
+            (header.entrySize == sizeof(HashEntry)) &&
+            header.count && !(header.count & (header.count - 1)));
+  }
+}
+
+//----------------------------------------------------------------------------
+void TranspositionTable::Free()
+{
+#ifndef WIN32
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+  else
+#endif
+  {
+    delete[] entries;
+  }
+  entries = NULL;
+  mapping = NULL;
+  mappingSize = 0;
+  shared = false;
+  keyMask = 0;
+}
+
+//----------------------------------------------------------------------------
+bool TranspositionTable::Resize(const size_t mbytes)
+{
+  Free();
+
+  const uint64_t bytes   = (mbytes * 1024 * 1024);
+  const uint64_t count   = (bytes / sizeof(HashEntry));
+  const uint64_t highBit = HighBit(count + 1);
+
+  // if highBit is 0 we've shifted beyond size_t bit count (e.g. too big!)
+  if (!highBit) {
+    return false;
+  }
+
+  keyMask = (highBit - 1);
+  if (!keyMask) {
+    return true;
+  }
+  if (shm.size() || file.size()) {
+    if (shm.size() ? Attach(shm, (keyMask + 1))
+                   : Map(file, (keyMask + 1), true))
+    {
+      ResetCounters();
+      return true;
+    }
+    keyMask = (highBit - 1);
+  }
+  if (!(entries = new HashEntry[keyMask + 1])) {
+    return false;
+  }
+
+  Clear();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TranspositionTable::Map(const std::string& fileName,
+                             const uint64_t count,
+                             const bool keep)
+{
+  Free();
+
+#ifdef WIN32
+  (void)count;
+  (void)keep;
+  senjo::Output() << "Cannot map '" << fileName << "': not supported";
+  return false;
+#else
+  const int fd = open(fileName.c_str(), (keep ? (O_RDWR | O_CREAT) : O_RDONLY),
+                      0644);
+  if (fd < 0) {
+    senjo::Output() << "Cannot open '" << fileName << "': "
+                    << strerror(errno);
+    return false;
+  }
+
+  HashFileHeader header;
+  struct stat st;
+  if (fstat(fd, &st)) {
+    senjo::Output() << "Cannot stat '" << fileName << "': "
+                    << strerror(errno);
+    close(fd);
+    return false;
+  }
+
+  // only empty files and files that already hold a hash table are written
+  const bool ours = ((read(fd, &header, sizeof(header)) == sizeof(header)) &&
+                     !memcmp(header.magic, HashFileMagic,
+                             sizeof(header.magic)));
+  const bool valid = (ours && IsValid(header));
+  if (!valid && !(keep && (ours || !st.st_size))) {
+    senjo::Output() << fileName << " is not a hash table file";
+    close(fd);
+    return false;
+  }
+
+  // a table already in the file is used whatever its size
+  uint64_t n = (valid ? header.count : count);
+  size_t size = (sizeof(header) + (n * sizeof(HashEntry)));
+
+  if (!valid || (static_cast<uint64_t>(st.st_size) < size)) {
+    if (!keep) {
+      senjo::Output() << fileName << " is truncated";
+      close(fd);
+      return false;
+    }
+
+    // start over with an empty table, ftruncate fills it with zeros
+    n = count;
+    size = (sizeof(header) + (n * sizeof(HashEntry)));
+    InitHeader(header, n);
+    if (ftruncate(fd, 0) || ftruncate(fd, static_cast<off_t>(size)) ||
+        (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)))
+    {
+      senjo::Output() << "Cannot write '" << fileName << "': "
+                      << strerror(errno);
+      close(fd);
+      return false;
+    }
+  }
+
+  void* addr = mmap(NULL, size, (PROT_READ | PROT_WRITE),
+                    (keep ? MAP_SHARED : MAP_PRIVATE), fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    senjo::Output() << "Cannot map '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  mapping = addr;
+  mappingSize = size;
+  entries = reinterpret_cast<HashEntry*>(static_cast<char*>(addr) +
+                                         sizeof(header));
+  keyMask = static_cast<size_t>(n - 1);
+  if (keep && (n != count)) {
+    senjo::Output() << "Using hash table file '" << fileName << "' of "
+                    << GetMBytes() << " MB";
+  }
+  return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool TranspositionTable::Attach(const std::string& name, const uint64_t count)
+{
+  Free();
+
+#ifdef WIN32
+  (void)count;
+  senjo::Output() << "Cannot attach '" << name << "': not supported";
+  return false;
+#else
+  // segment names must start with a slash
+  const std::string path = ((name[0] == '/') ? name : ('/' + name));
+
+  HashFileHeader header;
+  uint64_t n = count;
+  bool created = false;
+  int fd = -1;
+  for (int attempt = 0; (fd < 0) && (attempt < 2); ++attempt) {
+    created = true;
+    fd = shm_open(path.c_str(), (O_RDWR | O_CREAT | O_EXCL), 0644);
+    if ((fd < 0) && (errno == EEXIST)) {
+      created = false;
+      fd = shm_open(path.c_str(), O_RDWR, 0);
+    }
+    if (fd < 0) {
+      senjo::Output() << "Cannot open shared memory '" << path << "': "
+                      << strerror(errno);
+      return false;
+    }
+    if (created) {
+      break;
+    }
+
+    // the header is written last, wait for the creator to finish with it
+    bool valid = false;
+    for (int i = 0; !valid && (i < 100); ++i) {
+      valid = ((pread(fd, &header, sizeof(header), 0) == sizeof(header)) &&
+               IsValid(header));
+      if (!valid) {
+        senjo::MillisecondSleep(10);
+      }
+    }
+    struct stat st;
+    if (!valid || fstat(fd, &st) ||
+        (static_cast<uint64_t>(st.st_size) <
+         (sizeof(header) + (header.count * sizeof(HashEntry)))))
+    {
+      // most likely left behind by a creator that died before finishing
+      // it, processes already attached keep their mapping until they let go
+      senjo::Output() << "Shared memory '" << path
+                      << "' is not a hash table, starting it over";
+      close(fd);
+      fd = -1;
+      shm_unlink(path.c_str());
+      continue;
+    }
+    n = header.count;
+  }
+  if (fd < 0) {
+    senjo::Output() << "Cannot attach shared memory '" << path << "'";
+    return false;
+  }
+
+  if (created) {
+    // a new segment is all zeros, an empty table
+    const size_t size = (sizeof(header) + (n * sizeof(HashEntry)));
+    if (ftruncate(fd, static_cast<off_t>(size))) {
+      senjo::Output() << "Cannot size shared memory '" << path << "': "
+                      << strerror(errno);
+      close(fd);
+      shm_unlink(path.c_str());
+      return false;
+    }
+  }
+
+  const size_t size = (sizeof(header) + (n * sizeof(HashEntry)));
+  void* addr = mmap(NULL, size, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    senjo::Output() << "Cannot map shared memory '" << path << "': "
+                    << strerror(errno);
+    if (created) {
+      shm_unlink(path.c_str());
+    }
+    return false;
+  }
+  if (created) {
+    InitHeader(header, n);
+    memcpy(addr, &header, sizeof(header));
+  }
+
+  mapping = addr;
+  mappingSize = size;
+  shared = true;
+  entries = reinterpret_cast<HashEntry*>(static_cast<char*>(addr) +
+                                         sizeof(header));
+  keyMask = static_cast<size_t>(n - 1);
+  if (!created && (n != count)) {
+    senjo::Output() << "Attached to shared hash table '" << path << "' of "
+                    << GetMBytes() << " MB";
+  }
+  return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool TranspositionTable::Save(const std::string& fileName) const
+{
+  if (!entries) {
+    senjo::Output() << "There is no hash table to save";
+    return false;
+  }
+
+  FILE* fp = fopen(fileName.c_str(), "wb");
+  if (!fp) {
+    senjo::Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  HashFileHeader header;
+  InitHeader(header, (keyMask + 1));
+  bool ok = ((fwrite(&header, sizeof(header), 1, fp) == 1) &&
+             (fwrite(entries, sizeof(HashEntry), (keyMask + 1), fp) ==
+              (keyMask + 1)));
+  if (fclose(fp)) {
+    ok = false;
+  }
+  if (!ok) {
+    senjo::Output() << "Cannot write '" << fileName << "': "
+                    << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TranspositionTable::Load(const std::string& fileName)
+{
+  ResetCounters();
+#ifndef WIN32
+  return Map(fileName, 0, false);
+#else
+  Free();
+
+  FILE* fp = fopen(fileName.c_str(), "rb");
+  if (!fp) {
+    senjo::Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  HashFileHeader header;
+  if ((fread(&header, sizeof(header), 1, fp) != 1) || !IsValid(header)) {
+    senjo::Output() << fileName << " is not a hash table file";
+    fclose(fp);
+    return false;
+  }
+  if (!(entries = new HashEntry[header.count])) {
+    fclose(fp);
+    return false;
+  }
+  keyMask = static_cast<size_t>(header.count - 1);
+  if (fread(entries, sizeof(HashEntry), header.count, fp) != header.count) {
+    senjo::Output() << fileName << " is truncated";
+    fclose(fp);
+    Free();
+    return false;
+  }
+  fclose(fp);
+  return true;
+#endif
+}
+
 } // namespace bitfoot
@@ -7,6 +7,8 @@
 
 #include "Move.h"
 
+#include <string>
+
 namespace bitfoot
 {
 
@@ -53,6 +55,16 @@ public:
     return (flags & HashEntry::FromPV);
   }
 
+  //--------------------------------------------------------------------------
+  //! \return Everything but the position key packed into 64 bits
+  //--------------------------------------------------------------------------
+  uint64_t GetData() const {
+    return (static_cast<uint64_t>(moveBits) |
+            (static_cast<uint64_t>(static_cast<uint16_t>(score)) << 32) |
+            (static_cast<uint64_t>(depth) << 48) |
+            (static_cast<uint64_t>(flags) << 56));
+  }
+
   uint64_t positionKey;
   uint32_t moveBits;
   int16_t  score;
@@ -60,48 +72,107 @@ public:
   uint8_t  flags;
 };
 
+//----------------------------------------------------------------------------
+// The table can be written to a file and mapped back in.  Files are a 32
+// byte header followed by the entries exactly as they are in memory:
+//   char    magic[4]    "BFTT"
+//   uint32  version     FileVersion
+//   uint32  entrySize   sizeof(HashEntry)
+//   uint32  reserved
+//   uint64  count       number of entries, a power of 2
+//   uint64  reserved
+// Position keys come from the constant _HASH table so they are the same in
+// every run, a file is only rejected if its version or entry size differs.
 //----------------------------------------------------------------------------
 class TranspositionTable
 {
 public:
+  enum {
+    FileVersion    = 1,
+    FileHeaderSize = 32
+  };
+
   //--------------------------------------------------------------------------
   TranspositionTable()
-    : keyMask(0),
-      entries(NULL)
+    : stores(0),
+      hits(0),
+      checkmates(0),
+      stalemates(0),
+      keyMask(0),
+      entries(NULL),
+      mapping(NULL),
+      mappingSize(0),
+      shared(false)
   { }
 
   //--------------------------------------------------------------------------
   ~TranspositionTable() {
-    delete[] entries;
-    entries = NULL;
-    keyMask = 0;
+    Free();
   }
 
   //--------------------------------------------------------------------------
-  bool Resize(const size_t mbytes) {
-    delete[] entries;
-    entries = NULL;
-    keyMask = 0;
+  // allocate a table of at most 'mbytes', in 'fileName' if one has been set
+  // by SetFile(), otherwise on the heap
+  //--------------------------------------------------------------------------
+  bool Resize(const size_t mbytes);
 
-    const uint64_t bytes   = (mbytes * 1024 * 1024);
-    const uint64_t count   = (bytes / sizeof(HashEntry));
-    const uint64_t highBit = HighBit(count + 1);
+  //--------------------------------------------------------------------------
+  // keep the table in 'fileName' (empty for none) from the next Resize()
+  // on, the file is mapped shared so everything stored in the table is
+  // still there the next time the file is used.  A table already in the
+  // file is used as is whatever size it is, a table of another version is
+  // started over, and a new or empty file gets an empty table of the size
+  // given to Resize().  Any other file is left alone and the table goes on
+  // the heap instead.
+  //--------------------------------------------------------------------------
+  void SetFile(const std::string& fileName) {
+    file = fileName;
+  }
 
-    // if highBit is 0 we've shifted beyond size_t bit count (e.g. too big!)
-    if (!highBit) {
-      return false;
-    }
+  //--------------------------------------------------------------------------
+  // keep the table in the POSIX shared memory segment 'name' (empty for
+  // none) from the next Resize() on, this takes precedence over SetFile().
+  // The first process to use 'name' creates the segment with the size given
+  // to Resize(), every other process attaches to it as is whatever size it
+  // asks for.  The segment outlives the processes using it, so it is still
+  // there for the next one until it's removed (e.g. rm /dev/shm/name).  A
+  // segment that isn't a hash table, e.g. one left behind by a creator that
+  // died before setting it up, is removed and created again.
+  //--------------------------------------------------------------------------
+  void SetSharedMemory(const std::string& name) {
+    shm = name;
+  }
 
-    keyMask = (highBit - 1);
-    if (!keyMask) {
-      return true;
-    }
-    if (!(entries = new HashEntry[keyMask + 1])) {
-      return false;
-    }
+  //--------------------------------------------------------------------------
+  // is the table in a shared memory segment other processes may be using?
+  //--------------------------------------------------------------------------
+  bool IsSharedMemory() const {
+    return (mapping && shared);
+  }
+
+  //--------------------------------------------------------------------------
+  // is the table in a file or shared memory segment rather than on the heap?
+  //--------------------------------------------------------------------------
+  bool IsMapped() const {
+    return (mapping != NULL);
+  }
+
+  //--------------------------------------------------------------------------
+  // write the table to 'fileName'
+  //--------------------------------------------------------------------------
+  bool Save(const std::string& fileName) const;
+
+  //--------------------------------------------------------------------------
+  // replace the table with one written by Save(), the file is mapped copy
+  // on write so the table is usable right away no matter how big it is and
+  // the file isn't changed by searching
+  //--------------------------------------------------------------------------
+  bool Load(const std::string& fileName);
 
-    Clear();
-    return true;
+  //--------------------------------------------------------------------------
+  uint64_t GetMBytes() const {
+    return entries ? ((sizeof(HashEntry) * (keyMask + 1)) / (1024 * 1024))
+                   : 0;
   }
 
   //--------------------------------------------------------------------------
@@ -113,12 +184,27 @@ public:
   }
 
   //--------------------------------------------------------------------------
-  HashEntry* Probe(const uint64_t key) {
+  // Entries are written without locking so a table can be shared by engines
+  // searching on other threads or in other processes.  The key is stored
+  // xor'd with the data, so an entry torn by a concurrent Store() doesn't
+  // match.  The entry is copied to the caller's storage and a pointer to
+  // that copy is returned.
+  //
+  // Bitbase and mate scores count plies from the root of the search, 'ply'
+  // is how far the position is from the root.  Entries count them from the
+  // position they belong to, so they're still right at another ply or in
+  // another search.
+  //--------------------------------------------------------------------------
+  HashEntry* Probe(const uint64_t key, HashEntry& copy, const int ply) {
     if (key && entries) {
-      HashEntry* entry = (entries + (key & keyMask));
-      if (entry->positionKey == key) {
-        _hits++;
-        return entry;
+      copy = entries[key & keyMask];
+      if ((copy.positionKey ^ copy.GetData()) == key) {
+        copy.positionKey = key;
+        if (copy.GetPrimaryFlag() != HashEntry::Checkmate) {
+          copy.score = static_cast<int16_t>(RootScore(copy.score, ply));
+        }
+        hits++;
+        return &copy;
       }
     }
     return NULL;
@@ -129,7 +215,8 @@ public:
              const Move& bestmove,
              const int depth,
              const int primaryFlag,
-             const int otherFlags)
+             const int otherFlags,
+             const int ply)
   {
     assert(bestmove.IsValid());
     assert(abs(bestmove.GetScore()) < Infinity);
@@ -141,13 +228,16 @@ public:
 
     if (key && entries) {
       HashEntry* entry = (entries + (key & keyMask));
-      if (depth || !entry->depth || (key != entry->positionKey)) {
-        _stores++;
-        entry->positionKey = key;
+      if (depth || !entry->depth ||
+          (key != (entry->positionKey ^ entry->GetData())))
+      {
+        stores++;
         entry->moveBits    = bestmove.GetBits();
-        entry->score       = static_cast<int16_t>(bestmove.GetScore());
+        entry->score       = static_cast<int16_t>(
+            EntryScore(bestmove.GetScore(), ply));
         entry->depth       = static_cast<uint8_t>(depth);
         entry->flags       = static_cast<uint8_t>(primaryFlag | otherFlags);
+        entry->positionKey = (key ^ entry->GetData());
       }
     }
   }
@@ -155,51 +245,86 @@ public:
   //--------------------------------------------------------------------------
   void StoreCheckmate(const uint64_t key) {
     if (key && entries) {
-      _checkmates++;
+      checkmates++;
       HashEntry* entry   = (entries + (key & keyMask));
-      entry->positionKey = key;
       entry->moveBits    = 0;
       entry->score       = Infinity;
       entry->depth       = 0;
       entry->flags       = HashEntry::Checkmate;
+      entry->positionKey = (key ^ entry->GetData());
     }
   }
 
   //--------------------------------------------------------------------------
   void StoreStalemate(const uint64_t key) {
     if (key && entries) {
-      _stalemates++;
+      stalemates++;
       HashEntry* entry   = (entries + (key & keyMask));
-      entry->positionKey = key;
       entry->moveBits    = 0;
       entry->score       = 0;
       entry->depth       = 0;
       entry->flags       = HashEntry::Stalemate;
+      entry->positionKey = (key ^ entry->GetData());
     }
   }
 
   //--------------------------------------------------------------------------
   void ResetCounters() {
-    _stores = 0;
-    _hits = 0;
-    _checkmates = 0;
-    _stalemates = 0;
+    stores = 0;
+    hits = 0;
+    checkmates = 0;
+    stalemates = 0;
   }
 
   //--------------------------------------------------------------------------
-  uint64_t GetStores() const { return _stores; }
-  uint64_t GetHits() const { return _hits; }
-  uint64_t GetCheckmates() const { return _checkmates; }
-  uint64_t GetStalemates() const { return _stalemates; }
+  uint64_t GetStores() const { return stores; }
+  uint64_t GetHits() const { return hits; }
+  uint64_t GetCheckmates() const { return checkmates; }
+  uint64_t GetStalemates() const { return stalemates; }
 
 private:
-  static uint64_t _stores;
-  static uint64_t _hits;
-  static uint64_t _checkmates;
-  static uint64_t _stalemates;
+  TranspositionTable(const TranspositionTable&);
+  TranspositionTable& operator=(const TranspositionTable&);
+
+  void Free();
+  bool Map(const std::string& fileName, const uint64_t count,
+           const bool keep);
+  bool Attach(const std::string& name, const uint64_t count);
+
+  //--------------------------------------------------------------------------
+  static bool IsWinOrLoss(const int score) {
+    const int value = abs(score);
+    return ((value >= MateScore) ||
+            ((value <= BitbaseScore) && (value >= (BitbaseScore - MaxPlies))));
+  }
+
+  //--------------------------------------------------------------------------
+  static int EntryScore(const int score, const int ply) {
+    if (IsWinOrLoss(score)) {
+      return ((score > 0) ? (score + ply) : (score - ply));
+    }
+    return score;
+  }
+
+  //--------------------------------------------------------------------------
+  static int RootScore(const int score, const int ply) {
+    if (IsWinOrLoss(score)) {
+      return ((score > 0) ? (score - ply) : (score + ply));
+    }
+    return score;
+  }
 
-  size_t     keyMask;
-  HashEntry* entries;
+  uint64_t    stores;
+  uint64_t    hits;
+  uint64_t    checkmates;
+  uint64_t    stalemates;
+  size_t      keyMask;
+  HashEntry*  entries;
+  void*       mapping;     // entries are in a mapped file if not NULL
+  size_t      mappingSize;
+  bool        shared;      // mapping is a shared memory segment
+  std::string file;
+  std::string shm;
 };
 
 } // namespace bitfoot
@@ -0,0 +1,349 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Output.h"
+#include "Match.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// expected score for an elo difference
+//----------------------------------------------------------------------------
+static double ExpectedScore(const double elo)
+{
+  return (1.0 / (1.0 + pow(10.0, (-elo / 400.0))));
+}
+
+//----------------------------------------------------------------------------
+// elo difference for an expected score
+//----------------------------------------------------------------------------
+static double EloDifference(const double score)
+{
+  const double s = std::min<double>(0.9999, std::max<double>(0.0001, score));
+  return (-400.0 * log10((1.0 / s) - 1.0));
+}
+
+//----------------------------------------------------------------------------
+// match statistics from the point of view of configuration A
+//----------------------------------------------------------------------------
+struct MatchStats
+{
+  MatchStats(const int wins, const int losses, const int draws,
+             const double elo0, const double elo1)
+    : elo(0),
+      error(0),
+      llr(0)
+  {
+    const double n = (wins + losses + draws);
+    if (n <= 0) {
+      return;
+    }
+
+    const double w = (wins / n);
+    const double l = (losses / n);
+    const double d = (draws / n);
+    const double s = (w + (d / 2));
+    const double var = ((w * pow(1.0 - s, 2)) +
+                        (l * pow(0.0 - s, 2)) +
+                        (d * pow(0.5 - s, 2)));
+
+    // 95% confidence interval
+    const double margin = (1.959964 * sqrt(var / n));
+    elo = EloDifference(s);
+    error = ((EloDifference(s + margin) - EloDifference(s - margin)) / 2);
+
+    // generalized SPRT log-likelihood ratio, normal approximation
+    if (var > 0) {
+      const double s0 = ExpectedScore(elo0);
+      const double s1 = ExpectedScore(elo1);
+      llr = ((n * (s1 - s0) * ((2 * s) - s0 - s1)) / (2 * var));
+    }
+  }
+
+  double elo;
+  double error;
+  double llr;
+};
+
+//----------------------------------------------------------------------------
+Match::Match()
+  : nextGame(0),
+    wins(0),
+    losses(0),
+    draws(0),
+    verdict(0)
+{
+}
+
+//----------------------------------------------------------------------------
+Match::~Match()
+{
+  for (size_t i = 0; i < workers.size(); ++i) {
+    delete workers[i];
+  }
+  workers.clear();
+}
+
+//----------------------------------------------------------------------------
+bool Match::LoadOpenings(const std::string& fileName)
+{
+  std::ifstream fs(fileName.c_str());
+  if (!fs) {
+    Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  // only the position part of each line is used, operations are ignored
+  Engine engine;
+  engine.SetOption("Hash", "0");
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(fs, line)) {
+    lineNumber++;
+    std::istringstream is(line);
+    std::string board, color, castle, ep;
+    if (!(is >> board >> color >> castle >> ep) || (board[0] == '#')) {
+      continue;
+    }
+    const std::string fen = (board + ' ' + color + ' ' + castle + ' ' + ep +
+                             " 0 1");
+    if (!engine.SetPosition(fen) || engine.GetMoves().empty()) {
+      Output() << fileName << " line " << lineNumber
+               << ": invalid or finished position";
+      continue;
+    }
+    openings.push_back(fen);
+  }
+
+  if (openings.empty()) {
+    Output() << "No openings in " << fileName;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Match::Run(const std::string& epdFile, const Settings& config)
+{
+  settings = config;
+  settings.threads = std::max<int>(1, settings.threads);
+  settings.maxPlies = std::max<int>(1, settings.maxPlies);
+  if (!settings.nodes && !settings.movetime && !settings.time) {
+    Output() << "A node, move time, or game time limit is required";
+    return false;
+  }
+  if ((settings.elo1 <= settings.elo0) ||
+      (settings.alpha <= 0) || (settings.alpha >= 1) ||
+      (settings.beta <= 0) || (settings.beta >= 1))
+  {
+    Output() << "Invalid SPRT bounds";
+    return false;
+  }
+  if (!LoadOpenings(epdFile)) {
+    return false;
+  }
+
+  for (int i = 0; i < settings.threads; ++i) {
+    Worker* worker = new Worker();
+    workers.push_back(worker);
+    for (int k = 0; k < 2; ++k) {
+      const std::vector<Option>& options =
+          (k ? settings.optionsB : settings.optionsA);
+      Engine& engine = worker->engines[k];
+      engine.SetOption("Hash", std::to_string(settings.hashSize));
+      for (size_t n = 0; n < options.size(); ++n) {
+        if (!engine.SetOption(options[n].first, options[n].second)) {
+          Output() << "Invalid option for " << (k ? 'B' : 'A') << ": "
+                   << options[n].first << '=' << options[n].second;
+          return false;
+        }
+      }
+    }
+  }
+
+  Output() << "Playing up to " << settings.games << " games from "
+           << openings.size() << " openings with " << settings.threads
+           << " threads, SPRT elo0=" << settings.elo0
+           << " elo1=" << settings.elo1 << " alpha=" << settings.alpha
+           << " beta=" << settings.beta;
+
+  // report progress until the match is decided, finished, or interrupted
+  const bool ok = RunWorkers(settings.threads, 10000);
+  Report(true);
+  return ok;
+}
+
+//----------------------------------------------------------------------------
+void Match::Work(const int index)
+{
+  PlayGames(*workers[index]);
+}
+
+//----------------------------------------------------------------------------
+void Match::Progress()
+{
+  Report(false);
+}
+
+//----------------------------------------------------------------------------
+void Match::StopWorkers()
+{
+  // abandon games in progress
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->engines[0].Stop();
+    workers[i]->engines[1].Stop();
+  }
+}
+
+//----------------------------------------------------------------------------
+void Match::PlayGames(Worker& worker)
+{
+  // game pairs share an opening, configuration A is white in even games
+  int game;
+  while (!IsDone() && ((game = nextGame++) < settings.games)) {
+    const std::string& fen = openings[(game / 2) % openings.size()];
+    const bool whiteIsA = !(game & 1);
+    Engine& white = worker.engines[whiteIsA ? 0 : 1];
+    Engine& black = worker.engines[whiteIsA ? 1 : 0];
+    const Result result = PlayGame(white, black, fen);
+    if (result != Aborted) {
+      Record(result, whiteIsA);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+Match::Result Match::PlayGame(Engine& white, Engine& black,
+                              const std::string& fen)
+{
+  white.ClearSearchData();
+  black.ClearSearchData();
+  if (!white.SetPosition(fen) || !black.SetPosition(fen)) {
+    return Aborted;
+  }
+
+  // 'white' is also the referee, it tracks the position for both
+  bool whiteToMove = (fen.find(" w ") != std::string::npos);
+  int64_t clock[2] = {
+    static_cast<int64_t>(settings.time),
+    static_cast<int64_t>(settings.time)
+  };
+
+  SearchLimits limits;
+  limits.nodes = settings.nodes;
+  limits.movetime = settings.movetime;
+
+  for (int ply = 0; !IsDone(); ++ply) {
+    if (white.GetMoves().empty()) {
+      if (white.InCheck()) {
+        return (whiteToMove ? BlackWins : WhiteWins);
+      }
+      return Draw;
+    }
+    if (white.IsDraw() || (ply >= settings.maxPlies)) {
+      return Draw;
+    }
+
+    if (settings.time) {
+      limits.wtime = static_cast<uint64_t>(clock[0]);
+      limits.btime = static_cast<uint64_t>(clock[1]);
+      limits.winc = limits.binc = settings.inc;
+    }
+
+    Engine& mover = (whiteToMove ? white : black);
+    const SearchResult search = mover.Search(limits);
+    if (IsDone() || search.bestmove.empty()) {
+      break;
+    }
+
+    if (settings.time) {
+      int64_t& remaining = clock[whiteToMove ? 0 : 1];
+      remaining -= static_cast<int64_t>(search.msecs);
+      if (remaining <= 0) {
+        return (whiteToMove ? BlackWins : WhiteWins);
+      }
+      remaining += static_cast<int64_t>(settings.inc);
+    }
+
+    if (!white.MakeMove(search.bestmove) ||
+        !black.MakeMove(search.bestmove))
+    {
+      Output() << "Illegal move " << search.bestmove << " in "
+               << white.GetFEN();
+      break;
+    }
+    whiteToMove = !whiteToMove;
+  }
+  return Aborted;
+}
+
+//----------------------------------------------------------------------------
+void Match::Record(const Result result, const bool whiteIsA)
+{
+  const double lower = log(settings.beta / (1 - settings.alpha));
+  const double upper = log((1 - settings.beta) / settings.alpha);
+
+  resultLock.Lock();
+  if (result == Draw) {
+    draws++;
+  }
+  else if ((result == WhiteWins) == whiteIsA) {
+    wins++;
+  }
+  else {
+    losses++;
+  }
+  const MatchStats stats(wins, losses, draws, settings.elo0, settings.elo1);
+  if (!verdict && (stats.llr >= upper)) {
+    verdict = 1;
+  }
+  else if (!verdict && (stats.llr <= lower)) {
+    verdict = -1;
+  }
+  const bool over = (verdict || ((wins + losses + draws) >= settings.games));
+  resultLock.Unlock();
+
+  if (over) {
+    Finish();
+  }
+}
+
+//----------------------------------------------------------------------------
+void Match::Report(const bool final)
+{
+  resultLock.Lock();
+  const int w = wins;
+  const int l = losses;
+  const int d = draws;
+  const int decision = verdict;
+  resultLock.Unlock();
+
+  const double lower = log(settings.beta / (1 - settings.alpha));
+  const double upper = log((1 - settings.beta) / settings.alpha);
+  const MatchStats stats(w, l, d, settings.elo0, settings.elo1);
+
+  char sbuf[256];
+  snprintf(sbuf, sizeof(sbuf),
+           "%d games, A: +%d -%d =%d, elo %.1f +/- %.1f, "
+           "LLR %.2f (%.2f, %.2f)",
+           (w + l + d), w, l, d, stats.elo, stats.error,
+           stats.llr, lower, upper);
+  Output() << sbuf;
+
+  if (final) {
+    Output() << "SPRT: " << ((decision > 0) ? "H1 accepted" :
+                             (decision < 0) ? "H0 accepted" :
+                                              "inconclusive");
+  }
+}
+
+} // namespace bitfoot
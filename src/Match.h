@@ -0,0 +1,110 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_MATCH_H
+#define BITFOOT_MATCH_H
+
+#include "senjo/Threading.h"
+#include "Engine.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// engine vs engine match between two option configurations
+//
+// Worker threads play game pairs from the openings in an EPD file, each
+// opening once with either configuration as white.  Results are reported
+// from the point of view of configuration A, along with an SPRT of
+// elo0 (H0) against elo1 (H1).  The match stops when the SPRT accepts
+// either hypothesis, the game limit is reached, or it's interrupted.
+//----------------------------------------------------------------------------
+class Match : public WorkerPool
+{
+public:
+  typedef std::pair<std::string, std::string> Option;
+
+  struct Settings {
+    Settings()
+      : threads(1),
+        games(20000),
+        nodes(0),
+        movetime(0),
+        time(0),
+        inc(0),
+        maxPlies(400),
+        hashSize(16),
+        elo0(0),
+        elo1(5),
+        alpha(0.05),
+        beta(0.05)
+    { }
+
+    int                 threads;
+    int                 games;    // maximum number of games to play
+    uint64_t            nodes;    // search nodes per move, 0 = no limit
+    uint64_t            movetime; // milliseconds per move, 0 = no limit
+    uint64_t            time;     // milliseconds per game, 0 = no clock
+    uint64_t            inc;      // increment per move in milliseconds
+    int                 maxPlies; // adjudicate a draw after this many plies
+    int                 hashSize; // hash table MB per engine
+    double              elo0;     // SPRT null hypothesis
+    double              elo1;     // SPRT alternative hypothesis
+    double              alpha;    // SPRT false positive rate
+    double              beta;     // SPRT false negative rate
+    std::vector<Option> optionsA;
+    std::vector<Option> optionsB;
+  };
+
+  Match();
+  ~Match();
+
+  //--------------------------------------------------------------------------
+  // play the match using starting positions from 'epdFile'
+  //--------------------------------------------------------------------------
+  bool Run(const std::string& epdFile, const Settings& settings);
+
+private:
+  Match(const Match&);
+  Match& operator=(const Match&);
+
+  //--------------------------------------------------------------------------
+  enum Result {
+    WhiteWins,
+    BlackWins,
+    Draw,
+    Aborted
+  };
+
+  //--------------------------------------------------------------------------
+  struct Worker {
+    Engine engines[2]; // configuration A and B
+  };
+
+  void Work(const int index);
+  void Progress();
+  void StopWorkers();
+  bool LoadOpenings(const std::string& fileName);
+  void PlayGames(Worker& worker);
+  Result PlayGame(Engine& white, Engine& black, const std::string& fen);
+  void Record(const Result result, const bool whiteIsA);
+  void Report(const bool final);
+
+  Settings                 settings;
+  std::vector<std::string> openings;
+  std::vector<Worker*>     workers;
+  std::atomic<int>         nextGame;
+  int                      wins;      // guarded by resultLock
+  int                      losses;    // guarded by resultLock
+  int                      draws;     // guarded by resultLock
+  int                      verdict;   // 1 = H1, -1 = H0, 0 = inconclusive
+  senjo::Mutex             resultLock;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_MATCH_H
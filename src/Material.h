@@ -0,0 +1,70 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_MATERIAL_H
+#define BITFOOT_MATERIAL_H
+
+#include "Defs.h"
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// evaluation terms that depend only on the number of pieces of each type
+//----------------------------------------------------------------------------
+struct MaterialEntry
+{
+public:
+  enum Flag {
+    WhiteCanWin = 0x01,
+    BlackCanWin = 0x02,
+    DrawnEnding = 0x04
+  };
+
+  enum Scale {
+    NoScale,
+    QueenVsRook,
+    RookVsMinors,
+    RookEnding,
+    BishopEnding,
+    RookPawnVsRook,
+    WrongBishop
+  };
+
+  // endings with their own evaluation function, the general evaluation
+  // terms are skipped entirely when one of these applies
+  enum Endgame {
+    NoEndgame,
+    KXK,  // bare king vs enough material to mate, no pawns
+    KBNK, // bare king vs bishop and knight
+    KPK,  // bare king vs one pawn
+    KRKP, // rook vs one pawn
+    KQKR  // queen vs rook
+  };
+
+  //--------------------------------------------------------------------------
+  //! \return true if the given color has enough material to force a win
+  //--------------------------------------------------------------------------
+  bool CanWin(const Color color) const {
+    return (flags & (color ? BlackCanWin : WhiteCanWin));
+  }
+
+  //--------------------------------------------------------------------------
+  //! \return true if neither side has enough material to force a win
+  //--------------------------------------------------------------------------
+  bool IsDrawn() const {
+    return (flags & DrawnEnding);
+  }
+
+  uint64_t materialKey;
+  int16_t  imbalance;
+  uint8_t  flags;
+  uint8_t  scale;
+  uint8_t  endgame;
+  uint8_t  strong;    // color with the extra material in endgame
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_MATERIAL_H
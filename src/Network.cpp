@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Output.h"
+#include "Network.h"
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static bool ReadValues(FILE* fp, void* dest, const size_t size,
+                       const size_t count)
+{
+  return (fread(dest, size, count, fp) == count);
+}
+
+//----------------------------------------------------------------------------
+Network::Network()
+  : hidden(0),
+    outputBias(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void Network::Clear()
+{
+  hidden = 0;
+  outputBias = 0;
+  weights.clear();
+  biases.clear();
+  outputWeights.clear();
+}
+
+//----------------------------------------------------------------------------
+bool Network::Load(const std::string& fileName)
+{
+  Clear();
+
+  FILE* fp = fopen(fileName.c_str(), "rb");
+  if (!fp) {
+    Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  char magic[4] = {0};
+  uint32_t size = 0;
+  if (!ReadValues(fp, magic, 1, sizeof(magic)) ||
+      memcmp(magic, "BFN1", sizeof(magic)) ||
+      !ReadValues(fp, &size, sizeof(size), 1))
+  {
+    Output() << "'" << fileName << "' is not a network file";
+    fclose(fp);
+    return false;
+  }
+  if (!size || (size > MaxHidden) || (size % 16)) {
+    Output() << "'" << fileName << "' has unsupported hidden layer size "
+             << size;
+    fclose(fp);
+    return false;
+  }
+
+  weights.resize(Inputs * size);
+  biases.resize(size);
+  outputWeights.resize(2 * size);
+  int32_t bias = 0;
+  char extra = 0;
+  if (!ReadValues(fp, &weights[0], sizeof(int16_t), weights.size()) ||
+      !ReadValues(fp, &biases[0], sizeof(int16_t), biases.size()) ||
+      !ReadValues(fp, &outputWeights[0], sizeof(int16_t),
+                  outputWeights.size()) ||
+      !ReadValues(fp, &bias, sizeof(bias), 1) ||
+      ReadValues(fp, &extra, 1, 1))
+  {
+    Output() << "'" << fileName << "' has the wrong size";
+    fclose(fp);
+    Clear();
+    return false;
+  }
+  fclose(fp);
+
+  hidden = static_cast<int>(size);
+  outputBias = bias;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void Network::Refresh(Accumulator& acc, const uint64_t* pc) const
+{
+  for (int side = White; side <= Black; ++side) {
+    memcpy(acc.values[side], &biases[0], (hidden * sizeof(int16_t)));
+  }
+  for (int piece = WhitePawn; piece <= BlackKing; ++piece) {
+    for (uint64_t bits = pc[piece]; bits; bits &= (bits - 1)) {
+      Add(acc, piece, LowSquare(bits));
+    }
+  }
+}
+
+} // namespace bitfoot
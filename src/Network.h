@@ -0,0 +1,176 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_NETWORK_H
+#define BITFOOT_NETWORK_H
+
+#include "Defs.h"
+
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// efficiently updatable evaluation network
+//
+// 768 inputs (12 piece types * 64 squares) feed one hidden layer, the
+// accumulator, once from each side's point of view.  The side to move's
+// half and the other half are clipped to [0, QA] and combined by the
+// output layer into a single score for the side to move.
+//
+// network file format (all values little endian):
+//   char    magic[4]                  "BFN1"
+//   uint32  hidden                    multiple of 16, at most MaxHidden
+//   int16   weights[768][hidden]      input to hidden weights
+//   int16   biases[hidden]
+//   int16   outputWeights[2][hidden]  side to move half first
+//   int32   outputBias
+//
+// score = (outputBias + sum(clip(acc) * outputWeights)) * Scale / (QA * QB)
+//----------------------------------------------------------------------------
+class Network
+{
+public:
+  enum {
+    Inputs    = 768,
+    MaxHidden = 512,
+    QA        = 255,
+    QB        = 64,
+    Scale     = 400
+  };
+
+  //--------------------------------------------------------------------------
+  // first layer outputs for both points of view, one per ply
+  // NOTE: these live inside heap allocated engine contexts, which C++14
+  //       doesn't over-align, so the vector kernels use unaligned access
+  //--------------------------------------------------------------------------
+  struct Accumulator {
+    int16_t values[2][MaxHidden];
+  };
+
+  Network();
+
+  bool Load(const std::string& fileName);
+  void Clear();
+
+  bool IsLoaded() const {
+    return (hidden > 0);
+  }
+
+  int Hidden() const {
+    return hidden;
+  }
+
+  //--------------------------------------------------------------------------
+  // input index of a piece on a square from the given side's point of view,
+  // black sees the board flipped with the piece colors swapped
+  //--------------------------------------------------------------------------
+  static inline int Feature(const int side, const int piece, const int sqr) {
+    assert(IS_PIECE(piece));
+    assert(IS_SQUARE(sqr));
+    return ((((piece ^ side) - Pawn) * 64) + (side ? (sqr ^ 56) : sqr));
+  }
+
+  //--------------------------------------------------------------------------
+  // rebuild an accumulator from the piece bitboards
+  //--------------------------------------------------------------------------
+  void Refresh(Accumulator& acc, const uint64_t* pc) const;
+
+  //--------------------------------------------------------------------------
+  inline void Add(Accumulator& acc, const int piece, const int sqr) const {
+    Update<true>(acc.values[White], Feature(White, piece, sqr));
+    Update<true>(acc.values[Black], Feature(Black, piece, sqr));
+  }
+
+  //--------------------------------------------------------------------------
+  inline void Sub(Accumulator& acc, const int piece, const int sqr) const {
+    Update<false>(acc.values[White], Feature(White, piece, sqr));
+    Update<false>(acc.values[Black], Feature(Black, piece, sqr));
+  }
+
+  //--------------------------------------------------------------------------
+  inline void Copy(Accumulator& dest, const Accumulator& src) const {
+    memcpy(dest.values[White], src.values[White], (hidden * sizeof(int16_t)));
+    memcpy(dest.values[Black], src.values[Black], (hidden * sizeof(int16_t)));
+  }
+
+  //--------------------------------------------------------------------------
+  // score from the point of view of the side to move
+  //--------------------------------------------------------------------------
+  inline int Evaluate(const Accumulator& acc, const Color color) const {
+    const int64_t sum = (outputBias +
+                         Dot(acc.values[color], &outputWeights[0]) +
+                         Dot(acc.values[!color], &outputWeights[hidden]));
+    const int score = static_cast<int>((sum * Scale) / (QA * QB));
+    return std::max<int>(-(WinningScore - 1),
+                         std::min<int>((WinningScore - 1), score));
+  }
+
+private:
+  //--------------------------------------------------------------------------
+  template<bool add>
+  inline void Update(int16_t* values, const int feature) const {
+    const int16_t* w = &weights[feature * hidden];
+#ifdef __AVX2__
+    for (int i = 0; i < hidden; i += 16) {
+      __m256i* v = reinterpret_cast<__m256i*>(values + i);
+      const __m256i x = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(w + i));
+      const __m256i y = _mm256_loadu_si256(v);
+      _mm256_storeu_si256(v, (add ? _mm256_add_epi16(y, x)
+                                  : _mm256_sub_epi16(y, x)));
+    }
+#else
+    for (int i = 0; i < hidden; ++i) {
+      values[i] = static_cast<int16_t>(add ? (values[i] + w[i])
+                                           : (values[i] - w[i]));
+    }
+#endif
+  }
+
+  //--------------------------------------------------------------------------
+  // sum of clipped accumulator values times output weights
+  //--------------------------------------------------------------------------
+  inline int64_t Dot(const int16_t* values, const int16_t* w) const {
+#ifdef __AVX2__
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < hidden; i += 16) {
+      __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + i));
+      v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+      const __m256i x = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(w + i));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, x));
+    }
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    return (static_cast<int64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3] +
+            lanes[4] + lanes[5] + lanes[6] + lanes[7]);
+#else
+    int64_t sum = 0;
+    for (int i = 0; i < hidden; ++i) {
+      const int v = std::max<int>(0, std::min<int>(QA, values[i]));
+      sum += (v * w[i]);
+    }
+    return sum;
+#endif
+  }
+
+  int                  hidden;
+  int32_t              outputBias;
+  std::vector<int16_t> weights;
+  std::vector<int16_t> biases;
+  std::vector<int16_t> outputWeights;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_NETWORK_H
@@ -0,0 +1,125 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Output.h"
+#include "PackedPosition.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must be packed");
+
+//----------------------------------------------------------------------------
+RecordReader::RecordReader()
+  : data(NULL),
+    size(0),
+    recordSize(1),
+    count(0),
+    mapped(false),
+    next(0)
+{
+}
+
+//----------------------------------------------------------------------------
+RecordReader::~RecordReader()
+{
+  Close();
+}
+
+//----------------------------------------------------------------------------
+void RecordReader::Close()
+{
+  if (data) {
+#ifndef WIN32
+    if (mapped) {
+      munmap(const_cast<uint8_t*>(data), size);
+    }
+    else
+#endif
+    {
+      delete[] data;
+    }
+  }
+  data = NULL;
+  size = 0;
+  count = 0;
+  mapped = false;
+  next = 0;
+}
+
+//----------------------------------------------------------------------------
+bool RecordReader::Open(const std::string& fileName, const size_t recSize)
+{
+  Close();
+  if (!recSize) {
+    return false;
+  }
+  recordSize = recSize;
+
+#ifndef WIN32
+  const int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) || (st.st_size < 0)) {
+    Output() << "Cannot stat '" << fileName << "': " << strerror(errno);
+    close(fd);
+    return false;
+  }
+
+  size = static_cast<size_t>(st.st_size);
+  if (size) {
+    void* addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, size, MADV_SEQUENTIAL);
+      data = static_cast<const uint8_t*>(addr);
+      mapped = true;
+    }
+  }
+  close(fd);
+  if (size && !mapped)
+#endif
+  {
+    FILE* fp = fopen(fileName.c_str(), "rb");
+    if (!fp) {
+      Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+      return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = static_cast<size_t>(std::max<long>(0, ftell(fp)));
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* buf = new uint8_t[std::max<size_t>(1, size)];
+    if (fread(buf, 1, size, fp) != size) {
+      Output() << "Cannot read '" << fileName << "': " << strerror(errno);
+      delete[] buf;
+      fclose(fp);
+      size = 0;
+      return false;
+    }
+    fclose(fp);
+    data = buf;
+  }
+
+  if (size % recordSize) {
+    Output() << fileName << " has a partial record at the end, ignored";
+  }
+  count = (size / recordSize);
+  next = 0;
+  return true;
+}
+
+} // namespace bitfoot
@@ -0,0 +1,83 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_PACKED_POSITION_H
+#define BITFOOT_PACKED_POSITION_H
+
+#include "Defs.h"
+
+#include <atomic>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// fixed size binary position, 32 bytes, little endian
+//
+// occupied has a bit set for every occupied square (A1 = bit 0).  pieces
+// holds one 4 bit piece code (PieceType) per occupied square in ascending
+// square order, low nibble first.  flags holds the side to move and
+// castling rights using the StateMask bits (ColorMask|CastleMask).
+//----------------------------------------------------------------------------
+struct PackedPosition
+{
+  uint64_t occupied;
+  uint8_t  pieces[16];
+  uint8_t  flags;
+  uint8_t  ep;          // en passant square, 0xFF if none
+  uint16_t moveNumber;  // full move number
+  uint8_t  rcount;      // reversible move count (50 move rule)
+  uint8_t  reserved[3];
+};
+
+//----------------------------------------------------------------------------
+// read only view of a file of fixed size records
+//
+// The file is memory mapped where possible (read into memory otherwise).
+// Next() hands each record out once and may be called from any number of
+// threads at the same time.
+//----------------------------------------------------------------------------
+class RecordReader
+{
+public:
+  RecordReader();
+  ~RecordReader();
+
+  bool Open(const std::string& fileName, const size_t recordSize);
+  void Close();
+
+  uint64_t Count() const {
+    return count;
+  }
+
+  const void* Get(const uint64_t index) const {
+    return (index < count) ? (data + (index * recordSize)) : NULL;
+  }
+
+  //--------------------------------------------------------------------------
+  // next record not yet handed out, NULL when they're all gone
+  //--------------------------------------------------------------------------
+  const void* Next() {
+    return Get(next++);
+  }
+
+  void Rewind() {
+    next = 0;
+  }
+
+private:
+  RecordReader(const RecordReader&);
+  RecordReader& operator=(const RecordReader&);
+
+  const uint8_t*        data;
+  size_t                size;
+  size_t                recordSize;
+  uint64_t              count;
+  bool                  mapped;
+  std::atomic<uint64_t> next;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_PACKED_POSITION_H
@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_PARAMS_H
+#define BITFOOT_PARAMS_H
+
+#include "Defs.h"
+
+#include <vector>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// evaluation parameters
+//
+// Normal builds compile these into the evaluation as constants.  Builds
+// with BITFOOT_TUNE defined turn them (and the evaluation tables declared
+// with EVAL_CONST) into variables so the tuner can change them at runtime.
+//----------------------------------------------------------------------------
+#define BITFOOT_EVAL_PARAMS(PARAM) \
+  PARAM(NoPawns,               50) \
+  PARAM(PawnCandidate,          8) \
+  PARAM(PawnSupported,          4) \
+  PARAM(PawnBackward,           8) \
+  PARAM(PawnBackwardGuarded,   12) \
+  PARAM(PawnBackwardGuarded2,  16) \
+  PARAM(PawnBackwardOpen,       8) \
+  PARAM(PawnDoubled,           24) \
+  PARAM(PawnDoubledBackward,   40) \
+  PARAM(PawnBlockedCenter,     16) \
+  PARAM(KnightRedundant,       16) \
+  PARAM(KnightLoner,           50) \
+  PARAM(KnightKingAttack,      20) \
+  PARAM(KnightImmobile,        16) \
+  PARAM(KnightCornered,        32) \
+  PARAM(KnightBlocksC,         10) \
+  PARAM(KnightOutpost,          8) \
+  PARAM(KnightOutpostAlone,    16) \
+  PARAM(KnightOutpostHole,      8) \
+  PARAM(KnightOutpostGuarded,   8) \
+  PARAM(BishopPair,            48) \
+  PARAM(BishopLoner,           50) \
+  PARAM(BishopKingAttack,      20) \
+  PARAM(BishopImmobile,        16) \
+  PARAM(BishopCornered,        32) \
+  PARAM(BishopOutpost,          8) \
+  PARAM(BishopOutpostAlone,    16) \
+  PARAM(BishopOutpostHole,      8) \
+  PARAM(BishopOutpostGuarded,   8) \
+  PARAM(BishopFianchetto,       8) \
+  PARAM(BishopPawnColor,        3) \
+  PARAM(BishopPawnChain,        6) \
+  PARAM(RookEarly,              8) \
+  PARAM(RookKingAttack,        40) \
+  PARAM(RookBehindPasser,      12) \
+  PARAM(RookOpenKing,          12) \
+  PARAM(RookOpen,              10) \
+  PARAM(RookHalfOpenTarget,    10) \
+  PARAM(RookHalfOpen,           8) \
+  PARAM(RookBoxedIn,           50) \
+  PARAM(RookBehindPawns,       20) \
+  PARAM(RookConnected,          4) \
+  PARAM(QueenEarly,            12) \
+  PARAM(QueenKingAttack,       80) \
+  PARAM(QueenImmobile,         16) \
+  PARAM(QueenCornered,         32) \
+  PARAM(KingImmobile,          20) \
+  PARAM(KingFrontOfPawns,      10) \
+  PARAM(KingFrontOfPawnsMid,   40) \
+  PARAM(KingHole,               8) \
+  PARAM(KingHoleCastle,         4) \
+  PARAM(KingHoleAttacked,       6) \
+  PARAM(KingHoleWeak,           6) \
+  PARAM(KingOpenFile,           6) \
+  PARAM(PasserFriendDist,       8) \
+  PARAM(PasserEnemyDist,        8) \
+  PARAM(PasserFreePath,        20) \
+  PARAM(PasserUnstoppable,    200) \
+  PARAM(EndgameKnownWin,      400) \
+  PARAM(EndgameKingEdge,       20) \
+  PARAM(EndgameKingDist,       10) \
+  PARAM(EndgameCorner,         20) \
+  PARAM(EndgamePawnRank,        8)
+
+#ifdef BITFOOT_TUNE
+#define EVAL_CONST
+#define BITFOOT_DECLARE_PARAM(name, value) extern int name;
+#else
+#define EVAL_CONST const
+#define BITFOOT_DECLARE_PARAM(name, value) constexpr int name = value;
+#endif
+
+BITFOOT_EVAL_PARAMS(BITFOOT_DECLARE_PARAM)
+
+#undef BITFOOT_DECLARE_PARAM
+
+#ifdef BITFOOT_TUNE
+//----------------------------------------------------------------------------
+// one tunable value and every place it's stored, mirrored piece/square
+// table entries share a single EvalParam so they stay symmetric
+//----------------------------------------------------------------------------
+struct EvalParam
+{
+  EvalParam(const std::string& name, int* value)
+    : name(name),
+      slots(1, value)
+  { }
+
+  int Get() const {
+    return *slots[0];
+  }
+
+  void Set(const int value) {
+    for (size_t i = 0; i < slots.size(); ++i) {
+      *slots[i] = value;
+    }
+  }
+
+  std::string       name;
+  std::vector<int*> slots;
+};
+#endif
+
+} // namespace bitfoot
+
+#endif // BITFOOT_PARAMS_H
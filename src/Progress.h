@@ -0,0 +1,99 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_PROGRESS_H
+#define BITFOOT_PROGRESS_H
+
+#include "senjo/Platform.h"
+
+#include <atomic>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// search progress values reported by the info timer
+//----------------------------------------------------------------------------
+struct ProgressInfo
+{
+  ProgressInfo()
+    : depth(0),
+      seldepth(0),
+      movenum(0),
+      moveBits(0),
+      nodes(0),
+      qnodes(0)
+  { }
+
+  int      depth;
+  int      seldepth;
+  int      movenum;
+  uint32_t moveBits;
+  uint64_t nodes;
+  uint64_t qnodes;
+};
+
+//----------------------------------------------------------------------------
+// seqlock protected copy of ProgressInfo
+// The search thread is the only writer and publishes only at coarse
+// intervals, so the plain counters it updates at every node stay plain.
+// Readers on other threads retry until they see a consistent copy.
+//----------------------------------------------------------------------------
+class Progress
+{
+public:
+  Progress() : seq(0) {
+    Publish(ProgressInfo());
+  }
+
+  //--------------------------------------------------------------------------
+  void Publish(const ProgressInfo& info) {
+    const uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store((s + 1), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    depth.store(info.depth, std::memory_order_relaxed);
+    seldepth.store(info.seldepth, std::memory_order_relaxed);
+    movenum.store(info.movenum, std::memory_order_relaxed);
+    moveBits.store(info.moveBits, std::memory_order_relaxed);
+    nodes.store(info.nodes, std::memory_order_relaxed);
+    qnodes.store(info.qnodes, std::memory_order_relaxed);
+
+    seq.store((s + 2), std::memory_order_release);
+  }
+
+  //--------------------------------------------------------------------------
+  ProgressInfo Read() const {
+    ProgressInfo info;
+    uint32_t before;
+    uint32_t after;
+    do {
+      before = seq.load(std::memory_order_acquire);
+
+      info.depth    = depth.load(std::memory_order_relaxed);
+      info.seldepth = seldepth.load(std::memory_order_relaxed);
+      info.movenum  = movenum.load(std::memory_order_relaxed);
+      info.moveBits = moveBits.load(std::memory_order_relaxed);
+      info.nodes    = nodes.load(std::memory_order_relaxed);
+      info.qnodes   = qnodes.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || (before != after));
+    return info;
+  }
+
+private:
+  std::atomic<uint32_t> seq;
+  std::atomic<int>      depth;
+  std::atomic<int>      seldepth;
+  std::atomic<int>      movenum;
+  std::atomic<uint32_t> moveBits;
+  std::atomic<uint64_t> nodes;
+  std::atomic<uint64_t> qnodes;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_PROGRESS_H
@@ -0,0 +1,257 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/ChessEngine.h"
+#include "senjo/Output.h"
+#include "Defs.h"
+#include "SelfPlay.h"
+
+#include <random>
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static_assert(sizeof(TrainingRecord) == 40, "TrainingRecord must be packed");
+
+//----------------------------------------------------------------------------
+static uint16_t PackMove(const std::string& move)
+{
+  if ((move.size() < 4) ||
+      !IS_X(move[0]) || !IS_Y(move[1]) ||
+      !IS_X(move[2]) || !IS_Y(move[3]))
+  {
+    return 0;
+  }
+  int promo = 0;
+  if (move.size() > 4) {
+    switch (move[4]) {
+    case 'n': promo = 1; break;
+    case 'b': promo = 2; break;
+    case 'r': promo = 3; break;
+    case 'q': promo = 4; break;
+    }
+  }
+  const int from = SQR(TO_X(move[0]), TO_Y(move[1]));
+  const int to   = SQR(TO_X(move[2]), TO_Y(move[3]));
+  return static_cast<uint16_t>(from | (to << 6) | (promo << 12));
+}
+
+//----------------------------------------------------------------------------
+SelfPlay::SelfPlay()
+  : fp(NULL),
+    seenMask(0),
+    start(0),
+    games(0),
+    written(0)
+{
+}
+
+//----------------------------------------------------------------------------
+SelfPlay::~SelfPlay()
+{
+  for (size_t i = 0; i < workers.size(); ++i) {
+    delete workers[i];
+  }
+  workers.clear();
+  if (fp) {
+    fclose(fp);
+    fp = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool SelfPlay::Run(const std::string& fileName, const Settings& config)
+{
+  settings = config;
+  settings.threads = std::max<int>(1, settings.threads);
+  settings.randomPlies = std::max<int>(0, settings.randomPlies);
+  settings.maxPlies = std::max<int>(1, settings.maxPlies);
+  settings.resignScore = std::max<int>(1, settings.resignScore);
+  if (!settings.seed) {
+    settings.seed = Now();
+  }
+
+  if (!(fp = fopen(fileName.c_str(), "ab"))) {
+    Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+
+  // lossy table of keys already written, one slot per key
+  uint64_t slots = 1;
+  while ((slots * 2 * sizeof(uint64_t)) <=
+         (static_cast<uint64_t>(std::max<int>(1, settings.dedupSize)) << 20))
+  {
+    slots *= 2;
+  }
+  seen.reset(new std::atomic<uint64_t>[slots]);
+  for (uint64_t i = 0; i < slots; ++i) {
+    seen[i] = 0;
+  }
+  seenMask = (slots - 1);
+
+  for (int i = 0; i < settings.threads; ++i) {
+    Worker* worker = new Worker();
+    worker->seed = (settings.seed + i);
+    worker->engine.SetOption("Hash", std::to_string(settings.hashSize));
+    workers.push_back(worker);
+  }
+
+  Output() << "Writing " << settings.positions << " positions to "
+           << fileName << " with " << settings.threads << " threads, "
+           << settings.nodes << " nodes per move";
+
+  // report progress until done or interrupted
+  start = Now();
+  const bool ok = RunWorkers(settings.threads, 10000);
+  Progress();
+
+  fclose(fp);
+  fp = NULL;
+  return ok;
+}
+
+//----------------------------------------------------------------------------
+void SelfPlay::Work(const int index)
+{
+  PlayGames(*workers[index]);
+}
+
+//----------------------------------------------------------------------------
+void SelfPlay::Progress()
+{
+  writeLock.Lock();
+  const uint64_t count = written;
+  const uint64_t played = games;
+  writeLock.Unlock();
+  const uint64_t msecs = std::max<uint64_t>(1, (Now() - start));
+  Output() << played << " games, " << count << " positions, "
+           << ((count * 1000) / msecs) << " positions/sec";
+}
+
+//----------------------------------------------------------------------------
+bool SelfPlay::IsDuplicate(const uint64_t key)
+{
+  std::atomic<uint64_t>& slot = seen[key & seenMask];
+  if (slot.load(std::memory_order_relaxed) == key) {
+    return true;
+  }
+  slot.store(key, std::memory_order_relaxed);
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool SelfPlay::Write(const std::vector<TrainingRecord>& records)
+{
+  writeLock.Lock();
+  if (written < settings.positions) {
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(
+        records.size(), (settings.positions - written)));
+    if (count && (fwrite(&records[0], sizeof(TrainingRecord), count, fp) !=
+                  count))
+    {
+      Output() << "Write failed: " << strerror(errno);
+      written = settings.positions;
+    }
+    else {
+      written += count;
+      games++;
+    }
+  }
+  const bool full = (written >= settings.positions);
+  writeLock.Unlock();
+  if (full) {
+    Finish();
+  }
+  return !full;
+}
+
+//----------------------------------------------------------------------------
+void SelfPlay::PlayGames(Worker& worker)
+{
+  std::mt19937_64 random(worker.seed);
+  std::vector<TrainingRecord> records;
+  std::vector<std::string> moves;
+  Engine& engine = worker.engine;
+
+  SearchLimits limits;
+  limits.nodes = settings.nodes;
+
+  while (!IsDone()) {
+    engine.ClearSearchData();
+    if (!engine.SetPosition(ChessEngine::_STARTPOS)) {
+      break;
+    }
+
+    // random opening, start over if it ends the game
+    bool ok = true;
+    for (int i = 0; ok && (i < settings.randomPlies); ++i) {
+      moves = engine.GetMoves();
+      ok = (!moves.empty() &&
+            engine.MakeMove(moves[random() % moves.size()]) &&
+            !engine.IsDraw());
+    }
+    if (!ok || engine.GetMoves().empty()) {
+      continue;
+    }
+
+    // result is from white's point of view: 1 = win, 0 = draw, -1 = loss
+    int result = 0;
+    records.clear();
+    for (int ply = settings.randomPlies; !IsDone(); ++ply) {
+      if (engine.GetMoves().empty()) {
+        if (engine.InCheck()) {
+          result = ((ply & 1) ? 1 : -1);
+        }
+        break;
+      }
+      if (engine.IsDraw() || (ply >= settings.maxPlies)) {
+        break;
+      }
+
+      const SearchResult search = engine.Search(limits);
+      if (search.bestmove.empty()) {
+        break;
+      }
+      if (search.mate || (abs(search.score) >= settings.resignScore)) {
+        const int winner = (search.mate ? search.mate : search.score);
+        result = (((winner > 0) == !(ply & 1)) ? 1 : -1);
+        break;
+      }
+
+      // only quiet positions are useful as evaluation targets, the score of
+      // a position whose best move captures or promotes is still settling
+      if (!engine.InCheck() && !engine.IsCapOrPromo(search.bestmove) &&
+          !IsDuplicate(engine.GetPositionKey()))
+      {
+        TrainingRecord record;
+        memset(&record, 0, sizeof(record));
+        engine.GetPosition(record.position);
+        record.score = static_cast<int16_t>(search.score);
+        record.move = PackMove(search.bestmove);
+        record.ply = static_cast<uint16_t>(ply);
+        records.push_back(record);
+      }
+
+      if (!engine.MakeMove(search.bestmove)) {
+        break;
+      }
+    }
+    if (IsDone()) {
+      break;
+    }
+
+    for (size_t i = 0; i < records.size(); ++i) {
+      const bool black = (records[i].position.flags & ColorMask);
+      records[i].result = static_cast<int8_t>(black ? -result : result);
+    }
+    if (!Write(records)) {
+      break;
+    }
+  }
+}
+
+} // namespace bitfoot
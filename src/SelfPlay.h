@@ -0,0 +1,111 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_SELFPLAY_H
+#define BITFOOT_SELFPLAY_H
+
+#include "senjo/Threading.h"
+#include "Engine.h"
+#include "PackedPosition.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <memory>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// training data record, 40 bytes, little endian
+//
+// Scores and results are from the point of view of the side to move.
+//----------------------------------------------------------------------------
+struct TrainingRecord
+{
+  PackedPosition position;
+  int16_t        score;       // search score in centipawns
+  uint16_t       move;        // from | (to << 6) | (promo << 12), promo is
+                              // 0 = none, 1 = knight, 2 = bishop,
+                              // 3 = rook, 4 = queen
+  uint16_t       ply;         // game ply of this position
+  int8_t         result;      // 1 = win, 0 = draw, -1 = loss
+  uint8_t        reserved;
+};
+
+//----------------------------------------------------------------------------
+// self-play training data generator
+//
+// Worker threads play fixed node games against themselves, each from a
+// few random opening moves, and append every quiet position they see to
+// a file of TrainingRecords once the game's result is known.  Positions
+// already written (by zobrist key) are skipped.
+//----------------------------------------------------------------------------
+class SelfPlay : public WorkerPool
+{
+public:
+  struct Settings {
+    Settings()
+      : threads(1),
+        positions(1000000),
+        nodes(5000),
+        randomPlies(8),
+        maxPlies(400),
+        resignScore(2000),
+        hashSize(16),
+        dedupSize(64),
+        seed(0)
+    { }
+
+    int      threads;
+    uint64_t positions;   // stop after writing this many records
+    uint64_t nodes;       // search nodes per move
+    int      randomPlies; // random moves at the start of every game
+    int      maxPlies;    // adjudicate a draw after this many plies
+    int      resignScore; // adjudicate a win when the score reaches this
+    int      hashSize;    // hash table MB per thread
+    int      dedupSize;   // MB of position keys for duplicate detection
+    uint64_t seed;        // random number seed, 0 = time based
+  };
+
+  SelfPlay();
+  ~SelfPlay();
+
+  //--------------------------------------------------------------------------
+  // generate records into 'fileName' (appended) until settings.positions
+  // records are written or interrupted (SIGINT or SIGTERM)
+  //--------------------------------------------------------------------------
+  bool Run(const std::string& fileName, const Settings& settings);
+
+private:
+  SelfPlay(const SelfPlay&);
+  SelfPlay& operator=(const SelfPlay&);
+
+  //--------------------------------------------------------------------------
+  struct Worker {
+    Worker() : seed(0) { }
+
+    uint64_t seed;
+    Engine   engine;
+  };
+
+  void Work(const int index);
+  void Progress();
+  void PlayGames(Worker& worker);
+  bool IsDuplicate(const uint64_t key);
+  bool Write(const std::vector<TrainingRecord>& records);
+
+  Settings                                 settings;
+  FILE*                                    fp;
+  std::vector<Worker*>                     workers;
+  std::unique_ptr<std::atomic<uint64_t>[]> seen;
+  uint64_t                                 seenMask;
+  uint64_t                                 start;     // msecs timestamp
+  uint64_t                                 games;     // guarded by writeLock
+  uint64_t                                 written;   // guarded by writeLock
+  senjo::Mutex                             writeLock;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_SELFPLAY_H
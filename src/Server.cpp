@@ -0,0 +1,569 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/ChessEngine.h"
+#include "senjo/Output.h"
+#include "Server.h"
+#include "WorkerPool.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static const size_t MaxLineLength   = 0x10000;
+static const size_t MaxOutputLength = 0x1000000;
+
+//----------------------------------------------------------------------------
+Server::Server()
+  : quit(false)
+{
+  wakePipe[0] = wakePipe[1] = -1;
+}
+
+//----------------------------------------------------------------------------
+Server::~Server()
+{
+  while (workers.size()) {
+    delete workers.back();
+    workers.pop_back();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool Server::Run(const std::string& socketPath, const int workerCount,
+                 const int hashSize)
+{
+#ifdef WIN32
+  (void)socketPath;
+  (void)workerCount;
+  (void)hashSize;
+  Output() << "Unix domain sockets are not supported on this platform";
+  return false;
+#else
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socketPath.empty() || (socketPath.size() >= sizeof(addr.sun_path))) {
+    Output() << "Invalid socket path: '" << socketPath << "'";
+    return false;
+  }
+  strcpy(addr.sun_path, socketPath.c_str());
+
+  // remove the socket left behind by a previous server, but nothing else
+  struct stat info;
+  if (!stat(socketPath.c_str(), &info) && S_ISSOCK(info.st_mode)) {
+    unlink(socketPath.c_str());
+  }
+
+  const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    Output() << "Cannot create socket: " << strerror(errno);
+    return false;
+  }
+  fcntl(listener, F_SETFD, FD_CLOEXEC);
+  if (pipe(wakePipe)) {
+    Output() << "Cannot create pipe: " << strerror(errno);
+    close(listener);
+    return false;
+  }
+  for (int i = 0; i < 2; ++i) {
+    fcntl(wakePipe[i], F_SETFD, FD_CLOEXEC);
+    fcntl(wakePipe[i], F_SETFL, (fcntl(wakePipe[i], F_GETFL) | O_NONBLOCK));
+  }
+  if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+      listen(listener, 64))
+  {
+    Output() << "Cannot listen on '" << socketPath << "': " << strerror(errno);
+    close(listener);
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+    wakePipe[0] = wakePipe[1] = -1;
+    return false;
+  }
+
+  // the first worker owns the transposition table, everything is
+  // allocated and initialized up front so requests never wait for it
+  quit = false;
+  for (int i = 0; i < std::max<int>(1, workerCount); ++i) {
+    Worker* worker = new Worker();
+    worker->owner = this;
+    if (workers.empty()) {
+      if (hashSize > 0) {
+        worker->engine.SetOption("Hash", std::to_string(hashSize));
+      }
+    }
+    else {
+      worker->engine.ShareHashTable(&(workers[0]->engine));
+    }
+    worker->engine.SetPosition(ChessEngine::_STARTPOS);
+    workers.push_back(worker);
+  }
+
+  bool ok = true;
+  for (size_t i = 0; ok && (i < workers.size()); ++i) {
+    if (!workers[i]->thread.Start(RunWorker, workers[i])) {
+      Output() << "Failed to start worker thread";
+      ok = false;
+    }
+  }
+
+  InterruptGuard guard;
+
+  if (ok) {
+    Output() << "Serving on " << socketPath << " with " << workers.size()
+             << " workers";
+  }
+
+  std::vector<std::shared_ptr<Client> > clients;
+  std::vector<pollfd> fds;
+  while (ok && !InterruptGuard::IsInterrupted()) {
+    // clients that don't read their replies are dropped
+    for (size_t i = clients.size(); i > 0; --i) {
+      Client& client = *clients[i - 1];
+      client.outputLock.Lock();
+      const size_t pending = client.output.size();
+      client.outputLock.Unlock();
+      if (pending > MaxOutputLength) {
+        CloseClient(clients[i - 1]);
+        clients.erase(clients.begin() + (i - 1));
+      }
+    }
+
+    fds.resize(clients.size() + 3);
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    for (size_t i = 0; i < clients.size(); ++i) {
+      Client& client = *clients[i];
+      client.outputLock.Lock();
+      fds[i + 1].fd = client.fd;
+      fds[i + 1].events = (client.output.empty() ? POLLIN
+                                                 : (POLLIN | POLLOUT));
+      fds[i + 1].revents = 0;
+      client.outputLock.Unlock();
+    }
+    fds[clients.size() + 1].fd = wakePipe[0];
+    fds[clients.size() + 1].events = POLLIN;
+    fds[clients.size() + 1].revents = 0;
+    fds.back().fd = InterruptGuard::GetWakeFd();
+    fds.back().events = POLLIN;
+    fds.back().revents = 0;
+
+    if (poll(&fds[0], fds.size(), -1) < 0) {
+      if (errno != EINTR) {
+        Output() << "poll() failed: " << strerror(errno);
+        ok = false;
+      }
+      continue;
+    }
+
+    if (fds[clients.size() + 1].revents & POLLIN) {
+      char buf[256];
+      while (read(wakePipe[0], buf, sizeof(buf)) > 0) { }
+    }
+
+    for (size_t i = clients.size(); i > 0; --i) {
+      if (((fds[i].revents & POLLOUT) && !WriteClient(*clients[i - 1])) ||
+          ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+           !ReadClient(clients[i - 1])))
+      {
+        CloseClient(clients[i - 1]);
+        clients.erase(clients.begin() + (i - 1));
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      const int fd = accept(listener, NULL, NULL);
+      if (fd >= 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, (fcntl(fd, F_GETFL) | O_NONBLOCK));
+#ifdef SO_NOSIGPIPE
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        clients.push_back(std::make_shared<Client>(fd));
+      }
+    }
+  }
+
+  // shut down workers, searches in progress are cancelled even if they
+  // haven't cleared the stop flags of earlier searches yet
+  queueLock.Lock();
+  quit = true;
+  queue.clear();
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->cancel = true;
+    workers[i]->engine.Stop();
+  }
+  queueLock.Unlock();
+  queueSignal.Notify();
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->thread.Join();
+  }
+
+  while (workers.size()) {
+    delete workers.back();
+    workers.pop_back();
+  }
+
+  for (size_t i = 0; i < clients.size(); ++i) {
+    CloseClient(clients[i]);
+  }
+  close(listener);
+  close(wakePipe[0]);
+  close(wakePipe[1]);
+  wakePipe[0] = wakePipe[1] = -1;
+  unlink(socketPath.c_str());
+
+  Output() << "Server stopped";
+  return ok;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void Server::RunWorker(void* data)
+{
+  Worker* worker = static_cast<Worker*>(data);
+  Server* server = worker->owner;
+
+  while (true) {
+    server->queueLock.Lock();
+    if (server->quit) {
+      server->queueLock.Unlock();
+      break;
+    }
+    if (server->queue.empty()) {
+      server->queueLock.Unlock();
+      server->queueSignal.Wait();
+      continue;
+    }
+
+    const Request request = server->queue.front();
+    server->queue.pop_front();
+    worker->current = request.client;
+    worker->cancel = false;
+    const bool more = !server->queue.empty();
+    server->queueLock.Unlock();
+
+    // Signal only wakes one waiter, pass it on if there is more to do
+    if (more) {
+      server->queueSignal.Notify();
+    }
+
+    server->Execute(*worker, request);
+
+    server->queueLock.Lock();
+    worker->current.reset();
+    server->queueLock.Unlock();
+  }
+
+  // let the next worker see the quit flag too
+  server->queueSignal.Notify();
+}
+
+//----------------------------------------------------------------------------
+bool Server::ParseRequest(const char* params, Request& request,
+                          std::string& error)
+{
+  static const std::string argDepth    = "depth";
+  static const std::string argFen      = "fen";
+  static const std::string argId       = "id";
+  static const std::string argMoves    = "moves";
+  static const std::string argMovetime = "movetime";
+  static const std::string argStartpos = "startpos";
+
+  bool invalid = false;
+  while (!invalid && params && *NextWord(params)) {
+    if (StringParam(argId,       request.id,              params, invalid) ||
+        NumberParam(argDepth,    request.limits.depth,    params, invalid) ||
+        NumberParam(argMovetime, request.limits.movetime, params, invalid))
+    {
+      continue;
+    }
+    if (ParamMatch(argStartpos, params)) {
+      request.fen = ChessEngine::_STARTPOS;
+    }
+    else if (ParamMatch(argFen, params)) {
+      invalid = !ParamValue(request.fen, params, argMoves);
+    }
+    else if (ParamMatch(argMoves, params)) {
+      while (*params) {
+        const char* begin = params;
+        NextSpace(params);
+        request.moves.push_back(std::string(begin, (params - begin)));
+        NextWord(params);
+      }
+    }
+    else {
+      error = ("unexpected token: " + std::string(params));
+      return false;
+    }
+  }
+
+  if (invalid) {
+    error = "missing or invalid parameter value";
+    return false;
+  }
+  if (request.fen.empty()) {
+    error = "missing position";
+    return false;
+  }
+  if ((request.type == SearchRequest) &&
+      !request.limits.depth && !request.limits.movetime)
+  {
+    error = "search needs depth or movetime";
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void Server::Execute(Worker& worker, const Request& request)
+{
+  Client& client = *request.client;
+  client.outputLock.Lock();
+  const bool closed = client.closed;
+  client.outputLock.Unlock();
+  if (closed) {
+    return;
+  }
+
+  const std::string id = (request.id.empty() ? "" : (" id " + request.id));
+  Engine& engine = worker.engine;
+  if (!engine.SetPosition(request.fen)) {
+    Reply(client, ("error" + id + " invalid fen"));
+    return;
+  }
+  for (size_t i = 0; i < request.moves.size(); ++i) {
+    if (!engine.MakeMove(request.moves[i])) {
+      Reply(client, ("error" + id + " invalid move " + request.moves[i]));
+      return;
+    }
+  }
+
+  std::ostringstream out;
+  out << "result" << id;
+  switch (request.type) {
+  case SearchRequest: {
+    // the request may be cancelled before the search clears the stop flags
+    // of the last one, so the search checks 'cancel' after it has
+    SearchLimits limits = request.limits;
+    limits.cancel = &worker.cancel;
+    const SearchResult result = engine.Search(limits);
+    if (result.bestmove.empty()) {
+      Reply(client, ("error" + id + " no legal moves"));
+      return;
+    }
+    out << " bestmove " << result.bestmove;
+    if (result.mate) {
+      out << " score mate " << result.mate;
+    }
+    else {
+      out << " score cp " << result.score;
+    }
+    out << " depth " << result.depth
+        << " seldepth " << result.seldepth
+        << " nodes " << result.nodes
+        << " time " << result.msecs
+        << " pv";
+    for (size_t i = 0; i < result.pv.size(); ++i) {
+      out << ' ' << result.pv[i];
+    }
+    break;
+  }
+  case EvalRequest:
+    out << " eval " << engine.Evaluate();
+    break;
+  case QSearchRequest:
+    out << " qsearch " << engine.QSearch();
+    break;
+  }
+  Reply(client, out.str());
+}
+
+//----------------------------------------------------------------------------
+// queue 'line' to be sent to 'client' by the polling thread, may be called
+// from any thread
+//----------------------------------------------------------------------------
+void Server::Reply(Client& client, const std::string& line)
+{
+#ifndef WIN32
+  client.outputLock.Lock();
+  if (!client.closed) {
+    client.output += line;
+    client.output += '\n';
+  }
+  client.outputLock.Unlock();
+
+  const char c = 0;
+  const ssize_t n = write(wakePipe[1], &c, 1);
+  (void)n; // the pipe is full, poll() will return anyway
+#else
+  (void)client;
+  (void)line;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool Server::HandleLine(const std::shared_ptr<Client>& client, char* line)
+{
+  static const std::string cmdEval    = "eval";
+  static const std::string cmdQSearch = "qsearch";
+  static const std::string cmdQuit    = "quit";
+  static const std::string cmdSearch  = "search";
+
+  const char* params = NormalizeString(line);
+  if (!*params) {
+    return true;
+  }
+
+  Request request;
+  request.client = client;
+  if (ParamMatch(cmdSearch, params)) {
+    request.type = SearchRequest;
+  }
+  else if (ParamMatch(cmdEval, params)) {
+    request.type = EvalRequest;
+  }
+  else if (ParamMatch(cmdQSearch, params)) {
+    request.type = QSearchRequest;
+  }
+  else if (ParamMatch(cmdQuit, params)) {
+    return false;
+  }
+  else {
+    Reply(*client, ("error unknown command: " + std::string(params)));
+    return true;
+  }
+
+  std::string error;
+  if (!ParseRequest(params, request, error)) {
+    const std::string id = (request.id.empty() ? "" : (" id " + request.id));
+    Reply(*client, ("error" + id + ' ' + error));
+    return true;
+  }
+
+  queueLock.Lock();
+  queue.push_back(request);
+  queueLock.Unlock();
+  queueSignal.Notify();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Server::ReadClient(const std::shared_ptr<Client>& client)
+{
+#ifndef WIN32
+  char buf[4096];
+  const ssize_t n = read(client->fd, buf, sizeof(buf));
+  if (n <= 0) {
+    return ((n < 0) &&
+            ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)));
+  }
+
+  std::string& input = client->input;
+  input.append(buf, static_cast<size_t>(n));
+
+  size_t begin = 0;
+  size_t end;
+  while ((end = input.find('\n', begin)) != std::string::npos) {
+    std::string line = input.substr(begin, (end - begin));
+    begin = (end + 1);
+    if (!HandleLine(client, &line[0])) {
+      return false;
+    }
+  }
+  input.erase(0, begin);
+
+  if (input.size() > MaxLineLength) {
+    Reply(*client, "error request line too long");
+    return false;
+  }
+  return true;
+#else
+  (void)client;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// send as much of the client's pending output as the socket takes without
+// blocking, returns false if the connection is broken
+//----------------------------------------------------------------------------
+bool Server::WriteClient(Client& client)
+{
+#ifndef WIN32
+  bool ok = true;
+  client.outputLock.Lock();
+  std::string& output = client.output;
+  while (ok && !client.closed && !output.empty()) {
+    const ssize_t n = send(client.fd, output.c_str(), output.size(),
+                           MSG_NOSIGNAL);
+    if (n > 0) {
+      output.erase(0, static_cast<size_t>(n));
+    }
+    else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+      break;
+    }
+    else if (errno != EINTR) {
+      ok = false;
+    }
+  }
+  client.outputLock.Unlock();
+  return ok;
+#else
+  (void)client;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void Server::CloseClient(const std::shared_ptr<Client>& client)
+{
+#ifndef WIN32
+  // whatever the socket takes without waiting still goes out, e.g. the
+  // replies sent before a 'quit' request
+  WriteClient(*client);
+
+  client->outputLock.Lock();
+  if (!client->closed) {
+    client->closed = true;
+    client->output.clear();
+    close(client->fd);
+  }
+  client->outputLock.Unlock();
+#endif
+
+  // nobody is listening for the results of this client's requests
+  queueLock.Lock();
+  for (size_t i = queue.size(); i > 0; --i) {
+    if (queue[i - 1].client == client) {
+      queue.erase(queue.begin() + (i - 1));
+    }
+  }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    if (workers[i]->current == client) {
+      workers[i]->cancel = true;
+      workers[i]->engine.Stop();
+    }
+  }
+  queueLock.Unlock();
+}
+
+} // namespace bitfoot
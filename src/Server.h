@@ -0,0 +1,122 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_SERVER_H
+#define BITFOOT_SERVER_H
+
+#include "senjo/Threading.h"
+#include "Engine.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// analysis server on a unix domain socket
+//
+// Clients send one request per line and get one reply line per request.
+// Requests from all clients are queued and handed to a pool of workers,
+// each with its own Engine, so replies come back in the order they finish,
+// not the order they were sent.  Every reply carries the request's id.
+// All workers search with the first worker's transposition table, which
+// lives as long as the server does.  Replies are buffered and sent by the
+// thread that polls the sockets, so a client that stops reading them is
+// disconnected rather than holding anything up.
+//
+// requests:
+//   search [id <x>] [depth <x>] [movetime <msecs>] <position>
+//   eval [id <x>] <position>
+//   qsearch [id <x>] <position>
+//   quit
+// where <position> is: startpos|fen <fen> [moves <movelist>]
+//
+// replies:
+//   result [id <x>] bestmove <move> score cp|mate <x> depth <x>
+//          seldepth <x> nodes <x> time <msecs> pv <movelist>
+//   result [id <x>] eval <x>
+//   result [id <x>] qsearch <x>
+//   error [id <x>] <message>
+//----------------------------------------------------------------------------
+class Server
+{
+public:
+  Server();
+  ~Server();
+
+  //--------------------------------------------------------------------------
+  // serve requests until interrupted (SIGINT or SIGTERM)
+  // workers: number of searches that can run at the same time
+  // hashSize: shared transposition table MB, 0 for the 'Hash' option default
+  //--------------------------------------------------------------------------
+  bool Run(const std::string& socketPath, const int workers,
+           const int hashSize);
+
+private:
+  Server(const Server&);
+  Server& operator=(const Server&);
+
+  //--------------------------------------------------------------------------
+  struct Client {
+    Client(const int fd) : fd(fd), closed(false) { }
+
+    int          fd;
+    bool         closed;       // guarded by outputLock
+    std::string  input;        // unfinished request line
+    std::string  output;       // replies not sent yet, guarded by outputLock
+    senjo::Mutex outputLock;
+  };
+
+  //--------------------------------------------------------------------------
+  enum RequestType {
+    SearchRequest,
+    EvalRequest,
+    QSearchRequest
+  };
+
+  //--------------------------------------------------------------------------
+  struct Request {
+    std::shared_ptr<Client>  client;
+    RequestType              type;
+    std::string              id;
+    std::string              fen;
+    std::vector<std::string> moves;
+    SearchLimits             limits;
+  };
+
+  //--------------------------------------------------------------------------
+  struct Worker {
+    Worker() : owner(NULL), cancel(false) { }
+
+    Server*                 owner;
+    Engine                  engine;
+    senjo::Thread           thread;
+    std::shared_ptr<Client> current; // guarded by Server::queueLock
+    std::atomic<bool>       cancel;  // cleared when current is set, set to
+                                     // cancel it, both holding queueLock
+  };
+
+  static void RunWorker(void* data);
+
+  bool ParseRequest(const char* params, Request& request, std::string& error);
+  void Execute(Worker& worker, const Request& request);
+  void Reply(Client& client, const std::string& line);
+  bool HandleLine(const std::shared_ptr<Client>& client, char* line);
+  bool ReadClient(const std::shared_ptr<Client>& client);
+  bool WriteClient(Client& client);
+  void CloseClient(const std::shared_ptr<Client>& client);
+
+  bool                 quit;        // guarded by queueLock
+  int                  wakePipe[2]; // makes poll() return to send replies
+  std::vector<Worker*> workers;
+  std::deque<Request>  queue;
+  senjo::Mutex         queueLock;
+  senjo::Signal        queueSignal;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_SERVER_H
@@ -5,6 +5,9 @@
 #include "senjo/Output.h"
 #include "Stats.h"
 
+#include <math.h>
+#include <sstream>
+
 using namespace senjo;
 
 namespace bitfoot
@@ -14,6 +17,7 @@ namespace bitfoot
 void Stats::Clear()
 {
   statCount     = 1;
+  collected     = 0;
   snodes        = 0;
   qnodes        = 0;
   chkExts       = 0;
@@ -28,6 +32,7 @@ void Stats::Clear()
   rzrEarlyOut   = 0;
   rzrCutoffs    = 0;
   iidCount      = 0;
+  bitbaseHits   = 0;
   nullMoves     = 0;
   nmCutoffs     = 0;
   nmThreats     = 0;
@@ -40,11 +45,20 @@ void Stats::Clear()
   lmResearches  = 0;
   lmConfirmed   = 0;
   lmAlphaIncs   = 0;
+  memset(snodesAtPly, 0, sizeof(snodesAtPly));
+  memset(qnodesAtPly, 0, sizeof(qnodesAtPly));
+  memset(iterNodes, 0, sizeof(iterNodes));
+  memset(prevIterNodes, 0, sizeof(prevIterNodes));
+  memset(cutoffs, 0, sizeof(cutoffs));
+  memset(firstCutoffs, 0, sizeof(firstCutoffs));
+  memset(cutoffIndex, 0, sizeof(cutoffIndex));
+  memset(cutoffSource, 0, sizeof(cutoffSource));
 }
 
 //----------------------------------------------------------------------------
 Stats& Stats::operator+=(const Stats& other) {
   statCount     += 1;
+  collected     += other.collected;
   snodes        += other.snodes;
   qnodes        += other.qnodes;
   chkExts       += other.chkExts;
@@ -59,6 +73,7 @@ Stats& Stats::operator+=(const Stats& other) {
   rzrEarlyOut   += other.rzrEarlyOut;
   rzrCutoffs    += other.rzrCutoffs;
   iidCount      += other.iidCount;
+  bitbaseHits   += other.bitbaseHits;
   nullMoves     += other.nullMoves;
   nmCutoffs     += other.nmCutoffs;
   nmThreats     += other.nmThreats;
@@ -71,6 +86,24 @@ Stats& Stats::operator+=(const Stats& other) {
   lmResearches  += other.lmResearches;
   lmConfirmed   += other.lmConfirmed;
   lmAlphaIncs   += other.lmAlphaIncs;
+  for (int i = 0; i <= MaxPlies; ++i) {
+    snodesAtPly[i] += other.snodesAtPly[i];
+    qnodesAtPly[i] += other.qnodesAtPly[i];
+    iterNodes[i]     += other.iterNodes[i];
+    prevIterNodes[i] += other.prevIterNodes[i];
+  }
+  for (int pv = 0; pv < 2; ++pv) {
+    for (int d = 0; d < CutoffDepths; ++d) {
+      cutoffs[pv][d]      += other.cutoffs[pv][d];
+      firstCutoffs[pv][d] += other.firstCutoffs[pv][d];
+    }
+  }
+  for (int i = 0; i < CutoffIndexes; ++i) {
+    cutoffIndex[i] += other.cutoffIndex[i];
+  }
+  for (int i = 0; i < CutoffSources; ++i) {
+    cutoffSource[i] += other.cutoffSource[i];
+  }
   return *this;
 }
 
@@ -85,6 +118,7 @@ static uint64_t Avg(const uint64_t total, const uint64_t count) {
 //----------------------------------------------------------------------------
 Stats Stats::Average() const {
   Stats avg;
+  avg.collected     = collected;
   avg.snodes        = Avg(snodes,       statCount);
   avg.qnodes        = Avg(qnodes,       statCount);
   avg.chkExts       = Avg(chkExts,      statCount);
@@ -99,6 +133,7 @@ Stats Stats::Average() const {
   avg.rzrEarlyOut   = Avg(rzrEarlyOut,  statCount);
   avg.rzrCutoffs    = Avg(rzrCutoffs,   statCount);
   avg.iidCount      = Avg(iidCount,     statCount);
+  avg.bitbaseHits   = Avg(bitbaseHits,  statCount);
   avg.nullMoves     = Avg(nullMoves,    statCount);
   avg.nmCutoffs     = Avg(nmCutoffs,    statCount);
   avg.nmThreats     = Avg(nmThreats,    statCount);
@@ -111,6 +146,24 @@ Stats Stats::Average() const {
   avg.lmResearches  = Avg(lmResearches, statCount);
   avg.lmConfirmed   = Avg(lmConfirmed,  statCount);
   avg.lmAlphaIncs   = Avg(lmAlphaIncs,  statCount);
+  for (int i = 0; i <= MaxPlies; ++i) {
+    avg.snodesAtPly[i] = Avg(snodesAtPly[i], statCount);
+    avg.qnodesAtPly[i] = Avg(qnodesAtPly[i], statCount);
+    avg.iterNodes[i]     = Avg(iterNodes[i],     statCount);
+    avg.prevIterNodes[i] = Avg(prevIterNodes[i], statCount);
+  }
+  for (int pv = 0; pv < 2; ++pv) {
+    for (int d = 0; d < CutoffDepths; ++d) {
+      avg.cutoffs[pv][d]      = Avg(cutoffs[pv][d],      statCount);
+      avg.firstCutoffs[pv][d] = Avg(firstCutoffs[pv][d], statCount);
+    }
+  }
+  for (int i = 0; i < CutoffIndexes; ++i) {
+    avg.cutoffIndex[i] = Avg(cutoffIndex[i], statCount);
+  }
+  for (int i = 0; i < CutoffSources; ++i) {
+    avg.cutoffSource[i] = Avg(cutoffSource[i], statCount);
+  }
   return avg;
 }
 
@@ -123,8 +176,10 @@ void Stats::Print() {
              << hashExts << " hashed extensions";
   }
 
-  Output() << execs << " execs, "
-           << qexecs << " qexecs (" << Percent(qexecs, execs) << "%)";
+  if (execs) {
+    Output() << execs << " execs, "
+             << qexecs << " qexecs (" << Percent(qexecs, execs) << "%)";
+  }
 
   const uint64_t searches = (snodes + qnodes);
   Output() << snodes << " searches (" << Percent(snodes, searches) << "%), "
@@ -167,10 +222,16 @@ void Stats::Print() {
     Output() << iidCount << " IID searches";
   }
 
-  Output() << lateMoves << " late moves ("
-           << Percent(lateMoves, execs) << "%), "
-           << lmAlphaIncs << " increase alpha ("
-           << Percent(lmAlphaIncs, lateMoves) << "%)";
+  if (bitbaseHits) {
+    Output() << bitbaseHits << " bitbase hits";
+  }
+
+  if (lateMoves) {
+    Output() << lateMoves << " late moves ("
+             << Percent(lateMoves, execs) << "%), "
+             << lmAlphaIncs << " increase alpha ("
+             << Percent(lmAlphaIncs, lateMoves) << "%)";
+  }
 
   if (lmCandidates) {
     Output() << lmCandidates << " lmr candidates ("
@@ -182,6 +243,144 @@ void Stats::Print() {
              << lmConfirmed << " confirmed ("
              << Percent(lmConfirmed, lmResearches) << "%)";
   }
+
+  for (int i = 0; i <= MaxPlies; ++i) {
+    if (snodesAtPly[i] || qnodesAtPly[i]) {
+      Output() << "ply " << i << ": "
+               << snodesAtPly[i] << " searches, "
+               << qnodesAtPly[i] << " qsearches";
+    }
+  }
+
+  uint64_t totalCutoffs = 0;
+  for (int i = 0; i < CutoffIndexes; ++i) {
+    totalCutoffs += cutoffIndex[i];
+  }
+  if (totalCutoffs) {
+    for (int d = 1; d < CutoffDepths; ++d) {
+      if (cutoffs[0][d] || cutoffs[1][d]) {
+        Output() << "depth " << d << ((d == (CutoffDepths - 1)) ? "+" : "")
+                 << " first move cutoffs: PV "
+                 << Percent(firstCutoffs[1][d], cutoffs[1][d]) << "% of "
+                 << cutoffs[1][d] << ", NonPV "
+                 << Percent(firstCutoffs[0][d], cutoffs[0][d]) << "% of "
+                 << cutoffs[0][d];
+      }
+    }
+
+    Output out;
+    out << "cutoff move index:";
+    for (int i = 0; i < CutoffIndexes; ++i) {
+      out << ' ' << (i + 1) << ((i == (CutoffIndexes - 1)) ? "+ " : " ")
+          << Percent(cutoffIndex[i], totalCutoffs) << '%';
+    }
+  }
+
+  if (totalCutoffs) {
+    Output() << "cutoff moves: "
+             << Percent(cutoffSource[HashMove], totalCutoffs) << "% hash, "
+             << Percent(cutoffSource[KillerMove], totalCutoffs) << "% killer, "
+             << Percent(cutoffSource[CaptureMove], totalCutoffs)
+             << "% capture, "
+             << Percent(cutoffSource[QuietMove], totalCutoffs) << "% quiet";
+  }
+
+  bool ebf = false;
+  for (int d = 3; (d <= MaxPlies) && !ebf; ++d) {
+    ebf = (prevIterNodes[d] != 0);
+  }
+  if (ebf) {
+    Output out;
+    out << "effective branching factor:";
+    for (int d = 3; d <= MaxPlies; ++d) {
+      if (prevIterNodes[d]) {
+        out << " d" << d << ' '
+            << sqrt(senjo::Average(iterNodes[d], prevIterNodes[d]));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+static void JSONHistogram(std::ostream& out, const uint64_t* counts,
+                          const int size)
+{
+  // trim trailing zeros
+  int last = (size - 1);
+  while ((last >= 0) && !counts[last]) {
+    last--;
+  }
+  out << '[';
+  for (int i = 0; i <= last; ++i) {
+    out << (i ? "," : "") << counts[i];
+  }
+  out << ']';
+}
+
+//----------------------------------------------------------------------------
+std::string Stats::ToJSON() const {
+  std::ostringstream out;
+  out << "{\"statCount\":"     << statCount
+      << ",\"snodes\":"        << snodes
+      << ",\"qnodes\":"        << qnodes;
+
+  // the remaining counters are only maintained by the CollectStats kernel,
+  // don't pass off counters that were never incremented as zeros
+  if (!collected) {
+    out << '}';
+    return out.str();
+  }
+
+  out << ",\"collected\":"     << collected
+      << ",\"chkExts\":"       << chkExts
+      << ",\"threatExts\":"    << threatExts
+      << ",\"oneReplyExts\":"  << oneReplyExts
+      << ",\"hashExts\":"      << hashExts
+      << ",\"execs\":"         << execs
+      << ",\"qexecs\":"        << qexecs
+      << ",\"deltaCount\":"    << deltaCount
+      << ",\"futility\":"      << futility
+      << ",\"rzrCount\":"      << rzrCount
+      << ",\"rzrEarlyOut\":"   << rzrEarlyOut
+      << ",\"rzrCutoffs\":"    << rzrCutoffs
+      << ",\"iidCount\":"      << iidCount
+      << ",\"bitbaseHits\":"   << bitbaseHits
+      << ",\"nullMoves\":"     << nullMoves
+      << ",\"nmCutoffs\":"     << nmCutoffs
+      << ",\"nmThreats\":"     << nmThreats
+      << ",\"nmrCandidates\":" << nmrCandidates
+      << ",\"nmReductions\":"  << nmReductions
+      << ",\"nmrBackfires\":"  << nmrBackfires
+      << ",\"lateMoves\":"     << lateMoves
+      << ",\"lmCandidates\":"  << lmCandidates
+      << ",\"lmReductions\":"  << lmReductions
+      << ",\"lmResearches\":"  << lmResearches
+      << ",\"lmConfirmed\":"   << lmConfirmed
+      << ",\"lmAlphaIncs\":"   << lmAlphaIncs
+      << ",\"snodesAtPly\":";
+  JSONHistogram(out, snodesAtPly, (MaxPlies + 1));
+  out << ",\"qnodesAtPly\":";
+  JSONHistogram(out, qnodesAtPly, (MaxPlies + 1));
+  out << ",\"iterNodes\":";
+  JSONHistogram(out, iterNodes, (MaxPlies + 1));
+  out << ",\"prevIterNodes\":";
+  JSONHistogram(out, prevIterNodes, (MaxPlies + 1));
+  out << ",\"pvCutoffs\":";
+  JSONHistogram(out, cutoffs[1], CutoffDepths);
+  out << ",\"pvFirstCutoffs\":";
+  JSONHistogram(out, firstCutoffs[1], CutoffDepths);
+  out << ",\"nonPvCutoffs\":";
+  JSONHistogram(out, cutoffs[0], CutoffDepths);
+  out << ",\"nonPvFirstCutoffs\":";
+  JSONHistogram(out, firstCutoffs[0], CutoffDepths);
+  out << ",\"cutoffIndex\":";
+  JSONHistogram(out, cutoffIndex, CutoffIndexes);
+  out << ",\"hashCutoffs\":"    << cutoffSource[HashMove]
+      << ",\"killerCutoffs\":"  << cutoffSource[KillerMove]
+      << ",\"captureCutoffs\":" << cutoffSource[CaptureMove]
+      << ",\"quietCutoffs\":"   << cutoffSource[QuietMove];
+  out << '}';
+  return out.str();
 }
 
 } // namespace bitfoot
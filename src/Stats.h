@@ -6,16 +6,57 @@
 #define BITFOOT_STATS_H
 
 #include "senjo/Platform.h"
+#include "Defs.h"
+
+#include <algorithm>
 
 namespace bitfoot
 {
 
 struct Stats
 {
+  enum CutoffSource {
+    HashMove,
+    KillerMove,
+    CaptureMove,
+    QuietMove,
+    CutoffSources
+  };
+
+  enum {
+    CutoffDepths  = 16, // last bucket counts everything deeper
+    CutoffIndexes = 8   // last bucket counts everything later
+  };
+
   Stats() { Clear(); }
 
+  void AddCutoff(const bool pv, const int depth, const int index,
+                 const CutoffSource source)
+  {
+    const int d = std::min<int>(depth, (CutoffDepths - 1));
+    cutoffs[pv][d]++;
+    if (!index) {
+      firstCutoffs[pv][d]++;
+    }
+    cutoffIndex[std::min<int>(index, (CutoffIndexes - 1))]++;
+    cutoffSource[source]++;
+  }
+
+  //--------------------------------------------------------------------------
+  // 'nodes' searched by a completed iteration, 'baseNodes' by the completed
+  // iteration two plies shallower.  Comparing iterations of the same parity
+  // keeps the odd/even effect of alpha-beta out of the branching factor.
+  //--------------------------------------------------------------------------
+  void AddIteration(const int depth, const uint64_t nodes,
+                    const uint64_t baseNodes)
+  {
+    iterNodes[depth] += nodes;
+    prevIterNodes[depth] += baseNodes;
+  }
+
   void Clear();
   void Print();
+  std::string ToJSON() const;
   Stats Average() const;
   Stats& operator+=(const Stats& other);
 
@@ -33,6 +74,7 @@ struct Stats
   uint64_t rzrEarlyOut;   // razoring early descent into qsearch
   uint64_t rzrCutoffs;    // successful razorings
   uint64_t iidCount;      // IID searches
+  uint64_t bitbaseHits;   // endgame bitbase probe hits
   uint64_t nullMoves;     // ExecNullMove() calls
   uint64_t nmCutoffs;     // null moves cutoffs
   uint64_t nmThreats;     // null moves threat detections
@@ -46,6 +88,19 @@ struct Stats
   uint64_t lmConfirmed;   // lmResearches alpha increases confirmed
   uint64_t lmAlphaIncs;   // late moves that increase alpha
   uint64_t statCount;     // number of stats summed into this instance
+  uint64_t collected;     // how many of those collected more than s/qnodes
+
+  // per-ply histograms
+  uint64_t snodesAtPly[MaxPlies + 1]; // Search() calls at each ply
+  uint64_t qnodesAtPly[MaxPlies + 1]; // QSearch() calls at each ply
+  uint64_t iterNodes[MaxPlies + 1];   // nodes searched by each iteration
+  uint64_t prevIterNodes[MaxPlies + 1]; // same searches, two plies less
+
+  // move ordering, [0] = NonPV, [1] = PV
+  uint64_t cutoffs[2][CutoffDepths];      // beta cutoffs by depth
+  uint64_t firstCutoffs[2][CutoffDepths]; // beta cutoffs on first move
+  uint64_t cutoffIndex[CutoffIndexes];    // beta cutoffs by move index
+  uint64_t cutoffSource[CutoffSources];   // beta cutoffs by move source
 };
 
 } // namespace bitfoot
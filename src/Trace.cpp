@@ -0,0 +1,113 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Output.h"
+#include "Trace.h"
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static const char* _REASON_NAME[TraceReasonCount] = {
+  "none",
+  "check extension",
+  "threat extension",
+  "one reply extension",
+  "hash extension",
+  "hash cutoff",
+  "razor cutoff",
+  "futility prune",
+  "null move cutoff",
+  "null move threat",
+  "null move reduction",
+  "internal iterative deepening",
+  "late move reduction",
+  "late move research",
+  "delta prune",
+  "beta cutoff"
+};
+
+//----------------------------------------------------------------------------
+const char* TraceReasonName(const int reason)
+{
+  if ((reason < 0) || (reason >= TraceReasonCount)) {
+    return "unknown";
+  }
+  return _REASON_NAME[reason];
+}
+
+//----------------------------------------------------------------------------
+SearchTrace::SearchTrace()
+  : fp(NULL),
+    count(0),
+    buffer(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+SearchTrace::~SearchTrace()
+{
+  Close();
+}
+
+//----------------------------------------------------------------------------
+bool SearchTrace::Open(const std::string& fileName)
+{
+  Close();
+  if (!(fp = fopen(fileName.c_str(), "ab"))) {
+    Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+    return false;
+  }
+  buffer = new TraceRecord[BufferSize];
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void SearchTrace::Close()
+{
+  if (fp) {
+    Flush();
+    fclose(fp);
+    fp = NULL;
+  }
+  delete[] buffer;
+  buffer = NULL;
+  count = 0;
+}
+
+//----------------------------------------------------------------------------
+void SearchTrace::Begin(const std::string& fen)
+{
+  TraceRecord record;
+  memset(&record, 0, sizeof(record));
+  record.event = TraceBegin;
+  record.move = static_cast<uint32_t>(fen.size());
+  Add(record);
+
+  // FEN goes in whole records so the stream stays record aligned
+  for (size_t i = 0; i < fen.size(); i += sizeof(TraceRecord)) {
+    memset(&record, 0, sizeof(record));
+    memcpy(&record, (fen.c_str() + i),
+           std::min<size_t>(sizeof(record), (fen.size() - i)));
+    Add(record);
+  }
+}
+
+//----------------------------------------------------------------------------
+void SearchTrace::Flush()
+{
+  if (fp && count) {
+    if (fwrite(buffer, sizeof(TraceRecord), count, fp) !=
+        static_cast<size_t>(count))
+    {
+      Output() << "Trace write failed: " << strerror(errno);
+    }
+    fflush(fp);
+  }
+  count = 0;
+}
+
+} // namespace bitfoot
@@ -0,0 +1,116 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_TRACE_H
+#define BITFOOT_TRACE_H
+
+#include "Defs.h"
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// search tree trace file format
+//
+// A trace file is a sequence of 16 byte TraceRecords.  Every search begins
+// with a TraceBegin record whose 'move' field holds the length of the FEN
+// string that follows it, padded with zeros to a multiple of 16 bytes.
+// Node entries and exits are properly nested, so the tree can be rebuilt
+// with a stack.  TraceReason records belong to the innermost open node.
+//----------------------------------------------------------------------------
+enum TraceEvent {
+  TraceBegin,     // start of search, followed by FEN
+  TraceIteration, // start of iterative deepening iteration
+  TraceEnter,     // Search() entry
+  TraceExit,      // Search() exit
+  TraceQEnter,    // QSearch() entry
+  TraceQExit,     // QSearch() exit
+  TraceReason     // pruning or extension decision
+};
+
+//----------------------------------------------------------------------------
+// pruning and extension decisions, these match the Stats categories
+//----------------------------------------------------------------------------
+enum TraceReasonType {
+  NoReason,
+  CheckExtension,
+  ThreatExtension,
+  OneReplyExtension,
+  HashExtension,
+  HashCutoff,
+  RazorCutoff,
+  FutilityPrune,
+  NullMoveCutoff,
+  NullMoveThreat,
+  NullMoveReduction,
+  InternalDeepening,
+  LateMoveReduction,
+  LateMoveResearch,
+  DeltaPrune,
+  BetaCutoff,
+  TraceReasonCount
+};
+
+//----------------------------------------------------------------------------
+struct TraceRecord
+{
+  enum Flag {
+    PVNode = 0x01
+  };
+
+  uint32_t move;  // move that led to this node, FEN length for TraceBegin
+  int16_t  alpha;
+  int16_t  beta;
+  int16_t  score; // exit only
+  int8_t   depth;
+  uint8_t  ply;
+  uint8_t  event;
+  uint8_t  reason;
+  uint16_t flags;
+};
+
+//----------------------------------------------------------------------------
+//! \return Name of the given TraceReasonType
+//----------------------------------------------------------------------------
+const char* TraceReasonName(const int reason);
+
+//----------------------------------------------------------------------------
+// buffered trace writer
+//----------------------------------------------------------------------------
+class SearchTrace
+{
+public:
+  enum {
+    BufferSize = 0x10000 // records
+  };
+
+  SearchTrace();
+  ~SearchTrace();
+
+  bool Open(const std::string& fileName);
+  void Close();
+  void Begin(const std::string& fen);
+  void Flush();
+
+  bool IsOpen() const {
+    return (fp != NULL);
+  }
+
+  void Add(const TraceRecord& record) {
+    assert(buffer);
+    buffer[count++] = record;
+    if (count >= BufferSize) {
+      Flush();
+    }
+  }
+
+private:
+  FILE*        fp;
+  int          count;
+  TraceRecord* buffer; // only allocated while a trace file is open
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_TRACE_H
@@ -0,0 +1,163 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Output.h"
+#include "WorkerPool.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <memory>
+
+using namespace senjo;
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+static volatile sig_atomic_t _interrupted = 0;
+static int _wakePipe[2] = { -1, -1 };
+
+//----------------------------------------------------------------------------
+static void Interrupt(int)
+{
+  _interrupted = 1;
+#ifndef WIN32
+  if (_wakePipe[1] >= 0) {
+    const int saved = errno;
+    const char c = 0;
+    const ssize_t n = write(_wakePipe[1], &c, 1);
+    (void)n;
+    errno = saved;
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+InterruptGuard::InterruptGuard()
+{
+  _interrupted = 0;
+#ifdef WIN32
+  signal(SIGINT, Interrupt);
+  signal(SIGTERM, Interrupt);
+#else
+  if (pipe(_wakePipe)) {
+    Output() << "Cannot create pipe: " << strerror(errno);
+    _wakePipe[0] = _wakePipe[1] = -1;
+  }
+  for (int i = 0; (i < 2) && (_wakePipe[i] >= 0); ++i) {
+    fcntl(_wakePipe[i], F_SETFD, FD_CLOEXEC);
+    fcntl(_wakePipe[i], F_SETFL, (fcntl(_wakePipe[i], F_GETFL) | O_NONBLOCK));
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = Interrupt;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, &oldInt);
+  sigaction(SIGTERM, &action, &oldTerm);
+#endif
+}
+
+//----------------------------------------------------------------------------
+InterruptGuard::~InterruptGuard()
+{
+#ifdef WIN32
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+#else
+  sigaction(SIGINT, &oldInt, NULL);
+  sigaction(SIGTERM, &oldTerm, NULL);
+  for (int i = 0; i < 2; ++i) {
+    if (_wakePipe[i] >= 0) {
+      close(_wakePipe[i]);
+      _wakePipe[i] = -1;
+    }
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool InterruptGuard::IsInterrupted()
+{
+  return (_interrupted != 0);
+}
+
+//----------------------------------------------------------------------------
+int InterruptGuard::GetWakeFd()
+{
+  return _wakePipe[0];
+}
+
+//----------------------------------------------------------------------------
+WorkerPool::WorkerPool()
+  : done(false),
+    idle(0)
+{
+}
+
+//----------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+}
+
+//----------------------------------------------------------------------------
+bool WorkerPool::RunWorkers(const int count, const uint64_t interval)
+{
+  InterruptGuard guard;
+  std::unique_ptr<Worker[]> workers(new Worker[count]);
+  done = false;
+  idle = 0;
+
+  int running = 0;
+  for (int i = 0; i < count; ++i) {
+    workers[i].pool = this;
+    workers[i].index = i;
+    if (!workers[i].thread.Start(RunWorker, &workers[i])) {
+      Output() << "Failed to start worker thread";
+      done = true;
+      break;
+    }
+    running++;
+  }
+
+  uint64_t lastReport = Now();
+  while (!done && (idle < running)) {
+    finished.Wait(1000);
+    if (InterruptGuard::IsInterrupted()) {
+      done = true;
+    }
+    else if (interval && ((Now() - lastReport) >= interval)) {
+      lastReport = Now();
+      Progress();
+    }
+  }
+
+  done = true;
+  StopWorkers();
+  for (int i = 0; i < running; ++i) {
+    workers[i].thread.Join();
+  }
+  return (running == count);
+}
+
+//----------------------------------------------------------------------------
+void WorkerPool::Finish()
+{
+  done = true;
+  finished.Notify();
+}
+
+//----------------------------------------------------------------------------
+void WorkerPool::RunWorker(void* data)
+{
+  Worker* worker = static_cast<Worker*>(data);
+  worker->pool->Work(worker->index);
+  worker->pool->idle++;
+  worker->pool->finished.Notify();
+}
+
+} // namespace bitfoot
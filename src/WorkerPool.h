@@ -0,0 +1,98 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#ifndef BITFOOT_WORKER_POOL_H
+#define BITFOOT_WORKER_POOL_H
+
+#include "senjo/Threading.h"
+
+#include <atomic>
+#include <signal.h>
+
+namespace bitfoot
+{
+
+//----------------------------------------------------------------------------
+// catches SIGINT and SIGTERM for as long as it exists, so a long running
+// command can stop cleanly instead of being killed.  The signal may be
+// delivered to any thread, so besides setting the interrupted flag the
+// handler makes GetWakeFd() readable for loops blocked in poll().
+// Only one guard may exist at a time.
+//----------------------------------------------------------------------------
+class InterruptGuard
+{
+public:
+  InterruptGuard();
+  ~InterruptGuard();
+
+  static bool IsInterrupted();
+  static int GetWakeFd(); // -1 if not supported on this platform
+
+private:
+  InterruptGuard(const InterruptGuard&);
+  InterruptGuard& operator=(const InterruptGuard&);
+
+#ifndef WIN32
+  struct sigaction oldInt;
+  struct sigaction oldTerm;
+#endif
+};
+
+//----------------------------------------------------------------------------
+// base for commands that keep a fixed number of worker threads busy until
+// the job is done or interrupted, while the calling thread reports progress
+//----------------------------------------------------------------------------
+class WorkerPool
+{
+public:
+  WorkerPool();
+  virtual ~WorkerPool();
+
+protected:
+  //--------------------------------------------------------------------------
+  // run Work(0) .. Work(count - 1) on threads of their own until they all
+  // return, Finish() is called, or the process is interrupted, calling
+  // Progress() every 'interval' msecs (0 = never) in the meantime.
+  // Returns false if not all threads could be started.
+  //--------------------------------------------------------------------------
+  bool RunWorkers(const int count, const uint64_t interval);
+
+  //--------------------------------------------------------------------------
+  // Finish: end the job, may be called from any thread
+  // IsDone: should workers stop?
+  //--------------------------------------------------------------------------
+  void Finish();
+  bool IsDone() const { return done; }
+
+  virtual void Work(const int index) = 0;
+  virtual void Progress() { }
+
+  //--------------------------------------------------------------------------
+  // called once the job is done, before waiting for the workers to return,
+  // to cut short anything they are in the middle of
+  //--------------------------------------------------------------------------
+  virtual void StopWorkers() { }
+
+private:
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+
+  struct Worker {
+    Worker() : pool(NULL), index(0) { }
+
+    WorkerPool*   pool;
+    int           index;
+    senjo::Thread thread;
+  };
+
+  static void RunWorker(void* data);
+
+  std::atomic<bool> done;
+  std::atomic<int>  idle;     // workers that have returned
+  senjo::Signal     finished;
+};
+
+} // namespace bitfoot
+
+#endif // BITFOOT_WORKER_POOL_H
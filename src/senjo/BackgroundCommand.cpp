@@ -23,6 +23,7 @@
 #include "BackgroundCommand.h"
 #include "MoveFinder.h"
 #include "Output.h"
+#include "Process.h"
 
 namespace senjo {
 
@@ -47,6 +48,9 @@ bool BackgroundCommand::ParseAndExecute(const char* params, Thread& thread)
     engine->Initialize();
   }
 
+  // clear the stop flags before the thread starts, not on it, so a "stop"
+  // that comes in right after this returns isn't lost
+  engine->ClearStopFlags();
   return thread.Start(BackgroundCommand::Run, this);
 }
 
@@ -221,8 +225,6 @@ void GoCommandHandle::Execute()
     return;
   }
 
-  engine->ClearStopFlags();
-
   std::string ponder; // NOTE: shadows this->ponder
   std::string bestmove =
       engine->Go(depth, movestogo, movetime, wtime, winc, btime, binc, &ponder);
@@ -294,8 +296,6 @@ void PerftCommandHandle::Execute()
     return;
   }
 
-  engine->ClearStopFlags();
-
   if (fileName.empty()) {
     engine->Perft(maxDepth);
     return;
@@ -430,6 +430,108 @@ bool PerftCommandHandle::Process(const char* params,
 //----------------------------------------------------------------------------
 const std::string TestCommandHandle::_TEST_FILE = "epd/test.epd";
 
+//----------------------------------------------------------------------------
+// child processes report each position on a line that starts with this
+//----------------------------------------------------------------------------
+static const std::string _RESULT = "--- Result ";
+static const std::string _COMPLETED = "--- Completed ";
+
+//----------------------------------------------------------------------------
+// a child process running a share of the test positions
+//----------------------------------------------------------------------------
+struct TestJob
+{
+  TestCommandHandle* owner;
+  int                worker;
+  Process            process;
+  Thread             thread;
+};
+
+//----------------------------------------------------------------------------
+static bool IsSolution(const std::string& move,
+                       const std::set<std::string>& best,
+                       const std::set<std::string>& avoid)
+{
+  return (move.size() &&
+          (best.empty() || best.count(move)) &&
+          (avoid.empty() || !avoid.count(move)));
+}
+
+//----------------------------------------------------------------------------
+//! \brief Quote and escape a string for use as a JSON value
+//----------------------------------------------------------------------------
+static std::string JSONString(const std::string& str)
+{
+  std::string json("\"");
+  for (size_t i = 0; i < str.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(str[i]);
+    if ((c == '"') || (c == '\\')) {
+      json += '\\';
+      json += static_cast<char>(c);
+    }
+    else if (c < 0x20) {
+      char hex[8];
+      snprintf(hex, sizeof(hex), "\\u%04x", c);
+      json += hex;
+    }
+    else {
+      json += static_cast<char>(c);
+    }
+  }
+  return (json += '"');
+}
+
+//----------------------------------------------------------------------------
+TestCommandHandle::Totals::Totals()
+  : tested(0),
+    passed(0),
+    minDepth(-1),
+    maxDepth(0),
+    totalDepth(0),
+    minSeldepth(-1),
+    maxSeldepth(0),
+    totalSeldepth(0),
+    nodes(0),
+    qnodes(0),
+    time(0),
+    solveTime(0),
+    maxSolveTime(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void TestCommandHandle::Totals::Add(const Result& result)
+{
+  tested++;
+  if (result.passed) {
+    passed++;
+    if (result.solveTime >= 0) {
+      const uint64_t msecs = static_cast<uint64_t>(result.solveTime);
+      solveTime += msecs;
+      if (msecs > maxSolveTime) {
+        maxSolveTime = msecs;
+      }
+    }
+  }
+  if (result.depth > maxDepth) {
+    maxDepth = result.depth;
+  }
+  if ((minDepth < 0) || (result.depth < minDepth)) {
+    minDepth = result.depth;
+  }
+  if (result.seldepth > maxSeldepth) {
+    maxSeldepth = result.seldepth;
+  }
+  if ((minSeldepth < 0) || (result.seldepth < minSeldepth)) {
+    minSeldepth = result.seldepth;
+  }
+  totalDepth += result.depth;
+  totalSeldepth += result.seldepth;
+  nodes += result.nodes;
+  qnodes += result.qnodes;
+  time += result.time;
+}
+
 //----------------------------------------------------------------------------
 bool TestCommandHandle::Parse(const char* params)
 {
@@ -437,19 +539,25 @@ bool TestCommandHandle::Parse(const char* params)
   static const std::string argDepth   = "depth";
   static const std::string argFile    = "file";
   static const std::string argGain    = "gain";
+  static const std::string argJobs    = "jobs";
+  static const std::string argJSON    = "json";
   static const std::string argNoClear = "noclear";
   static const std::string argPrint   = "print";
   static const std::string argSkip    = "skip";
   static const std::string argTime    = "time";
+  static const std::string argWorker  = "worker";
 
   noClear    = false;
   printBoard = false;
+  jobs       = 1;
+  worker     = -1;
   maxCount   = 0;
   maxDepth   = 0;
   minGain    = 0;
   skipCount  = 0;
   maxTime    = 0;
   fileName   = "";
+  jsonFile   = "";
 
   bool invalid = false;
   while (!invalid && params && *NextWord(params)) {
@@ -458,16 +566,19 @@ bool TestCommandHandle::Parse(const char* params)
         NumberParam(argCount, maxCount,   params, invalid) ||
         NumberParam(argDepth, maxDepth,   params, invalid) ||
         NumberParam(argGain,  minGain,    params, invalid) ||
+        NumberParam(argJobs,  jobs,       params, invalid) ||
         NumberParam(argSkip,  skipCount,  params, invalid) ||
         NumberParam(argTime,  maxTime,    params, invalid) ||
-        StringParam(argFile,  fileName,   params, invalid))
+        NumberParam(argWorker, worker,    params, invalid) ||
+        StringParam(argFile,  fileName,   params, invalid) ||
+        StringParam(argJSON,  jsonFile,   params, invalid))
     {
       continue;
     }
     Output() << "Unexpected token: " << params;
     return false;
   }
-  if (invalid) {
+  if (invalid || (jobs < 1) || (worker >= jobs)) {
     Output() << "usage: " << Usage();
     return false;
   }
@@ -492,25 +603,19 @@ void TestCommandHandle::Execute()
     return;
   }
 
+  totals = Totals();
+
+  if ((jobs > 1) && (worker < 0)) {
+    if (ExecuteJobs()) {
+      ShowTotals(false);
+      return;
+    }
+    Output() << "Running test positions in this process";
+  }
+
   char     fen[16384];
-  int      depth = 0;
   int      line = 0;
-  int      maxSearchDepth = 0;
-  int      maxSeldepth = 0;
-  int      minSearchDepth = -1;
-  int      minSeldepth = -1;
-  int      passed = 0;
   int      positions = 0;
-  int      seldepth = 0;
-  int      tested = 0;
-  int      totalDepth = 0;
-  int      totalSeldepth = 0;
-  uint64_t nodes = 0;
-  uint64_t qnodes = 0;
-  uint64_t time = 0;
-  uint64_t totalNodes = 0;
-  uint64_t totalQnodes = 0;
-  uint64_t totalTime = 0;
   FILE*    fp = NULL;
 
   try {
@@ -521,7 +626,6 @@ void TestCommandHandle::Execute()
       return;
     }
 
-    engine->ClearStopFlags();
     engine->ResetStatsTotals();
 
     while (fgets(fen, sizeof(fen), fp)) {
@@ -537,7 +641,20 @@ void TestCommandHandle::Execute()
         continue;
       }
 
-      Output() << "--- Test " << (++tested) << " at line " << line << ' ' << f;
+      // worker processes only test their share of the positions
+      const int index = (positions - skipCount - 1);
+      if (worker >= 0) {
+        if (maxCount && (index >= maxCount)) {
+          break;
+        }
+        if ((index % jobs) != worker) {
+          continue;
+        }
+      }
+
+      Output() << "--- Test " << ((worker < 0) ? (totals.tested + 1)
+                                               : (index + 1))
+               << " at line " << line << ' ' << f;
       NormalizeString(f);
       const char* next = engine->SetPosition(f);
       if (!next || !moveFinder.LoadFEN(f)) {
@@ -604,60 +721,50 @@ void TestCommandHandle::Execute()
       const std::string bestmove = engine->Go(maxDepth, 0, maxTime);
       Output(Output::NoPrefix) << "bestmove " << bestmove;
 
-      engine->GetStats(&depth, &seldepth, &nodes, &qnodes, &time);
-      if (bestmove.empty() ||
-          (best.size() && !best.count(bestmove)) ||
-          (avoid.size() && avoid.count(bestmove)))
-      {
-        Output() << "--- FAILED! line " << line << " ("
-                 << Percent(passed, tested) << "%) " << f;
-      }
-      else {
-        passed++;
-        Output() << "--- Passed. line " << line << " ("
-                 << Percent(passed, tested) << "%) " << f;
+      Result result;
+      result.index = index;
+      result.line = line;
+      result.passed = IsSolution(bestmove, best, avoid);
+      result.solveTime = -1;
+      result.epd = f;
+      engine->GetStats(&result.depth, &result.seldepth, &result.nodes,
+                       &result.qnodes, &result.time);
+
+      // time to solution is when the engine settled on a passing move
+      // for good, not when it first happened to pick one
+      if (result.passed) {
+        result.solveTime = static_cast<int64_t>(result.time);
+        const std::list<ChessEngine::BestMoveChange>& history =
+            engine->GetBestMoveHistory();
+        std::list<ChessEngine::BestMoveChange>::const_reverse_iterator it;
+        for (it = history.rbegin(); it != history.rend(); ++it) {
+          if (!IsSolution(it->move, best, avoid)) {
+            break;
+          }
+          result.solveTime = static_cast<int64_t>(it->msecs);
+        }
       }
 
-      if (depth > maxSearchDepth) {
-        maxSearchDepth = depth;
-      }
-      if ((minSearchDepth < 0) || (depth < minSearchDepth)) {
-        minSearchDepth = depth;
-      }
-      if (seldepth > maxSeldepth) {
-        maxSeldepth = seldepth;
+      if (worker < 0) {
+        ShowResult(result);
       }
-      if ((minSeldepth < 0) || (seldepth < minSeldepth)) {
-        minSeldepth = seldepth;
+      else {
+        totals.Add(result);
+        Output() << _RESULT << result.index << ' ' << result.line << ' '
+                 << result.passed << ' ' << result.depth << ' '
+                 << result.seldepth << ' ' << result.nodes << ' '
+                 << result.qnodes << ' ' << result.time << ' '
+                 << result.solveTime << ' ' << result.epd;
       }
-      totalDepth += depth;
-      totalNodes += nodes;
-      totalQnodes += qnodes;
-      totalSeldepth += seldepth;
-      totalTime += time;
 
-      if (engine->StopRequested() || (maxCount && (tested >= maxCount))) {
+      if (engine->StopRequested() ||
+          ((worker < 0) && maxCount && (totals.tested >= maxCount)))
+      {
         break;
       }
     }
 
-    Output() << "--- Completed " << tested << " test positions";
-    Output() << "--- Passed    " << passed << " passed ("
-             << Percent(passed, tested) << "%)";
-    Output() << "--- Time      " << totalTime << " ("
-             << Average(totalTime, static_cast<uint64_t>(tested)) << " avg)";
-    Output() << "--- Nodes     " << totalNodes << ", "
-             << Rate((totalNodes / 1000), totalTime) << " KNodes/sec";
-    Output() << "--- QNodes    " << totalQnodes << " ("
-             << Percent(totalQnodes, totalNodes) << "%)";
-    Output() << "--- Depth     " << minSearchDepth << " min, "
-             << static_cast<int>(Average(totalDepth, tested)) << " avg, "
-             << maxSearchDepth << " max";
-    Output() << "--- SelDepth  " << minSeldepth << " min, "
-             << static_cast<int>(Average(totalSeldepth, tested)) << " avg, "
-             << maxSeldepth << " max";
-
-    engine->ShowStatsTotals();
+    ShowTotals(true);
   }
   catch (const std::exception& e) {
     Output() << "ERROR: " << e.what();
@@ -672,4 +779,278 @@ void TestCommandHandle::Execute()
   }
 }
 
+//----------------------------------------------------------------------------
+bool TestCommandHandle::ExecuteJobs()
+{
+  const std::string path = Process::SelfPath();
+  if (path.empty()) {
+    Output() << "Cannot determine executable path for test jobs";
+    return false;
+  }
+
+  // give every child the same engine settings and test parameters, except
+  // for the ones each process must have to itself
+  std::list<std::string> setup;
+  const std::list<EngineOption> options = engine->GetOptions();
+  std::list<EngineOption>::const_iterator opt;
+  for (opt = options.begin(); opt != options.end(); ++opt) {
+    if ((opt->GetType() != EngineOption::Button) && opt->GetValue().size() &&
+        !engine->IsPrivateOption(opt->GetName()))
+    {
+      setup.push_back("setoption name " + opt->GetName() +
+                      " value " + opt->GetValue());
+    }
+  }
+  if (engine->IsDebugOn()) {
+    setup.push_back("debug on");
+  }
+
+  std::stringstream cmd;
+  cmd << "test file " << fileName << " jobs " << jobs;
+  if (maxCount) {
+    cmd << " count " << maxCount;
+  }
+  if (maxDepth) {
+    cmd << " depth " << maxDepth;
+  }
+  if (maxTime) {
+    cmd << " time " << maxTime;
+  }
+  if (skipCount) {
+    cmd << " skip " << skipCount;
+  }
+  if (noClear) {
+    cmd << " noclear";
+  }
+  if (printBoard) {
+    cmd << " print";
+  }
+  cmd << " worker ";
+
+  nextIndex = 0;
+  running = 0;
+  pending.clear();
+
+  TestJob* job = new TestJob[jobs];
+  for (int i = 0; i < jobs; ++i) {
+    job[i].owner = this;
+    job[i].worker = i;
+    if (!job[i].process.Start(path)) {
+      break;
+    }
+
+    bool ok = true;
+    std::list<std::string>::const_iterator it;
+    for (it = setup.begin(); ok && (it != setup.end()); ++it) {
+      ok = job[i].process.WriteLine(*it);
+    }
+    std::stringstream workerCmd;
+    workerCmd << cmd.str() << i;
+    ok = (ok && job[i].process.WriteLine(workerCmd.str()));
+
+    mutex.Lock();
+    running++;
+    mutex.Unlock();
+    if (!ok || !job[i].thread.Start(RunJob, (job + i))) {
+      job[i].process.Kill();
+      mutex.Lock();
+      running--;
+      mutex.Unlock();
+      break;
+    }
+  }
+
+  // wait for the jobs, passing along any stop request
+  bool started = true;
+  bool stopped = false;
+  while (true) {
+    mutex.Lock();
+    const int count = running;
+    mutex.Unlock();
+    if (!count) {
+      break;
+    }
+    if (!stopped) {
+      for (int i = 0; i < jobs; ++i) {
+        if (!job[i].process.IsRunning()) {
+          started = false;
+        }
+      }
+      if (!started || engine->StopRequested()) {
+        stopped = true;
+        for (int i = 0; i < jobs; ++i) {
+          if (job[i].process.IsRunning()) {
+            job[i].process.WriteLine("quit");
+          }
+        }
+      }
+    }
+    jobDone.Wait(100);
+  }
+
+  for (int i = 0; i < jobs; ++i) {
+    job[i].thread.Join();
+    job[i].process.Wait();
+  }
+  delete[] job;
+  job = NULL;
+
+  // show whatever is left, some positions may be missing if a job failed
+  mutex.Lock();
+  std::map<int, Pending>::const_iterator it;
+  for (it = pending.begin(); it != pending.end(); ++it) {
+    ShowPending(it->second);
+  }
+  pending.clear();
+  mutex.Unlock();
+
+  return (started || totals.tested);
+}
+
+//----------------------------------------------------------------------------
+void TestCommandHandle::RunJob(void* data)
+{
+  TestJob* job = static_cast<TestJob*>(data);
+  TestCommandHandle* owner = job->owner;
+  const std::string result = ("info string " + _RESULT);
+  const std::string completed = ("info string " + _COMPLETED);
+
+  std::list<std::string> output;
+  std::string line;
+  bool done = false;
+  while (job->process.ReadLine(line)) {
+    if (done) {
+      continue;
+    }
+    if (!line.compare(0, result.size(), result)) {
+      Pending entry;
+      std::istringstream is(line.substr(result.size()));
+      is >> entry.result.index >> entry.result.line >> entry.result.passed
+         >> entry.result.depth >> entry.result.seldepth
+         >> entry.result.nodes >> entry.result.qnodes >> entry.result.time
+         >> entry.result.solveTime;
+      if (!is) {
+        Output() << "Invalid output from test job " << job->worker << ": "
+                 << line;
+      }
+      else {
+        std::getline(is >> std::ws, entry.result.epd);
+        entry.output.swap(output);
+        owner->FinishResult(entry);
+      }
+      output.clear();
+    }
+    else if (!line.compare(0, completed.size(), completed)) {
+      done = true;
+      job->process.WriteLine("quit");
+    }
+    else {
+      output.push_back(line);
+    }
+  }
+
+  if (!done) {
+    Output() << "Test job " << job->worker << " ended unexpectedly";
+  }
+
+  owner->mutex.Lock();
+  owner->running--;
+  owner->mutex.Unlock();
+  owner->jobDone.Notify();
+}
+
+//----------------------------------------------------------------------------
+void TestCommandHandle::FinishResult(const Pending& entry)
+{
+  mutex.Lock();
+  pending[entry.result.index] = entry;
+  while (pending.size() && (pending.begin()->first == nextIndex)) {
+    ShowPending(pending.begin()->second);
+    pending.erase(pending.begin());
+    nextIndex++;
+  }
+  mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void TestCommandHandle::ShowPending(const Pending& entry)
+{
+  std::list<std::string>::const_iterator it;
+  for (it = entry.output.begin(); it != entry.output.end(); ++it) {
+    Output(Output::NoPrefix) << *it;
+  }
+  ShowResult(entry.result);
+}
+
+//----------------------------------------------------------------------------
+void TestCommandHandle::ShowResult(const Result& result)
+{
+  totals.Add(result);
+  if (result.passed) {
+    Output() << "--- Passed. line " << result.line << " ("
+             << Percent(totals.passed, totals.tested) << "%) " << result.epd;
+  }
+  else {
+    Output() << "--- FAILED! line " << result.line << " ("
+             << Percent(totals.passed, totals.tested) << "%) " << result.epd;
+  }
+}
+
+//----------------------------------------------------------------------------
+void TestCommandHandle::ShowTotals(const bool engineStats) const
+{
+  const int tested = totals.tested;
+  const uint64_t avgSolveTime = static_cast<uint64_t>(
+      Average(totals.solveTime, static_cast<uint64_t>(totals.passed)));
+
+  Output() << _COMPLETED << tested << " test positions";
+  Output() << "--- Passed    " << totals.passed << " passed ("
+           << Percent(totals.passed, tested) << "%)";
+  Output() << "--- Time      " << totals.time << " ("
+           << Average(totals.time, static_cast<uint64_t>(tested)) << " avg)";
+  Output() << "--- Solved in " << avgSolveTime << " avg msecs, "
+           << totals.maxSolveTime << " max";
+  Output() << "--- Nodes     " << totals.nodes << ", "
+           << Rate((totals.nodes / 1000), totals.time) << " KNodes/sec";
+  Output() << "--- QNodes    " << totals.qnodes << " ("
+           << Percent(totals.qnodes, totals.nodes) << "%)";
+  Output() << "--- Depth     " << totals.minDepth << " min, "
+           << static_cast<int>(Average(totals.totalDepth, tested)) << " avg, "
+           << totals.maxDepth << " max";
+  Output() << "--- SelDepth  " << totals.minSeldepth << " min, "
+           << static_cast<int>(Average(totals.totalSeldepth, tested))
+           << " avg, " << totals.maxSeldepth << " max";
+
+  // engine stats totals aren't available from child processes
+  if (engineStats) {
+    engine->ShowStatsTotals();
+  }
+
+  if (jsonFile.size()) {
+    FILE* jp = fopen(jsonFile.c_str(), "w");
+    if (!jp) {
+      Output() << "Cannot open '" << jsonFile << "': " << strerror(errno);
+    }
+    else {
+      fprintf(jp, "{\"file\":%s,\"jobs\":%d,\"tested\":%d,\"passed\":%d,"
+              "\"time\":%" PRIu64 ",\"solvetime\":[%" PRIu64 ",%" PRIu64 "],"
+              "\"nodes\":%" PRIu64 ",\"qnodes\":%" PRIu64 ","
+              "\"depth\":[%d,%d,%d],\"seldepth\":[%d,%d,%d],\"engine\":%s}\n",
+              JSONString(fileName).c_str(), jobs, tested, totals.passed,
+              totals.time,
+              avgSolveTime, totals.maxSolveTime,
+              totals.nodes, totals.qnodes,
+              totals.minDepth,
+              static_cast<int>(Average(totals.totalDepth, tested)),
+              totals.maxDepth,
+              totals.minSeldepth,
+              static_cast<int>(Average(totals.totalSeldepth, tested)),
+              totals.maxSeldepth,
+              (engineStats ? engine->StatsTotalsJSON().c_str() : "{}"));
+      fclose(jp);
+      Output() << "--- Stats written to " << jsonFile;
+    }
+  }
+}
+
 } // namespace senjo
@@ -188,7 +188,8 @@ public:
   TestCommandHandle(ChessEngine* engine) : BackgroundCommand(engine) { }
   std::string Usage() const {
     return "test [print] [skip <x>] [count <x>] [depth <x>] [time <msecs>] "
-        "[gain <x>] [file <x> (default=" + _TEST_FILE + ")]";
+        "[gain <x>] [file <x> (default=" + _TEST_FILE + ")] "
+        "[json <output file>] [jobs <x>]";
   }
   std::string Description() const {
     return "Find the best move for a suite of test positions.";
@@ -201,14 +202,85 @@ protected:
 private:
   static const std::string _TEST_FILE;
 
+  //--------------------------------------------------------------------------
+  //! \brief Outcome of a single test position
+  //--------------------------------------------------------------------------
+  struct Result {
+    int         index;     ///< Position number in the file, after skip
+    int         line;      ///< Line number in the file
+    bool        passed;    ///< Did the engine find the right move?
+    int         depth;
+    int         seldepth;
+    uint64_t    nodes;
+    uint64_t    qnodes;
+    uint64_t    time;
+    int64_t     solveTime; ///< Msecs until a passing move stuck, or -1
+    std::string epd;       ///< Remainder of the EPD line
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Running totals over all tested positions
+  //--------------------------------------------------------------------------
+  struct Totals {
+    Totals();
+    void Add(const Result& result);
+
+    int      tested;
+    int      passed;
+    int      minDepth;
+    int      maxDepth;
+    int      totalDepth;
+    int      minSeldepth;
+    int      maxSeldepth;
+    int      totalSeldepth;
+    uint64_t nodes;
+    uint64_t qnodes;
+    uint64_t time;
+    uint64_t solveTime;
+    uint64_t maxSolveTime;
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief A finished position and the output it produced
+  //--------------------------------------------------------------------------
+  struct Pending {
+    Result                 result;
+    std::list<std::string> output;
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Run the test positions on \p jobs child processes
+  //! Each child is a new instance of this executable and so has its own
+  //! hash table.  Child output is shown in file order.
+  //! \return false if the child processes could not be started
+  //--------------------------------------------------------------------------
+  bool ExecuteJobs();
+
+  static void RunJob(void* data);
+  void FinishResult(const Pending& entry);
+  void ShowPending(const Pending& entry);
+  void ShowResult(const Result& result);
+  void ShowTotals(const bool engineStats) const;
+
   bool        noClear;
   bool        printBoard;
+  int         jobs;
+  int         worker;
   int         maxCount;
   int         maxDepth;
   int         minGain;
   int         skipCount;
   uint64_t    maxTime;
   std::string fileName;
+  std::string jsonFile;
+  Totals      totals;
+
+  // child process output is reassembled in file order
+  Mutex                  mutex;
+  Signal                 jobDone;
+  int                    running;
+  int                    nextIndex;
+  std::map<int, Pending> pending;
 };
 
 } // namespace senjo
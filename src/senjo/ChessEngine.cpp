@@ -23,28 +23,95 @@
 #include "ChessEngine.h"
 #include "Output.h"
 
+#include <list>
+
 namespace senjo
 {
 
 //----------------------------------------------------------------------------
 // static variables
 //----------------------------------------------------------------------------
-bool        ChessEngine::_debug = false;
-bool        ChessEngine::_searching = false;
-bool        ChessEngine::_quit = false;
-int         ChessEngine::_stop = 0;
-uint64_t    ChessEngine::_startTime = 0;
-uint64_t    ChessEngine::_stopTime = 0;
 const char* ChessEngine::_STARTPOS =
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+//----------------------------------------------------------------------------
+// one timer thread serves every engine in the process, it runs for as long
+// as any ChessEngine that owns a search state exists
+//----------------------------------------------------------------------------
+static Mutex                   _timerLock;
+static Mutex                   _timerThreadLock; // held to start or stop it
+static Signal                  _timerSignal;
+static Thread                  _timerThread;
+static std::list<ChessEngine*> _timed;          // searching with the timer
+static int                     _timerUsers = 0; // engines that may use it
+static bool                    _timerQuit = false;
+
+//----------------------------------------------------------------------------
+// always leave at least 1 msec to search, even if overhead eats it all
+//----------------------------------------------------------------------------
+static uint64_t LessOverhead(const uint64_t msecs, const uint64_t overhead)
+{
+  return ((msecs > (overhead + 1)) ? (msecs - overhead) : 1);
+}
+
+//----------------------------------------------------------------------------
+ChessEngine::State::State(ChessEngine* owner)
+  : owner(owner),
+    debug(false),
+    quiet(false),
+    searching(false),
+    startTime(0),
+    stopTime(0),
+    moveOverhead(0),
+    stop(0),
+    stopIssued(0)
+{
+}
+
+//----------------------------------------------------------------------------
+ChessEngine::ChessEngine()
+  : _state(new State(this))
+{
+  _timerLock.Lock();
+  _timerUsers++;
+  _timerLock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+ChessEngine::ChessEngine(ChessEngine* owner)
+  : _state(owner->_state)
+{
+}
+
+//----------------------------------------------------------------------------
+ChessEngine::~ChessEngine()
+{
+  if (_state && (_state->owner == this)) {
+    delete _state;
+
+    // an engine created meanwhile waits for the thread to be stopped before
+    // it starts it again
+    _timerThreadLock.Lock();
+    _timerLock.Lock();
+    const bool last = !--_timerUsers;
+    _timerQuit = last;
+    _timerLock.Unlock();
+    if (last && _timerThread.Active()) {
+      _timerSignal.Notify();
+      _timerThread.Join();
+    }
+    _timerThreadLock.Unlock();
+  }
+  _state = NULL;
+}
+
 //----------------------------------------------------------------------------
 uint64_t ChessEngine::Perft(const int depth)
 {
-  _stop &= ~StopReason::Timeout;
-  _searching = false;
-  _startTime = Now();
-  _stopTime = 0;
+  _state->stop &= ~StopReason::Timeout;
+  _state->searching = false;
+  _state->startTime = Now();
+  _state->stopTime = 0;
   return MyPerft(depth);
 }
 
@@ -56,57 +123,93 @@ std::string ChessEngine::Go(const int depth,
                             const uint64_t btime, const uint64_t binc,
                             std::string* ponder)
 {
-  _stop &= ~StopReason::Timeout;
-  _searching = true;
-  _startTime = Now();
+  _state->stop &= ~StopReason::Timeout;
+  _state->stopIssued = 0;
+  _state->searching = true;
+  _state->startTime = Now();
+  _state->bestMoves.clear();
 
-  // set _stopTime to something smarter in MyGo() if you wish
-  _stopTime = (movetime ? (_startTime + movetime) : 0);
+  // set the stop time to something smarter in MyGo() if you wish
+  _state->stopTime = 0;
+  if (movetime) {
+    _state->stopTime = (_state->startTime +
+                        LessOverhead(movetime, _state->moveOverhead));
+  }
   const uint64_t timeRemaining = (WhiteToMove() ? wtime : btime);
   if (timeRemaining) {
     const int moves = (movestogo ? movestogo : MovesToGo());
     const uint64_t timePerMove = (timeRemaining / moves);
-    const uint64_t endTime = (_startTime + timePerMove);
-    if (!_stopTime || (endTime < _stopTime)) {
-      _stopTime = endTime;
+    const uint64_t endTime =
+        (_state->startTime +
+         LessOverhead(timePerMove, _state->moveOverhead));
+    if (!_state->stopTime || (endTime < _state->stopTime)) {
+      _state->stopTime = endTime;
     }
   }
 
-  if (UseTimer() && !timerThread.Active()) {
-    if (!timerThread.Start(Timer, this)) {
+  const bool timed = UseTimer();
+  if (timed) {
+    _timerThreadLock.Lock();
+    _timerLock.Lock();
+    _timed.push_back(this);
+    _timerQuit = false;
+    if (!_timerThread.Active() && !_timerThread.Start(Timer, NULL)) {
       Output() << "Failed to start timer thread!";
     }
+    _timerLock.Unlock();
+    _timerThreadLock.Unlock();
+    _timerSignal.Notify();
   }
 
   std::string bestmove =
       MyGo(depth, movestogo, movetime, wtime, winc, btime, binc, ponder);
 
-  _searching = false;
+  _state->searching = false;
+  if (timed) {
+    _timerLock.Lock();
+    _timed.remove(this);
+    _timerLock.Unlock();
+  }
+
+  if (_state->debug && _state->stopIssued) {
+    const uint64_t now = Now();
+    Output out;
+    out << "Stop to bestmove latency " << (now - _state->stopIssued)
+        << " msecs";
+    if (_state->stopTime && TimeoutOccurred()) {
+      out << ", stopped " << (static_cast<int64_t>(_state->stopIssued) -
+                              static_cast<int64_t>(_state->stopTime))
+          << " msecs after deadline";
+    }
+  }
+
   return bestmove;
 }
 
 //----------------------------------------------------------------------------
-void ChessEngine::Timer(void* data)
+void ChessEngine::ReportBestMove(const std::string& move)
 {
-  try {
-    if (!data) {
-      Output() << "ChessEngine::Timer() NULL data parameter";
-      return;
-    }
-
-    ChessEngine* engine;
-#ifdef NDEBUG
-    engine = static_cast<ChessEngine*>(data);
-#else
-    engine = reinterpret_cast<ChessEngine*>(data);
-    if (!engine) {
-      Output() << "ChessEngine::Timer() failed to cast data parameter";
-      return;
-    }
-#endif
+  std::list<BestMoveChange>& bestMoves = _state->bestMoves;
+  if (bestMoves.empty() || (bestMoves.back().move != move)) {
+    BestMoveChange change;
+    change.msecs = (Now() - _state->startTime);
+    change.move  = move;
+    bestMoves.push_back(change);
+  }
+}
 
-    const unsigned int outputInterval = engine->TimerOutputInterval();
+//----------------------------------------------------------------------------
+uint64_t ChessEngine::TimerCheck(const uint64_t now)
+{
+  const uint64_t end = GetStopTime();
+  const uint64_t outputInterval = TimerOutputInterval();
 
+  if (end && (now >= end)) {
+    Stop(StopReason::Timeout);
+  }
+  else if (!_state->quiet && !TimeoutOccurred() &&
+           (now >= (Output::LastOutput() + outputInterval)))
+  {
     char     move[8];
     int      depth = 0;
     int      movenum = 0;
@@ -115,40 +218,66 @@ void ChessEngine::Timer(void* data)
     uint64_t nodes = 0;
     uint64_t qnodes = 0;
 
-    while (!_quit) {
-      const uint64_t now = Now();
-      const uint64_t end = engine->GetStopTime();
+    GetStats(&depth, &seldepth, &nodes, &qnodes, &msecs, &movenum, move,
+             sizeof(move));
 
-      if (engine->IsSearching()) {
-        if (end && ((now + 100) >= end)) {
-          engine->Stop(StopReason::Timeout);
-        }
-        else if (!engine->TimeoutOccurred() &&
-                 (now >= (Output::LastOutput() + outputInterval)))
-        {
-          engine->GetStats(&depth, &seldepth, &nodes, &qnodes, &msecs,
-                           &movenum, move, sizeof(move));
-
-          Output out(Output::NoPrefix);
-          out << "info depth " << depth
-              << " seldepth " << seldepth
-              << " nodes " << nodes
-              << " time " << msecs
-              << " nps " << static_cast<uint64_t>(Rate(nodes, msecs));
-
-          if (movenum > 0) {
-            out << " currmovenumber " << movenum
-                << " currmove " << move;
-          }
+    Output out(Output::NoPrefix);
+    out << "info depth " << depth
+        << " seldepth " << seldepth
+        << " nodes " << nodes
+        << " time " << msecs
+        << " nps " << static_cast<uint64_t>(Rate(nodes, msecs));
+
+    if (movenum > 0) {
+      out << " currmovenumber " << movenum
+          << " currmove " << move;
+    }
+  }
+
+  if (TimeoutOccurred()) {
+    return 0;
+  }
+  uint64_t wakeup = end;
+  if (!_state->quiet) {
+    const uint64_t next = (Output::LastOutput() + outputInterval);
+    if (!end || (next < end)) {
+      wakeup = next;
+    }
+  }
+  return wakeup;
+}
+
+//----------------------------------------------------------------------------
+void ChessEngine::Timer(void* /*data*/)
+{
+  try {
+    _timerLock.Lock();
+    while (!_timerQuit) {
+      // sleep until the next deadline or output of any engine, or until
+      // Go() or the last engine's destructor wakes us up
+      uint64_t wakeup = 0;
+      const uint64_t now = Now();
+      std::list<ChessEngine*>::iterator it;
+      for (it = _timed.begin(); it != _timed.end(); ++it) {
+        const uint64_t next = (*it)->TimerCheck(now);
+        if (next && (!wakeup || (next < wakeup))) {
+          wakeup = next;
         }
       }
+      _timerLock.Unlock();
 
-      const uint64_t tmout = (end - now - 100);
-      const uint64_t msecs = std::min<uint64_t>(100, tmout);
-      if (!MillisecondSleep(static_cast<unsigned int>(msecs))) {
-        break;
+      if (!wakeup) {
+        _timerSignal.Wait();
       }
+      else {
+        const uint64_t current = Now();
+        if (wakeup > current) {
+          _timerSignal.Wait(static_cast<unsigned int>(wakeup - current));
+        }
+      }
+      _timerLock.Lock();
     }
+    _timerLock.Unlock();
   }
   catch (std::exception& e) {
     std::cerr << "info string ChessEngine::Timer() ERROR: "
@@ -158,10 +287,6 @@ void ChessEngine::Timer(void* data)
     std::cerr << "info string ChessEngine::Timer() ERROR: unknown exception"
               << std::endl;
   }
-
-  if (_debug) {
-    Output() << "ChessEngine::Timer thread exiting";
-  }
 }
 
 } // namespace senjo
@@ -26,6 +26,8 @@
 #include "EngineOption.h"
 #include "Threading.h"
 
+#include <atomic>
+
 namespace senjo {
 
 //----------------------------------------------------------------------------
@@ -47,6 +49,19 @@ public:
   //--------------------------------------------------------------------------
   static const char* _STARTPOS;
 
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //! Every ChessEngine object has its own search state and stop flags unless
+  //! it was created with the \p owner constructor below.  One timer thread
+  //! is shared by all of them.
+  //--------------------------------------------------------------------------
+  ChessEngine();
+
+  //--------------------------------------------------------------------------
+  //! \brief Destructor, stops the timer thread if this is the last engine
+  //--------------------------------------------------------------------------
+  virtual ~ChessEngine();
+
   //--------------------------------------------------------------------------
   //! \brief Get the engine name
   //! \return The engine name
@@ -277,56 +292,112 @@ public:
   //! \brief Set the engine's debug mode on or off
   //! \param[in] flag true to enable debug mode, false to disable debug mode
   //--------------------------------------------------------------------------
-  void SetDebug(const bool flag) { _debug = flag; }
+  void SetDebug(const bool flag) { _state->debug = flag; }
 
   //--------------------------------------------------------------------------
   //! \brief Is debug mode enabled?
   //! \return true if debug mode is enabled
   //--------------------------------------------------------------------------
-  bool IsDebugOn() const { return _debug; }
+  bool IsDebugOn() const { return _state->debug; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Turn search progress output on or off
+  //! Quiet engines don't write "info" lines while searching, which is what
+  //! you want when the engine is embedded in another program rather than
+  //! talking to a GUI.  Results are still available through the engine's
+  //! own API and GetBestMoveHistory().
+  //! \param[in] flag true to suppress search output, false to enable it
+  //--------------------------------------------------------------------------
+  void SetQuiet(const bool flag) { _state->quiet = flag; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Is search progress output suppressed?
+  //! \return true if search output is suppressed
+  //--------------------------------------------------------------------------
+  bool IsQuiet() const { return _state->quiet; }
 
   //--------------------------------------------------------------------------
   //! \brief Is the engine currently executing the Go() method?
   //! It is not recommended to set this to true while Perft() is executing.
   //! \return true if the engine is searching
   //--------------------------------------------------------------------------
-  bool IsSearching() const { return _searching; }
+  bool IsSearching() const { return _state->searching; }
 
   //--------------------------------------------------------------------------
   //! \brief Get the millisecond timestamp of when Go() was started
   //! \return 0 if not searching
   //--------------------------------------------------------------------------
-  uint64_t GetStartTime() const { return _startTime; }
+  uint64_t GetStartTime() const { return _state->startTime; }
 
   //--------------------------------------------------------------------------
   //! \brief Get millisecond timestamp when the current search should timeout
   //! \return 0 if not searching or the current search should not timeout
   //--------------------------------------------------------------------------
-  uint64_t GetStopTime() const { return _stopTime; }
+  uint64_t GetStopTime() const { return _state->stopTime; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Set milliseconds reserved per move for communication overhead
+  //! The reserve is subtracted from the time allotted to each move so the
+  //! bestmove reaches the GUI before the clock runs out.
+  //! \param[in] msecs Number of milliseconds to reserve
+  //--------------------------------------------------------------------------
+  void SetMoveOverhead(const uint64_t msecs) {
+    _state->moveOverhead = msecs;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Get milliseconds reserved per move for communication overhead
+  //! \return Number of milliseconds reserved per move
+  //--------------------------------------------------------------------------
+  uint64_t GetMoveOverhead() const { return _state->moveOverhead; }
+
+  //--------------------------------------------------------------------------
+  //! \brief A change of best move during the last search
+  //--------------------------------------------------------------------------
+  struct BestMoveChange {
+    uint64_t    msecs; ///< Milliseconds since the search started
+    std::string move;  ///< The new best move in coordinate notation
+  };
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the best move changes reported during the last Go() call
+  //! \return Best move changes in the order they happened
+  //--------------------------------------------------------------------------
+  const std::list<BestMoveChange>& GetBestMoveHistory() const {
+    return _state->bestMoves;
+  }
 
   //--------------------------------------------------------------------------
   //! \brief Clear all stop flags
   //--------------------------------------------------------------------------
-  void ClearStopFlags() { _stop = 0; }
+  void ClearStopFlags() { _state->stop = 0; }
 
   //--------------------------------------------------------------------------
   //! \brief Tell the engine to stop searching
   //! Exit Perft()/Go() methods as quickly as possible.
   //! \param[in] reason The reason the search is being stopped
   //--------------------------------------------------------------------------
-  void Stop(const StopReason reason) { _stop |= reason; }
+  void Stop(const StopReason reason) {
+    uint64_t none = 0;
+    _state->stopIssued.compare_exchange_strong(none, Now());
+    _state->stop |= reason;
+  }
 
   //--------------------------------------------------------------------------
   //! \brief Was the last search stopped by user request?
   //! \return true if Stop() was called with reason set to UserRequest
   //--------------------------------------------------------------------------
-  bool StopRequested() const { return (_stop & StopReason::FullStop); }
+  bool StopRequested() const {
+    return (_state->stop & StopReason::FullStop);
+  }
 
   //--------------------------------------------------------------------------
   //! \brief Was the last search stopped because of timeout?
   //! \return true if Stop() was called with reason set to Timeout
   //--------------------------------------------------------------------------
-  uint64_t TimeoutOccurred() const { return (_stop & StopReason::Timeout); }
+  uint64_t TimeoutOccurred() const {
+    return (_state->stop & StopReason::Timeout);
+  }
 
   //--------------------------------------------------------------------------
   //! \brief Reset statistical counter totals
@@ -338,18 +409,66 @@ public:
   //--------------------------------------------------------------------------
   virtual void ShowStatsTotals() const { }
 
+  //--------------------------------------------------------------------------
+  //! \brief Get stats collected since last ResetStatsTotals call as JSON
+  //! \return A JSON object, empty if the engine doesn't collect stats
+  //--------------------------------------------------------------------------
+  virtual std::string StatsTotalsJSON() const { return "{}"; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Should an option be kept from child processes (e.g. test jobs)?
+  //! Options naming something a process must have to itself, such as an
+  //! output file, are left out when settings are copied to children.
+  //! \param[in] name The option name
+  //! \return true if the option must not be copied to child processes
+  //--------------------------------------------------------------------------
+  virtual bool IsPrivateOption(const std::string& /*name*/) const {
+    return false;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Write the hash table to a file
+  //! \param[in] fileName The file to write
+  //! \return false if not supported or the file could not be written
+  //--------------------------------------------------------------------------
+  virtual bool SaveHashTable(const std::string& /*fileName*/) {
+    return false;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Replace the hash table with one written by SaveHashTable()
+  //! \param[in] fileName The file to read
+  //! \return false if not supported or the file could not be read
+  //--------------------------------------------------------------------------
+  virtual bool LoadHashTable(const std::string& /*fileName*/) {
+    return false;
+  }
+
   //--------------------------------------------------------------------------
   //! \brief Stop searching and perform engine exit
   //--------------------------------------------------------------------------
   virtual void Quit() {
-    _quit = true;
-    _stop = FullStop;
-    if (UseTimer()) {
-      timerThread.Join();
-    }
+    _state->stop = FullStop;
   }
 
 protected:
+  //--------------------------------------------------------------------------
+  //! \brief Constructor for objects that work on behalf of \p owner
+  //! They use the owner's search state and stop flags instead of
+  //! having their own, so they are small enough to create in bulk (one per
+  //! search ply for example).  \p owner must outlive them.
+  //! \param[in] owner The engine whose state is used
+  //--------------------------------------------------------------------------
+  explicit ChessEngine(ChessEngine* owner);
+
+  //--------------------------------------------------------------------------
+  //! \brief Get the stop flags
+  //! For search loops that poll the flags often enough that a function call
+  //! per check matters.  A non-zero value means stop.
+  //! \return Pointer to the flags, valid as long as the owning engine is
+  //--------------------------------------------------------------------------
+  const std::atomic<int>* GetStopFlags() const { return &_state->stop; }
+
   //--------------------------------------------------------------------------
   //! \brief Do performance test on the current position
   //! Perft is useful for determining the speed of you move generator.
@@ -381,15 +500,50 @@ protected:
                            const uint64_t btime = 0, const uint64_t binc = 0,
                            std::string* ponder = NULL) = 0;
 
+  //--------------------------------------------------------------------------
+  //! \brief Call from MyGo() whenever a new principal variation is found
+  //! Only changes of best move are recorded, so calling this once per
+  //! iteration with the same move is fine.
+  //! \param[in] move The current best move in coordinate notation
+  //--------------------------------------------------------------------------
+  void ReportBestMove(const std::string& move);
+
+  //--------------------------------------------------------------------------
+  //! \brief Called by the timer thread while this engine is searching
+  //! Stops the search at the deadline and outputs progress now and then.
+  //! \param[in] now The current time
+  //! \return When to call again, 0 if not before the next search
+  //--------------------------------------------------------------------------
+  uint64_t TimerCheck(const uint64_t now);
+
   static void Timer(void* data);
-  Thread timerThread;
-
-  static bool     _debug;
-  static bool     _searching;
-  static bool     _quit;
-  static int      _stop;
-  static uint64_t _startTime;
-  static uint64_t _stopTime;
+
+private:
+  ChessEngine(const ChessEngine&);
+  ChessEngine& operator=(const ChessEngine&);
+
+  //--------------------------------------------------------------------------
+  //! \brief Search state, shared with the objects working for this engine
+  //--------------------------------------------------------------------------
+  struct State {
+    explicit State(ChessEngine* owner);
+
+    ChessEngine* owner;
+    bool         debug;
+    bool         quiet;
+    bool         searching;
+    uint64_t     startTime;
+    uint64_t     stopTime;
+    uint64_t     moveOverhead;
+
+    // written by the timer thread and by whoever calls Stop()
+    std::atomic<int>      stop;
+    std::atomic<uint64_t> stopIssued;
+
+    std::list<BestMoveChange> bestMoves;
+  };
+
+  State* _state;
 };
 
 } // namespace senjo
@@ -25,11 +25,169 @@
 namespace senjo
 {
 
+//----------------------------------------------------------------------------
+//! \brief Drains queued output lines to stdout on a dedicated thread
+//! Lines are copied into a fixed ring of slots whose buffers are reused, so
+//! posting a line doesn't allocate once the slots have grown to fit.
+//! Producers claim a slot with a single compare-and-swap.  The writer thread
+//! writes every consecutive filled slot and flushes stdout once per batch.
+//! A producer only waits if the ring is full.
+//----------------------------------------------------------------------------
+class OutputWriter
+{
+public:
+  OutputWriter()
+    : tail(0),
+      head(0),
+      posted(0),
+      written(0),
+      posting(0),
+      stopping(false),
+      running(false)
+  {
+    for (uint64_t i = 0; i < Slots; ++i) {
+      ring[i].sequence = i;
+    }
+    running = thread.Start(Run, this);
+  }
+
+  ~OutputWriter() {
+    if (running) {
+      stopping = true;
+      signal.Notify();
+      thread.Join();
+
+      // anything posted while the thread was exiting is written here
+      running = false;
+      while (posting) {
+        WriteQueued();
+        MillisecondSleep(1);
+      }
+      WriteQueued();
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Queue \p text for output
+  //! \return false if there is no writer thread to take it
+  //--------------------------------------------------------------------------
+  bool Post(const std::string& text) {
+    ++posting;
+    if (!running) {
+      --posting;
+      return false;
+    }
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &ring[pos & (Slots - 1)];
+      const uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+      if (seq == pos) {
+        if (tail.compare_exchange_weak(pos, (pos + 1),
+                                       std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (seq < pos) {
+        // full, wait for the writer to free the slot
+        signal.Notify();
+        MillisecondSleep(1);
+        pos = tail.load(std::memory_order_relaxed);
+      }
+      else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+    slot->text.assign(text);
+    slot->sequence = (pos + 1);
+    ++posted;
+    --posting;
+    if (pos == head) {
+      signal.Notify();
+    }
+    return true;
+  }
+
+  //--------------------------------------------------------------------------
+  //! \brief Wait until everything posted so far has been written
+  //--------------------------------------------------------------------------
+  void Flush() {
+    const uint64_t target = posted;
+    while (running && (written < target)) {
+      flushed.Wait(10);
+    }
+  }
+
+private:
+  enum {
+    Slots = 1024 // power of 2
+  };
+
+  //--------------------------------------------------------------------------
+  //! sequence is the ring position the slot may be filled for next, or that
+  //! position + 1 once it has been filled
+  //--------------------------------------------------------------------------
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    std::string           text;
+  };
+
+  static void Run(void* param) {
+    OutputWriter* me = static_cast<OutputWriter*>(param);
+    while (true) {
+      const bool stop = me->stopping;
+      if (!me->WriteQueued()) {
+        if (stop) {
+          break;
+        }
+        me->signal.Wait();
+      }
+    }
+  }
+
+  bool WriteQueued() {
+    uint64_t pos = head;
+    uint64_t count = 0;
+    while (true) {
+      Slot& slot = ring[pos & (Slots - 1)];
+      if (slot.sequence != (pos + 1)) {
+        break;
+      }
+      std::cout << slot.text;
+      slot.sequence.store((pos + Slots), std::memory_order_release);
+      head = ++pos;
+      ++count;
+    }
+    if (!count) {
+      return false;
+    }
+    std::cout.flush();
+    written += count;
+    flushed.Notify();
+    return true;
+  }
+
+  Slot                  ring[Slots];
+  std::atomic<uint64_t> tail;     // next ring position to fill
+  std::atomic<uint64_t> head;     // next ring position to write
+  std::atomic<uint64_t> posted;   // lines queued by Post()
+  std::atomic<uint64_t> written;  // lines written by WriteQueued()
+  std::atomic<int>      posting;  // Post() calls in progress
+  std::atomic<bool>     stopping;
+  std::atomic<bool>     running;
+  Signal                signal;
+  Signal                flushed;
+  Thread                thread;
+};
+
 //----------------------------------------------------------------------------
 // static variables
 //----------------------------------------------------------------------------
-Mutex    Output::_mutex;
-uint64_t Output::_lastOutput = 0;
+std::atomic<uint64_t> Output::_lastOutput(0);
+
+static Mutex        _mutex;
+static OutputWriter _writer;
 
 //----------------------------------------------------------------------------
 uint64_t Output::LastOutput()
@@ -37,13 +195,18 @@ uint64_t Output::LastOutput()
   return _lastOutput;
 }
 
+//----------------------------------------------------------------------------
+void Output::Flush()
+{
+  _writer.Flush();
+}
+
 //----------------------------------------------------------------------------
 Output::Output(const OutputPrefix prefix)
 {
-  _mutex.Lock();
   switch (prefix) {
   case OutputPrefix::InfoPrefix:
-    std::cout << "info string ";
+    buffer << "info string ";
     break;
   case OutputPrefix::NoPrefix:
     break;
@@ -53,10 +216,15 @@ Output::Output(const OutputPrefix prefix)
 //----------------------------------------------------------------------------
 Output::~Output()
 {
-  std::cout << '\n';
-  std::cout.flush();
+  buffer << '\n';
+  if (!_writer.Post(buffer.str())) {
+    // no writer thread (failed to start or already shut down)
+    _mutex.Lock();
+    std::cout << buffer.str();
+    std::cout.flush();
+    _mutex.Unlock();
+  }
   _lastOutput = Now();
-  _mutex.Unlock();
 }
 
 } // namespace senjo
@@ -25,13 +25,19 @@
 
 #include "Threading.h"
 
+#include <atomic>
+#include <sstream>
+
 namespace senjo
 {
 
 //----------------------------------------------------------------------------
 //! \brief Thread safe stdout stream
-//! Instantiating this class will obtain a lock on a mtuex guarding stdout.
-//! The stdout mutex is released when the instantiated object is destroyed.
+//! Text inserted into an instance of this class is collected in a private
+//! buffer.  When the instance is destroyed the buffer is handed to a
+//! dedicated writer thread through a lock-free queue, so the calling thread
+//! never waits on stdout.  The writer thread writes queued text in the order
+//! it was queued, batching as many lines as are available per flush.
 //!
 //! \e Important: '\n' is automatically appended when the object is destroyed.
 //! \e Important: The UCI protocol requires that lines end with a single
@@ -52,6 +58,8 @@ namespace senjo
 //! Notice it is not necessary to add '\n' on the end of either line.
 //! Notice it is possible that other threads could output something between
 //! "Line 1" and "Line 2".
+//! Notice "Line 1" is always written before "Line 2" because both are queued
+//! by the same thread.
 //!
 //! Example of multiple line outout without allowing another thread to output
 //! between each line:
@@ -70,9 +78,8 @@ namespace senjo
 //! "info string ".  If you know what you're doing concerning the UCI protocol
 //! you can omit "info string " where appropriate.
 //!
-//! To maintain exclusive access to stdout so that processing can be done
-//! between lines of output without allowing another thread to output between
-//! lines:
+//! To do processing between lines of output without allowing another thread
+//! to output between lines:
 //!
 //!   {
 //!     Output out;
@@ -113,6 +120,11 @@ public:
   //--------------------------------------------------------------------------
   static uint64_t LastOutput();
 
+  //--------------------------------------------------------------------------
+  //! \brief Wait for the writer thread to write everything queued so far
+  //--------------------------------------------------------------------------
+  static void Flush();
+
   //--------------------------------------------------------------------------
   //! \brief Insertion operator
   //! All data types supported by std::cout are supported here.
@@ -120,13 +132,14 @@ public:
   //--------------------------------------------------------------------------
   template<typename T>
   Output& operator<<(const T& x) {
-    std::cout << x;
+    buffer << x;
     return *this;
   }
 
 private:
-  static Mutex    _mutex;
-  static uint64_t _lastOutput;
+  static std::atomic<uint64_t> _lastOutput;
+
+  std::ostringstream buffer;
 };
 
 } // namespace senjo
@@ -65,16 +65,19 @@ namespace senjo
 
 //----------------------------------------------------------------------------
 //! \brief Get current millisecond timestamp
-//! \return Number of milliseconds since epoch
+//! The timestamp comes from a monotonic clock, so it is only meaningful
+//! when compared to other values returned by this function.
+//! \return Number of milliseconds since an arbitrary fixed point in time
 //----------------------------------------------------------------------------
 static inline uint64_t Now()
 {
 #ifdef WIN32
-  return static_cast<uint64_t>(GetTickCount());
+  return static_cast<uint64_t>(GetTickCount64());
 #else
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return static_cast<uint64_t>((tv.tv_sec * 1000) + (tv.tv_usec / 1000));
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((static_cast<uint64_t>(ts.tv_sec) * 1000) +
+          static_cast<uint64_t>(ts.tv_nsec / 1000000));
 #endif
 }
 
@@ -0,0 +1,366 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//----------------------------------------------------------------------------
+
+#include "Process.h"
+#include "Output.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+namespace senjo
+{
+
+//----------------------------------------------------------------------------
+std::string Process::SelfPath()
+{
+#ifdef WIN32
+  char path[MAX_PATH];
+  const DWORD len = GetModuleFileNameA(NULL, path, sizeof(path));
+  if (!len || (len >= sizeof(path))) {
+    return std::string();
+  }
+  return std::string(path, len);
+#else
+  char path[4096];
+  const ssize_t len = readlink("/proc/self/exe", path, sizeof(path));
+  if ((len <= 0) || (len >= static_cast<ssize_t>(sizeof(path)))) {
+    return std::string();
+  }
+  return std::string(path, len);
+#endif
+}
+
+//----------------------------------------------------------------------------
+Process::Process()
+#ifdef WIN32
+  : process(NULL),
+    input(NULL),
+    output(NULL)
+#else
+  : pid(0),
+    input(-1),
+    output(-1)
+#endif
+{
+}
+
+//----------------------------------------------------------------------------
+Process::~Process()
+{
+  Kill();
+}
+
+//----------------------------------------------------------------------------
+bool Process::Start(const std::string& path)
+{
+  if (IsRunning()) {
+    Output() << "Process::Start() process already running";
+    return false;
+  }
+
+  buffer.clear();
+
+#ifdef WIN32
+  SECURITY_ATTRIBUTES sa;
+  sa.nLength = sizeof(sa);
+  sa.lpSecurityDescriptor = NULL;
+  sa.bInheritHandle = TRUE;
+
+  HANDLE childInput = NULL;
+  HANDLE childOutput = NULL;
+  if (!CreatePipe(&childInput, &input, &sa, 0)) {
+    Output() << "Unable to create pipe: error code " << GetLastError();
+    return false;
+  }
+  if (!CreatePipe(&output, &childOutput, &sa, 0)) {
+    Output() << "Unable to create pipe: error code " << GetLastError();
+    CloseHandle(childInput);
+    CloseInput();
+    return false;
+  }
+  SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+  SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+  STARTUPINFOA si;
+  memset(&si, 0, sizeof(si));
+  si.cb = sizeof(si);
+  si.dwFlags = STARTF_USESTDHANDLES;
+  si.hStdInput = childInput;
+  si.hStdOutput = childOutput;
+  si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+  PROCESS_INFORMATION pi;
+  memset(&pi, 0, sizeof(pi));
+  std::string cmd = ("\"" + path + "\"");
+  const BOOL ok = CreateProcessA(NULL, &cmd[0], NULL, NULL, TRUE, 0, NULL,
+                                 NULL, &si, &pi);
+  CloseHandle(childInput);
+  CloseHandle(childOutput);
+  if (!ok) {
+    Output() << "Unable to start '" << path << "': error code "
+             << GetLastError();
+    CloseInput();
+    CloseOutput();
+    return false;
+  }
+  CloseHandle(pi.hThread);
+  process = pi.hProcess;
+#else
+  int in[2];
+  int out[2];
+  if (pipe(in)) {
+    Output() << "Unable to create pipe: " << strerror(errno);
+    return false;
+  }
+  if (pipe(out)) {
+    Output() << "Unable to create pipe: " << strerror(errno);
+    close(in[0]);
+    close(in[1]);
+    return false;
+  }
+
+  // keep this end of the pipes out of children started later
+  fcntl(in[1], F_SETFD, FD_CLOEXEC);
+  fcntl(out[0], F_SETFD, FD_CLOEXEC);
+
+  if ((pid = fork()) < 0) {
+    Output() << "Unable to fork: " << strerror(errno);
+    pid = 0;
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    return false;
+  }
+
+  if (!pid) {
+    // only async-signal-safe calls between fork and exec
+    dup2(in[0], STDIN_FILENO);
+    dup2(out[1], STDOUT_FILENO);
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    execl(path.c_str(), path.c_str(), static_cast<char*>(NULL));
+    _exit(127);
+  }
+
+  close(in[0]);
+  close(out[1]);
+  input = in[1];
+  output = out[0];
+#endif
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Process::IsRunning() const
+{
+#ifdef WIN32
+  return (process != NULL);
+#else
+  return (pid > 0);
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool Process::WriteLine(const std::string& line)
+{
+#ifndef WIN32
+  // a child that exits early must not take this process down with it, so
+  // SIGPIPE is held back on this thread while writing and one raised by
+  // the write is discarded, how the process handles it is left alone
+  sigset_t pipeSignal;
+  sigset_t oldMask;
+  sigset_t pending;
+  sigemptyset(&pipeSignal);
+  sigaddset(&pipeSignal, SIGPIPE);
+  sigpending(&pending);
+  const bool wasPending = sigismember(&pending, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+#endif
+
+  const std::string data = (line + '\n');
+  const char* p = data.c_str();
+  size_t remain = data.size();
+  bool ok = true;
+  while (ok && remain) {
+#ifdef WIN32
+    DWORD n = 0;
+    if (!input || !WriteFile(input, p, static_cast<DWORD>(remain), &n, NULL)) {
+      ok = false;
+      break;
+    }
+#else
+    if (input < 0) {
+      ok = false;
+      break;
+    }
+    const ssize_t n = write(input, p, remain);
+    if (n < 0) {
+      ok = (errno == EINTR);
+      continue;
+    }
+#endif
+    p += n;
+    remain -= n;
+  }
+
+#ifndef WIN32
+  sigpending(&pending);
+  if (!wasPending && sigismember(&pending, SIGPIPE)) {
+    int sig = 0;
+    sigwait(&pipeSignal, &sig);
+  }
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+#endif
+  return ok;
+}
+
+//----------------------------------------------------------------------------
+bool Process::ReadLine(std::string& line)
+{
+  size_t end;
+  while ((end = buffer.find('\n')) == std::string::npos) {
+    char chunk[4096];
+#ifdef WIN32
+    DWORD n = 0;
+    if (!output || !ReadFile(output, chunk, sizeof(chunk), &n, NULL) || !n) {
+      break;
+    }
+#else
+    if (output < 0) {
+      break;
+    }
+    const ssize_t n = read(output, chunk, sizeof(chunk));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (!n) {
+      break;
+    }
+#endif
+    buffer.append(chunk, n);
+  }
+
+  if (end == std::string::npos) {
+    // end of stream, return whatever is left as the last line
+    if (buffer.empty()) {
+      return false;
+    }
+    end = buffer.size();
+  }
+
+  line.assign(buffer, 0, end);
+  buffer.erase(0, (end + 1));
+  if (line.size() && (line[line.size() - 1] == '\r')) {
+    line.erase(line.size() - 1);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int Process::Wait()
+{
+  int result = -1;
+  CloseInput();
+#ifdef WIN32
+  if (process) {
+    DWORD code = 0;
+    WaitForSingleObject(process, INFINITE);
+    if (GetExitCodeProcess(process, &code)) {
+      result = static_cast<int>(code);
+    }
+    CloseHandle(process);
+    process = NULL;
+  }
+#else
+  if (pid > 0) {
+    int status = 0;
+    while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR)) { }
+    if (WIFEXITED(status)) {
+      result = WEXITSTATUS(status);
+    }
+    pid = 0;
+  }
+#endif
+  CloseOutput();
+  return result;
+}
+
+//----------------------------------------------------------------------------
+void Process::Kill()
+{
+#ifdef WIN32
+  if (process) {
+    TerminateProcess(process, 1);
+  }
+#else
+  if (pid > 0) {
+    kill(pid, SIGKILL);
+  }
+#endif
+  Wait();
+}
+
+//----------------------------------------------------------------------------
+void Process::CloseInput()
+{
+#ifdef WIN32
+  if (input) {
+    CloseHandle(input);
+    input = NULL;
+  }
+#else
+  if (input >= 0) {
+    close(input);
+    input = -1;
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+void Process::CloseOutput()
+{
+#ifdef WIN32
+  if (output) {
+    CloseHandle(output);
+    output = NULL;
+  }
+#else
+  if (output >= 0) {
+    close(output);
+    output = -1;
+  }
+#endif
+  buffer.clear();
+}
+
+} // namespace senjo
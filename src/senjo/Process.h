@@ -0,0 +1,117 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//----------------------------------------------------------------------------
+
+#ifndef SENJO_PROCESS_H
+#define SENJO_PROCESS_H
+
+#include "Platform.h"
+
+namespace senjo
+{
+
+//----------------------------------------------------------------------------
+//! \brief A child process connected by pipes to its stdin and stdout
+//! Lines written with WriteLine() arrive on the child's stdin and lines the
+//! child writes to stdout are returned by ReadLine().  The child's stderr is
+//! shared with this process.
+//----------------------------------------------------------------------------
+class Process
+{
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Get the full path of the currently running executable
+  //! \return Empty string if the path can't be determined
+  //--------------------------------------------------------------------------
+  static std::string SelfPath();
+
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //--------------------------------------------------------------------------
+  Process();
+
+  //--------------------------------------------------------------------------
+  //! \brief Destructor, kills the child process if it is still running
+  //--------------------------------------------------------------------------
+  virtual ~Process();
+
+  //--------------------------------------------------------------------------
+  //! \brief Start the given executable as a child process
+  //! \param[in] path Full path of the executable to run
+  //! \return true if the child process was started
+  //--------------------------------------------------------------------------
+  bool Start(const std::string& path);
+
+  //--------------------------------------------------------------------------
+  //! \brief Has the child process been started and not yet waited on?
+  //! \return true if the child process is running
+  //--------------------------------------------------------------------------
+  bool IsRunning() const;
+
+  //--------------------------------------------------------------------------
+  //! \brief Send a line of text to the child process's stdin
+  //! \param[in] line The text to send, a newline is appended
+  //! \return false if the child process can't be written to
+  //--------------------------------------------------------------------------
+  bool WriteLine(const std::string& line);
+
+  //--------------------------------------------------------------------------
+  //! \brief Read the next line of text the child process wrote to stdout
+  //! Blocks until a full line is available.
+  //! \param[out] line Set to the line that was read, without line terminator
+  //! \return false if the child process closed its stdout
+  //--------------------------------------------------------------------------
+  bool ReadLine(std::string& line);
+
+  //--------------------------------------------------------------------------
+  //! \brief Close the child's stdin and wait for the child process to exit
+  //! \return The child's exit code, -1 if it didn't exit normally
+  //--------------------------------------------------------------------------
+  int Wait();
+
+  //--------------------------------------------------------------------------
+  //! \brief Terminate the child process and wait for it to exit
+  //--------------------------------------------------------------------------
+  void Kill();
+
+private:
+  Process(const Process&);
+  Process& operator=(const Process&);
+
+  void CloseInput();
+  void CloseOutput();
+
+  std::string buffer;
+
+#ifdef WIN32
+  HANDLE process;
+  HANDLE input;
+  HANDLE output;
+#else
+  pid_t pid;
+  int   input;
+  int   output;
+#endif
+};
+
+} // namespace senjo
+
+#endif // SENJO_PROCESS_H
@@ -76,6 +76,102 @@ void Mutex::Unlock()
 #endif
 }
 
+//----------------------------------------------------------------------------
+Signal::Signal()
+{
+#ifdef WIN32
+  event = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (!event) {
+    std::cerr << "Unable to create event: error code " << GetLastError()
+              << std::endl;
+  }
+#else
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, &attr);
+  pthread_condattr_destroy(&attr);
+  signaled = false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+Signal::~Signal()
+{
+#ifdef WIN32
+  if (event) {
+    CloseHandle(event);
+    event = NULL;
+  }
+#else
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+#endif
+}
+
+//----------------------------------------------------------------------------
+void Signal::Notify()
+{
+#ifdef WIN32
+  if (event) {
+    SetEvent(event);
+  }
+#else
+  pthread_mutex_lock(&mutex);
+  signaled = true;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+#endif
+}
+
+//----------------------------------------------------------------------------
+void Signal::Wait()
+{
+#ifdef WIN32
+  if (event) {
+    WaitForSingleObject(event, INFINITE);
+  }
+#else
+  pthread_mutex_lock(&mutex);
+  while (!signaled) {
+    pthread_cond_wait(&cond, &mutex);
+  }
+  signaled = false;
+  pthread_mutex_unlock(&mutex);
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool Signal::Wait(const unsigned int msecs)
+{
+#ifdef WIN32
+  if (event) {
+    return (WaitForSingleObject(event, msecs) == WAIT_OBJECT_0);
+  }
+  return false;
+#else
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += (msecs / 1000);
+  deadline.tv_nsec += ((msecs % 1000) * 1000000L);
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&mutex);
+  int err = 0;
+  while (!signaled && !err) {
+    err = pthread_cond_timedwait(&cond, &mutex, &deadline);
+  }
+  const bool result = signaled;
+  signaled = false;
+  pthread_mutex_unlock(&mutex);
+  return result;
+#endif
+}
+
 //----------------------------------------------------------------------------
 Thread::Thread()
   : threadFunction(NULL),
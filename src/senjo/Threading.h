@@ -66,6 +66,52 @@ private:
 #endif
 };
 
+//----------------------------------------------------------------------------
+//! \brief Auto-reset event used to wake a waiting thread
+//! A Notify() that happens while no thread is waiting is remembered, so the
+//! next call to Wait() returns immediately.
+//----------------------------------------------------------------------------
+class Signal
+{
+public:
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //--------------------------------------------------------------------------
+  Signal();
+
+  //--------------------------------------------------------------------------
+  //! \brief Destructor
+  //--------------------------------------------------------------------------
+  virtual ~Signal();
+
+  //--------------------------------------------------------------------------
+  //! \brief Wake the thread blocked in Wait(), or the next one to call it
+  //--------------------------------------------------------------------------
+  void Notify();
+
+  //--------------------------------------------------------------------------
+  //! \brief Block until Notify() is called
+  //! Returns immediately if Notify() was called since the last Wait().
+  //--------------------------------------------------------------------------
+  void Wait();
+
+  //--------------------------------------------------------------------------
+  //! \brief Block until Notify() is called or \p msecs milliseconds elapse
+  //! \param[in] msecs Maximum number of milliseconds to wait
+  //! \return true if Notify() was called, false on timeout
+  //--------------------------------------------------------------------------
+  bool Wait(const unsigned int msecs);
+
+private:
+#ifdef WIN32
+  HANDLE event;
+#else
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool signaled;
+#endif
+};
+
 //----------------------------------------------------------------------------
 //! \brief Represents a single background thread
 //! Runs a single function at a time on the background thread.
@@ -33,8 +33,10 @@ namespace token
   static const std::string Exit("exit");
   static const std::string Fen("fen");
   static const std::string Go("go");
+  static const std::string Hash("hash");
   static const std::string Help("help");
   static const std::string IsReady("isready");
+  static const std::string Load("load");
   static const std::string Moves("moves");
   static const std::string Name("name");
   static const std::string New("new");
@@ -45,6 +47,7 @@ namespace token
   static const std::string Print("print");
   static const std::string Quit("quit");
   static const std::string Register("register");
+  static const std::string Save("save");
   static const std::string SetOption("setoption");
   static const std::string StartPos("startpos");
   static const std::string Stop("stop");
@@ -157,6 +160,14 @@ bool UCIAdapter::DoCommand(const char* command)
     StopCommand();
     TestCommand(command);
   }
+  else if (ParamMatch(token::Save, command)) {
+    StopCommand();
+    SaveCommand(command);
+  }
+  else if (ParamMatch(token::Load, command)) {
+    StopCommand();
+    LoadCommand(command);
+  }
   else if (ParamMatch(token::Opts, command)) {
     OptsCommand(command);
   }
@@ -202,9 +213,11 @@ void UCIAdapter::HelpCommand(const char* /*params*/)
   Output() << "  " << token::Exit;
   Output() << "  " << token::Fen;
   Output() << "  " << token::Help;
+  Output() << "  " << token::Load;
   Output() << "  " << token::New;
   Output() << "  " << token::Perft;
   Output() << "  " << token::Print;
+  Output() << "  " << token::Save;
   Output() << "  " << token::Test;
   Output() << "Also try '<command> help' for help on a specific command";
   Output() << "Or enter move(s) in coordinate notation, e.g. d2d4 g8f6";
@@ -228,6 +241,51 @@ void UCIAdapter::FENCommand(const char* params)
   Output() << engine->GetFEN();
 }
 
+//----------------------------------------------------------------------------
+//! \brief Do the "save" command (not a UCI command)
+//! Write the hash table to a file
+//----------------------------------------------------------------------------
+void UCIAdapter::SaveCommand(const char* params)
+{
+  if (!ParamMatch(token::Hash, params) || !params || !*params ||
+      ParamMatch(token::Help, params))
+  {
+    Output() << "usage: " << token::Save << ' ' << token::Hash << " <file>";
+    Output() << "Write the hash table to <file>.";
+    return;
+  }
+
+  if (!engine->IsInitialized()) {
+    engine->Initialize();
+  }
+  if (engine->SaveHashTable(params)) {
+    Output() << "hash table saved to " << params;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief Do the "load" command (not a UCI command)
+//! Replace the hash table with one written by the "save hash" command
+//----------------------------------------------------------------------------
+void UCIAdapter::LoadCommand(const char* params)
+{
+  if (!ParamMatch(token::Hash, params) || !params || !*params ||
+      ParamMatch(token::Help, params))
+  {
+    Output() << "usage: " << token::Load << ' ' << token::Hash << " <file>";
+    Output() << "Replace the hash table with one written by '"
+             << token::Save << ' ' << token::Hash << "'.";
+    return;
+  }
+
+  if (!engine->IsInitialized()) {
+    engine->Initialize();
+  }
+  if (engine->LoadHashTable(params)) {
+    Output() << "hash table loaded from " << params;
+  }
+}
+
 //----------------------------------------------------------------------------
 //! \brief Do the "print" command (not a UCI command)
 //! Output an ascii representation of the current board position
@@ -69,11 +69,13 @@ private:
   bool ExitCommand(const char* params);
   void FENCommand(const char* params);
   void HelpCommand(const char* params);
+  void LoadCommand(const char* params);
   void MoveCommand(const char* params);
   void NewCommand(const char* params);
   void OptsCommand(const char* params);
   void PerftCommand(const char* params);
   void PrintCommand(const char* params);
+  void SaveCommand(const char* params);
   void TestCommand(const char* params);
 
   // UCI commands
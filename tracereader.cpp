@@ -0,0 +1,234 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "Move.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace bitfoot;
+
+//----------------------------------------------------------------------------
+struct OpenNode {
+  uint32_t move;
+  int      ply;
+  uint64_t start; // node count when this node was entered
+};
+
+//----------------------------------------------------------------------------
+struct RootMove {
+  uint32_t move;
+  uint64_t nodes;
+  bool operator<(const RootMove& other) const {
+    return (nodes > other.nodes);
+  }
+};
+
+//----------------------------------------------------------------------------
+class SearchSummary
+{
+public:
+  SearchSummary(const std::string& fen, const int top)
+    : fen(fen),
+      top(top),
+      iteration(0),
+      maxPly(0),
+      nodes(0),
+      qnodes(0),
+      errors(0)
+  {
+    memset(plyNodes, 0, sizeof(plyNodes));
+    memset(reasons, 0, sizeof(reasons));
+  }
+
+  void Add(const TraceRecord& record) {
+    switch (record.event) {
+    case TraceIteration:
+      EndIteration();
+      iteration = record.depth;
+      break;
+    case TraceEnter:
+    case TraceQEnter:
+      Enter(record);
+      break;
+    case TraceExit:
+    case TraceQExit:
+      Exit(record);
+      break;
+    case TraceReason:
+      if (record.reason < TraceReasonCount) {
+        reasons[record.reason]++;
+      }
+      else {
+        errors++;
+      }
+      break;
+    default:
+      errors++;
+    }
+  }
+
+  void Print() {
+    EndIteration();
+    printf("position %s\n", fen.c_str());
+    printf("  %" PRIu64 " nodes, %" PRIu64 " qnodes (%.1f%%), max ply %d\n",
+           nodes, qnodes, Percent(qnodes, nodes), maxPly);
+    if (errors || stack.size()) {
+      printf("  %" PRIu64 " malformed records, %d unclosed nodes\n",
+             errors, static_cast<int>(stack.size()));
+    }
+
+    printf("  nodes per ply:\n");
+    for (int i = 0; i <= maxPly; ++i) {
+      if (plyNodes[i]) {
+        printf("    %3d %12" PRIu64 " %5.1f%%\n",
+               i, plyNodes[i], Percent(plyNodes[i], nodes));
+      }
+    }
+
+    printf("  pruning and extensions:\n");
+    for (int i = 1; i < TraceReasonCount; ++i) {
+      if (reasons[i]) {
+        printf("    %-30s %12" PRIu64 "\n", TraceReasonName(i), reasons[i]);
+      }
+    }
+
+    for (size_t i = 0; i < iterations.size(); ++i) {
+      std::vector<RootMove>& moves = iterations[i].second;
+      uint64_t total = 0;
+      for (size_t k = 0; k < moves.size(); ++k) {
+        total += moves[k].nodes;
+      }
+      std::sort(moves.begin(), moves.end());
+      printf("  iteration %d: %" PRIu64 " nodes\n",
+             iterations[i].first, total);
+      for (size_t k = 0; (k < moves.size()) && (static_cast<int>(k) < top);
+           ++k)
+      {
+        printf("    %-6s %12" PRIu64 " %5.1f%%\n",
+               Move(moves[k].move).ToString().c_str(),
+               moves[k].nodes, Percent(moves[k].nodes, total));
+      }
+    }
+  }
+
+private:
+  static double Percent(const uint64_t part, const uint64_t whole) {
+    return (whole ? ((100.0 * part) / whole) : 0);
+  }
+
+  void Enter(const TraceRecord& record) {
+    OpenNode node;
+    node.move  = record.move;
+    node.ply   = record.ply;
+    node.start = nodes;
+    stack.push_back(node);
+
+    nodes++;
+    if (record.event == TraceQEnter) {
+      qnodes++;
+    }
+    if (record.ply <= MaxPlies) {
+      plyNodes[record.ply]++;
+    }
+    if (record.ply > maxPly) {
+      maxPly = record.ply;
+    }
+  }
+
+  void Exit(const TraceRecord& record) {
+    if (stack.empty() || (stack.back().ply != record.ply)) {
+      errors++;
+      return;
+    }
+    const OpenNode node = stack.back();
+    stack.pop_back();
+    if (node.ply == 1) {
+      rootMoves[node.move] += (nodes - node.start);
+    }
+  }
+
+  void EndIteration() {
+    if (rootMoves.size()) {
+      std::vector<RootMove> moves;
+      std::map<uint32_t, uint64_t>::const_iterator it;
+      for (it = rootMoves.begin(); it != rootMoves.end(); ++it) {
+        RootMove rm;
+        rm.move  = it->first;
+        rm.nodes = it->second;
+        moves.push_back(rm);
+      }
+      iterations.push_back(std::make_pair(iteration, moves));
+      rootMoves.clear();
+    }
+  }
+
+  std::string fen;
+  int         top;
+  int         iteration;
+  int         maxPly;
+  uint64_t    nodes;
+  uint64_t    qnodes;
+  uint64_t    errors;
+  uint64_t    plyNodes[MaxPlies + 1];
+  uint64_t    reasons[TraceReasonCount];
+
+  std::vector<OpenNode> stack;
+  std::map<uint32_t, uint64_t> rootMoves;
+  std::vector<std::pair<int, std::vector<RootMove> > > iterations;
+};
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  if ((argc < 2) || (argc > 3)) {
+    fprintf(stderr, "usage: %s <trace file> [moves per iteration]\n",
+            argv[0]);
+    return 1;
+  }
+
+  const int top = (argc > 2) ? atoi(argv[2]) : 5;
+
+  FILE* fp = fopen(argv[1], "rb");
+  if (!fp) {
+    fprintf(stderr, "Cannot open '%s': %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  SearchSummary* summary = NULL;
+  TraceRecord record;
+  while (fread(&record, sizeof(record), 1, fp) == 1) {
+    if (record.event == TraceBegin) {
+      std::string fen;
+      for (size_t i = 0; i < record.move; i += sizeof(TraceRecord)) {
+        char sbuf[sizeof(TraceRecord)];
+        if (fread(sbuf, sizeof(sbuf), 1, fp) != 1) {
+          break;
+        }
+        fen.append(sbuf, std::min<size_t>(sizeof(sbuf), (record.move - i)));
+      }
+      if (summary) {
+        summary->Print();
+        delete summary;
+      }
+      summary = new SearchSummary(fen, top);
+    }
+    else if (summary) {
+      summary->Add(record);
+    }
+  }
+
+  if (summary) {
+    summary->Print();
+    delete summary;
+  }
+  else {
+    fprintf(stderr, "No searches found in '%s'\n", argv[1]);
+  }
+
+  fclose(fp);
+  return 0;
+}
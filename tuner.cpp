@@ -0,0 +1,502 @@
+//----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//----------------------------------------------------------------------------
+
+#include "senjo/Threading.h"
+#include "Bitfoot.h"
+#include "Engine.h"
+#include "SelfPlay.h"
+
+#include <math.h>
+#include <thread>
+
+using namespace bitfoot;
+
+//----------------------------------------------------------------------------
+// Texel style evaluation tuner
+//
+// Every line of the dataset is an EPD position labelled with the game
+// result, either as a 'c9' opcode ("1-0", "0-1", "1/2-1/2") or in square
+// brackets ([1.0], [0.0], [0.5]), always from white's point of view.  The
+// error of a parameter set is the mean squared difference between the
+// results and sigmoid(K * qsearch score).  Parameters are adjusted one at a
+// time by +/- step until no single change lowers the error any further.
+//
+// With --binary the dataset is a file of TrainingRecords written by
+// --gensfen instead, labelled with their game results.  It is memory
+// mapped and the records go to the workers without any text parsing.
+//
+// The dataset is streamed from disk on every pass so its size is limited
+// by time, not memory.
+//----------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------
+struct Sample {
+  std::string    fen;         // empty if the sample is 'position'
+  PackedPosition position;
+  bool           blackToMove;
+  double         result;
+};
+
+//----------------------------------------------------------------------------
+// hands out batches of samples to the worker threads, one pass at a time
+//----------------------------------------------------------------------------
+class SampleReader
+{
+public:
+  enum {
+    BatchSize = 1024
+  };
+
+  SampleReader() : fp(NULL), binary(false), skipped(0) { }
+  ~SampleReader() {
+    if (fp) {
+      fclose(fp);
+    }
+  }
+
+  bool Open(const std::string& fileName, const bool binaryFile) {
+    if ((binary = binaryFile)) {
+      return records.Open(fileName, sizeof(TrainingRecord));
+    }
+    if (!(fp = fopen(fileName.c_str(), "r"))) {
+      fprintf(stderr, "Cannot open '%s': %s\n", fileName.c_str(),
+              strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  void Rewind() {
+    if (binary) {
+      records.Rewind();
+    }
+    else {
+      rewind(fp);
+    }
+    skipped = 0;
+  }
+
+  uint64_t Skipped() const {
+    return skipped;
+  }
+
+  //--------------------------------------------------------------------------
+  // fill 'batch' with up to BatchSize samples, false at end of file
+  //--------------------------------------------------------------------------
+  bool Next(std::vector<Sample>& batch) {
+    char line[1024];
+    Sample sample;
+    batch.clear();
+    if (binary) {
+      const void* record;
+      while ((batch.size() < BatchSize) && (record = records.Next())) {
+        Unpack(*static_cast<const TrainingRecord*>(record), sample);
+        batch.push_back(sample);
+      }
+      return !batch.empty();
+    }
+
+    lock.Lock();
+    while ((batch.size() < BatchSize) && fgets(line, sizeof(line), fp)) {
+      if (Parse(line, sample)) {
+        batch.push_back(sample);
+      }
+      else if (*line && (*line != '#') && !isspace(*line)) {
+        skipped++;
+      }
+    }
+    lock.Unlock();
+    return !batch.empty();
+  }
+
+private:
+  //--------------------------------------------------------------------------
+  static bool Parse(const char* line, Sample& sample) {
+    // piece placement, side to move, castling rights, en passant square
+    const char* p = line;
+    for (int field = 0; field < 4; ++field) {
+      while (*p && isspace(*p)) p++;
+      if (field == 1) {
+        sample.blackToMove = (*p == 'b');
+      }
+      while (*p && !isspace(*p)) p++;
+    }
+    if (!*p) {
+      return false;
+    }
+    sample.fen.assign(line, (p - line));
+
+    if (strstr(p, "1/2-1/2") || strstr(p, "[0.5]")) {
+      sample.result = 0.5;
+    }
+    else if (strstr(p, "1-0") || strstr(p, "[1.0]") || strstr(p, "[1]")) {
+      sample.result = 1.0;
+    }
+    else if (strstr(p, "0-1") || strstr(p, "[0.0]") || strstr(p, "[0]")) {
+      sample.result = 0.0;
+    }
+    else {
+      return false;
+    }
+    return true;
+  }
+
+  //--------------------------------------------------------------------------
+  static void Unpack(const TrainingRecord& record, Sample& sample) {
+    sample.fen.clear();
+    sample.position = record.position;
+    sample.blackToMove = ((record.position.flags & ColorMask) == Black);
+    sample.result = ((record.result > 0) ? 1.0 :
+                     (record.result < 0) ? 0.0 : 0.5);
+    if (sample.blackToMove) {
+      sample.result = (1.0 - sample.result);
+    }
+  }
+
+  FILE*         fp;
+  RecordReader  records; // used instead of fp for binary datasets
+  bool          binary;
+  uint64_t      skipped; // guarded by lock
+  senjo::Mutex  lock;
+};
+
+//----------------------------------------------------------------------------
+struct Score {
+  int    score;  // white's point of view
+  double result;
+};
+
+//----------------------------------------------------------------------------
+// one thread and one engine context per worker, reused for every pass
+//----------------------------------------------------------------------------
+struct Worker {
+  Worker() : reader(NULL), scores(NULL), error(0), count(0), k(0) {
+    // hash table entries would go stale every time a parameter changes
+    engine.SetOption("Hash", "0");
+  }
+
+  SampleReader*       reader;
+  std::vector<Score>* scores;  // collect scores here if not NULL
+  double              error;
+  uint64_t            count;
+  double              k;
+  Engine              engine;
+  senjo::Thread       thread;
+};
+
+//----------------------------------------------------------------------------
+static inline double Sigmoid(const double k, const int score)
+{
+  return (1.0 / (1.0 + pow(10.0, ((-k * score) / 400.0))));
+}
+
+//----------------------------------------------------------------------------
+static void RunWorker(void* data)
+{
+  Worker& worker = *static_cast<Worker*>(data);
+  std::vector<Sample> batch;
+  worker.error = 0;
+  worker.count = 0;
+  while (worker.reader->Next(batch)) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      const Sample& sample = batch[i];
+      if (!(sample.fen.empty() ? worker.engine.SetPosition(sample.position)
+                               : worker.engine.SetPosition(sample.fen)))
+      {
+        continue;
+      }
+      int score = worker.engine.QSearch();
+      if (sample.blackToMove) {
+        score = -score;
+      }
+      if (worker.scores) {
+        Score s = { score, sample.result };
+        worker.scores->push_back(s);
+      }
+      const double diff = (sample.result - Sigmoid(worker.k, score));
+      worker.error += (diff * diff);
+      worker.count++;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+static bool WriteParams(const std::string& fileName)
+{
+  FILE* fp = fopen(fileName.c_str(), "w");
+  if (!fp) {
+    fprintf(stderr, "Cannot open '%s': %s\n", fileName.c_str(),
+            strerror(errno));
+    return false;
+  }
+  Bitfoot::PrintEvalParams(fp);
+  fclose(fp);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+class Tuner
+{
+public:
+  Tuner(const int threads)
+    : k(0),
+      count(0)
+  {
+    for (int i = 0; i < threads; ++i) {
+      Worker* worker = new Worker();
+      worker->reader = &reader;
+      workers.push_back(worker);
+    }
+  }
+
+  ~Tuner() {
+    for (size_t i = 0; i < workers.size(); ++i) {
+      delete workers[i];
+    }
+  }
+
+  bool Open(const std::string& fileName, const bool binary) {
+    return reader.Open(fileName, binary);
+  }
+
+  //--------------------------------------------------------------------------
+  // mean squared error over the whole dataset with the current parameters
+  //--------------------------------------------------------------------------
+  double Error(std::vector<Score>* scores = NULL) {
+    reader.Rewind();
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i]->k = k;
+      workers[i]->scores = (scores ? &perThread[i] : NULL);
+      workers[i]->thread.Start(RunWorker, workers[i]);
+    }
+    double error = 0;
+    count = 0;
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i]->thread.Join();
+      error += workers[i]->error;
+      count += workers[i]->count;
+      if (scores) {
+        scores->insert(scores->end(), perThread[i].begin(),
+                       perThread[i].end());
+        perThread[i].clear();
+      }
+    }
+    return (count ? (error / count) : 0);
+  }
+
+  //--------------------------------------------------------------------------
+  // the scaling constant that best fits the current evaluation, the scores
+  // don't depend on K so only one pass over the dataset is needed
+  //--------------------------------------------------------------------------
+  void FitK() {
+    std::vector<Score> scores;
+    perThread.assign(workers.size(), std::vector<Score>());
+    Error(&scores);
+
+    double lo = 0.0;
+    double hi = 4.0;
+    for (int i = 0; i < 100; ++i) {
+      const double a = (lo + ((hi - lo) / 3));
+      const double b = (hi - ((hi - lo) / 3));
+      if (Error(scores, a) < Error(scores, b)) {
+        hi = b;
+      }
+      else {
+        lo = a;
+      }
+    }
+    k = ((lo + hi) / 2);
+  }
+
+  //--------------------------------------------------------------------------
+  // adjust 'params' by 'step' until none of them can lower the error,
+  // 'outName' (if not empty) gets the tuned values after every improving
+  // iteration so an interrupted run isn't wasted
+  //--------------------------------------------------------------------------
+  void Run(std::vector<EvalParam>& params, const int step,
+           const int maxIterations, const std::string& outName)
+  {
+    double best = Error();
+    printf("%" PRIu64 " positions (%" PRIu64 " skipped), K %.4f, "
+           "error %.8f\n", count, reader.Skipped(), k, best);
+    fflush(stdout);
+
+    for (int iteration = 1;
+         !maxIterations || (iteration <= maxIterations);
+         ++iteration)
+    {
+      int improved = 0;
+      for (size_t i = 0; i < params.size(); ++i) {
+        EvalParam& param = params[i];
+        const int value = param.Get();
+        double error;
+
+        param.Set(value + step);
+        if ((error = Error()) < best) {
+          best = error;
+          improved++;
+          continue;
+        }
+
+        param.Set(value - step);
+        if ((error = Error()) < best) {
+          best = error;
+          improved++;
+          continue;
+        }
+
+        param.Set(value);
+      }
+
+      printf("iteration %d: %d changed, error %.8f\n", iteration, improved,
+             best);
+      fflush(stdout);
+
+      if (!improved) {
+        break;
+      }
+      if (outName.size()) {
+        WriteParams(outName);
+      }
+    }
+  }
+
+  double GetK() const {
+    return k;
+  }
+
+  void SetK(const double value) {
+    k = value;
+  }
+
+private:
+  //--------------------------------------------------------------------------
+  static double Error(const std::vector<Score>& scores, const double k) {
+    double error = 0;
+    for (size_t i = 0; i < scores.size(); ++i) {
+      const double diff = (scores[i].result - Sigmoid(k, scores[i].score));
+      error += (diff * diff);
+    }
+    return (scores.empty() ? 0 : (error / scores.size()));
+  }
+
+  double                          k;
+  uint64_t                        count;
+  SampleReader                    reader;
+  std::vector<Worker*>            workers;
+  std::vector<std::vector<Score>> perThread;
+};
+
+//----------------------------------------------------------------------------
+static void Usage(const char* name)
+{
+  fprintf(stderr, "usage: %s <epd file> [--binary] [--threads <n>] "
+          "[--k <x>] [--step <n>] [--iterations <n>] [--only <prefix>] "
+          "[--out <file>] [--list]\n", name);
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  const std::string fileName = argv[1];
+  int threads = static_cast<int>(std::thread::hardware_concurrency());
+  int step = 1;
+  int iterations = 0;
+  double k = 0;
+  bool list = false;
+  bool binary = false;
+  std::string only;
+  std::string outName;
+
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if ((arg == "--threads") && ((i + 1) < argc)) {
+      threads = atoi(argv[++i]);
+    }
+    else if ((arg == "--k") && ((i + 1) < argc)) {
+      k = atof(argv[++i]);
+    }
+    else if ((arg == "--step") && ((i + 1) < argc)) {
+      step = atoi(argv[++i]);
+    }
+    else if ((arg == "--iterations") && ((i + 1) < argc)) {
+      iterations = atoi(argv[++i]);
+    }
+    else if ((arg == "--only") && ((i + 1) < argc)) {
+      only = argv[++i];
+    }
+    else if ((arg == "--out") && ((i + 1) < argc)) {
+      outName = argv[++i];
+    }
+    else if (arg == "--list") {
+      list = true;
+    }
+    else if (arg == "--binary") {
+      binary = true;
+    }
+    else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // parameters whose names start with any of the comma separated prefixes
+  std::vector<EvalParam> all;
+  std::vector<EvalParam> params;
+  Bitfoot::GetEvalParams(all);
+  for (size_t i = 0; i < all.size(); ++i) {
+    bool match = only.empty();
+    for (size_t pos = 0; !match && (pos != std::string::npos); ) {
+      const size_t end = only.find(',', pos);
+      const std::string prefix = only.substr(pos, (end - pos));
+      match = (!prefix.empty() && !all[i].name.compare(0, prefix.size(),
+                                                       prefix));
+      pos = ((end == std::string::npos) ? end : (end + 1));
+    }
+    if (match) {
+      params.push_back(all[i]);
+    }
+  }
+  if (list) {
+    for (size_t i = 0; i < params.size(); ++i) {
+      printf("%s = %d\n", params[i].name.c_str(), params[i].Get());
+    }
+    return 0;
+  }
+  if (params.empty()) {
+    fprintf(stderr, "No parameters match '%s'\n", only.c_str());
+    return 1;
+  }
+
+  Tuner tuner(std::max<int>(1, threads));
+  if (!tuner.Open(fileName, binary)) {
+    return 1;
+  }
+
+  if (outName.size() && !WriteParams(outName)) {
+    return 1;
+  }
+
+  if (k > 0) {
+    tuner.SetK(k);
+  }
+  else {
+    tuner.FitK();
+  }
+
+  printf("tuning %d parameters on %d threads\n",
+         static_cast<int>(params.size()), std::max<int>(1, threads));
+  tuner.Run(params, std::max<int>(1, step), iterations, outName);
+
+  if (outName.size()) {
+    return (WriteParams(outName) ? 0 : 1);
+  }
+  Bitfoot::PrintEvalParams(stdout);
+  return 0;
+}